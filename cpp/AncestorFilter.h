@@ -0,0 +1,80 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include "StyleElement.h"
+
+/**
+ * A counting Bloom filter of the types, ids and classes of the ancestors of the element being
+ * styled, maintained as the tree is walked. A selector whose ancestor compounds have a key the
+ * filter doesn't contain can't match, so it's rejected without walking up the tree. The filter
+ * may contain keys it hasn't been given, never the other way round.
+ */
+class AncestorFilter {
+public:
+    static constexpr uint32_t TYPE_KEY = 1;
+    static constexpr uint32_t ID_KEY = 2;
+    static constexpr uint32_t CLASS_KEY = 3;
+
+    AncestorFilter() { std::memset(mCounters, 0, sizeof(mCounters)); }
+
+    /**
+     * @return the hash of the key of an atom, e.g. hash(CLASS_KEY, atom) for a class
+     */
+    static uint32_t hash(uint32_t kind, int atom) {
+        uint32_t hash = static_cast<uint32_t>(atom) * 0x9E3779B1u + kind * 0x85EBCA6Bu;
+        return hash ^ (hash >> 15);
+    }
+
+    /**
+     * Adds the keys of the element, entered by the walk.
+     */
+    void push(const StyleElement& element) { update(element, 1); }
+
+    /**
+     * Removes the keys of the element, left by the walk.
+     */
+    void pop(const StyleElement& element) { update(element, -1); }
+
+    bool mayContain(uint32_t hash) const {
+        return mCounters[hash & KEY_MASK] != 0 && mCounters[(hash >> KEY_BITS) & KEY_MASK] != 0;
+    }
+
+private:
+    static constexpr int KEY_BITS = 12;
+    static constexpr uint32_t KEY_MASK = (1u << KEY_BITS) - 1;
+    /** A counter which has reached the maximum sticks to it, as its count is lost */
+    static constexpr uint8_t MAX_COUNT = 0xFF;
+
+    uint8_t mCounters[1u << KEY_BITS];
+
+    void update(const StyleElement& element, int delta) {
+        if (element.getType() != AtomTable::NONE) {
+            update(hash(TYPE_KEY, element.getType()), delta);
+        }
+        if (element.getId() != AtomTable::NONE) {
+            update(hash(ID_KEY, element.getId()), delta);
+        }
+        for (int cssClass : element.getClasses()) {
+            update(hash(CLASS_KEY, cssClass), delta);
+        }
+    }
+
+    void update(uint32_t hash, int delta) {
+        updateCounter(mCounters[hash & KEY_MASK], delta);
+        updateCounter(mCounters[(hash >> KEY_BITS) & KEY_MASK], delta);
+    }
+
+    static void updateCounter(uint8_t& counter, int delta) {
+        if (counter != MAX_COUNT) {
+            counter = static_cast<uint8_t>(counter + delta);
+        }
+    }
+};
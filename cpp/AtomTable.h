@@ -0,0 +1,51 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Maps the names of the types, ids and classes to small integers, so that selectors and
+ * elements compare and hash them as numbers. The selectors and the elements they are matched
+ * against have to use the same table.
+ */
+class AtomTable {
+public:
+    static constexpr int NONE = -1;
+
+    /**
+     * @return the atom of the name, added if it's new
+     */
+    int intern(const std::string& name) {
+        auto it = mAtoms.find(name);
+        if (it != mAtoms.end()) {
+            return it->second;
+        }
+        int atom = static_cast<int>(mNames.size());
+        mAtoms.emplace(name, atom);
+        mNames.push_back(name);
+        return atom;
+    }
+
+    /**
+     * @return the atom of the name, or {@link #NONE} if it hasn't been interned
+     */
+    int find(const std::string& name) const {
+        auto it = mAtoms.find(name);
+        return it != mAtoms.end() ? it->second : NONE;
+    }
+
+    const std::string& getName(int atom) const { return mNames[atom]; }
+
+private:
+    std::unordered_map<std::string, int> mAtoms;
+
+    std::vector<std::string> mNames;
+};
@@ -0,0 +1,70 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include "ChildList.h"
+
+void ChildList::insert(int index, Item* item) {
+    if (mSize == static_cast<int>(mSlots.size())) {
+        grow();
+    }
+    if (index < mSize / 2) {
+        // The children before the index move one slot towards the front.
+        mHead = (mHead - 1) & mMask;
+        for (int i = 0; i < index; i++) {
+            set(i, get(i + 1));
+        }
+    } else {
+        // The children from the index move one slot towards the back.
+        for (int i = mSize; i > index; i--) {
+            set(i, get(i - 1));
+        }
+    }
+    set(index, item);
+    mSize++;
+}
+
+Item* ChildList::removeAt(int index) {
+    Item* item = get(index);
+    item->mChildSlot = -1;
+    if (index < mSize / 2) {
+        // The children before the index move one slot towards the back.
+        for (int i = index; i > 0; i--) {
+            set(i, get(i - 1));
+        }
+        mSlots[mHead] = nullptr;
+        mHead = (mHead + 1) & mMask;
+    } else {
+        // The children after the index move one slot towards the front.
+        for (int i = index; i < mSize - 1; i++) {
+            set(i, get(i + 1));
+        }
+        mSlots[(mHead + mSize - 1) & mMask] = nullptr;
+    }
+    mSize--;
+    return item;
+}
+
+void ChildList::clear() {
+    forEach([](Item* child) { child->mChildSlot = -1; });
+    mSlots.clear();
+    mMask = -1;
+    mHead = 0;
+    mSize = 0;
+}
+
+void ChildList::grow() {
+    int capacity = mSlots.empty() ? INITIAL_CAPACITY : static_cast<int>(mSlots.size()) * 2;
+    std::vector<Item*> slots(capacity, nullptr);
+    for (int i = 0; i < mSize; i++) {
+        Item* child = get(i);
+        slots[i] = child;
+        child->mChildSlot = i;
+    }
+    mSlots.swap(slots);
+    mMask = capacity - 1;
+    mHead = 0;
+}
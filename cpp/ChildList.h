@@ -0,0 +1,108 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#pragma once
+
+#include <vector>
+#include "Item.h"
+
+/**
+ * The children of a container, stored in a ring buffer: adding or removing a child at either
+ * end, e.g. a list to which items are prepended while the oldest ones are removed, doesn't move
+ * the other children, and a mutation inside the list only shifts the children on its shorter
+ * side. Each child keeps the slot it is stored in, which gives its index without a search.
+ */
+class ChildList {
+public:
+    static constexpr int INITIAL_CAPACITY = 8;
+
+    /**
+     * @return the number of children
+     */
+    int size() const { return mSize; }
+
+    /**
+     * @param index the index of the child, between 0 and {@link #size()} excluded
+     * @return the child at the index
+     */
+    Item* get(int index) const { return mSlots[(mHead + index) & mMask]; }
+
+    /**
+     * Returns the index of the given child in constant time.
+     *
+     * @param item the child
+     * @return the index of the child, or -1 if it isn't in this list
+     */
+    int indexOf(const Item* item) const {
+        int slot = item->mChildSlot;
+        if (slot < 0 || slot >= static_cast<int>(mSlots.size()) || mSlots[slot] != item) {
+            return -1;
+        }
+        return (slot - mHead) & mMask;
+    }
+
+    /**
+     * Inserts the item at the given index.
+     *
+     * @param index the index, between 0 and {@link #size()} included
+     * @param item  the item to insert
+     */
+    void insert(int index, Item* item);
+
+    /**
+     * Removes the child at the given index.
+     *
+     * @param index the index of the child
+     * @return the removed child
+     */
+    Item* removeAt(int index);
+
+    /**
+     * Removes all the children.
+     */
+    void clear();
+
+    /**
+     * Calls the function with each child, in order.
+     *
+     * @param function the function to call
+     */
+    template<typename Function>
+    void forEach(Function function) const {
+        for (int i = 0; i < mSize; i++) {
+            function(get(i));
+        }
+    }
+
+private:
+    /**
+     * The slots, whose number is a power of two so that positions wrap around with a mask.
+     * The free slots are null.
+     */
+    std::vector<Item*> mSlots;
+    int mMask = -1;
+
+    /**
+     * The slot of the first child and the number of children.
+     */
+    int mHead = 0;
+    int mSize = 0;
+
+    /**
+     * Stores the child at the given index of the list, without changing the size.
+     */
+    void set(int index, Item* child) {
+        int slot = (mHead + index) & mMask;
+        mSlots[slot] = child;
+        child->mChildSlot = slot;
+    }
+
+    /**
+     * Doubles the number of slots, the children are stored from the first one.
+     */
+    void grow();
+};
@@ -175,3 +175,13 @@ struct JustifyContent {
      */
     static constexpr int SPACE_EVENLY = 5;
 };
+
+/** The intrinsic sizes of an item, see {@link Item#getIntrinsicWidth(int)}. */
+struct IntrinsicSize {
+
+    /** The smallest size the content can take without overflowing, e.g. each item on its own line. */
+    static constexpr int MIN_CONTENT = 0;
+
+    /** The size the content takes when it has all the space it wants, e.g. all items on one line. */
+    static constexpr int MAX_CONTENT = 1;
+};
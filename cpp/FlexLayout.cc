@@ -5,12 +5,51 @@
  * found in the LICENSE file.
  */
 
+#include <algorithm>
 #include <stdexcept>
 #include "FlexLayout.h"
+#include "ItemArena.h"
 
 FlexLayout::FlexLayout() : mFlexboxHelper(this) {
 }
 
+FlexLayout::FlexLayout(const FlexLayout& prototype)
+        : Layout(prototype),
+          mFlexDirection(prototype.mFlexDirection),
+          mFlexWrap(prototype.mFlexWrap),
+          mJustifyContent(prototype.mJustifyContent),
+          mAlignItems(prototype.mAlignItems),
+          mAlignContent(prototype.mAlignContent),
+          mMaxLine(prototype.mMaxLine),
+          mFlexboxHelper(this) {
+}
+
+Item* FlexLayout::cloneItem(ItemArena* arena) const {
+    return arena != nullptr ? arena->copy(*this) : new FlexLayout(*this);
+}
+
+bool FlexLayout::copyAttributes(const Item& prototype) {
+    const FlexLayout& flexLayout = static_cast<const FlexLayout&>(prototype);
+    bool changed = Layout::copyAttributes(prototype);
+    changed |= assignAttribute(mFlexDirection, flexLayout.mFlexDirection);
+    changed |= assignAttribute(mFlexWrap, flexLayout.mFlexWrap);
+    changed |= assignAttribute(mJustifyContent, flexLayout.mJustifyContent);
+    changed |= assignAttribute(mAlignItems, flexLayout.mAlignItems);
+    changed |= assignAttribute(mAlignContent, flexLayout.mAlignContent);
+    changed |= assignAttribute(mMaxLine, flexLayout.mMaxLine);
+    return changed;
+}
+
+int FlexLayout::computeIntrinsicSize(bool horizontal, int intrinsicSize) {
+    // With the min-content main size each item of a multi-line container is on a line of its
+    // own, with the max-content one they all are on the same line.
+    bool stacked = mFlexWrap != FlexWrap::NOWRAP && intrinsicSize == IntrinsicSize::MIN_CONTENT;
+    bool mainAxis = horizontal == isMainAxisDirectionHorizontal();
+    int content = mainAxis != stacked ? sumChildIntrinsicSizes(horizontal, intrinsicSize, 0)
+                                      : maxChildIntrinsicSize(horizontal, intrinsicSize);
+    return content + (horizontal ? getPaddingLeft() + getPaddingRight() : getPaddingTop() + getPaddingBottom());
+}
+
 void FlexLayout::onMeasure(int widthMeasureSpec, int heightMeasureSpec) {
     switch (mFlexDirection) {
         case FlexDirection::ROW: // Intentional fall through
@@ -31,11 +70,15 @@ void FlexLayout::measureHorizontal(int widthMeasureSpec, int heightMeasureSpec)
     mFlexLines.clear();
 
     mFlexLinesResult.reset();
+    int fromIndex = retainFlexLines(widthMeasureSpec, heightMeasureSpec, mRetainedFlexLines);
     mFlexboxHelper.calculateHorizontalFlexLines(mFlexLinesResult, widthMeasureSpec,
-                                                heightMeasureSpec);
-    mFlexLines = mFlexLinesResult.mFlexLines;
+                                                heightMeasureSpec, INT_MAX, fromIndex, &mRetainedFlexLines);
+    updateCalculatedFlexLines();
+
+    mFlexboxHelper.determineMainSize(widthMeasureSpec, heightMeasureSpec, fromIndex);
+    mMainSizedFlexLines = mFlexLines;
 
-    mFlexboxHelper.determineMainSize(widthMeasureSpec, heightMeasureSpec);
+    updateFlexLineBaselines();
 
     mFlexboxHelper.determineCrossSize(widthMeasureSpec, heightMeasureSpec,
                                       getPaddingTop() + getPaddingBottom());
@@ -44,16 +87,19 @@ void FlexLayout::measureHorizontal(int widthMeasureSpec, int heightMeasureSpec)
     mFlexboxHelper.stretchViews();
     setMeasuredDimensionForFlex(mFlexDirection, widthMeasureSpec, heightMeasureSpec,
                                 mFlexLinesResult.mChildState);
+    setMeasuredBaseline(computeBaseline());
 }
 
 void FlexLayout::measureVertical(int widthMeasureSpec, int heightMeasureSpec) {
     mFlexLines.clear();
     mFlexLinesResult.reset();
+    int fromIndex = retainFlexLines(widthMeasureSpec, heightMeasureSpec, mRetainedFlexLines);
     mFlexboxHelper.calculateVerticalFlexLines(mFlexLinesResult, widthMeasureSpec,
-                                              heightMeasureSpec);
-    mFlexLines = mFlexLinesResult.mFlexLines;
+                                              heightMeasureSpec, INT_MAX, fromIndex, &mRetainedFlexLines);
+    updateCalculatedFlexLines();
 
-    mFlexboxHelper.determineMainSize(widthMeasureSpec, heightMeasureSpec);
+    mFlexboxHelper.determineMainSize(widthMeasureSpec, heightMeasureSpec, fromIndex);
+    mMainSizedFlexLines = mFlexLines;
     mFlexboxHelper.determineCrossSize(widthMeasureSpec, heightMeasureSpec,
                                       getPaddingLeft() + getPaddingRight());
     // Now cross size for each flex line is determined.
@@ -61,6 +107,174 @@ void FlexLayout::measureVertical(int widthMeasureSpec, int heightMeasureSpec) {
     mFlexboxHelper.stretchViews();
     setMeasuredDimensionForFlex(mFlexDirection, widthMeasureSpec, heightMeasureSpec,
                                 mFlexLinesResult.mChildState);
+    setMeasuredBaseline(computeBaseline());
+}
+
+void FlexLayout::updateFlexLineBaselines() {
+    bool wrapReverse = mFlexWrap == FlexWrap::WRAP_REVERSE;
+    for (auto& flexLine : mFlexLines) {
+        flexLine.mMaxBaseline = 0;
+        for (int i = 0; i < flexLine.mItemCount; i++) {
+            Item* child = getFlexItemAt(flexLine.mFirstIndex + i);
+            if (child == nullptr || child->getVisibility() == Item::GONE) {
+                continue;
+            }
+            // As in FlexboxHelper#calculateFlexLines.
+            flexLine.mMaxBaseline = std::max(flexLine.mMaxBaseline,
+                                             wrapReverse
+                                             ? child->getMeasuredHeight() - child->getBaseline() + child->getMarginBottom()
+                                             : child->getBaseline() + child->getMarginTop());
+        }
+        if (mAlignItems != AlignItems::BASELINE) {
+            continue;
+        }
+        int largestHeightInLine = INT_MIN;
+        for (int i = 0; i < flexLine.mItemCount; i++) {
+            Item* child = getFlexItemAt(flexLine.mFirstIndex + i);
+            if (child == nullptr || child->getVisibility() == Item::GONE) {
+                continue;
+            }
+            // The margins are stretched to put the baselines on the one of the line.
+            int height;
+            if (!wrapReverse) {
+                int marginTop = std::max(flexLine.mMaxBaseline - child->getBaseline(), child->getMarginTop());
+                height = child->getMeasuredHeight() + marginTop + child->getMarginBottom();
+            } else {
+                int marginBottom = std::max(flexLine.mMaxBaseline - child->getMeasuredHeight() + child->getBaseline(),
+                                            child->getMarginBottom());
+                height = child->getMeasuredHeight() + child->getMarginTop() + marginBottom;
+            }
+            largestHeightInLine = std::max(largestHeightInLine, height);
+        }
+        if (largestHeightInLine != INT_MIN) {
+            flexLine.mCrossSize = largestHeightInLine;
+        }
+    }
+}
+
+int FlexLayout::computeBaseline() {
+    if (mFlexLines.empty()) {
+        return 0;
+    }
+    const FlexLine& flexLine = mFlexLines[0];
+    bool wrapReverse = mFlexWrap == FlexWrap::WRAP_REVERSE;
+    Item* first = nullptr;
+    int firstAlign = 0;
+    for (int i = 0; i < flexLine.mItemCount; i++) {
+        Item* child = getFlexItemAt(flexLine.mFirstIndex + i);
+        if (child == nullptr || child->getVisibility() == Item::GONE) {
+            continue;
+        }
+        if (!isMainAxisDirectionHorizontal()) {
+            // The first item of a column, at its main start.
+            return getPaddingTop() + child->getMarginTop() + child->getBaseline();
+        }
+        int alignSelf = child->getAlignSelf() != AlignSelf::AUTO ? child->getAlignSelf() : mAlignItems;
+        if (alignSelf == AlignItems::BASELINE) {
+            // The baseline shared by the line, see FlexboxHelper#layoutSingleChildHorizontal.
+            return wrapReverse ? getMeasuredHeight() - getPaddingBottom() - flexLine.mMaxBaseline
+                               : getPaddingTop() + flexLine.mMaxBaseline;
+        }
+        if (first == nullptr) {
+            first = child;
+            firstAlign = alignSelf;
+        }
+    }
+    if (first == nullptr) {
+        return 0;
+    }
+    int crossSize = flexLine.mCrossSize;
+    int height = first->getMeasuredHeight();
+    int marginTop = first->getMarginTop();
+    int marginBottom = first->getMarginBottom();
+    // The top of the item in the line, as laid out by FlexboxHelper#layoutSingleChildHorizontal.
+    int top;
+    switch (firstAlign) {
+        case AlignItems::FLEX_END:
+            top = wrapReverse ? marginTop : crossSize - height - marginBottom;
+            break;
+        case AlignItems::CENTER:
+            top = (crossSize - height + marginTop - marginBottom) / 2;
+            if (wrapReverse) {
+                top = crossSize - height - top;
+            }
+            break;
+        default:
+            top = wrapReverse ? crossSize - height - marginBottom : marginTop;
+            break;
+    }
+    int lineTop = wrapReverse ? getMeasuredHeight() - getPaddingBottom() - crossSize : getPaddingTop();
+    return lineTop + top + first->getBaseline();
+}
+
+int FlexLayout::retainFlexLines(int widthMeasureSpec, int heightMeasureSpec,
+                                std::vector<FlexLine>& retainedLines) {
+    retainedLines.clear();
+    int firstChangedChild = consumeFirstChangedChild();
+    updateReorderedChildren();
+    // The lines of the last measure index the flex items in the order they had then.
+    bool reordered = mChildrenReordered || mFlexLinesReordered;
+    mFlexLinesReordered = mChildrenReordered;
+    bool sameSpecs = widthMeasureSpec == mLastWidthMeasureSpec && heightMeasureSpec == mLastHeightMeasureSpec;
+    mLastWidthMeasureSpec = widthMeasureSpec;
+    mLastHeightMeasureSpec = heightMeasureSpec;
+
+    // The free space of a line depends on the other lines unless the main size is exact, and the
+    // changed indices are the ones of the children, not of the reordered flex items.
+    int mainMeasureSpec = isMainAxisDirectionHorizontal() ? widthMeasureSpec : heightMeasureSpec;
+    if (!sameSpecs || reordered || MeasureSpec::getMode(mainMeasureSpec) != MeasureSpec::EXACTLY) {
+        return 0;
+    }
+    int fromIndex = 0;
+    for (const auto& flexLine : mCalculatedFlexLines) {
+        // The item after the line decides whether it wraps, so it has to be unchanged too.
+        if (flexLine.mLastIndex + 1 >= firstChangedChild) {
+            break;
+        }
+        retainedLines.emplace_back(flexLine);
+        fromIndex = flexLine.mLastIndex + 1;
+    }
+    for (int i = 0; i < fromIndex; i++) {
+        reuseChildMeasures(getFlexItemAt(i));
+    }
+    return fromIndex;
+}
+
+void FlexLayout::updateCalculatedFlexLines() {
+    mCalculatedFlexLines = mFlexLinesResult.mFlexLines;
+    mFlexLines = mFlexLinesResult.mFlexLines;
+    std::copy(mMainSizedFlexLines.cbegin(), mMainSizedFlexLines.cbegin() + mRetainedFlexLines.size(),
+              mFlexLines.begin());
+}
+
+size_t FlexLayout::computeLayoutHash() const {
+    size_t hash = Layout::computeLayoutHash();
+    for (int value : {mFlexDirection, mFlexWrap, mJustifyContent, mAlignItems, mAlignContent, mMaxLine}) {
+        hash = hashCombine(hash, value);
+    }
+    return hash;
+}
+
+bool FlexLayout::isChildBaselineUsed(const Item* child) {
+    int alignSelf = child->getAlignSelf() != AlignSelf::AUTO ? child->getAlignSelf() : mAlignItems;
+    if (isMainAxisDirectionHorizontal() && alignSelf == AlignItems::BASELINE) {
+        return true;
+    }
+    // The baseline of the container is taken from the items of its first line, in the order
+    // they were measured in.
+    if (mFlexLines.empty()) {
+        return false;
+    }
+    const FlexLine& flexLine = mFlexLines[0];
+    int end = std::min(flexLine.mFirstIndex + flexLine.mItemCount, static_cast<int>(mReorderedChildren.size()));
+    return std::find(mReorderedChildren.begin() + std::min(flexLine.mFirstIndex, end),
+                     mReorderedChildren.begin() + end, child) != mReorderedChildren.begin() + end;
+}
+
+void FlexLayout::copyMeasuredState(const Item& source) {
+    Layout::copyMeasuredState(source);
+    mFlexLines = static_cast<const FlexLayout&>(source).mFlexLines;
+    updateReorderedChildren();
 }
 
 int FlexLayout::getSumOfCrossSize() {
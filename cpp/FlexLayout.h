@@ -16,14 +16,35 @@
 #include "Layout.h"
 
 class FlexLayout : public Layout {
+    friend class TreeFormat;
+    friend class LayoutSnapshot;
+
 public:
     FlexLayout();
 
+    /**
+     * Copies the attributes of the prototype but not its children, see
+     * {@link Item#cloneSubtree(ItemArena*)}.
+     */
+    FlexLayout(const FlexLayout& prototype);
+
 protected:
     void onMeasure(int widthMeasureSpec, int heightMeasureSpec) override;
 
     void onLayout(bool changed, int left, int top, int right, int bottom) override;
 
+    size_t computeLayoutHash() const override;
+
+    bool isChildBaselineUsed(const Item* child) override;
+
+    void copyMeasuredState(const Item& source) override;
+
+    Item* cloneItem(ItemArena* arena) const override;
+
+    bool copyAttributes(const Item& prototype) override;
+
+    int computeIntrinsicSize(bool horizontal, int intrinsicSize) override;
+
 private:
     /**
      * The current value of the {@link FlexDirection}, the default value is {@link
@@ -71,6 +92,58 @@ private:
 
     FlexboxHelper mFlexboxHelper;
 
+    /**
+     * The children sorted by their order attribute, sorted again only when a child has been
+     * added or removed or has changed its order.
+     */
+    std::vector<Item*> mReorderedChildren;
+
+    /**
+     * True if the order of {@link #mReorderedChildren} differs from the order of the children.
+     */
+    bool mChildrenReordered = false;
+
+    /**
+     * The value of {@link #mChildrenReordered} when the flex lines were calculated.
+     */
+    bool mFlexLinesReordered = false;
+
+    /**
+     * The flex lines of the last measure as calculated, then once their main size has been
+     * determined, before the cross size step adjusts them, and the specs of that measure. When
+     * measured again with the same exact main size, the lines which end before the first changed
+     * child are reused: the calculated ones to resume the calculation, which depends on their
+     * cross size before the flexible lengths are resolved, and the main sized ones afterwards.
+     */
+    std::vector<FlexLine> mCalculatedFlexLines;
+    std::vector<FlexLine> mMainSizedFlexLines;
+    std::vector<FlexLine> mRetainedFlexLines;
+    int mLastWidthMeasureSpec = INT_MIN;
+    int mLastHeightMeasureSpec = INT_MIN;
+
+    /**
+     * Keeps the lines of the last measure which are not affected by the changes of the children
+     * since then and returns the index of the first child to measure.
+     *
+     * @param widthMeasureSpec  the horizontal space requirements as imposed by the parent
+     * @param heightMeasureSpec the vertical space requirements as imposed by the parent
+     * @param retainedLines     receives the lines to reuse
+     * @return the index of the first flex item which isn't in a retained line
+     */
+    int retainFlexLines(int widthMeasureSpec, int heightMeasureSpec, std::vector<FlexLine>& retainedLines);
+
+    /**
+     * Takes the lines calculated by the flexbox helper, the retained ones being replaced with
+     * their main sized versions.
+     */
+    void updateCalculatedFlexLines();
+
+    void updateReorderedChildren() {
+        if (consumeChildOrderChanged()) {
+            mChildrenReordered = mFlexboxHelper.createReorderedChildren(mReorderedChildren);
+        }
+    }
+
     std::vector<FlexLine> mFlexLines;
 
     /**
@@ -89,12 +162,16 @@ public:
     int getFlexItemCount() { return getChildCount(); }
 
     /**
-     * Returns a flex item as a View at the given index.
+     * Returns a flex item as a View at the given index, in the order the flex items are laid out.
      *
      * @param index the index
      * @return the view at the index
+     * @see Item#getOrder()
      */
-    Item* getFlexItemAt(int index) { return getChildAt(index); }
+    Item* getFlexItemAt(int index) {
+        updateReorderedChildren();
+        return mReorderedChildren[index];
+    }
 
 
     /**
@@ -109,7 +186,12 @@ public:
      * @param flexDirection the flex direction value
      * @see FlexDirection
      */
-    void setFlexDirection(int flexDirection) { mFlexDirection = flexDirection; }
+    void setFlexDirection(int flexDirection) {
+        if (mFlexDirection != flexDirection) {
+            mFlexDirection = flexDirection;
+            requestLayout();
+        }
+    }
 
     /**
      * @return the flex wrap attribute of the flex container.
@@ -123,7 +205,12 @@ public:
      * @param flexWrap the flex wrap value
      * @see FlexWrap
      */
-    void setFlexWrap(int flexWrap) { mFlexWrap = flexWrap; }
+    void setFlexWrap(int flexWrap) {
+        if (mFlexWrap != flexWrap) {
+            mFlexWrap = flexWrap;
+            requestLayout();
+        }
+    }
 
     /**
      * @return the justify content attribute of the flex container.
@@ -137,7 +224,12 @@ public:
      * @param justifyContent the justify content value
      * @see JustifyContent
      */
-    void setJustifyContent(int justifyContent) { mJustifyContent = justifyContent; }
+    void setJustifyContent(int justifyContent) {
+        if (mJustifyContent != justifyContent) {
+            mJustifyContent = justifyContent;
+            requestLayout();
+        }
+    }
 
     /**
      * @return the align content attribute of the flex container.
@@ -150,7 +242,12 @@ public:
      *
      * @param alignContent the align content value
      */
-    void setAlignContent(int alignContent) { mAlignContent = alignContent; }
+    void setAlignContent(int alignContent) {
+        if (mAlignContent != alignContent) {
+            mAlignContent = alignContent;
+            requestLayout();
+        }
+    }
 
     /**
      * @return the align items attribute of the flex container.
@@ -164,7 +261,12 @@ public:
      * @param alignItems the align items value
      * @see AlignItems
      */
-    void setAlignItems(int alignItems) { mAlignItems = alignItems; }
+    void setAlignItems(int alignItems) {
+        if (mAlignItems != alignItems) {
+            mAlignItems = alignItems;
+            requestLayout();
+        }
+    }
 
     /**
      * @return the flex lines composing this flex container. The overridden method should return a
@@ -238,7 +340,12 @@ public:
      *
      * @param maxLine the int value, which specifies the maximum number of flex lines
      */
-    void setMaxLine(int maxLine) { mMaxLine = maxLine; }
+    void setMaxLine(int maxLine) {
+        if (mMaxLine != maxLine) {
+            mMaxLine = maxLine;
+            requestLayout();
+        }
+    }
 
     /**
      * @return the list of the flex lines including dummy flex lines (flex line that doesn't have
@@ -257,6 +364,23 @@ public:
 
     void measureHorizontal(int widthMeasureSpec, int heightMeasureSpec);
 
+    /**
+     * Computes the largest baseline of each line again from the sizes and baselines of its items
+     * once the main sizes are determined, since an item measured again, e.g. a text given less
+     * width, may change its baseline. For a container whose alignItems attribute is BASELINE,
+     * the cross size of each line is then set to fit its items aligned by their baselines.
+     */
+    void updateFlexLineBaselines();
+
+    /**
+     * Computes the baseline of the container from its first line: the baseline shared by the
+     * items aligned by their baselines in the line if there are any, otherwise the baseline of
+     * the first item. The lines are assumed to be packed at the cross start.
+     *
+     * @return the distance from the top of the container to its baseline
+     */
+    int computeBaseline();
+
     void measureVertical(int widthMeasureSpec, int heightMeasureSpec);
 
     void setMeasuredDimensionForFlex(int flexDirection, int widthMeasureSpec,
@@ -6,12 +6,19 @@
  */
 
 
+#include <algorithm>
 #include <stdexcept>
 #include "FlexboxHelper.h"
 #include "FlexLine.h"
 #include "Item.h"
 #include "FlexLayout.h"
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
 #define NO_POSITION -1
 
 void FlexboxHelper::calculateHorizontalFlexLines(FlexboxHelper::FlexLinesResult& result, int widthMeasureSpec,
@@ -27,11 +34,116 @@ void FlexboxHelper::calculateVerticalFlexLines(FlexboxHelper::FlexLinesResult& r
                        0, NO_POSITION, nullptr);
 }
 
+void FlexboxHelper::calculateHorizontalFlexLines(FlexboxHelper::FlexLinesResult& result, int widthMeasureSpec,
+                                                 int heightMeasureSpec, int needsCalcAmount, int fromIndex,
+                                                 std::vector<FlexLine>* existingLines) {
+    calculateFlexLines(result, widthMeasureSpec, heightMeasureSpec, needsCalcAmount,
+                       fromIndex, NO_POSITION, existingLines);
+}
+
+void FlexboxHelper::calculateVerticalFlexLines(FlexboxHelper::FlexLinesResult& result, int widthMeasureSpec,
+                                               int heightMeasureSpec, int needsCalcAmount, int fromIndex,
+                                               std::vector<FlexLine>* existingLines) {
+    calculateFlexLines(result, heightMeasureSpec, widthMeasureSpec, needsCalcAmount,
+                       fromIndex, NO_POSITION, existingLines);
+}
+
+bool FlexboxHelper::createReorderedChildren(std::vector<Item*>& reorderedChildren) {
+    int childCount = mFlexContainer->getChildCount();
+    reorderedChildren.resize(childCount);
+    if (childCount == 0) {
+        return false;
+    }
+    int minOrder = INT_MAX;
+    int maxOrder = INT_MIN;
+    bool sorted = true;
+    int previousOrder = INT_MIN;
+    for (int i = 0; i < childCount; i++) {
+        int order = mFlexContainer->getChildAt(i)->getOrder();
+        minOrder = std::min(minOrder, order);
+        maxOrder = std::max(maxOrder, order);
+        sorted = sorted && order >= previousOrder;
+        previousOrder = order;
+    }
+
+    if (sorted) {
+        // The common case, e.g. all the children have the default order.
+        for (int i = 0; i < childCount; i++) {
+            reorderedChildren[i] = mFlexContainer->getChildAt(i);
+        }
+    } else if (static_cast<long long>(maxOrder) - minOrder < MAX_COUNTING_SORT_RANGE) {
+        int range = maxOrder - minOrder + 1;
+        mOrderCounts.assign(range, 0);
+        for (int i = 0; i < childCount; i++) {
+            mOrderCounts[mFlexContainer->getChildAt(i)->getOrder() - minOrder]++;
+        }
+        // Turns the counts into the first position of each order.
+        int position = 0;
+        for (int& count : mOrderCounts) {
+            int next = position + count;
+            count = position;
+            position = next;
+        }
+        for (int i = 0; i < childCount; i++) {
+            Item* child = mFlexContainer->getChildAt(i);
+            reorderedChildren[mOrderCounts[child->getOrder() - minOrder]++] = child;
+        }
+    } else {
+        for (int i = 0; i < childCount; i++) {
+            reorderedChildren[i] = mFlexContainer->getChildAt(i);
+        }
+        std::stable_sort(reorderedChildren.begin(), reorderedChildren.end(),
+                         [](Item* a, Item* b) { return a->getOrder() < b->getOrder(); });
+    }
+    return !sorted;
+}
+
 static bool isLastFlexItem(int childIndex, int childCount,
                            FlexLine& flexLine) {
     return childIndex == childCount - 1 && flexLine.getItemCountNotGone() != 0;
 }
 
+/**
+ * The main axis spec of a child only depends on its own attributes and the padding of the
+ * container, so the specs of all the children from the given index are computed together.
+ */
+void FlexboxHelper::computeChildMainMeasureSpecs(int mainMeasureSpec, int fromIndex, bool isMainHorizontal) {
+    int mainMode = Item::MeasureSpec::getMode(mainMeasureSpec);
+    int mainSize = Item::MeasureSpec::getSize(mainMeasureSpec);
+    int mainPadding = getPaddingStartMain(isMainHorizontal) + getPaddingEndMain(isMainHorizontal);
+
+    int childCount = mFlexContainer->getFlexItemCount();
+    int count = std::max(0, childCount - fromIndex);
+    mChildMainSizes.resize(count);
+    mChildMainPaddings.resize(count);
+    mChildMainPercents.resize(count);
+    mChildMainMeasureSpecs.resize(childCount);
+    for (int i = 0; i < count; i++) {
+        Item* flexItem = mFlexContainer->getFlexItemAt(fromIndex + i);
+        if (flexItem == nullptr || flexItem->getVisibility() == Item::GONE) {
+            mChildMainSizes[i] = 0;
+            mChildMainPaddings[i] = 0;
+            mChildMainPercents[i] = 0;
+            continue;
+        }
+
+        int childMainSize = getFlexItemSizeMain(flexItem, isMainHorizontal);
+        if (flexItem->getFlexBasisPercent() != flexItem->FLEX_BASIS_PERCENT_DEFAULT
+            && mainMode == Item::MeasureSpec::EXACTLY) {
+            childMainSize = static_cast<int>(round(static_cast<float>(mainSize) * flexItem->getFlexBasisPercent()));
+            // Use the dimension from the layout if the mainMode is not
+            // MeasureSpec.EXACTLY even if any fraction value is set to
+            // layout_flexBasisPercent.
+        }
+        mChildMainSizes[i] = childMainSize;
+        mChildMainPaddings[i] = mainPadding + getFlexItemMarginStartMain(flexItem, isMainHorizontal)
+                                + getFlexItemMarginEndMain(flexItem, isMainHorizontal);
+        mChildMainPercents[i] = isMainHorizontal ? flexItem->getWidthPercent() : flexItem->getHeightPercent();
+    }
+    Layout::getChildMeasureSpecs(mainMeasureSpec, mChildMainPaddings.data(), mChildMainSizes.data(),
+                                 mChildMainPercents.data(), mChildMainMeasureSpecs.data() + fromIndex, count);
+}
+
 void
 FlexboxHelper::calculateFlexLines(FlexboxHelper::FlexLinesResult& result, int mainMeasureSpec, int crossMeasureSpec,
                                   int needsCalcAmount, int fromIndex, int toIndex, std::vector<FlexLine>* flexLines) {
@@ -43,8 +155,28 @@ FlexboxHelper::calculateFlexLines(FlexboxHelper::FlexLinesResult& result, int ma
 
     int childState = 0;
 
-    if (flexLines != nullptr) {
+    // The amount of cross size calculated in this method call.
+    int sumCrossSize = 0;
+
+    int childCount = mFlexContainer->getFlexItemCount();
+    mChildMeasuredStates.resize(childCount);
+    std::fill(mChildMeasuredStates.begin() + std::min(fromIndex, childCount), mChildMeasuredStates.end(), 0);
+    // The item at fromIndex wrapped after the last existing line, whose cross size is only
+    // used from the wrap on, as when the line is added by this method.
+    bool wrapAfterExistingLines = false;
+    int existingLineCrossSize = 0;
+    if (flexLines != nullptr && !flexLines->empty()) {
         result.mFlexLines.insert(result.mFlexLines.end(), flexLines->cbegin(), flexLines->cend());
+        // The items of the existing lines have been measured by a previous calculation.
+        for (const auto& existingLine : *flexLines) {
+            sumCrossSize += existingLine.mCrossSize;
+        }
+        existingLineCrossSize = flexLines->back().mCrossSize;
+        sumCrossSize -= existingLineCrossSize;
+        wrapAfterExistingLines = true;
+        for (int i = 0; i < fromIndex; i++) {
+            childState = Item::combineMeasuredStates(childState, mChildMeasuredStates[i]);
+        }
     }
 
     bool reachedToIndex = toIndex == NO_POSITION;
@@ -56,9 +188,6 @@ FlexboxHelper::calculateFlexLines(FlexboxHelper::FlexLinesResult& result, int ma
 
     int largestSizeInCross = INT_MIN;
 
-    // The amount of cross size calculated in this method call.
-    int sumCrossSize = 0;
-
     // The index of the view in the flex line.
     int indexInFlexLine = 0;
 
@@ -66,7 +195,8 @@ FlexboxHelper::calculateFlexLines(FlexboxHelper::FlexLinesResult& result, int ma
     flexLine.mFirstIndex = fromIndex;
     flexLine.mMainSize = mainPaddingStart + mainPaddingEnd;
 
-    int childCount = mFlexContainer->getFlexItemCount();
+    computeChildMainMeasureSpecs(mainMeasureSpec, fromIndex, isMainHorizontal);
+
     for (int i = fromIndex; i < childCount; i++) {
         Item* flexItem = mFlexContainer->getFlexItemAt(i);
 
@@ -88,24 +218,9 @@ FlexboxHelper::calculateFlexLines(FlexboxHelper::FlexLinesResult& result, int ma
             flexLine.mIndicesAlignSelfStretch.emplace_back(i);
         }
 
-        int childMainSize = getFlexItemSizeMain(flexItem, isMainHorizontal);
-
-        if (flexItem->getFlexBasisPercent() != flexItem->FLEX_BASIS_PERCENT_DEFAULT
-            && mainMode == Item::MeasureSpec::EXACTLY) {
-            childMainSize = static_cast<int>(round(static_cast<float>(mainSize) * flexItem->getFlexBasisPercent()));
-            // Use the dimension from the layout if the mainMode is not
-            // MeasureSpec.EXACTLY even if any fraction value is set to
-            // layout_flexBasisPercent.
-        }
-
-        int childMainMeasureSpec;
+        int childMainMeasureSpec = mChildMainMeasureSpecs[i];
         int childCrossMeasureSpec;
         if (isMainHorizontal) {
-            childMainMeasureSpec = mFlexContainer->getChildWidthMeasureSpec(mainMeasureSpec,
-                                                                            mainPaddingStart + mainPaddingEnd +
-                                                                            getFlexItemMarginStartMain(flexItem, true) +
-                                                                            getFlexItemMarginEndMain(flexItem, true),
-                                                                            childMainSize, flexItem->getWidthPercent());
             childCrossMeasureSpec = mFlexContainer->getChildHeightMeasureSpec(crossMeasureSpec,
                                                                               crossPaddingStart + crossPaddingEnd +
                                                                               getFlexItemMarginStartCross(flexItem,
@@ -126,13 +241,6 @@ FlexboxHelper::calculateFlexLines(FlexboxHelper::FlexLinesResult& result, int ma
                                                                              sumCrossSize,
                                                                              getFlexItemSizeCross(flexItem, false),
                                                                              flexItem->getWidthPercent());
-            childMainMeasureSpec = mFlexContainer->getChildHeightMeasureSpec(mainMeasureSpec,
-                                                                             mainPaddingStart + mainPaddingEnd +
-                                                                             getFlexItemMarginStartMain(flexItem,
-                                                                                                        false) +
-                                                                             getFlexItemMarginEndMain(flexItem, false),
-                                                                             childMainSize,
-                                                                             flexItem->getHeightPercent());
             flexItem->measure(childCrossMeasureSpec, childMainMeasureSpec);
             updateMeasureCache(i, childCrossMeasureSpec, childMainMeasureSpec, flexItem);
         }
@@ -146,14 +254,19 @@ FlexboxHelper::calculateFlexLines(FlexboxHelper::FlexLinesResult& result, int ma
         // less than the min width after the first measurement.
         checkSizeConstraints(flexItem, i);
 
-        childState = Item::combineMeasuredStates(childState, flexItem->getMeasuredState());
+        mChildMeasuredStates[i] = flexItem->getMeasuredState();
+        childState = Item::combineMeasuredStates(childState, mChildMeasuredStates[i]);
 
-        if (isWrapRequired(flexItem, mainMode, mainSize, flexLine.mMainSize,
-                           getViewMeasuredSizeMain(flexItem, isMainHorizontal)
-                           + getFlexItemMarginStartMain(flexItem, isMainHorizontal) +
-                           getFlexItemMarginEndMain(flexItem, isMainHorizontal),
-                           i, indexInFlexLine, result.mFlexLines.size())) {
-            if (flexLine.getItemCountNotGone() > 0) {
+        if (wrapAfterExistingLines
+            || isWrapRequired(flexItem, mainMode, mainSize, flexLine.mMainSize,
+                              getViewMeasuredSizeMain(flexItem, isMainHorizontal)
+                              + getFlexItemMarginStartMain(flexItem, isMainHorizontal) +
+                              getFlexItemMarginEndMain(flexItem, isMainHorizontal),
+                              i, indexInFlexLine, result.mFlexLines.size())) {
+            if (wrapAfterExistingLines) {
+                sumCrossSize += existingLineCrossSize;
+                wrapAfterExistingLines = false;
+            } else if (flexLine.getItemCountNotGone() > 0) {
                 addFlexLine(result.mFlexLines, flexLine, i > 0 ? i - 1 : 0, sumCrossSize);
                 sumCrossSize += flexLine.mCrossSize;
             }
@@ -368,11 +481,11 @@ void FlexboxHelper::determineMainSize(int widthMeasureSpec, int heightMeasureSpe
             throw std::invalid_argument("Invalid flex direction: " + std::to_string(flexDirection));
     }
 
-    int flexLineIndex = 0;
-    // if (mIndexToFlexLine != null) {
-    //     flexLineIndex = mIndexToFlexLine[fromIndex];
-    // }
     std::vector<FlexLine>& flexLines = mFlexContainer->getFlexLinesInternal();
+    int flexLineIndex = 0;
+    while (flexLineIndex < static_cast<int>(flexLines.size()) && flexLines[flexLineIndex].mLastIndex < fromIndex) {
+        flexLineIndex++;
+    }
     for (int i = flexLineIndex, size = flexLines.size(); i < size; i++) {
         FlexLine& flexLine = flexLines[i];
         if (flexLine.mMainSize < mainSize && flexLine.mAnyItemsHaveFlexGrow) {
@@ -385,6 +498,128 @@ void FlexboxHelper::determineMainSize(int widthMeasureSpec, int heightMeasureSpe
     }
 }
 
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+/**
+ * Turns the rounded prefix shares of four items into their new sizes, clamped to their limits.
+ * Returns the rounded prefix share of the last of the four items.
+ */
+static inline int applyPrefixShares(__m128i prefixShares, int previousPrefixShare, bool shrink,
+                                    const int* sizes, const int* limits, int* outSizes, int* outClamped) {
+    __m128i previous = _mm_or_si128(_mm_slli_si128(prefixShares, 4), _mm_cvtsi32_si128(previousPrefixShare));
+    __m128i shares = _mm_sub_epi32(prefixShares, previous);
+    __m128i size = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sizes));
+    __m128i limit = _mm_loadu_si128(reinterpret_cast<const __m128i*>(limits));
+    __m128i clamped;
+    if (shrink) {
+        size = _mm_sub_epi32(size, shares);
+        clamped = _mm_cmplt_epi32(size, limit);
+    } else {
+        size = _mm_add_epi32(size, shares);
+        clamped = _mm_cmpgt_epi32(size, limit);
+    }
+    size = _mm_or_si128(_mm_and_si128(clamped, limit), _mm_andnot_si128(clamped, size));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(outSizes), size);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(outClamped), _mm_and_si128(clamped, _mm_set1_epi32(1)));
+    return _mm_cvtsi128_si32(_mm_shuffle_epi32(prefixShares, _MM_SHUFFLE(3, 3, 3, 3)));
+}
+#endif
+
+void FlexboxHelper::distributeFreeSpace(float unitSpace, bool shrink, const int* sizes, const float* factors,
+                                        const int* limits, int* outSizes, int* outClamped, int count) {
+    double unit = unitSpace;
+    double prefixFactor = 0;
+    int previousPrefixShare = 0;
+
+    int i = 0;
+#if defined(__AVX2__)
+    const __m256d vUnit = _mm256_set1_pd(unit);
+    const __m256d vHalf = _mm256_set1_pd(0.5);
+    const __m256d vZero = _mm256_setzero_pd();
+    for (; i + 4 <= count; i += 4) {
+        // Inclusive scan of the four factors, then add the factors before them.
+        __m256d factor = _mm256_cvtps_pd(_mm_loadu_ps(factors + i));
+        factor = _mm256_add_pd(factor, _mm256_blend_pd(
+                _mm256_permute4x64_pd(factor, _MM_SHUFFLE(2, 1, 0, 0)), vZero, 0x1));
+        factor = _mm256_add_pd(factor, _mm256_blend_pd(
+                _mm256_permute4x64_pd(factor, _MM_SHUFFLE(1, 0, 0, 0)), vZero, 0x3));
+        factor = _mm256_add_pd(factor, _mm256_set1_pd(prefixFactor));
+        prefixFactor = _mm_cvtsd_f64(_mm256_extractf128_pd(
+                _mm256_permute4x64_pd(factor, _MM_SHUFFLE(3, 3, 3, 3)), 0));
+
+        // The prefix shares aren't negative, truncating them after adding a half rounds them.
+        __m128i prefixShares = _mm256_cvttpd_epi32(_mm256_add_pd(_mm256_mul_pd(vUnit, factor), vHalf));
+        previousPrefixShare = applyPrefixShares(prefixShares, previousPrefixShare, shrink,
+                                                sizes + i, limits + i, outSizes + i, outClamped + i);
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    const __m128d vUnit = _mm_set1_pd(unit);
+    const __m128d vHalf = _mm_set1_pd(0.5);
+    const __m128d vZero = _mm_setzero_pd();
+    for (; i + 4 <= count; i += 4) {
+        __m128 factor = _mm_loadu_ps(factors + i);
+        __m128d low = _mm_cvtps_pd(factor);
+        __m128d high = _mm_cvtps_pd(_mm_movehl_ps(factor, factor));
+        low = _mm_add_pd(low, _mm_unpacklo_pd(vZero, low));
+        high = _mm_add_pd(high, _mm_unpacklo_pd(vZero, high));
+        low = _mm_add_pd(low, _mm_set1_pd(prefixFactor));
+        high = _mm_add_pd(high, _mm_unpackhi_pd(low, low));
+        prefixFactor = _mm_cvtsd_f64(_mm_unpackhi_pd(high, high));
+
+        // The prefix shares aren't negative, truncating them after adding a half rounds them.
+        __m128i prefixShares = _mm_unpacklo_epi64(
+                _mm_cvttpd_epi32(_mm_add_pd(_mm_mul_pd(vUnit, low), vHalf)),
+                _mm_cvttpd_epi32(_mm_add_pd(_mm_mul_pd(vUnit, high), vHalf)));
+        previousPrefixShare = applyPrefixShares(prefixShares, previousPrefixShare, shrink,
+                                                sizes + i, limits + i, outSizes + i, outClamped + i);
+    }
+#endif
+    for (; i < count; i++) {
+        prefixFactor += factors[i];
+        int prefixShare = static_cast<int>(unit * prefixFactor + 0.5);
+        int share = prefixShare - previousPrefixShare;
+        previousPrefixShare = prefixShare;
+
+        int size = shrink ? sizes[i] - share : sizes[i] + share;
+        bool clamped = shrink ? size < limits[i] : size > limits[i];
+        outSizes[i] = clamped ? limits[i] : size;
+        outClamped[i] = clamped;
+    }
+}
+
+void FlexboxHelper::distributeFreeSpace(FlexLine& flexLine, float unitSpace, bool shrink) {
+    bool isMainHorizontal = mFlexContainer->isMainAxisDirectionHorizontal();
+    int count = flexLine.mItemCount;
+    mLineMainSizes.resize(count);
+    mLineFactors.resize(count);
+    mLineLimits.resize(count);
+    mDistributedSizes.resize(count);
+    mDistributedClamped.resize(count);
+    for (int i = 0; i < count; i++) {
+        int index = flexLine.mFirstIndex + i;
+        Item* flexItem = mFlexContainer->getFlexItemAt(index);
+        float factor = 0;
+        if (flexItem != nullptr && flexItem->getVisibility() != Item::GONE && !mChildrenFrozen[index]) {
+            factor = shrink ? flexItem->getFlexShrink() : flexItem->getFlexGrow();
+        }
+        if (factor > 0) {
+            mLineMainSizes[i] = getViewMeasuredSizeMain(flexItem, isMainHorizontal);
+            mLineFactors[i] = factor;
+            if (isMainHorizontal) {
+                mLineLimits[i] = shrink ? flexItem->getMinWidth() : flexItem->getMaxWidth();
+            } else {
+                mLineLimits[i] = shrink ? flexItem->getMinHeight() : flexItem->getMaxHeight();
+            }
+        } else {
+            // Items which aren't flexed keep their size and can't reach a limit.
+            mLineMainSizes[i] = 0;
+            mLineFactors[i] = 0;
+            mLineLimits[i] = shrink ? INT_MIN : INT_MAX;
+        }
+    }
+    distributeFreeSpace(unitSpace, shrink, mLineMainSizes.data(), mLineFactors.data(), mLineLimits.data(),
+                        mDistributedSizes.data(), mDistributedClamped.data(), count);
+}
+
 void
 FlexboxHelper::expandFlexItems(int widthMeasureSpec, int heightMeasureSpec, FlexLine& flexLine, int maxMainSize,
                                int paddingAlongMainAxis, bool calledRecursively) {
@@ -409,7 +644,7 @@ FlexboxHelper::expandFlexItems(int widthMeasureSpec, int heightMeasureSpec, Flex
     if (!calledRecursively) {
         flexLine.mCrossSize = INT_MIN;
     }
-    float accumulatedRoundError = 0;
+    distributeFreeSpace(flexLine, unitSpace, false);
     for (int i = 0; i < flexLine.mItemCount; i++) {
         int index = flexLine.mFirstIndex + i;
         Item* child = mFlexContainer->getFlexItemAt(index);
@@ -437,33 +672,14 @@ FlexboxHelper::expandFlexItems(int widthMeasureSpec, int heightMeasureSpec, Flex
             // childMeasuredHeight = extractHigherInt(mMeasuredSizeCache[index]);
             // }
             if (!mChildrenFrozen[index] && flexItem->getFlexGrow() > 0) {
-                float rawCalculatedWidth = childMeasuredWidth
-                                           + unitSpace * flexItem->getFlexGrow();
-                if (i == flexLine.mItemCount - 1) {
-                    rawCalculatedWidth += accumulatedRoundError;
-                    accumulatedRoundError = 0;
-                }
-                int newWidth = static_cast<int>(round(rawCalculatedWidth));
-                if (newWidth > flexItem->getMaxWidth()) {
+                int newWidth = mDistributedSizes[i];
+                if (mDistributedClamped[i]) {
                     // This means the child can't expand beyond the value of the mMaxWidth
-                    // attribute.
-                    // To adjust the flex line length to the size of maxMainSize, remaining
-                    // positive free space needs to be re-distributed to other flex items
-                    // (children views). In that case, invoke this method again with the same
-                    // fromIndex.
+                    // attribute. The remaining positive free space is re-distributed to the other
+                    // flex items by invoking this method again with the same flex line.
                     needsReexpand = true;
-                    newWidth = flexItem->getMaxWidth();
                     mChildrenFrozen[index] = true;
                     flexLine.mTotalFlexGrow -= flexItem->getFlexGrow();
-                } else {
-                    accumulatedRoundError += (rawCalculatedWidth - static_cast<float>(newWidth));
-                    if (accumulatedRoundError > 1.0) {
-                        newWidth += 1;
-                        accumulatedRoundError -= 1.0;
-                    } else if (accumulatedRoundError < -1.0) {
-                        newWidth -= 1;
-                        accumulatedRoundError += 1.0;
-                    }
                 }
                 int childHeightMeasureSpec = getChildHeightMeasureSpecInternal(
                         heightMeasureSpec, flexItem, flexLine.mSumCrossSizeBefore);
@@ -500,33 +716,14 @@ FlexboxHelper::expandFlexItems(int widthMeasureSpec, int heightMeasureSpec, Flex
             //             extractLowerInt(mMeasuredSizeCache[index]);
             // }
             if (!mChildrenFrozen[index] && flexItem->getFlexGrow() > 0) {
-                float rawCalculatedHeight = childMeasuredHeight
-                                            + unitSpace * flexItem->getFlexGrow();
-                if (i == flexLine.mItemCount - 1) {
-                    rawCalculatedHeight += accumulatedRoundError;
-                    accumulatedRoundError = 0;
-                }
-                int newHeight = static_cast<int>(round(rawCalculatedHeight));
-                if (newHeight > flexItem->getMaxHeight()) {
+                int newHeight = mDistributedSizes[i];
+                if (mDistributedClamped[i]) {
                     // This means the child can't expand beyond the value of the mMaxHeight
-                    // attribute.
-                    // To adjust the flex line length to the size of maxMainSize, remaining
-                    // positive free space needs to be re-distributed to other flex items
-                    // (children views). In that case, invoke this method again with the same
-                    // fromIndex.
+                    // attribute. The remaining positive free space is re-distributed to the other
+                    // flex items by invoking this method again with the same flex line.
                     needsReexpand = true;
-                    newHeight = flexItem->getMaxHeight();
                     mChildrenFrozen[index] = true;
                     flexLine.mTotalFlexGrow -= flexItem->getFlexGrow();
-                } else {
-                    accumulatedRoundError += (rawCalculatedHeight - newHeight);
-                    if (accumulatedRoundError > 1.0) {
-                        newHeight += 1;
-                        accumulatedRoundError -= 1.0;
-                    } else if (accumulatedRoundError < -1.0) {
-                        newHeight -= 1;
-                        accumulatedRoundError += 1.0;
-                    }
                 }
                 int childWidthMeasureSpec = getChildWidthMeasureSpecInternal(widthMeasureSpec,
                                                                              flexItem,
@@ -560,9 +757,11 @@ FlexboxHelper::expandFlexItems(int widthMeasureSpec, int heightMeasureSpec, Flex
 void FlexboxHelper::ensureChildrenFrozen(int size) {
     if (mChildrenFrozen.empty()) {
         mChildrenFrozen.resize(size < INITIAL_CAPACITY ? INITIAL_CAPACITY : size);
-    } else if (mChildrenFrozen.size() < size) {
+    } else if (mChildrenFrozen.size() < static_cast<size_t>(size)) {
         auto newCapacity = mChildrenFrozen.size() * 2;
-        mChildrenFrozen.resize(newCapacity >= size ? newCapacity : size);
+        mChildrenFrozen.assign(newCapacity >= static_cast<size_t>(size) ? newCapacity : size, false);
+    } else {
+        std::fill(mChildrenFrozen.begin(), mChildrenFrozen.end(), false);
     }
 }
 
@@ -649,7 +848,6 @@ FlexboxHelper::shrinkFlexItems(int widthMeasureSpec, int heightMeasureSpec, Flex
     }
     bool needsReshrink = false;
     float unitShrink = static_cast<float>(flexLine.mMainSize - maxMainSize) / flexLine.mTotalFlexShrink;
-    float accumulatedRoundError = 0;
     flexLine.mMainSize = paddingAlongMainAxis;
 
     // Setting the cross size of the flex line as the temporal value since the cross size of
@@ -665,6 +863,7 @@ FlexboxHelper::shrinkFlexItems(int widthMeasureSpec, int heightMeasureSpec, Flex
     if (!calledRecursively) {
         flexLine.mCrossSize = INT_MIN;
     }
+    distributeFreeSpace(flexLine, unitShrink, true);
     for (int i = 0; i < flexLine.mItemCount; i++) {
         int index = flexLine.mFirstIndex + i;
         Item* flexItem = mFlexContainer->getFlexItemAt(index);
@@ -690,33 +889,14 @@ FlexboxHelper::shrinkFlexItems(int widthMeasureSpec, int heightMeasureSpec, Flex
             // childMeasuredHeight = extractHigherInt(mMeasuredSizeCache[index]);
             // }
             if (!mChildrenFrozen[index] && flexItem->getFlexShrink() > 0) {
-                float rawCalculatedWidth = childMeasuredWidth
-                                           - unitShrink * flexItem->getFlexShrink();
-                if (i == flexLine.mItemCount - 1) {
-                    rawCalculatedWidth += accumulatedRoundError;
-                    accumulatedRoundError = 0;
-                }
-                int newWidth = static_cast<int>(round(rawCalculatedWidth));
-                if (newWidth < flexItem->getMinWidth()) {
+                int newWidth = mDistributedSizes[i];
+                if (mDistributedClamped[i]) {
                     // This means the child doesn't have enough space to distribute the negative
-                    // free space. To adjust the flex line length down to the maxMainSize,
-                    // remaining
-                    // negative free space needs to be re-distributed to other flex items
-                    // (children views). In that case, invoke this method again with the same
-                    // fromIndex.
+                    // free space. The remaining negative free space is re-distributed to the other
+                    // flex items by invoking this method again with the same flex line.
                     needsReshrink = true;
-                    newWidth = flexItem->getMinWidth();
                     mChildrenFrozen[index] = true;
                     flexLine.mTotalFlexShrink -= flexItem->getFlexShrink();
-                } else {
-                    accumulatedRoundError += (rawCalculatedWidth - newWidth);
-                    if (accumulatedRoundError > 1.0) {
-                        newWidth += 1;
-                        accumulatedRoundError -= 1;
-                    } else if (accumulatedRoundError < -1.0) {
-                        newWidth -= 1;
-                        accumulatedRoundError += 1;
-                    }
                 }
                 int childHeightMeasureSpec = getChildHeightMeasureSpecInternal(
                         heightMeasureSpec, flexItem, flexLine.mSumCrossSizeBefore);
@@ -754,28 +934,14 @@ FlexboxHelper::shrinkFlexItems(int widthMeasureSpec, int heightMeasureSpec, Flex
             //         extractLowerInt(mMeasuredSizeCache[index]);
             // }
             if (!mChildrenFrozen[index] && flexItem->getFlexShrink() > 0) {
-                float rawCalculatedHeight = childMeasuredHeight
-                                            - unitShrink * flexItem->getFlexShrink();
-                if (i == flexLine.mItemCount - 1) {
-                    rawCalculatedHeight += accumulatedRoundError;
-                    accumulatedRoundError = 0;
-                }
-                int newHeight = static_cast<int>(round(rawCalculatedHeight));
-                if (newHeight < flexItem->getMinHeight()) {
-                    // Need to invoke this method again like the case flex direction is vertical
+                int newHeight = mDistributedSizes[i];
+                if (mDistributedClamped[i]) {
+                    // This means the child doesn't have enough space to distribute the negative
+                    // free space. The remaining negative free space is re-distributed to the other
+                    // flex items by invoking this method again with the same flex line.
                     needsReshrink = true;
-                    newHeight = flexItem->getMinHeight();
                     mChildrenFrozen[index] = true;
                     flexLine.mTotalFlexShrink -= flexItem->getFlexShrink();
-                } else {
-                    accumulatedRoundError += (rawCalculatedHeight - newHeight);
-                    if (accumulatedRoundError > 1.0) {
-                        newHeight += 1;
-                        accumulatedRoundError -= 1;
-                    } else if (accumulatedRoundError < -1.0) {
-                        newHeight -= 1;
-                        accumulatedRoundError += 1;
-                    }
                 }
                 int childWidthMeasureSpec = getChildWidthMeasureSpecInternal(widthMeasureSpec,
                                                                              flexItem,
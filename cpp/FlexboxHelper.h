@@ -33,16 +33,85 @@ public:
 
     static constexpr int INITIAL_CAPACITY = 10;
 
+    /**
+     * The largest range of order values sorted with a counting sort, larger ranges fall back to
+     * a stable comparison sort.
+     */
+    static constexpr int MAX_COUNTING_SORT_RANGE = 1024;
+
+    /**
+     * Fills the given list with the children of the flex container sorted by their order
+     * attribute. The sort is stable, so children with the same order keep the order they have
+     * been added in.
+     *
+     * @param reorderedChildren receives the children in the order they are laid out
+     * @return true if the order differs from the order of the children
+     */
+    bool createReorderedChildren(std::vector<Item*>& reorderedChildren);
+
+    /**
+     * Distributes free space along a flex line in proportion to the flex factors of its items.
+     * Item k receives round(unitSpace * F(k)) - round(unitSpace * F(k - 1)) where F is the prefix
+     * sum of the factors, so the shares always add up to the rounded free space and don't depend
+     * on the order in which rounding errors would otherwise be carried. The prefix sums are
+     * computed in double precision, which is exact for float factors, so the AVX2, SSE2 and
+     * scalar paths produce the same sizes.
+     *
+     * @param unitSpace   the free space per unit of flex factor, never negative
+     * @param shrink      true to take the shares away from the sizes, false to add them
+     * @param sizes       the current main size of each item
+     * @param factors     the flex grow or shrink factor of each item, 0 for items not flexed
+     * @param limits      the max size of each item when growing, the min size when shrinking
+     * @param outSizes    receives the new main size of each item, clamped to its limit
+     * @param outClamped  receives true for the items which have been clamped to their limit
+     * @param count       the number of items
+     */
+    static void distributeFreeSpace(float unitSpace, bool shrink, const int* sizes, const float* factors,
+                                    const int* limits, int* outSizes, int* outClamped, int count);
+
     void calculateHorizontalFlexLines(FlexLinesResult& result, int widthMeasureSpec,
                                       int heightMeasureSpec);
 
     void calculateVerticalFlexLines(FlexLinesResult& result, int widthMeasureSpec,
                                     int heightMeasureSpec);
 
+    /**
+     * Calculates the flex lines from the given index, after the given existing lines which hold
+     * the flex items before it.
+     *
+     * @param result            the result of the calculation
+     * @param widthMeasureSpec  the horizontal space requirements as imposed by the parent
+     * @param heightMeasureSpec the vertical space requirements as imposed by the parent
+     * @param needsCalcAmount   the amount of cross size after which the calculation stops
+     * @param fromIndex         the index of the first flex item to calculate
+     * @param existingLines     the lines holding the flex items before fromIndex, may be null
+     */
+    void calculateHorizontalFlexLines(FlexLinesResult& result, int widthMeasureSpec,
+                                      int heightMeasureSpec, int needsCalcAmount, int fromIndex,
+                                      std::vector<FlexLine>* existingLines);
+
+    void calculateVerticalFlexLines(FlexLinesResult& result, int widthMeasureSpec,
+                                    int heightMeasureSpec, int needsCalcAmount, int fromIndex,
+                                    std::vector<FlexLine>* existingLines);
+
     void determineMainSize(int widthMeasureSpec, int heightMeasureSpec) {
         determineMainSize(widthMeasureSpec, heightMeasureSpec, 0);
     };
 
+    /**
+     * Determine the main size by expanding (shrinking if negative remaining free space is given)
+     * an individual child in each flex line if any children's mFlexGrow (or mFlexShrink if
+     * remaining
+     * space is negative) properties are set to non-zero.
+     *
+     * @param widthMeasureSpec  horizontal space requirements as imposed by the parent
+     * @param heightMeasureSpec vertical space requirements as imposed by the parent
+     * @param fromIndex         the index of the first flex item, the lines before it are skipped
+     * @see FlexContainer#setFlexDirection(int)
+     * @see FlexContainer#getFlexDirection()
+     */
+    void determineMainSize(int widthMeasureSpec, int heightMeasureSpec, int fromIndex);
+
     void determineCrossSize(int widthMeasureSpec, int heightMeasureSpec,
                             int paddingAlongCrossAxis);
 
@@ -66,6 +135,40 @@ private:
      */
     std::vector<bool> mChildrenFrozen;
 
+    /**
+     * The number of children of each order value, used by {@link #createReorderedChildren}.
+     */
+    std::vector<int> mOrderCounts;
+
+    /**
+     * The measured state of each flex item after its first measure in
+     * {@link #calculateFlexLines}, kept for the items of the lines which are reused.
+     */
+    std::vector<int> mChildMeasuredStates;
+
+    /**
+     * The main axis measure specs of the children and the arrays they are computed from in one
+     * batch at the start of {@link #calculateFlexLines}.
+     */
+    std::vector<int> mChildMainMeasureSpecs;
+    std::vector<int> mChildMainSizes;
+    std::vector<int> mChildMainPaddings;
+    std::vector<float> mChildMainPercents;
+
+    void computeChildMainMeasureSpecs(int mainMeasureSpec, int fromIndex, bool isMainHorizontal);
+
+    /**
+     * The main sizes, flex factors and limits of the items of the flex line being expanded or
+     * shrunk, and the sizes distributed to them, indexed relative to the first item of the line.
+     */
+    std::vector<int> mLineMainSizes;
+    std::vector<float> mLineFactors;
+    std::vector<int> mLineLimits;
+    std::vector<int> mDistributedSizes;
+    std::vector<int> mDistributedClamped;
+
+    void distributeFreeSpace(FlexLine& flexLine, float unitSpace, bool shrink);
+
     void calculateFlexLines(FlexLinesResult& result, int mainMeasureSpec,
                             int crossMeasureSpec, int needsCalcAmount, int fromIndex, int toIndex,
                             std::vector<FlexLine>* existingLines);
@@ -270,18 +373,6 @@ private:
     void checkSizeConstraints(Item* view, int index);
 
 
-    /**
-     * Determine the main size by expanding (shrinking if negative remaining free space is given)
-     * an individual child in each flex line if any children's mFlexGrow (or mFlexShrink if
-     * remaining
-     * space is negative) properties are set to non-zero.
-     *
-     * @param widthMeasureSpec  horizontal space requirements as imposed by the parent
-     * @param heightMeasureSpec vertical space requirements as imposed by the parent
-     * @see FlexContainer#setFlexDirection(int)
-     * @see FlexContainer#getFlexDirection()
-     */
-    void determineMainSize(int widthMeasureSpec, int heightMeasureSpec, int fromIndex);
 
 
     /**
@@ -5,7 +5,9 @@
  * found in the LICENSE file.
  */
 
+#include <algorithm>
 #include "FlowLayout.h"
+#include "ItemArena.h"
 
 static int getMeasuredDimension(int size, int mode, int childrenEdge) {
     switch (mode) {
@@ -18,6 +20,22 @@ static int getMeasuredDimension(int size, int mode, int childrenEdge) {
     }
 }
 
+int FlowLayout::nextVisibleChild(int index) {
+    int count = getChildCount();
+    while (index < count && getChildAt(index)->getVisibility() == Item::GONE) {
+        index++;
+    }
+    return index;
+}
+
+int FlowLayout::lastVisibleChildBefore(int index) {
+    index--;
+    while (index >= 0 && getChildAt(index)->getVisibility() == Item::GONE) {
+        index--;
+    }
+    return index;
+}
+
 void FlowLayout::onMeasure(int widthMeasureSpec, int heightMeasureSpec) {
     int width = MeasureSpec::getSize(widthMeasureSpec);
     int widthMode = MeasureSpec::getMode(widthMeasureSpec);
@@ -30,57 +48,159 @@ void FlowLayout::onMeasure(int widthMeasureSpec, int heightMeasureSpec) {
             ? width
             : INT_MAX;
 
-    int childLeft = getPaddingLeft();
-    int childTop = getPaddingTop();
-    int childBottom = childTop;
-    int childRight = childLeft;
-    int maxChildRight = 0;
-    int maxRight = maxWidth - getPaddingRight();
-    for (int i = 0; i < getChildCount(); i++) {
+    int count = getChildCount();
+    // The specs of the children only depend on this item's specs and padding.
+    getChildMeasureSpecs(widthMeasureSpec, getPaddingLeft() + getPaddingRight(), true, false,
+                         mChildWidthMeasureSpecs);
+    getChildMeasureSpecs(heightMeasureSpec, getPaddingTop() + getPaddingBottom(), false, false,
+                         mChildHeightMeasureSpecs);
+    // The children before the first changed one have the same specs, size and position.
+    int firstChangedChild = consumeFirstChangedChild();
+    int from = widthMeasureSpec == mLastWidthMeasureSpec && heightMeasureSpec == mLastHeightMeasureSpec
+               ? std::min(firstChangedChild, count) : 0;
+    mLastWidthMeasureSpec = widthMeasureSpec;
+    mLastHeightMeasureSpec = heightMeasureSpec;
+    mAdvanceSums.resize(count + 1);
+    mChildEnds.resize(count);
+    mAdvanceSums[0] = 0;
+    if (mFirstDecreasingEnd >= from) {
+        mFirstDecreasingEnd = count;
+    }
+    for (int i = from; i < count; i++) {
         Item* child = getChildAt(i);
 
         if (child->getVisibility() == Item::GONE) {
-            continue;
-        }
-        measureChild(child, widthMeasureSpec, heightMeasureSpec);
-
-        int leftMargin = child->getMarginLeft();
-        int rightMargin = child->getMarginRight();
-
-        childRight = childLeft + leftMargin + child->getMeasuredWidth();
+            mChildEnds[i] = mAdvanceSums[i];
+            mAdvanceSums[i + 1] = mAdvanceSums[i];
+        } else {
+            child->measure(mChildWidthMeasureSpecs[i], mChildHeightMeasureSpecs[i]);
 
-        // If the current child's right bound exce->ds Flowlayout's max right bound and flowlayout is
-        // not confined to a single line, move this child to the next line and reset its left bound to
-        // flowlayout's left bound.
-        if (childRight > maxRight && !isSingleLine()) {
-            childLeft = getPaddingLeft();
-            childTop = childBottom + mLineSpacing;
+            int leftMargin = child->getMarginLeft();
+            int rightMargin = child->getMarginRight();
+            mChildEnds[i] = mAdvanceSums[i] + leftMargin + child->getMeasuredWidth();
+            mAdvanceSums[i + 1] = mChildEnds[i] + rightMargin + mItemSpacing;
         }
-
-        childRight = childLeft + leftMargin + child->getMeasuredWidth();
-        childBottom = childTop + child->getMeasuredHeight();
-
-        // Updates Flowlayout's max right bound if current child's right bound exceeds it.
-        if (childRight > maxChildRight) {
-            maxChildRight = childRight;
+        if (i > 0 && mChildEnds[i] < mChildEnds[i - 1]) {
+            mFirstDecreasingEnd = std::min(mFirstDecreasingEnd, i);
         }
+    }
 
-        childLeft += (leftMargin + rightMargin + child->getMeasuredWidth()) + mItemSpacing;
+    // The rows depend on the children's sizes, which may have changed.
+    mRowsMinAvailable = INT_MAX;
+    mRowsMaxAvailable = INT_MIN;
+    computeRows(maxWidth - getPaddingRight() - getPaddingLeft());
 
-        // For all preceding children, the child's right margin is taken into account in the next
-        // child's left bound (childLeft). However, childLeft is ignored after the last child so the
-        // last child's right margin needs to be explicitly added to Flowlayout's max right bound.
-        if (i == (getChildCount() - 1)) {
-            maxChildRight += rightMargin;
+    // The end of the last visible child of a row is the furthest one when the ends are
+    // non-decreasing.
+    int maxChildRight = 0;
+    if (mFirstDecreasingEnd < count) {
+        for (int i = nextVisibleChild(0); i < count; i = nextVisibleChild(i + 1)) {
+            maxChildRight = std::max(maxChildRight,
+                                     getPaddingLeft() + mChildEnds[i] - mAdvanceSums[mRowStarts[mChildRows[i]]]);
         }
+    } else {
+        for (int row = 0, rowCount = mRowStarts.size(); row < rowCount; row++) {
+            int rowEnd = row + 1 < rowCount ? mRowStarts[row + 1] : count;
+            int last = lastVisibleChildBefore(rowEnd);
+            if (last >= mRowStarts[row]) {
+                maxChildRight = std::max(maxChildRight,
+                                         getPaddingLeft() + mChildEnds[last] - mAdvanceSums[mRowStarts[row]]);
+            }
+        }
+    }
+    // For all preceding children, the child's right margin is taken into account in the next
+    // child's left bound. However, it is ignored after the last child so the last child's right
+    // margin needs to be explicitly added to Flowlayout's max right bound.
+    if (count > 0 && getChildAt(count - 1)->getVisibility() != Item::GONE) {
+        maxChildRight += getChildAt(count - 1)->getMarginRight();
     }
 
     maxChildRight += getPaddingRight();
-    childBottom += getPaddingBottom();
+    int childBottom = mContentBottom + getPaddingBottom();
 
     int Width = getMeasuredDimension(width, widthMode, maxChildRight);
     int Height = getMeasuredDimension(height, heightMode, childBottom);
     setMeasuredDimension(Width, Height);
+    // The baseline of the first child of the first row.
+    int first = nextVisibleChild(0);
+    setMeasuredBaseline(first < count ? mRowTops[0] + getChildAt(first)->getBaseline() : 0);
+}
+
+void FlowLayout::computeRows(int available) {
+    if (available >= mRowsMinAvailable && available <= mRowsMaxAvailable) {
+        return;
+    }
+    int count = getChildCount();
+    mRowStarts.clear();
+    mRowTops.clear();
+    mChildRows.resize(count);
+    mRowsMinAvailable = INT_MIN;
+    mRowsMaxAvailable = INT_MAX;
+
+    int childTop = getPaddingTop();
+    mContentBottom = childTop;
+    int start = nextVisibleChild(0);
+    mLeadingBreak = false;
+    if (start < count && !mSingleLine) {
+        // If the first child doesn't fit, it is moved to the next line like any other child.
+        int firstWidth = mChildEnds[start] - mAdvanceSums[start];
+        mLeadingBreak = firstWidth > available;
+        if (mLeadingBreak) {
+            childTop += mLineSpacing;
+            mRowsMaxAvailable = firstWidth - 1;
+        } else {
+            mRowsMinAvailable = firstWidth;
+        }
+    }
+    if (start >= count) {
+        std::fill(mChildRows.begin(), mChildRows.end(), 0);
+        return;
+    }
+
+    int rowStart = 0;
+    while (true) {
+        int end = count;
+        // The furthest end of the children after the first one of the row.
+        int rowEnd = INT_MIN;
+        if (!mSingleLine) {
+            // The first child whose end exceeds the available width starts the next row.
+            long long limit = static_cast<long long>(available) + mAdvanceSums[start];
+            if (mFirstDecreasingEnd < count) {
+                end = nextVisibleChild(start + 1);
+                while (end < count && mChildEnds[end] <= limit) {
+                    rowEnd = std::max(rowEnd, mChildEnds[end]);
+                    end = nextVisibleChild(end + 1);
+                }
+            } else {
+                auto breakAt = std::upper_bound(mChildEnds.begin() + start + 1, mChildEnds.end(), limit,
+                                                [](long long value, int end) { return value < end; });
+                end = nextVisibleChild(static_cast<int>(breakAt - mChildEnds.begin()));
+                int last = lastVisibleChildBefore(end);
+                if (last > start) {
+                    rowEnd = mChildEnds[last];
+                }
+            }
+        }
+
+        int row = mRowStarts.size();
+        mRowStarts.emplace_back(start);
+        mRowTops.emplace_back(childTop);
+        std::fill(mChildRows.begin() + rowStart, mChildRows.begin() + end, row);
+
+        int last = lastVisibleChildBefore(end);
+        if (rowEnd != INT_MIN) {
+            mRowsMinAvailable = std::max(mRowsMinAvailable, rowEnd - mAdvanceSums[start]);
+        }
+        mContentBottom = childTop + getChildAt(last)->getMeasuredHeight();
+        if (end >= count) {
+            break;
+        }
+        mRowsMaxAvailable = std::min(mRowsMaxAvailable, mChildEnds[end] - mAdvanceSums[start] - 1);
+
+        childTop = mContentBottom + mLineSpacing;
+        start = end;
+        rowStart = end;
+    }
 }
 
 void FlowLayout::onLayout(bool sizeChanged, int left, int top, int right, int bottom) {
@@ -89,18 +209,17 @@ void FlowLayout::onLayout(bool sizeChanged, int left, int top, int right, int bo
         mRowCount = 0;
         return;
     }
-    mRowCount = 1;
 
     bool isRtl = false;
     int paddingStart = isRtl ? getPaddingRight() : getPaddingLeft();
     int paddingEnd = isRtl ? getPaddingLeft() : getPaddingRight();
-    int childStart = paddingStart;
-    int childTop = getPaddingTop();
-    int childBottom = childTop;
-    int childEnd;
 
     int maxChildEnd = right - left - paddingEnd;
 
+    // Reuses the rows of the measure pass unless the width changed enough to move a break.
+    computeRows(maxChildEnd - paddingStart);
+    mRowCount = mRowStarts.size() + (mLeadingBreak ? 1 : 0);
+
     for (int i = 0; i < getChildCount(); i++) {
         Item* child = getChildAt(i);
 
@@ -108,19 +227,12 @@ void FlowLayout::onLayout(bool sizeChanged, int left, int top, int right, int bo
             continue;
         }
 
+        int row = mChildRows[i];
         int startMargin = child->getMarginLeft();
-        int endMargin = child->getMarginRight();
-
-        childEnd = childStart + startMargin + child->getMeasuredWidth();
-
-        if (!mSingleLine && (childEnd > maxChildEnd)) {
-            childStart = paddingStart;
-            childTop = childBottom + mLineSpacing;
-            mRowCount++;
-        }
-
-        childEnd = childStart + startMargin + child->getMeasuredWidth();
-        childBottom = childTop + child->getMeasuredHeight();
+        int childStart = paddingStart + mAdvanceSums[i] - mAdvanceSums[mRowStarts[row]];
+        int childEnd = childStart + startMargin + child->getMeasuredWidth();
+        int childTop = mRowTops[row];
+        int childBottom = childTop + child->getMeasuredHeight();
 
         if (isRtl) {
             child->layout(
@@ -128,11 +240,62 @@ void FlowLayout::onLayout(bool sizeChanged, int left, int top, int right, int bo
         } else {
             child->layout(childStart + startMargin, childTop, childEnd, childBottom);
         }
+    }
+}
+
+size_t FlowLayout::computeLayoutHash() const {
+    size_t hash = hashCombine(Layout::computeLayoutHash(), mLineSpacing);
+    hash = hashCombine(hash, mItemSpacing);
+    return hashCombine(hash, mSingleLine);
+}
 
-        childStart += (startMargin + endMargin + child->getMeasuredWidth()) + mItemSpacing;
+void FlowLayout::copyMeasuredState(const Item& source) {
+    Layout::copyMeasuredState(source);
+    const FlowLayout& flowLayout = static_cast<const FlowLayout&>(source);
+    mAdvanceSums = flowLayout.mAdvanceSums;
+    mChildEnds = flowLayout.mChildEnds;
+    mFirstDecreasingEnd = flowLayout.mFirstDecreasingEnd;
+    mRowStarts = flowLayout.mRowStarts;
+    mRowTops = flowLayout.mRowTops;
+    mChildRows = flowLayout.mChildRows;
+    mLeadingBreak = flowLayout.mLeadingBreak;
+    mContentBottom = flowLayout.mContentBottom;
+    mRowsMinAvailable = flowLayout.mRowsMinAvailable;
+    mRowsMaxAvailable = flowLayout.mRowsMaxAvailable;
+    mRowCount = flowLayout.mRowCount;
+}
+
+Item* FlowLayout::cloneItem(ItemArena* arena) const {
+    return arena != nullptr ? arena->copy(*this) : new FlowLayout(*this);
+}
+
+bool FlowLayout::copyAttributes(const Item& prototype) {
+    const FlowLayout& flowLayout = static_cast<const FlowLayout&>(prototype);
+    bool changed = Layout::copyAttributes(prototype);
+    changed |= assignAttribute(mLineSpacing, flowLayout.mLineSpacing);
+    changed |= assignAttribute(mItemSpacing, flowLayout.mItemSpacing);
+    changed |= assignAttribute(mSingleLine, flowLayout.mSingleLine);
+    return changed;
+}
+
+int FlowLayout::computeIntrinsicSize(bool horizontal, int intrinsicSize) {
+    // With the min-content width each child is on a row of its own, with the max-content one
+    // they all are on the same row.
+    bool oneRow = mSingleLine || intrinsicSize == IntrinsicSize::MAX_CONTENT;
+    if (horizontal) {
+        int content = oneRow ? sumChildIntrinsicSizes(true, intrinsicSize, mItemSpacing)
+                             : maxChildIntrinsicSize(true, intrinsicSize);
+        return content + getPaddingLeft() + getPaddingRight();
     }
+    int content = oneRow ? maxChildIntrinsicSize(false, intrinsicSize)
+                         : sumChildIntrinsicSizes(false, intrinsicSize, mLineSpacing);
+    return content + getPaddingTop() + getPaddingBottom();
 }
 
 int FlowLayout::getRowIndex(Item* item) {
-    return 0;
+    int index = indexOfChild(item);
+    if (index < 0 || index >= static_cast<int>(mChildRows.size())) {
+        return -1;
+    }
+    return mChildRows[index] + (mLeadingBreak ? 1 : 0);
 }
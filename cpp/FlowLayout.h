@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <vector>
 #include "Layout.h"
 
 /**
@@ -15,6 +16,10 @@
  *
  */
 class FlowLayout : public Layout {
+    friend class TreeFormat;
+    friend class JsonTreeLoader;
+    friend class LayoutSnapshot;
+
 private:
 
     int mLineSpacing = 0;
@@ -22,6 +27,69 @@ private:
     bool mSingleLine = false;
     int mRowCount = 0;
 
+    /**
+     * Prefix sums of the advance widths (margins, measured width and item spacing) of the
+     * children: entry i is the offset of child i from the start of the flow, the last entry is
+     * the total advance.
+     */
+    std::vector<int> mAdvanceSums;
+
+    /** The measure specs of the children, computed in one batch per measure. */
+    std::vector<int> mChildWidthMeasureSpecs;
+    std::vector<int> mChildHeightMeasureSpecs;
+
+    /**
+     * Offset of the end of each child from the start of the flow (the advance sum before it
+     * plus its start margin and measured width). Usually non-decreasing, so line breaks are
+     * found by binary search.
+     */
+    std::vector<int> mChildEnds;
+
+    /**
+     * The index of the first child whose end is before the end of the previous child, due to a
+     * negative margin or item spacing, or the child count if the ends are non-decreasing. The
+     * rows are then found by a linear scan.
+     */
+    int mFirstDecreasingEnd = 0;
+
+    /** Index of the first child of each row. */
+    std::vector<int> mRowStarts;
+
+    /** Top of each row. */
+    std::vector<int> mRowTops;
+
+    /** Row index of each child. */
+    std::vector<int> mChildRows;
+
+    /** True if the first child didn't fit in the first row and has been moved down. */
+    bool mLeadingBreak = false;
+
+    /** The bottom of the last child. */
+    int mContentBottom = 0;
+
+    /**
+     * The specs of the last measure. When measured again with the same specs, the children
+     * before the first changed one keep their size and prefix sums.
+     */
+    int mLastWidthMeasureSpec = INT_MIN;
+    int mLastHeightMeasureSpec = INT_MIN;
+
+    /** The range of available widths for which the computed rows are valid. */
+    int mRowsMinAvailable = INT_MAX;
+    int mRowsMaxAvailable = INT_MIN;
+
+    /**
+     * Computes the rows from the prefix sums for the given available width, unless the current
+     * rows are still valid for it.
+     *
+     * @param available the width available for the children between the paddings
+     */
+    void computeRows(int available);
+
+    int nextVisibleChild(int index);
+
+    int lastVisibleChildBefore(int index);
+
 protected:
 
     int getLineSpacing() const {
@@ -29,7 +97,10 @@ protected:
     }
 
     void setLineSpacing(int lineSpacing) {
-        mLineSpacing = lineSpacing;
+        if (mLineSpacing != lineSpacing) {
+            mLineSpacing = lineSpacing;
+            requestLayout();
+        }
     }
 
     int getItemSpacing() const {
@@ -37,14 +108,38 @@ protected:
     }
 
     void setItemSpacing(int itemSpacing) {
-        mItemSpacing = itemSpacing;
+        if (mItemSpacing != itemSpacing) {
+            mItemSpacing = itemSpacing;
+            requestLayout();
+        }
     }
 
     void onMeasure(int widthMeasureSpec, int heightMeasureSpec) override;
 
     void onLayout(bool sizeChanged, int left, int top, int right, int bottom) override;
 
+    size_t computeLayoutHash() const override;
+
+    void copyMeasuredState(const Item& source) override;
+
+    Item* cloneItem(ItemArena* arena) const override;
+
+    bool copyAttributes(const Item& prototype) override;
+
+    int computeIntrinsicSize(bool horizontal, int intrinsicSize) override;
+
 public:
+    FlowLayout() = default;
+
+    /**
+     * Copies the attributes of the prototype but not its children, see
+     * {@link Item#cloneSubtree(ItemArena*)}.
+     */
+    FlowLayout(const FlowLayout& prototype)
+            : Layout(prototype),
+              mLineSpacing(prototype.mLineSpacing),
+              mItemSpacing(prototype.mItemSpacing),
+              mSingleLine(prototype.mSingleLine) {}
 
     /** Returns whether this chip group is single line or reflowed multiline. */
     bool isSingleLine() const {
@@ -53,8 +148,22 @@ public:
 
     /** Sets whether this chip group is single line, or reflowed multiline. */
     void setSingleLine(bool singleLine) {
-        mSingleLine = singleLine;
+        if (mSingleLine != singleLine) {
+            mSingleLine = singleLine;
+            requestLayout();
+        }
     }
 
+    /**
+     * @return the number of rows of the last layout.
+     */
+    int getRowCount() const { return mRowCount; }
+
+    /**
+     * Returns the row of the given child computed by the last layout.
+     *
+     * @param item the child
+     * @return the row index, or -1 if the item is not a child of this layout
+     */
     int getRowIndex(Item* item);
 };
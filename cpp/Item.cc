@@ -5,10 +5,415 @@
  * found in the LICENSE file.
  */
 
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <typeinfo>
 #include "Item.h"
+#include "ItemArena.h"
+#include "Layout.h"
+#include "LayoutTransaction.h"
+
+thread_local unsigned int Item::sMeasurePass = 0;
+thread_local unsigned int Item::sLayoutEpoch = 1;
+thread_local unsigned int Item::sTreeMutations = 0;
 
 void Item::measure(int widthMeasureSpec, int heightMeasureSpec) {
-    onMeasure(widthMeasureSpec, heightMeasureSpec);
+    if (mParent == nullptr) {
+        beginMeasurePass();
+    }
+
+    // An item stays a relayout boundary only if every measure of the pass was exact on both axes,
+    // e.g. the flex grow step measures with an exact size what has been measured with AT_MOST.
+    if (mMeasurePass != sMeasurePass) {
+        mMeasurePass = sMeasurePass;
+        mPrivateFlags |= PFLAG_RELAYOUT_BOUNDARY;
+    }
+    if (MeasureSpec::getMode(widthMeasureSpec) != MeasureSpec::EXACTLY
+        || MeasureSpec::getMode(heightMeasureSpec) != MeasureSpec::EXACTLY) {
+        mPrivateFlags &= ~PFLAG_RELAYOUT_BOUNDARY;
+    }
+
+    mLayoutSource = nullptr;
+    bool forceLayout = (mPrivateFlags & PFLAG_FORCE_LAYOUT) == PFLAG_FORCE_LAYOUT;
+    bool specChanged = widthMeasureSpec != mOldWidthMeasureSpec
+                       || heightMeasureSpec != mOldHeightMeasureSpec;
+    if (specChanged && !forceLayout && mParent != nullptr
+        && (mParent->mPrivateFlags & PFLAG_RESIZE_MODE) == PFLAG_RESIZE_MODE
+        && isMeasurementValidFor(widthMeasureSpec, heightMeasureSpec)) {
+        // Resize mode: the intrinsic size is kept, only the container redistributes the space.
+        specChanged = false;
+    }
+    if (mMeasureCachePass != sMeasurePass) {
+        // In resize mode the sizes of the last passes are kept: they stay valid until a change in
+        // the subtree clears them, and a resize back to a former width measures with their specs.
+        if (mParent != nullptr && (mParent->mPrivateFlags & PFLAG_RESIZE_MODE) == PFLAG_RESIZE_MODE) {
+            if (mMeasureCache.size() > MAX_KEPT_MEASURES) {
+                mMeasureCache.erase(mMeasureCache.begin(), mMeasureCache.end() - MAX_KEPT_MEASURES);
+            }
+        } else {
+            mMeasureCache.clear();
+        }
+        mMeasureCachePass = sMeasurePass;
+    }
+    // A forced item has already been measured again in this pass if it has an entry.
+    const MeasureCacheEntry* entry = findMeasureCacheEntry(widthMeasureSpec, heightMeasureSpec);
+    if (entry != nullptr) {
+        if (forceLayout || specChanged) {
+            setMeasuredDimension(entry->measuredWidth, entry->measuredHeight);
+            mBaseline = entry->baseline;
+            if (widthMeasureSpec != mLastOnMeasureWidthSpec || heightMeasureSpec != mLastOnMeasureHeightSpec) {
+                mPrivateFlags |= PFLAG_MEASURE_NEEDED_BEFORE_LAYOUT;
+            } else {
+                mPrivateFlags &= ~PFLAG_MEASURE_NEEDED_BEFORE_LAYOUT;
+            }
+            mPrivateFlags |= PFLAG_LAYOUT_REQUIRED;
+        }
+    } else {
+        Layout* sharingContainer = mParent != nullptr && (mParent->mPrivateFlags & PFLAG_SHARE_CHILD_LAYOUTS) != 0
+                                   ? static_cast<Layout*>(mParent) : nullptr;
+        if (forceLayout || specChanged) {
+            const Item* source = sharingContainer != nullptr
+                                 ? sharingContainer->findSharedLayout(this, widthMeasureSpec, heightMeasureSpec)
+                                 : nullptr;
+            if (source != nullptr) {
+                // An equal sibling has been measured with the same specs.
+                copyLayout(*source);
+            } else {
+                onMeasure(widthMeasureSpec, heightMeasureSpec);
+            }
+            mLastOnMeasureWidthSpec = widthMeasureSpec;
+            mLastOnMeasureHeightSpec = heightMeasureSpec;
+            mPrivateFlags &= ~PFLAG_MEASURE_NEEDED_BEFORE_LAYOUT;
+            mPrivateFlags |= PFLAG_LAYOUT_REQUIRED;
+        }
+        if (sharingContainer != nullptr) {
+            sharingContainer->shareLayout(this, widthMeasureSpec, heightMeasureSpec);
+        }
+        // The reused size is remembered too, a later measure in the pass may come back to it.
+        mMeasureCache.push_back({widthMeasureSpec, heightMeasureSpec, mMeasuredWidth, mMeasuredHeight, mBaseline});
+    }
+
+    mOldWidthMeasureSpec = widthMeasureSpec;
+    mOldHeightMeasureSpec = heightMeasureSpec;
+}
+
+const Item::MeasureCacheEntry* Item::findMeasureCacheEntry(int widthMeasureSpec, int heightMeasureSpec) const {
+    for (const auto& entry : mMeasureCache) {
+        if (entry.widthMeasureSpec == widthMeasureSpec && entry.heightMeasureSpec == heightMeasureSpec) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+static bool isSizeValidFor(int measuredSizeAndState, int oldSpec, int newSpec) {
+    int measuredSize = measuredSizeAndState & Item::MEASURED_SIZE_MASK;
+    int oldMode = Item::MeasureSpec::getMode(oldSpec);
+    int newMode = Item::MeasureSpec::getMode(newSpec);
+    int newSize = Item::MeasureSpec::getSize(newSpec);
+    if (oldSpec == newSpec) {
+        return true;
+    }
+    // See getDefaultSize(): an unbounded spec gives the min size, a bounded one its own size.
+    if (newMode == Item::MeasureSpec::UNSPECIFIED) {
+        return oldMode == Item::MeasureSpec::UNSPECIFIED;
+    }
+    return (measuredSizeAndState & Item::MEASURED_STATE_TOO_SMALL) == 0 && newSize == measuredSize;
+}
+
+bool Item::isMeasurementValidFor(int widthMeasureSpec, int heightMeasureSpec) const {
+    // The height of a text depends on its width, the axes can't be checked one at a time.
+    if (mOldWidthMeasureSpec == INT_MIN || mMeasureFunction) {
+        return false;
+    }
+    return isSizeValidFor(mMeasuredWidth, mOldWidthMeasureSpec, widthMeasureSpec)
+           && isSizeValidFor(mMeasuredHeight, mOldHeightMeasureSpec, heightMeasureSpec);
+}
+
+bool Item::isRelayoutBoundary() const {
+    return mParent == nullptr
+           || ((mPrivateFlags & PFLAG_RELAYOUT_BOUNDARY) != 0
+               && !static_cast<Layout*>(mParent)->isChildBaselineUsed(this));
+}
+
+void Item::requestLayout() {
+    invalidateSubtreeCaches();
+    if (LayoutTransaction::record(this, PFLAG_PENDING_LAYOUT_REQUEST)) {
+        return;
+    }
+    mPrivateFlags |= PFLAG_LAYOUT_INVALIDATED;
+    invalidateLayout();
+}
+
+void Item::invalidateLayout() {
+    mPrivateFlags = (mPrivateFlags | PFLAG_FORCE_LAYOUT) & ~PFLAG_LAYOUT_REQUIRED;
+    mMeasureCache.clear();
+    if (mParent == nullptr) {
+        return;
+    }
+    if (isRelayoutBoundary()) {
+        // The size of this item can't change, mark the path so that layoutIfNeeded() finds it.
+        // The ancestors note the changed child too in case they are measured again anyway.
+        for (Item* child = this, *parent = mParent; parent != nullptr; child = parent, parent = parent->mParent) {
+            Layout* container = static_cast<Layout*>(parent);
+            int index = container->indexOfChild(child);
+            if ((parent->mPrivateFlags & PFLAG_CHILD_NEEDS_LAYOUT) != 0
+                && parent->mChildNeedsLayoutEpoch == sLayoutEpoch && container->mFirstChangedChild <= index) {
+                // An earlier request of this batch has marked the rest of the path.
+                return;
+            }
+            container->onChildChanged(index);
+            parent->mPrivateFlags |= PFLAG_CHILD_NEEDS_LAYOUT;
+            parent->mChildNeedsLayoutEpoch = sLayoutEpoch;
+            // The sizes kept in resize mode may come from specs this item wasn't exact for.
+            parent->mMeasureCache.clear();
+        }
+        return;
+    }
+    // The container only has to measure again from this child.
+    Layout* container = static_cast<Layout*>(mParent);
+    container->onChildChanged(container->indexOfChild(this));
+    if (!mParent->isMeasureRequested()) {
+        mParent->invalidateLayout();
+    }
+}
+
+void Item::onLayoutParamsChanged() {
+    invalidateSubtreeCaches();
+    if (LayoutTransaction::record(this, PFLAG_PENDING_PARAMS_CHANGE)) {
+        return;
+    }
+    mPrivateFlags = (mPrivateFlags | PFLAG_FORCE_LAYOUT | PFLAG_LAYOUT_INVALIDATED) & ~PFLAG_LAYOUT_REQUIRED;
+    mMeasureCache.clear();
+    if (mParent == nullptr) {
+        return;
+    }
+    // Unlike a layout request, this reaches the container even from a relayout boundary.
+    Layout* container = static_cast<Layout*>(mParent);
+    container->onChildChanged(container->indexOfChild(this));
+    if (!mParent->isMeasureRequested()) {
+        mParent->invalidateLayout();
+    }
+}
+
+void Item::invalidateSubtreeCaches() {
+    // This item may not have computed anything, e.g. while gone, but its container has.
+    mPrivateFlags &= ~PFLAG_SUBTREE_CACHES;
+    for (Item* item = mParent; item != nullptr && (item->mPrivateFlags & PFLAG_SUBTREE_CACHES) != 0;
+         item = item->mParent) {
+        item->mPrivateFlags &= ~PFLAG_SUBTREE_CACHES;
+    }
+}
+
+int Item::getIntrinsicSize(bool horizontal, int intrinsicSize) {
+    if (intrinsicSize != IntrinsicSize::MIN_CONTENT && intrinsicSize != IntrinsicSize::MAX_CONTENT) {
+        throw std::invalid_argument("Invalid value for the intrinsic size: " + std::to_string(intrinsicSize));
+    }
+    int index = getIntrinsicSizeIndex(horizontal, intrinsicSize);
+    // The lowest bit of the mask is the one of the first entry.
+    int validFlag = (PFLAG_INTRINSIC_SIZES_VALID & -PFLAG_INTRINSIC_SIZES_VALID) << index;
+    if ((mPrivateFlags & validFlag) == 0) {
+        int dimension = horizontal ? mWidth : mHeight;
+        int size = dimension >= 0 ? dimension : computeIntrinsicSize(horizontal, intrinsicSize);
+        int maxSize = horizontal ? mMaxWidth : mMaxHeight;
+        int minSize = horizontal ? mMinWidth : mMinHeight;
+        mIntrinsicSizes[index] = std::max(std::min(size, maxSize), std::max(minSize, 0));
+        mPrivateFlags |= validFlag;
+    }
+    return mIntrinsicSizes[index];
+}
+
+int Item::computeIntrinsicSize(bool horizontal, int intrinsicSize) {
+    if (!mMeasureFunction) {
+        return 0;
+    }
+    int unspecified = MeasureSpec::makeMeasureSpec(0, MeasureSpec::UNSPECIFIED);
+    if (intrinsicSize == IntrinsicSize::MAX_CONTENT) {
+        MeasureResult content = mMeasureFunction(this, unspecified, unspecified);
+        return horizontal ? content.width : content.height;
+    }
+    if (horizontal) {
+        return mMeasureFunction(this, MeasureSpec::makeMeasureSpec(0, MeasureSpec::AT_MOST), unspecified).width;
+    }
+    // The height at the min-content width, e.g. a text broken at every opportunity.
+    int width = MeasureSpec::makeMeasureSpec(getIntrinsicWidth(IntrinsicSize::MIN_CONTENT), MeasureSpec::AT_MOST);
+    return mMeasureFunction(this, width, unspecified).height;
+}
+
+size_t Item::getLayoutHash() {
+    if ((mPrivateFlags & PFLAG_LAYOUT_HASH_VALID) == 0) {
+        mLayoutHash = computeLayoutHash();
+        mPrivateFlags |= PFLAG_LAYOUT_HASH_VALID;
+    }
+    return mLayoutHash;
+}
+
+size_t Item::computeLayoutHash() const {
+    size_t hash = typeid(*this).hash_code();
+    for (int value : {mOrder, mAlignSelf, mMinWidth, mMinHeight, mMaxWidth, mMaxHeight, mWidth, mHeight,
+                      mLeftMargin, mTopMargin, mRightMargin, mBottomMargin, getVisibility(),
+                      mPaddingLeft, mPaddingTop, mPaddingRight, mPaddingBottom}) {
+        hash = hashCombine(hash, value);
+    }
+    for (float value : {mFlexGrow, mFlexShrink, mFlexBasisPercent, mWidthPercent, mHeightPercent, mWeight}) {
+        hash = hashCombine(hash, value);
+    }
+    hash = hashCombine(hash, mWrapBefore);
+    if (!mMeasureFunction) {
+        return hash;
+    }
+    // The content measured by a function can only be compared through its key.
+    return mContentKey != 0 ? hashCombine(hash, mContentKey) : hashCombine(hash, this);
+}
+
+void Item::copyLayout(const Item& source) {
+    mMeasuredWidth = source.mMeasuredWidth;
+    mMeasuredHeight = source.mMeasuredHeight;
+    mBaseline = source.mBaseline;
+    mLayoutSource = &source;
+    mLayoutSourceMutations = sTreeMutations;
+    // The state used to measure again incrementally isn't copied.
+    mPrivateFlags |= PFLAG_LAYOUT_INVALIDATED;
+    copyMeasuredState(source);
+}
+
+Item::Item(const Item& prototype)
+        : mOrder(prototype.mOrder),
+          mFlexGrow(prototype.mFlexGrow),
+          mFlexShrink(prototype.mFlexShrink),
+          mAlignSelf(prototype.mAlignSelf),
+          mFlexBasisPercent(prototype.mFlexBasisPercent),
+          mMinWidth(prototype.mMinWidth),
+          mMinHeight(prototype.mMinHeight),
+          mMaxWidth(prototype.mMaxWidth),
+          mMaxHeight(prototype.mMaxHeight),
+          mWidth(prototype.mWidth),
+          mHeight(prototype.mHeight),
+          mLeftMargin(prototype.mLeftMargin),
+          mTopMargin(prototype.mTopMargin),
+          mRightMargin(prototype.mRightMargin),
+          mBottomMargin(prototype.mBottomMargin),
+          mWrapBefore(prototype.mWrapBefore),
+          mWidthPercent(prototype.mWidthPercent),
+          mHeightPercent(prototype.mHeightPercent),
+          mViewFlags(prototype.mViewFlags),
+          mWeight(prototype.mWeight),
+          // The modes of a container are attributes too, and the subtree copied is equal. The
+          // caches of an item with a measure function and no content key aren't: its hash is its
+          // address, and the function may measure another content for the copy.
+          mPrivateFlags((prototype.mPrivateFlags
+                         & (PFLAG_RESIZE_MODE | PFLAG_SHARE_CHILD_LAYOUTS
+                            | (prototype.mMeasureFunction && prototype.mContentKey == 0 ? 0 : PFLAG_SUBTREE_CACHES)))
+                        | PFLAG_FORCE_LAYOUT | PFLAG_LAYOUT_INVALIDATED | PFLAG_FRAME_DAMAGED),
+          mLayoutHash(prototype.mLayoutHash),
+          mMeasureFunction(prototype.mMeasureFunction),
+          mContentKey(prototype.mContentKey),
+          mPaddingLeft(prototype.mPaddingLeft),
+          mPaddingRight(prototype.mPaddingRight),
+          mPaddingTop(prototype.mPaddingTop),
+          mPaddingBottom(prototype.mPaddingBottom) {
+    std::copy(std::begin(prototype.mIntrinsicSizes), std::end(prototype.mIntrinsicSizes), mIntrinsicSizes);
+}
+
+Item* Item::cloneSubtree(ItemArena* arena) const {
+    Item* clone = cloneItem(arena);
+    clone->cloneChildren(*this, arena);
+    return clone;
+}
+
+bool Item::resetAttributes(const Item& prototype) {
+    if (typeid(*this) != typeid(prototype)) {
+        return false;
+    }
+    int order = mOrder;
+    if (copyAttributes(prototype)) {
+        if (mOrder != order && mParent != nullptr) {
+            mParent->mPrivateFlags |= PFLAG_CHILD_ORDER_CHANGED;
+        }
+        onLayoutParamsChanged();
+    }
+    return true;
+}
+
+bool Item::resetSubtree(const Item& prototype) {
+    if (!resetAttributes(prototype)) {
+        return false;
+    }
+    if (mMeasureFunction && mContentKey == 0) {
+        // The content can't be compared with the one measured last.
+        requestLayout();
+    }
+    return resetChildren(prototype);
+}
+
+bool Item::copyAttributes(const Item& prototype) {
+    bool changed = assignAttribute(mOrder, prototype.mOrder);
+    changed |= assignAttribute(mFlexGrow, prototype.mFlexGrow);
+    changed |= assignAttribute(mFlexShrink, prototype.mFlexShrink);
+    changed |= assignAttribute(mAlignSelf, prototype.mAlignSelf);
+    changed |= assignAttribute(mFlexBasisPercent, prototype.mFlexBasisPercent);
+    changed |= assignAttribute(mMinWidth, prototype.mMinWidth);
+    changed |= assignAttribute(mMinHeight, prototype.mMinHeight);
+    changed |= assignAttribute(mMaxWidth, prototype.mMaxWidth);
+    changed |= assignAttribute(mMaxHeight, prototype.mMaxHeight);
+    changed |= assignAttribute(mWidth, prototype.mWidth);
+    changed |= assignAttribute(mHeight, prototype.mHeight);
+    changed |= assignAttribute(mLeftMargin, prototype.mLeftMargin);
+    changed |= assignAttribute(mTopMargin, prototype.mTopMargin);
+    changed |= assignAttribute(mRightMargin, prototype.mRightMargin);
+    changed |= assignAttribute(mBottomMargin, prototype.mBottomMargin);
+    changed |= assignAttribute(mWrapBefore, prototype.mWrapBefore);
+    changed |= assignAttribute(mWidthPercent, prototype.mWidthPercent);
+    changed |= assignAttribute(mHeightPercent, prototype.mHeightPercent);
+    changed |= assignAttribute(mViewFlags, prototype.mViewFlags);
+    changed |= assignAttribute(mWeight, prototype.mWeight);
+    changed |= assignAttribute(mPaddingLeft, prototype.mPaddingLeft);
+    changed |= assignAttribute(mPaddingRight, prototype.mPaddingRight);
+    changed |= assignAttribute(mPaddingTop, prototype.mPaddingTop);
+    changed |= assignAttribute(mPaddingBottom, prototype.mPaddingBottom);
+    // The modes of a container don't change its layout.
+    int modes = PFLAG_RESIZE_MODE | PFLAG_SHARE_CHILD_LAYOUTS;
+    mPrivateFlags = (mPrivateFlags & ~modes) | (prototype.mPrivateFlags & modes);
+    return changed;
+}
+
+Item* Item::cloneItem(ItemArena* arena) const {
+    return arena != nullptr ? arena->copy(*this) : new Item(*this);
+}
+
+void Item::setOrder(int order) {
+    if (mOrder == order) {
+        return;
+    }
+    mOrder = order;
+    // The order is part of the layout hash of this item, not only of its container.
+    invalidateSubtreeCaches();
+    if (mParent != nullptr) {
+        mParent->mPrivateFlags |= PFLAG_CHILD_ORDER_CHANGED;
+        mParent->requestLayout();
+    }
+}
+
+void Item::layoutIfNeeded() {
+    if (isMeasureRequested()) {
+        if (mOldWidthMeasureSpec == INT_MIN) {
+            // Never measured, there is nothing to reuse.
+            return;
+        }
+        beginMeasurePass();
+        measure(mOldWidthMeasureSpec, mOldHeightMeasureSpec);
+        if (MeasureSpec::getMode(mOldWidthMeasureSpec) == MeasureSpec::EXACTLY
+            && MeasureSpec::getMode(mOldHeightMeasureSpec) == MeasureSpec::EXACTLY) {
+            layout(mLeft, mTop, mRight, mBottom);
+        } else {
+            // Only a root gets here with other specs, its size may have changed with its content.
+            layout(mLeft, mTop, mLeft + getMeasuredWidth(), mTop + getMeasuredHeight());
+        }
+    } else if ((mPrivateFlags & PFLAG_CHILD_NEEDS_LAYOUT) != 0) {
+        mPrivateFlags &= ~PFLAG_CHILD_NEEDS_LAYOUT;
+        layoutChildrenIfNeeded();
+    }
 }
 
 int Item::getMeasuredState() {
@@ -17,10 +422,6 @@ int Item::getMeasuredState() {
               & (MEASURED_STATE_MASK >> MEASURED_HEIGHT_STATE_SHIFT));
 }
 
-int Item::getBaseline() {
-    return 0;
-}
-
 int Item::getDefaultSize(int size, int measureSpec) {
     int result = size;
     int specMode = MeasureSpec::getMode(measureSpec);
@@ -45,8 +446,39 @@ void Item::setMeasuredDimension(int measuredWidth, int measuredHeight) {
 }
 
 void Item::layout(int l, int t, int r, int b) {
+    // The flags cleared below may leave the ones of the children it doesn't lay out.
+    ++sLayoutEpoch;
+    if ((mPrivateFlags & (PFLAG_FORCE_LAYOUT | PFLAG_LAYOUT_REQUIRED)) == PFLAG_FORCE_LAYOUT
+        && mOldWidthMeasureSpec != INT_MIN) {
+        // A relayout boundary which requested a layout but whose container skipped measuring it,
+        // its size can't have changed. It keeps the boundary flag of the pass it was measured in.
+        mMeasurePass = sMeasurePass;
+        measure(mOldWidthMeasureSpec, mOldHeightMeasureSpec);
+    }
+    if ((mPrivateFlags & PFLAG_MEASURE_NEEDED_BEFORE_LAYOUT) != 0) {
+        // The children have last been measured for other specs than the final ones.
+        onMeasure(mOldWidthMeasureSpec, mOldHeightMeasureSpec);
+        mLastOnMeasureWidthSpec = mOldWidthMeasureSpec;
+        mLastOnMeasureHeightSpec = mOldHeightMeasureSpec;
+        mPrivateFlags &= ~PFLAG_MEASURE_NEEDED_BEFORE_LAYOUT;
+    }
+    // The source may have been removed, or destroyed, since the measure.
+    const Item* source = mLayoutSourceMutations == sTreeMutations ? mLayoutSource : nullptr;
+    mLayoutSource = nullptr;
     bool changed = setFrame(l, t, r, b);
-    if (changed) onLayout(changed, l, t, r, b);
+    if (changed || (mPrivateFlags & PFLAG_LAYOUT_REQUIRED) == PFLAG_LAYOUT_REQUIRED) {
+        // The frames of the children are copied from the equal subtree this layout comes from.
+        if (source == nullptr || !source->hasLayoutFor(r - l, b - t) || !layoutChildrenFrom(*source)) {
+            onLayout(changed, l, t, r, b);
+        }
+        mPrivateFlags &= ~(PFLAG_LAYOUT_REQUIRED | PFLAG_CHILD_NEEDS_LAYOUT);
+    } else if ((mPrivateFlags & PFLAG_CHILD_NEEDS_LAYOUT) != 0) {
+        // The measure of an ancestor has skipped this item, but a relayout boundary below it
+        // still has to be laid out.
+        mPrivateFlags &= ~PFLAG_CHILD_NEEDS_LAYOUT;
+        layoutChildrenIfNeeded();
+    }
+    mPrivateFlags &= ~PFLAG_FORCE_LAYOUT;
 }
 
 bool Item::setFrame(int left, int top, int right, int bottom) {
@@ -67,9 +499,27 @@ bool Item::setFrame(int left, int top, int right, int bottom) {
         mBottom = bottom;
 
     }
+    if (changed || (mPrivateFlags & PFLAG_FRAME_DAMAGED) != 0) {
+        // A new item is reported once laid out even if its frame is still empty.
+        markFrameDamaged();
+    }
     return changed;
 }
 
+void Item::markFrameDamaged() {
+    mPrivateFlags |= PFLAG_FRAME_DAMAGED;
+    if (mParent != nullptr) {
+        mParent->markChildFrameDamaged();
+    }
+}
+
+void Item::markChildFrameDamaged() {
+    for (Item* item = this; item != nullptr && (item->mPrivateFlags & PFLAG_CHILD_FRAME_DAMAGED) == 0;
+         item = item->mParent) {
+        item->mPrivateFlags |= PFLAG_CHILD_FRAME_DAMAGED;
+    }
+}
+
 int Item::resolveSizeAndState(int size, int measureSpec, int childMeasuredState) {
     int specMode = MeasureSpec::getMode(measureSpec);
     int specSize = MeasureSpec::getSize(measureSpec);
@@ -93,6 +543,15 @@ int Item::resolveSizeAndState(int size, int measureSpec, int childMeasuredState)
 }
 
 void Item::onMeasure(int widthMeasureSpec, int heightMeasureSpec) {
-    setMeasuredDimension(getDefaultSize(mMinWidth, widthMeasureSpec),
-                         getDefaultSize(mMinHeight, heightMeasureSpec));
+    // The min sizes default to NOT_SET, which isn't a size.
+    if (mMeasureFunction) {
+        MeasureResult content = mMeasureFunction(this, widthMeasureSpec, heightMeasureSpec);
+        setMeasuredDimension(resolveSizeAndState(std::max(content.width, mMinWidth), widthMeasureSpec, 0),
+                             resolveSizeAndState(std::max(content.height, mMinHeight), heightMeasureSpec, 0));
+        setMeasuredBaseline(content.baseline);
+        return;
+    }
+    setMeasuredDimension(getDefaultSize(std::max(mMinWidth, 0), widthMeasureSpec),
+                         getDefaultSize(std::max(mMinHeight, 0), heightMeasureSpec));
+    setMeasuredBaseline(0);
 }
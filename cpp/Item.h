@@ -9,9 +9,22 @@
 
 #include <cmath>
 #include <climits>
+#include <functional>
+#include <vector>
 #include "FlexEnum.h"
 
+class Layout;
+class ItemArena;
+
 class Item {
+    friend class Layout;
+    friend class ChildList;
+    friend class LayoutTransaction;
+    friend class TreeFormat;
+    friend class JsonTreeLoader;
+    friend class LayoutResultWriter;
+    friend class LayoutSnapshot;
+
 public:
 
     struct LayoutParams {
@@ -105,6 +118,24 @@ public:
         }
     };
 
+    /**
+     * The size of the content of an item and its baseline, as computed by a
+     * {@link MeasureFunction}.
+     */
+    struct MeasureResult {
+        int width;
+        int height;
+
+        /** The distance from the top of the content to its baseline */
+        int baseline = 0;
+    };
+
+    /**
+     * Measures the content of an item without children, e.g. a text, for the specs the item is
+     * measured with. The size returned is then resolved against the specs and the min sizes.
+     */
+    using MeasureFunction = std::function<MeasureResult(Item* item, int widthMeasureSpec, int heightMeasureSpec)>;
+
     /**
      * Bits of {@link #getMeasuredWidthAndState()} and
      * {@link #getMeasuredWidthAndState()} that provide the actual measured size.
@@ -160,6 +191,7 @@ private:
     int mTop = 0;
     int mBottom = 0;
 
+    int mOrder = ORDER_DEFAULT;
     float mFlexGrow = FLEX_GROW_DEFAULT;
     float mFlexShrink = FLEX_SHRINK_DEFAULT;
     int mAlignSelf = AlignSelf::AUTO;
@@ -182,6 +214,183 @@ private:
     int mViewFlags = 0;
     float mWeight = 0;
 
+    /**
+     * The container this item has been added to, or null for the root of a tree.
+     */
+    Item* mParent = nullptr;
+
+    /**
+     * The slot of this item in the child list of its container, see {@link ChildList}.
+     */
+    int mChildSlot = -1;
+
+    /**
+     * A new item has to be reported by the next {@link LayoutResultWriter}.
+     */
+    int mPrivateFlags = PFLAG_FRAME_DAMAGED;
+
+    /**
+     * The id identifying the item in the results handed to a renderer.
+     */
+    int mId = NO_ID;
+
+    /**
+     * The specs of the last call to {@link #measure(int, int)}. A relayout boundary is
+     * re-measured with these when its subtree is laid out again in isolation.
+     */
+    int mOldWidthMeasureSpec = INT_MIN;
+    int mOldHeightMeasureSpec = INT_MIN;
+
+    /**
+     * The measure pass in which the relayout boundary flag was last evaluated.
+     */
+    unsigned int mMeasurePass = 0;
+
+    /**
+     * Counter identifying the current measure pass of the calling thread.
+     */
+    static thread_local unsigned int sMeasurePass;
+
+    /**
+     * Counter of the measure passes and layouts of the calling thread, which may clear the
+     * {@link #PFLAG_CHILD_NEEDS_LAYOUT} flags of a tree.
+     */
+    static thread_local unsigned int sLayoutEpoch;
+
+    /**
+     * The layout epoch in which {@link #PFLAG_CHILD_NEEDS_LAYOUT} was last set. While it is the
+     * current one, the ancestors of this item have the flag too.
+     */
+    unsigned int mChildNeedsLayoutEpoch = 0;
+
+    /**
+     * Counter of the changes of the children of the containers of the calling thread and of the
+     * items destroyed, any of which may take away the source of a copied layout.
+     */
+    static thread_local unsigned int sTreeMutations;
+
+    /**
+     * A measured size memoized for a pair of specs during a measure pass.
+     */
+    struct MeasureCacheEntry {
+        int widthMeasureSpec;
+        int heightMeasureSpec;
+        int measuredWidth;
+        int measuredHeight;
+        int baseline;
+    };
+
+    /**
+     * The sizes measured in pass {@link #mMeasureCachePass}, so that an item measured several
+     * times with the same specs by its containers (e.g. the weighted and uniform passes of nested
+     * LinearLayouts) only runs {@link #onMeasure(int, int)} once per pass. The children of a
+     * container in resize mode also keep the last entries of the previous passes, until they are
+     * invalidated.
+     */
+    std::vector<MeasureCacheEntry> mMeasureCache;
+    unsigned int mMeasureCachePass = 0;
+
+    /** The number of entries of the previous passes kept in resize mode. */
+    static constexpr size_t MAX_KEPT_MEASURES = 8;
+
+    /**
+     * The specs of the last {@link #onMeasure(int, int)}, i.e. the specs the children have been
+     * measured for.
+     */
+    int mLastOnMeasureWidthSpec = INT_MIN;
+    int mLastOnMeasureHeightSpec = INT_MIN;
+
+    const MeasureCacheEntry* findMeasureCacheEntry(int widthMeasureSpec, int heightMeasureSpec) const;
+
+    /**
+     * The structural hash of the layout inputs of the subtree, valid while
+     * {@link #PFLAG_LAYOUT_HASH_VALID} is set.
+     */
+    size_t mLayoutHash = 0;
+
+    /**
+     * Measures the content of this item if it has no children, see
+     * {@link #setMeasureFunction(MeasureFunction)}.
+     */
+    MeasureFunction mMeasureFunction;
+
+    /**
+     * Identifies the content measured by {@link #mMeasureFunction} in the layout hash, or 0 if it
+     * can't be compared, see {@link #setContentKey(size_t)}.
+     */
+    size_t mContentKey = 0;
+
+    /**
+     * The baseline computed by the last measure, along with the measured size.
+     */
+    int mBaseline = 0;
+
+    /**
+     * The equal subtree whose measured layout has been copied by the last measure, so that the
+     * following layout copies its frames too. Only set between the two.
+     */
+    const Item* mLayoutSource = nullptr;
+
+    /**
+     * The tree mutation counter when {@link #mLayoutSource} was set. The source is only followed
+     * while no container has changed its children and no item has been destroyed since.
+     */
+    unsigned int mLayoutSourceMutations = 0;
+
+    /**
+     * The intrinsic sizes, indexed by {@link #getIntrinsicSizeIndex(bool, int)}. Each one is valid
+     * while its bit of {@link #PFLAG_INTRINSIC_SIZES_VALID} is set.
+     */
+    int mIntrinsicSizes[4] = {};
+
+    static int getIntrinsicSizeIndex(bool horizontal, int intrinsicSize) {
+        return (horizontal ? 0 : 2) + intrinsicSize;
+    }
+
+    int getIntrinsicSize(bool horizontal, int intrinsicSize);
+
+    /**
+     * Clears the layout hash and the intrinsic sizes of this item and of its ancestors.
+     */
+    void invalidateSubtreeCaches();
+
+    /**
+     * Takes the measured layout of an equal subtree instead of measuring this one.
+     */
+    void copyLayout(const Item& source);
+
+    /**
+     * Returns whether this item has been laid out with the given size and nothing is pending,
+     * so that its frames can be copied.
+     */
+    bool hasLayoutFor(int width, int height) const {
+        return (mPrivateFlags & (PFLAG_FORCE_LAYOUT | PFLAG_LAYOUT_REQUIRED | PFLAG_MEASURE_NEEDED_BEFORE_LAYOUT)) == 0
+               && mRight - mLeft == width && mBottom - mTop == height;
+    }
+
+    /**
+     * Marks this item as needing a layout and notifies its container of the change, see
+     * {@link #requestLayout()}.
+     */
+    void invalidateLayout();
+
+    /**
+     * Called when an attribute read by the container has changed: the container has to measure
+     * this item again even if this item is a relayout boundary. Deferred to the end of the
+     * current {@link LayoutTransaction} if there is one.
+     */
+    void onLayoutParamsChanged();
+
+    /**
+     * Returns whether a layout has been requested on this item and it hasn't been measured since.
+     * A request clears {@link #PFLAG_LAYOUT_REQUIRED}, which the next measure sets again, so an
+     * item measured but not laid out yet, e.g. by a container which doesn't lay out its children,
+     * doesn't hold back the requests of its descendants.
+     */
+    bool isMeasureRequested() const {
+        return (mPrivateFlags & (PFLAG_FORCE_LAYOUT | PFLAG_LAYOUT_REQUIRED)) == PFLAG_FORCE_LAYOUT;
+    }
+
 protected:
     int mPaddingLeft = 0;
     int mPaddingRight = 0;
@@ -194,7 +403,10 @@ public:
     }
 
     inline void setWidth(int width) {
-        mWidth = width;
+        if (mWidth != width) {
+            mWidth = width;
+            onLayoutParamsChanged();
+        }
     }
 
     inline int getHeight() const {
@@ -202,15 +414,33 @@ public:
     }
 
     inline void setHeight(int height) {
-        mHeight = height;
+        if (mHeight != height) {
+            mHeight = height;
+            onLayoutParamsChanged();
+        }
+    }
+
+    inline int getOrder() const {
+        return mOrder;
     }
 
+    /**
+     * Sets the order of the item in its flex container, items are laid out in ascending order
+     * and the ones with the same order keep the order they have been added in.
+     *
+     * @param order the order value
+     */
+    void setOrder(int order);
+
     inline float getFlexGrow() const {
         return mFlexGrow;
     }
 
     inline void setFlexGrow(float flexGrow) {
-        mFlexGrow = flexGrow;
+        if (mFlexGrow != flexGrow) {
+            mFlexGrow = flexGrow;
+            onLayoutParamsChanged();
+        }
     }
 
     inline float getFlexShrink() const {
@@ -218,7 +448,10 @@ public:
     }
 
     inline void setFlexShrink(float flexShrink) {
-        mFlexShrink = flexShrink;
+        if (mFlexShrink != flexShrink) {
+            mFlexShrink = flexShrink;
+            onLayoutParamsChanged();
+        }
     }
 
     inline int getAlignSelf() const {
@@ -226,7 +459,10 @@ public:
     }
 
     inline void setAlignSelf(int alignSelf) {
-        mAlignSelf = alignSelf;
+        if (mAlignSelf != alignSelf) {
+            mAlignSelf = alignSelf;
+            onLayoutParamsChanged();
+        }
     }
 
     inline int getMinWidth() const {
@@ -234,7 +470,10 @@ public:
     }
 
     inline void setMinWidth(int minWidth) {
-        mMinWidth = minWidth;
+        if (mMinWidth != minWidth) {
+            mMinWidth = minWidth;
+            onLayoutParamsChanged();
+        }
     }
 
     inline int getMinHeight() const {
@@ -242,7 +481,10 @@ public:
     }
 
     inline void setMinHeight(int minHeight) {
-        mMinHeight = minHeight;
+        if (mMinHeight != minHeight) {
+            mMinHeight = minHeight;
+            onLayoutParamsChanged();
+        }
     }
 
     inline int getMaxWidth() const {
@@ -250,7 +492,10 @@ public:
     }
 
     inline void setMaxWidth(int maxWidth) {
-        mMaxWidth = maxWidth;
+        if (mMaxWidth != maxWidth) {
+            mMaxWidth = maxWidth;
+            onLayoutParamsChanged();
+        }
     }
 
     inline int getMaxHeight() const {
@@ -258,7 +503,10 @@ public:
     }
 
     inline void setMaxHeight(int maxHeight) {
-        mMaxHeight = maxHeight;
+        if (mMaxHeight != maxHeight) {
+            mMaxHeight = maxHeight;
+            onLayoutParamsChanged();
+        }
     }
 
     inline bool isWrapBefore() const {
@@ -266,7 +514,10 @@ public:
     }
 
     inline void setWrapBefore(bool wrapBefore) {
-        mWrapBefore = wrapBefore;
+        if (mWrapBefore != wrapBefore) {
+            mWrapBefore = wrapBefore;
+            onLayoutParamsChanged();
+        }
     }
 
     inline float getFlexBasisPercent() const {
@@ -274,7 +525,10 @@ public:
     }
 
     inline void setFlexBasisPercent(float flexBasisPercent) {
-        mFlexBasisPercent = flexBasisPercent;
+        if (mFlexBasisPercent != flexBasisPercent) {
+            mFlexBasisPercent = flexBasisPercent;
+            onLayoutParamsChanged();
+        }
     }
 
     inline int getMarginLeft() const {
@@ -293,12 +547,30 @@ public:
         return mBottomMargin;
     }
 
+    /**
+     * Sets the margins of the item, in its container.
+     *
+     * @param left   the left margin
+     * @param top    the top margin
+     * @param right  the right margin
+     * @param bottom the bottom margin
+     */
+    void setMargins(int left, int top, int right, int bottom) {
+        if (mLeftMargin != left || mTopMargin != top || mRightMargin != right || mBottomMargin != bottom) {
+            mLeftMargin = left;
+            mTopMargin = top;
+            mRightMargin = right;
+            mBottomMargin = bottom;
+            onLayoutParamsChanged();
+        }
+    }
+
     inline int getMarginHorizontal() const {
-        return mRight + mLeft;
+        return mLeftMargin + mRightMargin;
     }
 
     inline int getMarginVertical() const {
-        return mTop + mBottom;
+        return mTopMargin + mBottomMargin;
     }
 
     inline int getLeft() const {
@@ -318,7 +590,10 @@ public:
     }
 
     inline void setWidthPercent(float percent) {
-        mWidthPercent = percent;
+        if (mWidthPercent != percent) {
+            mWidthPercent = percent;
+            onLayoutParamsChanged();
+        }
     }
 
     inline float getWidthPercent() const {
@@ -326,7 +601,10 @@ public:
     };
 
     inline void setHeightPercent(float percent) {
-        mHeightPercent = percent;
+        if (mHeightPercent != percent) {
+            mHeightPercent = percent;
+            onLayoutParamsChanged();
+        }
     }
 
     inline float getHeightPercent() const {
@@ -338,15 +616,286 @@ public:
     }
 
     inline void setWeight(float weight) {
-        mWeight = weight;
+        if (mWeight != weight) {
+            mWeight = weight;
+            onLayoutParamsChanged();
+        }
     }
 
 protected:
+    /**
+     * Indicates that this item has to be measured and laid out again: set by
+     * {@link #requestLayout()} and cleared once the item has been laid out.
+     */
+    static constexpr int PFLAG_FORCE_LAYOUT = 0x00001000;
+
+    /**
+     * Set by {@link #measure(int, int)} so that the following {@link #layout(int, int, int, int)}
+     * calls {@link #onLayout(bool, int, int, int, int)} even if the frame did not change.
+     */
+    static constexpr int PFLAG_LAYOUT_REQUIRED = 0x00002000;
+
+    /**
+     * Set on the ancestors of a relayout boundary that requested a layout, so that
+     * {@link #layoutIfNeeded()} can find the boundary without visiting the whole tree.
+     */
+    static constexpr int PFLAG_CHILD_NEEDS_LAYOUT = 0x00004000;
+
+    /**
+     * Set while every measure of the current pass handed this item exact sizes on both axes.
+     */
+    static constexpr int PFLAG_RELAYOUT_BOUNDARY = 0x00008000;
+
+    /**
+     * Set on a container whose children keep their measured size when a new spec can't change it.
+     */
+    static constexpr int PFLAG_RESIZE_MODE = 0x00010000;
+
+    /**
+     * Set when the last measure has been served from the measure cache with other specs than
+     * the last {@link #onMeasure(int, int)}: the children have to be measured again for the final
+     * specs before they are laid out.
+     */
+    static constexpr int PFLAG_MEASURE_NEEDED_BEFORE_LAYOUT = 0x00020000;
+
+    /**
+     * Set on a container when a child has been added or removed or has changed its order, so
+     * that the order of the children is only sorted again when it may have changed.
+     */
+    static constexpr int PFLAG_CHILD_ORDER_CHANGED = 0x00040000;
+
+    /**
+     * Set when the layout of the item itself has been requested, as opposed to a request
+     * propagated from one of its children: all the children have to be measured again.
+     */
+    static constexpr int PFLAG_LAYOUT_INVALIDATED = 0x00080000;
+
+    /**
+     * Set while a layout request, respectively a change of the layout attributes, of the item is
+     * recorded by a {@link LayoutTransaction} and not applied yet.
+     */
+    static constexpr int PFLAG_PENDING_LAYOUT_REQUEST = 0x00100000;
+    static constexpr int PFLAG_PENDING_PARAMS_CHANGE = 0x00200000;
+
+    /**
+     * Set while {@link #mLayoutHash} is up to date. Cleared on the ancestors of a changed item.
+     */
+    static constexpr int PFLAG_LAYOUT_HASH_VALID = 0x00400000;
+
+    /**
+     * Set on a container whose children share the layouts measured for equal subtrees.
+     */
+    static constexpr int PFLAG_SHARE_CHILD_LAYOUTS = 0x00800000;
+
+    /**
+     * One bit per entry of {@link #mIntrinsicSizes}, set while the entry is up to date.
+     */
+    static constexpr int PFLAG_INTRINSIC_SIZES_VALID = 0x0F000000;
+
+    /**
+     * The caches of values derived from the whole subtree, cleared on the ancestors of a changed
+     * item.
+     */
+    static constexpr int PFLAG_SUBTREE_CACHES = PFLAG_LAYOUT_HASH_VALID | PFLAG_INTRINSIC_SIZES_VALID;
+
+    /**
+     * Set when the frame of the item has changed since a {@link LayoutResultWriter} last reported
+     * it, and on its ancestors up to the root, so that the writer only visits the branches with
+     * changed frames.
+     */
+    static constexpr int PFLAG_FRAME_DAMAGED = 0x10000000;
+    static constexpr int PFLAG_CHILD_FRAME_DAMAGED = 0x20000000;
+
+    /**
+     * Set when the item has been added to a container since a {@link LayoutResultWriter} last
+     * reported it: the frames of its whole subtree are reported again.
+     */
+    static constexpr int PFLAG_SUBTREE_FRAME_DAMAGED = 0x40000000;
+
+    /**
+     * Set once the frame of the item has been reported, and cleared when it is removed from its
+     * container: only the removal of an item the renderer knows has to be reported.
+     */
+    static constexpr int PFLAG_FRAME_REPORTED = 0x00000800;
+
+    /**
+     * Adds the item to the damage set, see {@link #PFLAG_FRAME_DAMAGED}.
+     */
+    void markFrameDamaged();
+
+    /**
+     * Marks the item and its ancestors as containing damage, see {@link #PFLAG_FRAME_DAMAGED}.
+     */
+    void markChildFrameDamaged();
+
+    /**
+     * Combines a value into a hash.
+     */
+    template<typename T>
+    static size_t hashCombine(size_t seed, const T& value) {
+        return seed ^ (std::hash<T>()(value) + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2));
+    }
+
+    /**
+     * Computes the hash of the inputs of the layout of this subtree: the attributes of this item
+     * and the layout hashes of its children. Subclasses add the attributes they measure with.
+     *
+     * @return the layout hash
+     */
+    virtual size_t computeLayoutHash() const;
+
+    /**
+     * Copies the state computed by {@link #onMeasure(int, int)} and read by
+     * {@link #onLayout(bool, int, int, int, int)} from an equal subtree. Containers copy the
+     * measured layout of their children.
+     *
+     * @param source the item whose layout is copied, of the same class
+     */
+    virtual void copyMeasuredState(const Item& /* source */) {}
+
+    /**
+     * Lays out the children with the frames of the children of an equal subtree laid out with
+     * the same size.
+     *
+     * @param source the item whose layout is copied
+     * @return false if the children of the source haven't all been laid out
+     */
+    virtual bool layoutChildrenFrom(const Item& /* source */) { return true; }
+
+    /**
+     * Computes an intrinsic size of the content of this item along an axis, paddings included,
+     * for an item whose size along the axis isn't fixed. Containers combine the intrinsic sizes
+     * of their children. An item without children asks its measure function for the size of its
+     * content with no limit, or with none at all for the min-content width, if it has one.
+     *
+     * @param horizontal    true for the width, false for the height
+     * @param intrinsicSize {@link IntrinsicSize#MIN_CONTENT} or {@link IntrinsicSize#MAX_CONTENT}
+     * @return the intrinsic size, before the min and max sizes of this item are applied
+     */
+    virtual int computeIntrinsicSize(bool horizontal, int intrinsicSize);
+
+    /**
+     * Stores the baseline of this item, to be called by {@link #onMeasure(int, int)} along with
+     * {@link #setMeasuredDimension(int, int)}.
+     *
+     * @param baseline the distance from the top of this item to its baseline
+     */
+    void setMeasuredBaseline(int baseline) { mBaseline = baseline; }
+
+    /**
+     * Starts a new measure pass on the calling thread.
+     */
+    static void beginMeasurePass() {
+        ++sMeasurePass;
+        ++sLayoutEpoch;
+    }
+
     virtual void onMeasure(int widthMeasureSpec, int heightMeasureSpec);
 
     virtual void onLayout(bool changed, int left, int top, int right, int bottom) {}
 
+    /**
+     * Called by {@link #layoutIfNeeded()} on an item which doesn't need a layout itself but has
+     * descendants which do. Containers forward the call to their children.
+     */
+    virtual void layoutChildrenIfNeeded() {}
+
+    /**
+     * Creates a copy of this item with the copy constructor of its class. Each class overrides it.
+     *
+     * @param arena the arena owning the copy, or null to allocate it with new
+     * @return the copy
+     */
+    virtual Item* cloneItem(ItemArena* arena) const;
+
+    /**
+     * Adds copies of the children of the prototype to this copy of it. Containers override it.
+     *
+     * @param prototype the item this one is a copy of
+     * @param arena     the arena owning the copies, or null to allocate them with new
+     */
+    virtual void cloneChildren(const Item& /* prototype */, ItemArena* /* arena */) {}
+
+    /**
+     * Sets the attributes of this item back to the ones of the prototype, without invalidating
+     * anything. Each class overrides it to add its own attributes.
+     *
+     * @param prototype the item this one has been cloned from
+     * @return true if an attribute has changed
+     */
+    virtual bool copyAttributes(const Item& prototype);
+
+    /**
+     * Resets the children of this copy of the prototype, see {@link #resetSubtree(const Item&)}.
+     * Containers override it.
+     *
+     * @return false if the children don't match the ones of the prototype any more
+     */
+    virtual bool resetChildren(const Item& /* prototype */) { return true; }
+
+    /**
+     * Assigns the value to the attribute.
+     *
+     * @return true if the value has changed
+     */
+    template<typename T>
+    static bool assignAttribute(T& attribute, const T& value) {
+        if (attribute == value) {
+            return false;
+        }
+        attribute = value;
+        return true;
+    }
+
 public:
+    Item() = default;
+
+    /**
+     * Copies the attributes of the prototype, i.e. everything set through the setters. The copy
+     * doesn't belong to any container, has no children and has to be measured.
+     *
+     * @param prototype the item whose attributes are copied
+     */
+    Item(const Item& prototype);
+
+    Item& operator=(const Item&) = delete;
+
+    virtual ~Item() { ++sTreeMutations; }
+
+    /**
+     * Creates a copy of this item and of its descendants, e.g. to instantiate a cell template
+     * many times instead of building each cell with the setters. The attributes of each item are
+     * copied in one go and the copies keep the layout hash and the intrinsic sizes of their
+     * prototypes, so a container sharing its children's layouts doesn't have to hash them. The
+     * subtrees with a measure function compute them again.
+     *
+     * @param arena the arena owning the copies, or null to allocate each one with new
+     * @return the copy of this item, not added to any container
+     */
+    Item* cloneSubtree(ItemArena* arena = nullptr) const;
+
+    /**
+     * Sets the attributes of this subtree back to the ones of the prototype it has been cloned
+     * from, e.g. before binding a recycled item to new data. Only the items whose attributes
+     * actually differ are invalidated, and the items measured by a function without a content
+     * key, whose content is about to be bound. The others keep their measured size and are not
+     * measured again if their container gives them the same specs.
+     *
+     * @param prototype the root of the subtree this one has been cloned from
+     * @return false if the structure of the subtree differs from the prototype's, in which case
+     * it has to be cloned again
+     */
+    bool resetSubtree(const Item& prototype);
+
+    /**
+     * Sets the attributes of this item, but not of its children, to the ones of an item of the
+     * same class, invalidating it only if they differ.
+     *
+     * @param prototype the item to copy the attributes of
+     * @return false if the prototype has another class
+     */
+    bool resetAttributes(const Item& prototype);
+
 
     enum class Visibility {
         VISIBLE,
@@ -384,6 +933,99 @@ public:
 
     int getVisibility() const { return mViewFlags & VISIBILITY_MASK; }
 
+    /**
+     * Set the visibility state of this item.
+     *
+     * @param visibility One of {@link #VISIBLE}, {@link #INVISIBLE}, or {@link #GONE}.
+     */
+    void setVisibility(int visibility) {
+        if (getVisibility() != visibility) {
+            mViewFlags = (mViewFlags & ~VISIBILITY_MASK) | (visibility & VISIBILITY_MASK);
+            onLayoutParamsChanged();
+        }
+    }
+
+    /**
+     * @return the container of this item, or null if it hasn't been added to one.
+     */
+    Item* getParent() const { return mParent; }
+
+    /**
+     * Call this when something has changed which has invalidated the layout of this item.
+     * The request is propagated to the ancestors up to the nearest relayout boundary,
+     * which is the only item that has to be measured and laid out again.
+     * The setters of the attributes consumed by the container (size, margins, flex attributes...)
+     * notify the container themselves.
+     * Inside a {@link LayoutTransaction}, the request is applied when the transaction commits.
+     */
+    void requestLayout();
+
+    /**
+     * Forces this item to be laid out during the next layout pass, without notifying the
+     * ancestors.
+     */
+    void forceLayout() {
+        mPrivateFlags = (mPrivateFlags | PFLAG_FORCE_LAYOUT | PFLAG_LAYOUT_INVALIDATED) & ~PFLAG_LAYOUT_REQUIRED;
+        mMeasureCache.clear();
+    }
+
+    /**
+     * @return true if a layout has been requested on this item and not performed yet.
+     */
+    bool isLayoutRequested() const { return (mPrivateFlags & PFLAG_FORCE_LAYOUT) == PFLAG_FORCE_LAYOUT; }
+
+    /**
+     * Returns a hash of everything the layout of this subtree depends on apart from the specs:
+     * the class and the attributes of each item and the structure of the subtree. Two subtrees
+     * with the same hash measured with the same specs have the same measured layout.
+     *
+     * @return the layout hash, computed again only after a change in the subtree
+     */
+    size_t getLayoutHash();
+
+    /**
+     * Returns the min-content or max-content width of this item: its fixed width if it has one,
+     * otherwise the width its content needs with all the space it wants or with the least
+     * space, clamped by the min and max widths. Margins aren't included. Answered without
+     * measuring, and cached until something changes in the subtree.
+     *
+     * @param intrinsicSize {@link IntrinsicSize#MIN_CONTENT} or {@link IntrinsicSize#MAX_CONTENT}
+     * @return the intrinsic width
+     * @throws std::invalid_argument for another value of the intrinsic size
+     */
+    int getIntrinsicWidth(int intrinsicSize) { return getIntrinsicSize(true, intrinsicSize); }
+
+    /**
+     * Returns the min-content or max-content height of this item, see
+     * {@link #getIntrinsicWidth(int)}. The height of a container which wraps its content is
+     * the one it has at the matching intrinsic width.
+     *
+     * @param intrinsicSize {@link IntrinsicSize#MIN_CONTENT} or {@link IntrinsicSize#MAX_CONTENT}
+     * @return the intrinsic height
+     * @throws std::invalid_argument for another value of the intrinsic size
+     */
+    int getIntrinsicHeight(int intrinsicSize) { return getIntrinsicSize(false, intrinsicSize); }
+
+    /**
+     * Returns whether this item absorbs any change inside its subtree. That is the case for the
+     * root of a tree and for any item whose parent measured it with {@link MeasureSpec#EXACTLY}
+     * specs on both axes during the last measure pass, because its size then doesn't depend on
+     * its children, unless the parent uses its baseline, see
+     * {@link Layout#isChildBaselineUsed(const Item*)}.
+     *
+     * @return true if this item is a relayout boundary
+     */
+    bool isRelayoutBoundary() const;
+
+    /**
+     * Measures and lays out again the relayout boundaries below this item which requested a
+     * layout, reusing the specs and frames they had during the last pass. Items which are not
+     * on the path to a dirty boundary are not visited. The item has to be measured and laid
+     * out once before this can be used. A root measured with other than EXACTLY specs keeps its
+     * position but takes its new measured size.
+     */
+    void layoutIfNeeded();
+
     void measure(int widthMeasureSpec, int heightMeasureSpec);
 
     int getMeasuredWidth() const { return mMeasuredWidth & MEASURED_SIZE_MASK; }
@@ -408,11 +1050,77 @@ public:
 
     int getMeasuredState();
 
-    int getBaseline();
+    /**
+     * Returns the distance from the top of this item to its baseline, computed by the last
+     * measure: the baseline returned by the measure function of an item without children, or for
+     * a container the baseline of its first child or line. 0 if the item has none.
+     *
+     * @return the baseline of this item
+     */
+    int getBaseline() const { return mBaseline; }
+
+    /**
+     * Sets the function measuring the content of this item, which mustn't have children, and
+     * requests a layout. Call {@link #requestLayout()} when the content changes. An item with a
+     * measure function only has the layout hash of another item if both have the same content
+     * key, see {@link #setContentKey(size_t)}. The measure function is copied by
+     * {@link #cloneSubtree(ItemArena*)} but left as is by {@link #resetSubtree(const Item&)}.
+     *
+     * @param measureFunction the measure function, or null to take the min size
+     */
+    void setMeasureFunction(MeasureFunction measureFunction) {
+        mMeasureFunction = std::move(measureFunction);
+        requestLayout();
+    }
+
+    /**
+     * Sets the key identifying the content measured by the measure function, e.g. a hash of the
+     * text and its font, and requests a layout if it changes. Items whose measure functions
+     * measure the same content the same way, with equal attributes, get the same layout hash and
+     * may share their layouts. 0, the default, means that the content can't be compared: the
+     * item then never has the layout hash of another item. Like the measure function, the key is
+     * copied by {@link #cloneSubtree(ItemArena*)} but left as is by
+     * {@link #resetSubtree(const Item&)}.
+     *
+     * @param contentKey the key of the content, or 0
+     */
+    void setContentKey(size_t contentKey) {
+        if (mContentKey != contentKey) {
+            mContentKey = contentKey;
+            requestLayout();
+        }
+    }
+
+    size_t getContentKey() const { return mContentKey; }
 
     void setMeasuredDimension(int measuredWidth, int measuredHeight);
 
+    /**
+     * Returns whether the measured size computed for the last specs is still the result of
+     * measuring with the given specs. The default measure fills a bounded spec, so the new spec
+     * has to be bounded by the measured size, or unbounded like the last one. A subclass which
+     * measures a content has to override this along with {@link #onMeasure(int, int)}. It never
+     * is for an item with a measure function, whose size along an axis may depend on the other.
+     *
+     * @param widthMeasureSpec  the new horizontal space requirements
+     * @param heightMeasureSpec the new vertical space requirements
+     * @return true if the item doesn't have to be measured again
+     */
+    virtual bool isMeasurementValidFor(int widthMeasureSpec, int heightMeasureSpec) const;
+
     void layout(int l, int t, int r, int b);
 
     bool setFrame(int left, int top, int right, int bottom);
+
+    /** The id of an item which hasn't been given one */
+    static constexpr int NO_ID = -1;
+
+    /**
+     * Sets the id identifying the item in the results written by a {@link LayoutResultWriter},
+     * e.g. the id of the node it has been created for in the renderer. Not copied by
+     * {@link #cloneSubtree(ItemArena*)}.
+     */
+    void setId(int id) { mId = id; }
+
+    int getId() const { return mId; }
 };
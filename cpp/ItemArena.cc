@@ -0,0 +1,31 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <cstdint>
+#include "ItemArena.h"
+
+ItemArena::~ItemArena() {
+    for (auto it = mItems.rbegin(); it != mItems.rend(); ++it) {
+        (*it)->~Item();
+    }
+}
+
+void* ItemArena::allocate(size_t size, size_t alignment) {
+    auto address = reinterpret_cast<uintptr_t>(mCursor);
+    size_t padding = (alignment - address % alignment) % alignment;
+    if (mCursor == nullptr || size + padding > static_cast<size_t>(mEnd - mCursor)) {
+        // Blocks come from new[], aligned for any fundamental type.
+        size_t blockSize = size > mBlockSize ? size : mBlockSize;
+        mBlocks.emplace_back(new char[blockSize]);
+        mCursor = mBlocks.back().get();
+        mEnd = mCursor + blockSize;
+        padding = 0;
+    }
+    void* memory = mCursor + padding;
+    mCursor += padding + size;
+    return memory;
+}
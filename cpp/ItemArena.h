@@ -0,0 +1,82 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#pragma once
+
+#include <memory>
+#include <new>
+#include <vector>
+#include "Item.h"
+
+/**
+ * Owns items allocated one after the other in large blocks, e.g. the copies of a template made
+ * by {@link Item#cloneSubtree(ItemArena*)}, so that instantiating many subtrees doesn't go
+ * through the allocator for each item. The items are destroyed with the arena, they must not be
+ * deleted individually.
+ */
+class ItemArena {
+public:
+    /** The default size of the blocks the items are allocated from */
+    static constexpr size_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+    /**
+     * @param blockSize the size of the blocks, larger items get a block of their own
+     */
+    explicit ItemArena(size_t blockSize = DEFAULT_BLOCK_SIZE) : mBlockSize(blockSize) {}
+
+    /**
+     * Destroys the items in the reverse order of their creation.
+     */
+    ~ItemArena();
+
+    ItemArena(const ItemArena&) = delete;
+
+    ItemArena& operator=(const ItemArena&) = delete;
+
+    /**
+     * Creates an item in the arena with the default constructor of its class.
+     *
+     * @return the item, owned by the arena
+     */
+    template<typename T>
+    T* create() {
+        T* item = new(allocate(sizeof(T), alignof(T))) T();
+        mItems.push_back(item);
+        return item;
+    }
+
+    /**
+     * Creates a copy of the item in the arena with the copy constructor of its class.
+     *
+     * @param prototype the item to copy
+     * @return the copy, owned by the arena
+     */
+    template<typename T>
+    T* copy(const T& prototype) {
+        T* item = new(allocate(sizeof(T), alignof(T))) T(prototype);
+        mItems.push_back(item);
+        return item;
+    }
+
+    /**
+     * @return the number of items owned by the arena.
+     */
+    int size() const { return static_cast<int>(mItems.size()); }
+
+private:
+    size_t mBlockSize;
+
+    std::vector<std::unique_ptr<char[]>> mBlocks;
+
+    /** The free space of the current block */
+    char* mCursor = nullptr;
+    char* mEnd = nullptr;
+
+    std::vector<Item*> mItems;
+
+    void* allocate(size_t size, size_t alignment);
+};
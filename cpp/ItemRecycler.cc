@@ -0,0 +1,67 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <stdexcept>
+#include <string>
+#include "ItemRecycler.h"
+#include "Layout.h"
+
+void ItemRecycler::setPrototype(int viewType, const Item* prototype) {
+    Pool& pool = mPools[viewType];
+    if (pool.prototype != prototype) {
+        pool.prototype = prototype;
+        // The recycled subtrees may not have the structure of the new template.
+        for (Item* item : pool.recycled) {
+            release(item);
+        }
+        pool.recycled.clear();
+    }
+}
+
+Item* ItemRecycler::obtain(int viewType) {
+    Pool& pool = getPool(viewType);
+    while (!pool.recycled.empty()) {
+        Item* item = pool.recycled.back();
+        pool.recycled.pop_back();
+        if (item->resetSubtree(*pool.prototype)) {
+            return item;
+        }
+        // Children have been added to or removed from the subtree, it is dropped.
+        release(item);
+    }
+    std::unique_ptr<ItemArena> arena(new ItemArena(SUBTREE_BLOCK_SIZE));
+    Item* item = pool.prototype->cloneSubtree(arena.get());
+    mArenas.emplace(item, std::move(arena));
+    return item;
+}
+
+void ItemRecycler::recycle(int viewType, Item* item) {
+    Pool& pool = getPool(viewType);
+    Layout* parent = static_cast<Layout*>(item->getParent());
+    if (parent != nullptr) {
+        parent->removeItemAt(parent->indexOfChild(item));
+    }
+    pool.recycled.push_back(item);
+}
+
+int ItemRecycler::getRecycledCount(int viewType) const {
+    auto it = mPools.find(viewType);
+    return it != mPools.end() ? static_cast<int>(it->second.recycled.size()) : 0;
+}
+
+ItemRecycler::Pool& ItemRecycler::getPool(int viewType) {
+    auto it = mPools.find(viewType);
+    if (it == mPools.end() || it->second.prototype == nullptr) {
+        throw std::invalid_argument("No prototype is set for the view type: " + std::to_string(viewType));
+    }
+    return it->second;
+}
+
+void ItemRecycler::release(Item* item) {
+    // A subtree the recycler hasn't cloned is only forgotten.
+    mArenas.erase(item);
+}
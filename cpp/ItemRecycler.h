@@ -0,0 +1,107 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "ItemArena.h"
+
+/**
+ * A pool of detached subtrees for virtualized lists, which add and remove items at the edges of
+ * the viewport while scrolling. Each view type has a template; the subtrees handed out are
+ * recycled ones reset to their template, and new copies of it only when the pool of the type is
+ * empty.
+ *
+ * <pre>
+ * Item* row = recycler.obtain(ROW);
+ * bind(row, data);
+ * list->addItem(row);
+ * ...
+ * recycler.recycle(ROW, list->getChildAt(0));
+ * </pre>
+ *
+ * A recycled subtree keeps its measured size and the specs it has been measured with. Once reset
+ * to the template and bound, it isn't measured again unless a binding changed its attributes or
+ * its content, or its container gives it other specs. The reset invalidates the items measured by
+ * a function without a content key, whose content only the binding knows; the binding sets the
+ * content key of the others, which invalidates them if it changes. Scrolling through a list of a
+ * few view types therefore allocates nothing once each pool holds the items of a screen.
+ *
+ * Each subtree is cloned into an arena of its own, released when the subtree is dropped because
+ * it doesn't match its template any more, or when the recycler is destroyed. The items removed
+ * from an obtained subtree stay in its arena and are released with it.
+ */
+class ItemRecycler {
+public:
+    ItemRecycler() = default;
+
+    ItemRecycler(const ItemRecycler&) = delete;
+
+    ItemRecycler& operator=(const ItemRecycler&) = delete;
+
+    /**
+     * Sets the template of a view type. The subtrees recycled for the type must have been
+     * obtained for it. The template must not change while the recycler uses it.
+     *
+     * @param viewType  the view type
+     * @param prototype the root of the template, not added to any container
+     */
+    void setPrototype(int viewType, const Item* prototype);
+
+    /**
+     * Returns a subtree of the view type, reset to its template.
+     *
+     * @param viewType the view type
+     * @return the root of the subtree, not added to any container
+     * @throws std::invalid_argument if the view type has no template
+     */
+    Item* obtain(int viewType);
+
+    /**
+     * Detaches the subtree from its container if it has one and keeps it for the next call to
+     * {@link #obtain(int)} with the view type.
+     *
+     * @param viewType the view type the subtree has been obtained for
+     * @param item     the root of the subtree
+     */
+    void recycle(int viewType, Item* item);
+
+    /**
+     * @return the number of subtrees of the view type waiting to be obtained.
+     */
+    int getRecycledCount(int viewType) const;
+
+    /**
+     * @return the number of subtrees owned by the recycler, obtained or waiting to be.
+     */
+    int getSubtreeCount() const { return static_cast<int>(mArenas.size()); }
+
+private:
+    /** The size of the blocks of the arena of a subtree, which holds the items of a list row */
+    static constexpr size_t SUBTREE_BLOCK_SIZE = 4 * 1024;
+
+    struct Pool {
+        const Item* prototype = nullptr;
+        std::vector<Item*> recycled;
+    };
+
+    std::unordered_map<int, Pool> mPools;
+
+    /**
+     * The arenas owning the subtrees cloned from the templates, by root.
+     */
+    std::unordered_map<const Item*, std::unique_ptr<ItemArena>> mArenas;
+
+    Pool& getPool(int viewType);
+
+    /**
+     * Destroys a detached subtree cloned by the recycler, along with the items of its arena.
+     */
+    void release(Item* item);
+};
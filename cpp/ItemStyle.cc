@@ -0,0 +1,578 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+#include "ItemStyle.h"
+#include "FlexLayout.h"
+
+static constexpr uint32_t MARGIN_MASK = 1u << ItemStyle::MARGIN_LEFT | 1u << ItemStyle::MARGIN_TOP
+                                        | 1u << ItemStyle::MARGIN_RIGHT | 1u << ItemStyle::MARGIN_BOTTOM;
+static constexpr uint32_t PADDING_MASK = 1u << ItemStyle::PADDING_LEFT | 1u << ItemStyle::PADDING_TOP
+                                         | 1u << ItemStyle::PADDING_RIGHT | 1u << ItemStyle::PADDING_BOTTOM;
+static constexpr uint32_t LAYOUT_MASK = ~0u << ItemStyle::PADDING_LEFT;
+static constexpr uint32_t FLEX_LAYOUT_MASK = ~0u << ItemStyle::FLEX_DIRECTION;
+
+using Tokens = std::vector<std::string>;
+
+/**
+ * Compiles the tokens of the value of a property, returns false if they aren't valid.
+ */
+using Compiler = bool (*)(ItemStyle& style, const Tokens& tokens);
+
+struct Keyword {
+    const char* name;
+    int value;
+};
+
+static bool parseDouble(const std::string& token, double& value, const char* unit) {
+    char* end = nullptr;
+    value = std::strtod(token.c_str(), &end);
+    if (end == token.c_str() || !std::isfinite(value)) {
+        return false;
+    }
+    return *end == '\0' || (unit != nullptr && std::strcmp(end, unit) == 0);
+}
+
+static bool parseNumber(const std::string& token, float& value, const char* unit) {
+    double number;
+    if (!parseDouble(token, number, unit) || std::fabs(number) > FLT_MAX) {
+        return false;
+    }
+    value = static_cast<float>(number);
+    return true;
+}
+
+/**
+ * Parses a length truncated to an int, as the items take them, rejecting one out of the range of
+ * an int.
+ */
+static bool parseLength(const std::string& token, int& value) {
+    double number;
+    if (!parseDouble(token, number, "px") || !(number > INT_MIN - 1.0 && number < INT_MAX + 1.0)) {
+        return false;
+    }
+    value = static_cast<int>(number);
+    return true;
+}
+
+/**
+ * Parses a percentage as a fraction, e.g. 0.5 for 50%.
+ */
+static bool parsePercent(const std::string& token, float& value) {
+    if (token.empty() || token.back() != '%' || !parseNumber(token.substr(0, token.size() - 1), value, nullptr)) {
+        return false;
+    }
+    value /= 100;
+    return true;
+}
+
+template<size_t N>
+static bool parseKeyword(const Keyword (&keywords)[N], const Tokens& tokens, int& value) {
+    if (tokens.size() != 1) {
+        return false;
+    }
+    for (const Keyword& keyword : keywords) {
+        if (tokens[0] == keyword.name) {
+            value = keyword.value;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Compiles a width or a height: a length, a percentage or auto.
+ */
+static bool compileSize(ItemStyle& style, const Tokens& tokens, int property, int percentProperty) {
+    float percent;
+    int length;
+    if (tokens.size() != 1) {
+        return false;
+    }
+    if (tokens[0] == "auto") {
+        style.setInt(property, Item::LayoutParams::WRAP_CONTENT);
+        style.setFloat(percentProperty, 1);
+    } else if (parsePercent(tokens[0], percent)) {
+        style.setInt(property, Item::LayoutParams::MATCH_PARENT);
+        style.setFloat(percentProperty, percent);
+    } else if (parseLength(tokens[0], length) && length >= 0) {
+        style.setInt(property, length);
+        // The percentage only applies to match_parent, it's reset so that merged styles are exact.
+        style.setFloat(percentProperty, 1);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static bool compileLength(ItemStyle& style, const Tokens& tokens, int property, const char* none, int noneValue) {
+    int value;
+    if (tokens.size() == 1 && tokens[0] == none) {
+        style.setInt(property, noneValue);
+    } else if (tokens.size() == 1 && parseLength(tokens[0], value) && value >= 0) {
+        style.setInt(property, value);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Compiles the margin or padding shorthand: top [right [bottom [left]]].
+ */
+static bool compileBox(ItemStyle& style, const Tokens& tokens, int left, int top, int right, int bottom) {
+    int values[4];
+    if (tokens.empty() || tokens.size() > 4) {
+        return false;
+    }
+    for (size_t i = 0; i < tokens.size(); i++) {
+        if (!parseLength(tokens[i], values[i])) {
+            return false;
+        }
+    }
+    style.setInt(top, values[0]);
+    style.setInt(right, tokens.size() > 1 ? values[1] : values[0]);
+    style.setInt(bottom, tokens.size() > 2 ? values[2] : values[0]);
+    style.setInt(left, tokens.size() > 3 ? values[3] : style.getInt(right));
+    return true;
+}
+
+static bool compileSide(ItemStyle& style, const Tokens& tokens, int property) {
+    int value;
+    if (tokens.size() != 1 || !parseLength(tokens[0], value)) {
+        return false;
+    }
+    style.setInt(property, value);
+    return true;
+}
+
+static bool compileFactor(ItemStyle& style, const Tokens& tokens, int property) {
+    float value;
+    if (tokens.size() != 1 || !parseNumber(tokens[0], value, nullptr) || value < 0) {
+        return false;
+    }
+    style.setFloat(property, value);
+    return true;
+}
+
+static bool compileFlexBasis(ItemStyle& style, const std::string& token) {
+    float percent;
+    int length;
+    if (token == "auto") {
+        style.setFloat(ItemStyle::FLEX_BASIS_PERCENT, Item::FLEX_BASIS_PERCENT_DEFAULT);
+        style.setInt(ItemStyle::FLEX_BASIS, -1);
+    } else if (parsePercent(token, percent) && percent >= 0) {
+        style.setFloat(ItemStyle::FLEX_BASIS_PERCENT, percent);
+        style.setInt(ItemStyle::FLEX_BASIS, -1);
+    } else if (parseLength(token, length) && length >= 0) {
+        style.setFloat(ItemStyle::FLEX_BASIS_PERCENT, Item::FLEX_BASIS_PERCENT_DEFAULT);
+        style.setInt(ItemStyle::FLEX_BASIS, length);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Compiles the flex shorthand: none, auto, initial, or grow [shrink] and a basis, before or
+ * after them, either being optional.
+ */
+static bool compileFlex(ItemStyle& style, const Tokens& tokens) {
+    if (tokens.size() == 1 && (tokens[0] == "none" || tokens[0] == "auto" || tokens[0] == "initial")) {
+        style.setFloat(ItemStyle::FLEX_GROW, tokens[0] == "auto" ? 1 : 0);
+        style.setFloat(ItemStyle::FLEX_SHRINK, tokens[0] == "none" ? 0 : 1);
+        return compileFlexBasis(style, "auto");
+    }
+    if (tokens.empty() || tokens.size() > 3) {
+        return false;
+    }
+    // A unitless number is a factor, so "1 0" sets the shrink factor rather than the basis.
+    float factors[2] = {1, 1};
+    size_t factorCount = 0;
+    float value;
+    size_t first = parseNumber(tokens[0], value, nullptr) ? 0 : 1;
+    for (size_t i = first; i < tokens.size() && factorCount < 2 && parseNumber(tokens[i], value, nullptr); i++) {
+        if (value < 0) {
+            return false;
+        }
+        factors[factorCount++] = value;
+    }
+    size_t basisCount = tokens.size() - factorCount;
+    if (basisCount > 1) {
+        return false;
+    }
+    // Without a basis, grow sets a basis of 0%, as in CSS.
+    const std::string& basis = basisCount == 0 ? "0%" : first == 1 ? tokens[0] : tokens.back();
+    if (!compileFlexBasis(style, basis)) {
+        return false;
+    }
+    style.setFloat(ItemStyle::FLEX_GROW, factors[0]);
+    style.setFloat(ItemStyle::FLEX_SHRINK, factors[1]);
+    return true;
+}
+
+static const Keyword ALIGN_SELF_KEYWORDS[] = {
+        {"auto", AlignSelf::AUTO}, {"flex-start", AlignSelf::FLEX_START}, {"flex-end", AlignSelf::FLEX_END},
+        {"center", AlignSelf::CENTER}, {"baseline", AlignSelf::BASELINE}, {"stretch", AlignSelf::STRETCH}};
+
+static const Keyword VISIBILITY_KEYWORDS[] = {
+        {"visible", Item::VISIBLE}, {"hidden", Item::INVISIBLE}, {"collapse", Item::GONE}};
+
+static const Keyword FLEX_DIRECTION_KEYWORDS[] = {
+        {"row", FlexDirection::ROW}, {"row-reverse", FlexDirection::ROW_REVERSE},
+        {"column", FlexDirection::COLUMN}, {"column-reverse", FlexDirection::COLUMN_REVERSE}};
+
+static const Keyword FLEX_WRAP_KEYWORDS[] = {
+        {"nowrap", FlexWrap::NOWRAP}, {"wrap", FlexWrap::WRAP}, {"wrap-reverse", FlexWrap::WRAP_REVERSE}};
+
+static const Keyword JUSTIFY_CONTENT_KEYWORDS[] = {
+        {"flex-start", JustifyContent::FLEX_START}, {"flex-end", JustifyContent::FLEX_END},
+        {"center", JustifyContent::CENTER}, {"space-between", JustifyContent::SPACE_BETWEEN},
+        {"space-around", JustifyContent::SPACE_AROUND}, {"space-evenly", JustifyContent::SPACE_EVENLY}};
+
+static const Keyword ALIGN_ITEMS_KEYWORDS[] = {
+        {"flex-start", AlignItems::FLEX_START}, {"flex-end", AlignItems::FLEX_END}, {"center", AlignItems::CENTER},
+        {"baseline", AlignItems::BASELINE}, {"stretch", AlignItems::STRETCH}};
+
+static const Keyword ALIGN_CONTENT_KEYWORDS[] = {
+        {"flex-start", AlignContent::FLEX_START}, {"flex-end", AlignContent::FLEX_END},
+        {"center", AlignContent::CENTER}, {"space-between", AlignContent::SPACE_BETWEEN},
+        {"space-around", AlignContent::SPACE_AROUND}, {"stretch", AlignContent::STRETCH}};
+
+#define KEYWORD_COMPILER(keywords, property)                        \
+    [](ItemStyle& style, const Tokens& tokens) {                    \
+        int value;                                                  \
+        if (!parseKeyword(keywords, tokens, value)) {               \
+            return false;                                           \
+        }                                                           \
+        style.setInt(property, value);                              \
+        return true;                                                \
+    }
+
+static Compiler findCompiler(const std::string& property) {
+    static const std::unordered_map<std::string, Compiler> compilers = {
+            {"width", [](ItemStyle& style, const Tokens& tokens) {
+                return compileSize(style, tokens, ItemStyle::WIDTH, ItemStyle::WIDTH_PERCENT);
+            }},
+            {"height", [](ItemStyle& style, const Tokens& tokens) {
+                return compileSize(style, tokens, ItemStyle::HEIGHT, ItemStyle::HEIGHT_PERCENT);
+            }},
+            {"min-width", [](ItemStyle& style, const Tokens& tokens) {
+                return compileLength(style, tokens, ItemStyle::MIN_WIDTH, "auto", Item::NOT_SET);
+            }},
+            {"min-height", [](ItemStyle& style, const Tokens& tokens) {
+                return compileLength(style, tokens, ItemStyle::MIN_HEIGHT, "auto", Item::NOT_SET);
+            }},
+            {"max-width", [](ItemStyle& style, const Tokens& tokens) {
+                return compileLength(style, tokens, ItemStyle::MAX_WIDTH, "none", Item::MAX_SIZE);
+            }},
+            {"max-height", [](ItemStyle& style, const Tokens& tokens) {
+                return compileLength(style, tokens, ItemStyle::MAX_HEIGHT, "none", Item::MAX_SIZE);
+            }},
+            {"margin", [](ItemStyle& style, const Tokens& tokens) {
+                return compileBox(style, tokens, ItemStyle::MARGIN_LEFT, ItemStyle::MARGIN_TOP,
+                                  ItemStyle::MARGIN_RIGHT, ItemStyle::MARGIN_BOTTOM);
+            }},
+            {"margin-left", [](ItemStyle& style, const Tokens& tokens) {
+                return compileSide(style, tokens, ItemStyle::MARGIN_LEFT);
+            }},
+            {"margin-top", [](ItemStyle& style, const Tokens& tokens) {
+                return compileSide(style, tokens, ItemStyle::MARGIN_TOP);
+            }},
+            {"margin-right", [](ItemStyle& style, const Tokens& tokens) {
+                return compileSide(style, tokens, ItemStyle::MARGIN_RIGHT);
+            }},
+            {"margin-bottom", [](ItemStyle& style, const Tokens& tokens) {
+                return compileSide(style, tokens, ItemStyle::MARGIN_BOTTOM);
+            }},
+            {"padding", [](ItemStyle& style, const Tokens& tokens) {
+                return compileBox(style, tokens, ItemStyle::PADDING_LEFT, ItemStyle::PADDING_TOP,
+                                  ItemStyle::PADDING_RIGHT, ItemStyle::PADDING_BOTTOM);
+            }},
+            {"padding-left", [](ItemStyle& style, const Tokens& tokens) {
+                return compileSide(style, tokens, ItemStyle::PADDING_LEFT);
+            }},
+            {"padding-top", [](ItemStyle& style, const Tokens& tokens) {
+                return compileSide(style, tokens, ItemStyle::PADDING_TOP);
+            }},
+            {"padding-right", [](ItemStyle& style, const Tokens& tokens) {
+                return compileSide(style, tokens, ItemStyle::PADDING_RIGHT);
+            }},
+            {"padding-bottom", [](ItemStyle& style, const Tokens& tokens) {
+                return compileSide(style, tokens, ItemStyle::PADDING_BOTTOM);
+            }},
+            {"order", [](ItemStyle& style, const Tokens& tokens) {
+                double value;
+                if (tokens.size() != 1 || !parseDouble(tokens[0], value, nullptr) || value != std::floor(value)
+                    || value < INT_MIN || value > INT_MAX) {
+                    return false;
+                }
+                style.setInt(ItemStyle::ORDER, static_cast<int>(value));
+                return true;
+            }},
+            {"flex", compileFlex},
+            {"flex-grow", [](ItemStyle& style, const Tokens& tokens) {
+                return compileFactor(style, tokens, ItemStyle::FLEX_GROW);
+            }},
+            {"flex-shrink", [](ItemStyle& style, const Tokens& tokens) {
+                return compileFactor(style, tokens, ItemStyle::FLEX_SHRINK);
+            }},
+            {"flex-basis", [](ItemStyle& style, const Tokens& tokens) {
+                return tokens.size() == 1 && compileFlexBasis(style, tokens[0]);
+            }},
+            {"align-self", KEYWORD_COMPILER(ALIGN_SELF_KEYWORDS, ItemStyle::ALIGN_SELF)},
+            {"visibility", KEYWORD_COMPILER(VISIBILITY_KEYWORDS, ItemStyle::VISIBILITY)},
+            {"flex-direction", KEYWORD_COMPILER(FLEX_DIRECTION_KEYWORDS, ItemStyle::FLEX_DIRECTION)},
+            {"flex-wrap", KEYWORD_COMPILER(FLEX_WRAP_KEYWORDS, ItemStyle::FLEX_WRAP)},
+            {"justify-content", KEYWORD_COMPILER(JUSTIFY_CONTENT_KEYWORDS, ItemStyle::JUSTIFY_CONTENT)},
+            {"align-items", KEYWORD_COMPILER(ALIGN_ITEMS_KEYWORDS, ItemStyle::ALIGN_ITEMS)},
+            {"align-content", KEYWORD_COMPILER(ALIGN_CONTENT_KEYWORDS, ItemStyle::ALIGN_CONTENT)},
+    };
+    auto it = compilers.find(property);
+    return it != compilers.end() ? it->second : nullptr;
+}
+
+#undef KEYWORD_COMPILER
+
+void ItemStyle::merge(const ItemStyle& other) {
+    for (int property = 0; property < PROPERTY_COUNT; property++) {
+        if (other.has(property)) {
+            mMask |= 1u << property;
+            mValues[property] = other.mValues[property];
+        }
+    }
+}
+
+bool ItemStyle::compile(const std::string& property, const std::string& value) {
+    Compiler compiler = findCompiler(property);
+    if (compiler == nullptr) {
+        return false;
+    }
+    Tokens tokens;
+    std::istringstream stream(value);
+    for (std::string token; stream >> token;) {
+        tokens.push_back(token);
+    }
+    // Compiled apart, so that an invalid value leaves the style unchanged.
+    ItemStyle declaration;
+    if (!compiler(declaration, tokens)) {
+        return false;
+    }
+    merge(declaration);
+    return true;
+}
+
+/**
+ * @return the values of the properties of a new item
+ */
+static ItemStyle createDefaults() {
+    FlexLayout layout;
+    ItemStyle defaults;
+    defaults.setInt(ItemStyle::WIDTH, layout.getWidth());
+    defaults.setInt(ItemStyle::HEIGHT, layout.getHeight());
+    defaults.setFloat(ItemStyle::WIDTH_PERCENT, layout.getWidthPercent());
+    defaults.setFloat(ItemStyle::HEIGHT_PERCENT, layout.getHeightPercent());
+    defaults.setInt(ItemStyle::MIN_WIDTH, layout.getMinWidth());
+    defaults.setInt(ItemStyle::MIN_HEIGHT, layout.getMinHeight());
+    defaults.setInt(ItemStyle::MAX_WIDTH, layout.getMaxWidth());
+    defaults.setInt(ItemStyle::MAX_HEIGHT, layout.getMaxHeight());
+    defaults.setInt(ItemStyle::MARGIN_LEFT, layout.getMarginLeft());
+    defaults.setInt(ItemStyle::MARGIN_TOP, layout.getMarginTop());
+    defaults.setInt(ItemStyle::MARGIN_RIGHT, layout.getMarginRight());
+    defaults.setInt(ItemStyle::MARGIN_BOTTOM, layout.getMarginBottom());
+    defaults.setInt(ItemStyle::ORDER, layout.getOrder());
+    defaults.setFloat(ItemStyle::FLEX_GROW, layout.getFlexGrow());
+    defaults.setFloat(ItemStyle::FLEX_SHRINK, layout.getFlexShrink());
+    defaults.setFloat(ItemStyle::FLEX_BASIS_PERCENT, layout.getFlexBasisPercent());
+    defaults.setInt(ItemStyle::ALIGN_SELF, layout.getAlignSelf());
+    defaults.setInt(ItemStyle::VISIBILITY, layout.getVisibility());
+    defaults.setInt(ItemStyle::FLEX_BASIS, -1);
+    defaults.setInt(ItemStyle::PADDING_LEFT, layout.getPaddingLeft());
+    defaults.setInt(ItemStyle::PADDING_TOP, layout.getPaddingTop());
+    defaults.setInt(ItemStyle::PADDING_RIGHT, layout.getPaddingRight());
+    defaults.setInt(ItemStyle::PADDING_BOTTOM, layout.getPaddingBottom());
+    defaults.setInt(ItemStyle::FLEX_DIRECTION, layout.getFlexDirection());
+    defaults.setInt(ItemStyle::FLEX_WRAP, layout.getFlexWrap());
+    defaults.setInt(ItemStyle::JUSTIFY_CONTENT, layout.getJustifyContent());
+    defaults.setInt(ItemStyle::ALIGN_ITEMS, layout.getAlignItems());
+    defaults.setInt(ItemStyle::ALIGN_CONTENT, layout.getAlignContent());
+    return defaults;
+}
+
+static const ItemStyle& getDefaults() {
+    static const ItemStyle defaults = createDefaults();
+    return defaults;
+}
+
+void ItemStyle::apply(Item* item, const ItemStyle* previous) const {
+    uint32_t removed = previous != nullptr ? previous->mMask & ~mMask : 0;
+    if (removed != 0) {
+        ItemStyle style;
+        for (int property = 0; property < PROPERTY_COUNT; property++) {
+            if ((removed & (1u << property)) != 0) {
+                style.mMask |= 1u << property;
+                style.mValues[property] = getDefaults().mValues[property];
+            }
+        }
+        style.merge(*this);
+        // Sets every property of the previous style, nothing is removed any more.
+        style.apply(item, previous);
+        return;
+    }
+    if (has(WIDTH)) {
+        item->setWidth(getInt(WIDTH));
+    }
+    if (has(HEIGHT)) {
+        item->setHeight(getInt(HEIGHT));
+    }
+    if (has(WIDTH_PERCENT)) {
+        item->setWidthPercent(getFloat(WIDTH_PERCENT));
+    }
+    if (has(HEIGHT_PERCENT)) {
+        item->setHeightPercent(getFloat(HEIGHT_PERCENT));
+    }
+    if (has(MIN_WIDTH)) {
+        item->setMinWidth(getInt(MIN_WIDTH));
+    }
+    if (has(MIN_HEIGHT)) {
+        item->setMinHeight(getInt(MIN_HEIGHT));
+    }
+    if (has(MAX_WIDTH)) {
+        item->setMaxWidth(getInt(MAX_WIDTH));
+    }
+    if (has(MAX_HEIGHT)) {
+        item->setMaxHeight(getInt(MAX_HEIGHT));
+    }
+    if ((mMask & MARGIN_MASK) != 0) {
+        item->setMargins(has(MARGIN_LEFT) ? getInt(MARGIN_LEFT) : item->getMarginLeft(),
+                         has(MARGIN_TOP) ? getInt(MARGIN_TOP) : item->getMarginTop(),
+                         has(MARGIN_RIGHT) ? getInt(MARGIN_RIGHT) : item->getMarginRight(),
+                         has(MARGIN_BOTTOM) ? getInt(MARGIN_BOTTOM) : item->getMarginBottom());
+    }
+    if (has(ORDER)) {
+        item->setOrder(getInt(ORDER));
+    }
+    if (has(FLEX_GROW)) {
+        item->setFlexGrow(getFloat(FLEX_GROW));
+    }
+    if (has(FLEX_SHRINK)) {
+        item->setFlexShrink(getFloat(FLEX_SHRINK));
+    }
+    if (has(FLEX_BASIS_PERCENT)) {
+        item->setFlexBasisPercent(getFloat(FLEX_BASIS_PERCENT));
+    }
+    if (has(ALIGN_SELF)) {
+        item->setAlignSelf(getInt(ALIGN_SELF));
+    }
+    if (has(VISIBILITY)) {
+        item->setVisibility(getInt(VISIBILITY));
+    }
+    auto container = dynamic_cast<FlexLayout*>(item->getParent());
+    // A length replaces the main size, which is set back when a later style has none.
+    if (container != nullptr && (hasFlexBasisLength() || (previous != nullptr && previous->hasFlexBasisLength()))) {
+        applySize(item, container->isMainAxisDirectionHorizontal(), hasFlexBasisLength());
+    }
+    if ((mMask & LAYOUT_MASK) == 0) {
+        return;
+    }
+    auto layout = dynamic_cast<Layout*>(item);
+    if (layout == nullptr) {
+        return;
+    }
+    if ((mMask & PADDING_MASK) != 0) {
+        layout->setPadding(has(PADDING_LEFT) ? getInt(PADDING_LEFT) : layout->getPaddingLeft(),
+                           has(PADDING_TOP) ? getInt(PADDING_TOP) : layout->getPaddingTop(),
+                           has(PADDING_RIGHT) ? getInt(PADDING_RIGHT) : layout->getPaddingRight(),
+                           has(PADDING_BOTTOM) ? getInt(PADDING_BOTTOM) : layout->getPaddingBottom());
+    }
+    auto flexLayout = (mMask & FLEX_LAYOUT_MASK) != 0 ? dynamic_cast<FlexLayout*>(item) : nullptr;
+    if (flexLayout == nullptr) {
+        return;
+    }
+    if (has(FLEX_DIRECTION)) {
+        flexLayout->setFlexDirection(getInt(FLEX_DIRECTION));
+    }
+    if (has(FLEX_WRAP)) {
+        flexLayout->setFlexWrap(getInt(FLEX_WRAP));
+    }
+    if (has(JUSTIFY_CONTENT)) {
+        flexLayout->setJustifyContent(getInt(JUSTIFY_CONTENT));
+    }
+    if (has(ALIGN_ITEMS)) {
+        flexLayout->setAlignItems(getInt(ALIGN_ITEMS));
+    }
+    if (has(ALIGN_CONTENT)) {
+        flexLayout->setAlignContent(getInt(ALIGN_CONTENT));
+    }
+}
+
+void ItemStyle::resolveFlexBasis(Item* item, const ItemStyle* previous) const {
+    auto container = dynamic_cast<FlexLayout*>(item->getParent());
+    if (container == nullptr || !(hasFlexBasisLength() || (previous != nullptr && previous->hasFlexBasisLength()))) {
+        return;
+    }
+    bool horizontal = container->isMainAxisDirectionHorizontal();
+    applySize(item, !horizontal, false);
+    applySize(item, horizontal, hasFlexBasisLength());
+}
+
+void ItemStyle::applySize(Item* item, bool horizontal, bool flexBasis) const {
+    int sizeProperty = horizontal ? WIDTH : HEIGHT;
+    const ItemStyle& sizes = has(sizeProperty) && !flexBasis ? *this : getDefaults();
+    int size = flexBasis ? getInt(FLEX_BASIS) : sizes.getInt(sizeProperty);
+    if (horizontal) {
+        item->setWidth(size);
+        item->setWidthPercent(sizes.getFloat(WIDTH_PERCENT));
+    } else {
+        item->setHeight(size);
+        item->setHeightPercent(sizes.getFloat(HEIGHT_PERCENT));
+    }
+}
+
+size_t ItemStyle::hash() const {
+    static_assert(sizeof(Value) == sizeof(uint32_t), "A value is hashed as 32 bits");
+    size_t hash = mMask;
+    for (int property = 0; property < PROPERTY_COUNT; property++) {
+        if (has(property)) {
+            uint32_t bits;
+            std::memcpy(&bits, &mValues[property], sizeof(bits));
+            hash = hash * 31 + bits;
+        }
+    }
+    return hash;
+}
+
+bool ItemStyle::operator==(const ItemStyle& other) const {
+    if (mMask != other.mMask) {
+        return false;
+    }
+    for (int property = 0; property < PROPERTY_COUNT; property++) {
+        if (has(property) && (isFloat(property) ? getFloat(property) != other.getFloat(property)
+                                                : getInt(property) != other.getInt(property))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const ItemStyle* ItemStylePool::intern(const ItemStyle& style) {
+    auto it = mStyles.find(&style);
+    if (it != mStyles.end()) {
+        return *it;
+    }
+    mStorage.push_back(style);
+    const ItemStyle* interned = &mStorage.back();
+    mStyles.insert(interned);
+    return interned;
+}
@@ -0,0 +1,191 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_set>
+
+class Item;
+
+/**
+ * The layout attributes set by a style: the flex, size, margin and padding declarations of a
+ * rule compiled to numbers, each identified by one of the property constants. The other
+ * properties of the item keep their values when the style is applied.
+ *
+ * Equal styles are interned by an {@link ItemStylePool}, so that the rules and the items with
+ * the same declarations share one record and two styles can be compared by address.
+ */
+class ItemStyle {
+public:
+    static constexpr int WIDTH = 0;
+    static constexpr int HEIGHT = 1;
+    static constexpr int WIDTH_PERCENT = 2;
+    static constexpr int HEIGHT_PERCENT = 3;
+    static constexpr int MIN_WIDTH = 4;
+    static constexpr int MIN_HEIGHT = 5;
+    static constexpr int MAX_WIDTH = 6;
+    static constexpr int MAX_HEIGHT = 7;
+    static constexpr int MARGIN_LEFT = 8;
+    static constexpr int MARGIN_TOP = 9;
+    static constexpr int MARGIN_RIGHT = 10;
+    static constexpr int MARGIN_BOTTOM = 11;
+    static constexpr int ORDER = 12;
+    static constexpr int FLEX_GROW = 13;
+    static constexpr int FLEX_SHRINK = 14;
+    static constexpr int FLEX_BASIS_PERCENT = 15;
+    static constexpr int ALIGN_SELF = 16;
+    static constexpr int VISIBILITY = 17;
+    /**
+     * A flex-basis length, set as the width or the height of the item depending on the direction
+     * of its {@link FlexLayout} when the style is applied, and again by {@link #resolveFlexBasis}
+     * when the direction changes, or -1 for auto or a percentage
+     */
+    static constexpr int FLEX_BASIS = 18;
+    /** The properties from here on are only taken by the containers */
+    static constexpr int PADDING_LEFT = 19;
+    static constexpr int PADDING_TOP = 20;
+    static constexpr int PADDING_RIGHT = 21;
+    static constexpr int PADDING_BOTTOM = 22;
+    /** The properties from here on are only taken by the {@link FlexLayout}s */
+    static constexpr int FLEX_DIRECTION = 23;
+    static constexpr int FLEX_WRAP = 24;
+    static constexpr int JUSTIFY_CONTENT = 25;
+    static constexpr int ALIGN_ITEMS = 26;
+    static constexpr int ALIGN_CONTENT = 27;
+    static constexpr int PROPERTY_COUNT = 28;
+
+    bool isEmpty() const { return mMask == 0; }
+
+    bool has(int property) const { return (mMask & (1u << property)) != 0; }
+
+    /**
+     * @return whether the property is a float, a factor or a percentage, rather than an int
+     */
+    static bool isFloat(int property) { return (FLOAT_PROPERTIES & (1u << property)) != 0; }
+
+    /**
+     * @return the value of an int property, 0 if it isn't set
+     */
+    int getInt(int property) const { return mValues[property].intValue; }
+
+    /**
+     * @return the value of a float property, 0 if it isn't set
+     */
+    float getFloat(int property) const { return mValues[property].floatValue; }
+
+    void setInt(int property, int value) {
+        mMask |= 1u << property;
+        mValues[property].intValue = value;
+    }
+
+    void setFloat(int property, float value) {
+        mMask |= 1u << property;
+        // -0 is stored as 0, so that equal styles hash the same.
+        mValues[property].floatValue = value == 0 ? 0 : value;
+    }
+
+    /**
+     * Sets the properties set by the other style, as a later rule of the cascade does.
+     */
+    void merge(const ItemStyle& other);
+
+    /**
+     * Compiles a CSS declaration into the style, e.g. <code>padding: 20 0</code>. The lengths are
+     * in pixels, with or without the <code>px</code> unit.
+     *
+     * @param property the lowercase name of the property
+     * @param value    the value, without the variables and the expressions resolved by the
+     *                 style scope
+     * @return false if the declaration isn't a layout one or its value isn't supported, e.g. a
+     *         length out of the range of an int, in which case the style is left unchanged
+     */
+    bool compile(const std::string& property, const std::string& value);
+
+    /**
+     * Sets the properties of the style to the item, skipping those the class of the item doesn't
+     * have, as CSS does for the properties which don't apply.
+     *
+     * @param previous the style previously applied to the item, whose properties this style
+     *                 doesn't set are set back to their default values, or null
+     */
+    void apply(Item* item, const ItemStyle* previous = nullptr) const;
+
+    /**
+     * Sets the flex-basis length of the style, or of the previous one, along the main axis of the
+     * {@link FlexLayout} of the item again, once the direction of the container has changed: the
+     * size along the other axis is set back to the one of the style.
+     *
+     * @param previous the style previously applied to the item, or null
+     */
+    void resolveFlexBasis(Item* item, const ItemStyle* previous = nullptr) const;
+
+    size_t hash() const;
+
+    bool operator==(const ItemStyle& other) const;
+
+private:
+    static constexpr uint32_t FLOAT_PROPERTIES = 1u << WIDTH_PERCENT | 1u << HEIGHT_PERCENT | 1u << FLEX_GROW
+                                                 | 1u << FLEX_SHRINK | 1u << FLEX_BASIS_PERCENT;
+
+    /** The lengths are ints, as the items take them, so that they are exact up to any int */
+    union Value {
+        int intValue;
+        float floatValue;
+    };
+
+    /** The bit of each property which is set */
+    uint32_t mMask = 0;
+
+    Value mValues[PROPERTY_COUNT] = {};
+
+    /**
+     * @return whether the style, applied to the item, sets its main size to a flex-basis length
+     */
+    bool hasFlexBasisLength() const { return has(FLEX_BASIS) && getInt(FLEX_BASIS) >= 0; }
+
+    /**
+     * Sets the size of the item along an axis to the flex-basis length, or to the one of the
+     * style, or to its default value.
+     */
+    void applySize(Item* item, bool horizontal, bool flexBasis) const;
+};
+
+/**
+ * Interns the styles: every distinct style is stored once and stays at the same address for the
+ * life of the pool.
+ */
+class ItemStylePool {
+public:
+    ItemStylePool() = default;
+
+    ItemStylePool(const ItemStylePool&) = delete;
+
+    ItemStylePool& operator=(const ItemStylePool&) = delete;
+
+    /**
+     * @return the style of the pool equal to the given one
+     */
+    const ItemStyle* intern(const ItemStyle& style);
+
+    size_t size() const { return mStyles.size(); }
+
+private:
+    struct Hash {
+        size_t operator()(const ItemStyle* style) const { return style->hash(); }
+    };
+
+    struct Equal {
+        bool operator()(const ItemStyle* a, const ItemStyle* b) const { return *a == *b; }
+    };
+
+    std::deque<ItemStyle> mStorage;
+
+    std::unordered_set<const ItemStyle*, Hash, Equal> mStyles;
+};
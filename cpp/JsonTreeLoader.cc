@@ -0,0 +1,585 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <cstdlib>
+#include <stdexcept>
+#include <unordered_map>
+#include "JsonTreeLoader.h"
+#include "ItemArena.h"
+#include "FlexLayout.h"
+#include "FlowLayout.h"
+#include "LinearLayout.h"
+#include "TreeFormat.h"
+
+template<typename T>
+static T* newItem(ItemArena* arena) {
+    return arena != nullptr ? arena->create<T>() : new T();
+}
+
+template<typename T>
+static T* as(Item* item, const char* name) {
+    auto typed = dynamic_cast<T*>(item);
+    if (typed == nullptr) {
+        throw std::invalid_argument(std::string("Not an attribute of the item: ") + name);
+    }
+    return typed;
+}
+
+static bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+/**
+ * Matches the JSON number grammar, which strtod() extends with hexadecimal numbers, infinities,
+ * leading zeros and a leading '+' among others.
+ */
+static bool isNumber(const std::string& literal) {
+    size_t i = literal[0] == '-' ? 1 : 0;
+    if (i >= literal.size() || !isDigit(literal[i])) {
+        return false;
+    }
+    if (literal[i++] != '0') {
+        while (i < literal.size() && isDigit(literal[i])) {
+            i++;
+        }
+    }
+    if (i < literal.size() && literal[i] == '.') {
+        if (++i >= literal.size() || !isDigit(literal[i])) {
+            return false;
+        }
+        while (i < literal.size() && isDigit(literal[i])) {
+            i++;
+        }
+    }
+    if (i < literal.size() && (literal[i] == 'e' || literal[i] == 'E')) {
+        if (++i < literal.size() && (literal[i] == '+' || literal[i] == '-')) {
+            i++;
+        }
+        if (i >= literal.size() || !isDigit(literal[i])) {
+            return false;
+        }
+        while (i < literal.size() && isDigit(literal[i])) {
+            i++;
+        }
+    }
+    return i == literal.size();
+}
+
+static int hexValue(char c) {
+    if (isDigit(c)) {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    return c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+}
+
+/**
+ * Deletes the items of a tree allocated one by one, the containers don't own their children.
+ */
+static void deleteSubtree(Item* item) {
+    if (auto layout = dynamic_cast<Layout*>(item)) {
+        for (int i = 0; i < layout->getChildCount(); i++) {
+            deleteSubtree(layout->getChildAt(i));
+        }
+    }
+    delete item;
+}
+
+bool JsonTreeLoader::isLiteralChar(char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')
+           || c == '-' || c == '+' || c == '.';
+}
+
+bool JsonTreeLoader::isLiteral(const std::string& literal) {
+    return literal == "true" || literal == "false" || literal == "null" || isNumber(literal);
+}
+
+Item* JsonTreeLoader::load(const std::string& json, ItemArena* arena) {
+    JsonTreeLoader loader(arena);
+    loader.feed(json.data(), json.size());
+    return loader.finish();
+}
+
+void JsonTreeLoader::feed(const char* data, size_t size) {
+    try {
+        parse(data, size);
+    } catch (...) {
+        discard();
+        throw;
+    }
+}
+
+void JsonTreeLoader::discard() {
+    if (mArena == nullptr) {
+        // The open nodes below the root aren't in their containers yet.
+        for (const Frame& frame : mFrames) {
+            if (frame.role == NODE && frame.item != nullptr && frame.item != mRoot) {
+                deleteSubtree(frame.item);
+            }
+        }
+        if (mRoot != nullptr) {
+            deleteSubtree(mRoot);
+        }
+    }
+    mRoot = nullptr;
+    mFrames.clear();
+    mState = END;
+    mLexeme = NONE;
+    mToken.clear();
+}
+
+void JsonTreeLoader::parse(const char* data, size_t size) {
+    for (size_t i = 0; i < size; i++, mOffset++) {
+        char c = data[i];
+        if (mLexeme == STRING) {
+            if (mEscaped) {
+                mEscaped = false;
+            } else if (c == '\\') {
+                mEscaped = true;
+            } else if (c == '"') {
+                mLexeme = NONE;
+                std::string value;
+                try {
+                    value = decodeString(mToken);
+                } catch (const std::invalid_argument& e) {
+                    fail(e.what());
+                }
+                onString(value);
+                mToken.clear();
+                continue;
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                fail("control character in a string");
+            }
+            mToken += c;
+            continue;
+        }
+        if (mLexeme == LITERAL) {
+            if (isLiteralChar(c)) {
+                mToken += c;
+                continue;
+            }
+            // The character ending the literal is handled below.
+            mLexeme = NONE;
+            onLiteral(mToken);
+            mToken.clear();
+        }
+        switch (c) {
+            case ' ':
+            case '\t':
+            case '\n':
+            case '\r':
+                break;
+            case '{':
+            case '[':
+                onBeginContainer(c == '{');
+                break;
+            case '}':
+            case ']':
+                onEndContainer(c == '}');
+                break;
+            case ':':
+                if (mState != COLON) {
+                    fail("unexpected ':'");
+                }
+                mState = VALUE;
+                break;
+            case ',':
+                if (mState != NEXT) {
+                    fail("unexpected ','");
+                }
+                mState = mFrames.back().object ? KEY : VALUE;
+                break;
+            case '"':
+                mLexeme = STRING;
+                break;
+            default:
+                if (!isLiteralChar(c)) {
+                    fail(std::string("unexpected character '") + c + "'");
+                }
+                mLexeme = LITERAL;
+                mToken += c;
+                break;
+        }
+    }
+}
+
+Item* JsonTreeLoader::finish() {
+    try {
+        if (mLexeme == LITERAL) {
+            mLexeme = NONE;
+            onLiteral(mToken);
+            mToken.clear();
+        }
+        if (mLexeme != NONE || mState != END || mRoot == nullptr) {
+            fail("incomplete document");
+        }
+    } catch (...) {
+        discard();
+        throw;
+    }
+    return mRoot;
+}
+
+void JsonTreeLoader::onBeginContainer(bool object) {
+    if (mState != VALUE && mState != FIRST_VALUE) {
+        fail(object ? "unexpected '{'" : "unexpected '['");
+    }
+    Role role = SKIPPED;
+    if (mFrames.empty() || mFrames.back().role == CHILDREN) {
+        if (!object) {
+            fail(mFrames.empty() ? "the root isn't an object" : "a child isn't an object");
+        }
+        role = NODE;
+    } else if (mFrames.back().role == NODE) {
+        const Frame& node = mFrames.back();
+        if (node.key == "type") {
+            fail("the type isn't a string");
+        }
+        if (node.key == "children") {
+            if (object) {
+                fail("the children aren't an array");
+            }
+            if (dynamic_cast<Layout*>(node.item) == nullptr) {
+                fail("an item which isn't a layout has children");
+            }
+            role = CHILDREN;
+        }
+    }
+    mFrames.push_back({object, role, nullptr, std::string()});
+    mState = object ? FIRST_KEY : FIRST_VALUE;
+}
+
+void JsonTreeLoader::onEndContainer(bool object) {
+    if (mFrames.empty() || mFrames.back().object != object
+        || (mState != NEXT && mState != (object ? FIRST_KEY : FIRST_VALUE))) {
+        fail(object ? "unexpected '}'" : "unexpected ']'");
+    }
+    Frame& frame = mFrames.back();
+    if (frame.role == NODE) {
+        Item* item = ensureItem(frame, std::string());
+        TreeFormat::NodeRecord record;
+        TreeFormat::writeRecord(item, record);
+        try {
+            TreeFormat::checkRecord(record);
+        } catch (const std::invalid_argument& e) {
+            fail(e.what());
+        }
+        // A node is nested in the children array of its container, which it joins once complete:
+        // while detached, its setters don't invalidate the ancestors.
+        int depth = static_cast<int>(mFrames.size() - 1) / 2;
+        if (depth > 0) {
+            static_cast<Layout*>(mFrames[mFrames.size() - 3].item)->addItem(item);
+        }
+        mFrames.pop_back();
+        onValueEnd();
+        if (mSubtreeListener) {
+            mSubtreeListener(item, depth);
+        }
+        return;
+    }
+    mFrames.pop_back();
+    onValueEnd();
+}
+
+void JsonTreeLoader::onString(const std::string& value) {
+    if (mState == FIRST_KEY || mState == KEY) {
+        Frame& frame = mFrames.back();
+        frame.key = value;
+        if (frame.role == NODE) {
+            if (value != "type") {
+                ensureItem(frame, std::string());
+            } else if (frame.item != nullptr) {
+                fail("the type isn't the first member of the node");
+            }
+        }
+        mState = COLON;
+        return;
+    }
+    if (mState != VALUE && mState != FIRST_VALUE) {
+        fail("unexpected string");
+    }
+    if (mFrames.empty()) {
+        fail("the root isn't an object");
+    }
+    Frame& frame = mFrames.back();
+    if (frame.role == CHILDREN) {
+        fail("a child isn't an object");
+    }
+    if (frame.role == NODE) {
+        if (frame.key == "type") {
+            ensureItem(frame, value);
+        } else if (findAttribute(frame.key) != nullptr) {
+            fail("the attribute " + frame.key + " isn't a number");
+        }
+    }
+    onValueEnd();
+}
+
+void JsonTreeLoader::onLiteral(const std::string& literal) {
+    if (literal == "true" || literal == "false") {
+        onScalar(literal == "true" ? 1 : 0, false);
+    } else if (literal == "null") {
+        onScalar(0, true);
+    } else {
+        if (!isNumber(literal)) {
+            fail("invalid literal " + literal);
+        }
+        onScalar(std::strtod(literal.c_str(), nullptr), false);
+    }
+}
+
+void JsonTreeLoader::onScalar(double value, bool isNull) {
+    if (mState != VALUE && mState != FIRST_VALUE) {
+        fail("unexpected value");
+    }
+    if (mFrames.empty()) {
+        fail("the root isn't an object");
+    }
+    Frame& frame = mFrames.back();
+    if (frame.role == CHILDREN) {
+        fail("a child isn't an object");
+    }
+    if (frame.role == NODE) {
+        if (frame.key == "type") {
+            fail("the type isn't a string");
+        }
+        Setter setter = findAttribute(frame.key);
+        if (setter != nullptr && !isNull) {
+            // The attributes are ints or floats, converting a larger value is undefined, and a
+            // size or a margin must be one whose negation doesn't overflow. This rejects the
+            // infinities of the numbers too large for a double as well.
+            if (!(value >= -Item::MAX_SIZE && value <= Item::MAX_SIZE)) {
+                fail("the value of the attribute " + frame.key + " is out of range");
+            }
+            setter(frame.item, value);
+        }
+    }
+    onValueEnd();
+}
+
+Item* JsonTreeLoader::ensureItem(Frame& frame, const std::string& type) {
+    if (frame.item != nullptr) {
+        return frame.item;
+    }
+    if (type.empty() || type == "Item" || type == "View") {
+        frame.item = newItem<Item>(mArena);
+    } else if (type == "FlexLayout") {
+        frame.item = newItem<FlexLayout>(mArena);
+    } else if (type == "LinearLayout") {
+        frame.item = newItem<LinearLayout>(mArena);
+    } else if (type == "FlowLayout") {
+        frame.item = newItem<FlowLayout>(mArena);
+    } else {
+        fail("unknown type " + type);
+    }
+    if (mFrames.size() == 1) {
+        mRoot = frame.item;
+    }
+    return frame.item;
+}
+
+JsonTreeLoader::Setter JsonTreeLoader::findAttribute(const std::string& name) {
+    auto& setters = getSetters();
+    auto it = setters.find(name);
+    return it != setters.end() ? it->second : nullptr;
+}
+
+std::vector<std::string> JsonTreeLoader::getAttributeNames() {
+    std::vector<std::string> names;
+    for (auto& entry : getSetters()) {
+        names.push_back(entry.first);
+    }
+    return names;
+}
+
+const std::unordered_map<std::string, JsonTreeLoader::Setter>& JsonTreeLoader::getSetters() {
+    static const std::unordered_map<std::string, Setter> setters = {
+            {"width", [](Item* item, double value) { item->setWidth(static_cast<int>(value)); }},
+            {"height", [](Item* item, double value) { item->setHeight(static_cast<int>(value)); }},
+            {"order", [](Item* item, double value) { item->setOrder(static_cast<int>(value)); }},
+            {"flexGrow", [](Item* item, double value) { item->setFlexGrow(static_cast<float>(value)); }},
+            {"flexShrink", [](Item* item, double value) { item->setFlexShrink(static_cast<float>(value)); }},
+            {"flexBasisPercent", [](Item* item, double value) {
+                item->setFlexBasisPercent(static_cast<float>(value));
+            }},
+            {"alignSelf", [](Item* item, double value) { item->setAlignSelf(static_cast<int>(value)); }},
+            {"minWidth", [](Item* item, double value) { item->setMinWidth(static_cast<int>(value)); }},
+            {"minHeight", [](Item* item, double value) { item->setMinHeight(static_cast<int>(value)); }},
+            {"maxWidth", [](Item* item, double value) { item->setMaxWidth(static_cast<int>(value)); }},
+            {"maxHeight", [](Item* item, double value) { item->setMaxHeight(static_cast<int>(value)); }},
+            {"wrapBefore", [](Item* item, double value) { item->setWrapBefore(value != 0); }},
+            {"widthPercent", [](Item* item, double value) { item->setWidthPercent(static_cast<float>(value)); }},
+            {"heightPercent", [](Item* item, double value) { item->setHeightPercent(static_cast<float>(value)); }},
+            {"weight", [](Item* item, double value) { item->setWeight(static_cast<float>(value)); }},
+            {"visibility", [](Item* item, double value) {
+                // The setter keeps the bits of the mask, which any value has.
+                int visibility = static_cast<int>(value);
+                if (visibility != Item::VISIBLE && visibility != Item::INVISIBLE && visibility != Item::GONE) {
+                    throw std::invalid_argument("Unknown visibility: " + std::to_string(visibility));
+                }
+                item->setVisibility(visibility);
+            }},
+            {"margin", [](Item* item, double value) {
+                int margin = static_cast<int>(value);
+                item->setMargins(margin, margin, margin, margin);
+            }},
+            {"marginLeft", [](Item* item, double value) {
+                item->setMargins(static_cast<int>(value), item->getMarginTop(), item->getMarginRight(),
+                                 item->getMarginBottom());
+            }},
+            {"marginTop", [](Item* item, double value) {
+                item->setMargins(item->getMarginLeft(), static_cast<int>(value), item->getMarginRight(),
+                                 item->getMarginBottom());
+            }},
+            {"marginRight", [](Item* item, double value) {
+                item->setMargins(item->getMarginLeft(), item->getMarginTop(), static_cast<int>(value),
+                                 item->getMarginBottom());
+            }},
+            {"marginBottom", [](Item* item, double value) {
+                item->setMargins(item->getMarginLeft(), item->getMarginTop(), item->getMarginRight(),
+                                 static_cast<int>(value));
+            }},
+            {"padding", [](Item* item, double value) {
+                int padding = static_cast<int>(value);
+                as<Layout>(item, "padding")->setPadding(padding, padding, padding, padding);
+            }},
+            {"paddingLeft", [](Item* item, double value) {
+                auto layout = as<Layout>(item, "paddingLeft");
+                layout->setPadding(static_cast<int>(value), layout->getPaddingTop(), layout->getPaddingRight(),
+                                   layout->getPaddingBottom());
+            }},
+            {"paddingTop", [](Item* item, double value) {
+                auto layout = as<Layout>(item, "paddingTop");
+                layout->setPadding(layout->getPaddingLeft(), static_cast<int>(value), layout->getPaddingRight(),
+                                   layout->getPaddingBottom());
+            }},
+            {"paddingRight", [](Item* item, double value) {
+                auto layout = as<Layout>(item, "paddingRight");
+                layout->setPadding(layout->getPaddingLeft(), layout->getPaddingTop(), static_cast<int>(value),
+                                   layout->getPaddingBottom());
+            }},
+            {"paddingBottom", [](Item* item, double value) {
+                auto layout = as<Layout>(item, "paddingBottom");
+                layout->setPadding(layout->getPaddingLeft(), layout->getPaddingTop(), layout->getPaddingRight(),
+                                   static_cast<int>(value));
+            }},
+            {"resizeMode", [](Item* item, double value) { as<Layout>(item, "resizeMode")->setResizeMode(value != 0); }},
+            {"layoutSharing", [](Item* item, double value) {
+                as<Layout>(item, "layoutSharing")->setLayoutSharing(value != 0);
+            }},
+            {"flexDirection", [](Item* item, double value) {
+                as<FlexLayout>(item, "flexDirection")->setFlexDirection(static_cast<int>(value));
+            }},
+            {"flexWrap", [](Item* item, double value) {
+                as<FlexLayout>(item, "flexWrap")->setFlexWrap(static_cast<int>(value));
+            }},
+            {"justifyContent", [](Item* item, double value) {
+                as<FlexLayout>(item, "justifyContent")->setJustifyContent(static_cast<int>(value));
+            }},
+            {"alignItems", [](Item* item, double value) {
+                as<FlexLayout>(item, "alignItems")->setAlignItems(static_cast<int>(value));
+            }},
+            {"alignContent", [](Item* item, double value) {
+                as<FlexLayout>(item, "alignContent")->setAlignContent(static_cast<int>(value));
+            }},
+            {"maxLine", [](Item* item, double value) {
+                as<FlexLayout>(item, "maxLine")->setMaxLine(static_cast<int>(value));
+            }},
+            {"orientation", [](Item* item, double value) {
+                as<LinearLayout>(item, "orientation")->setOrientation(static_cast<int>(value));
+            }},
+            {"weightSum", [](Item* item, double value) {
+                as<LinearLayout>(item, "weightSum")->mWeightSum = static_cast<float>(value);
+            }},
+            {"useLargestChild", [](Item* item, double value) {
+                as<LinearLayout>(item, "useLargestChild")->mUseLargestChild = value != 0;
+            }},
+            {"showDividers", [](Item* item, double value) {
+                as<LinearLayout>(item, "showDividers")->mShowDividers = static_cast<int>(value);
+            }},
+            {"dividerWidth", [](Item* item, double value) {
+                as<LinearLayout>(item, "dividerWidth")->mDividerWidth = static_cast<int>(value);
+            }},
+            {"dividerHeight", [](Item* item, double value) {
+                as<LinearLayout>(item, "dividerHeight")->mDividerHeight = static_cast<int>(value);
+            }},
+            {"lineSpacing", [](Item* item, double value) {
+                as<FlowLayout>(item, "lineSpacing")->setLineSpacing(static_cast<int>(value));
+            }},
+            {"itemSpacing", [](Item* item, double value) {
+                as<FlowLayout>(item, "itemSpacing")->setItemSpacing(static_cast<int>(value));
+            }},
+            {"singleLine", [](Item* item, double value) {
+                as<FlowLayout>(item, "singleLine")->setSingleLine(value != 0);
+            }},
+    };
+    return setters;
+}
+
+std::string JsonTreeLoader::decodeString(const std::string& raw) {
+    std::string value;
+    for (size_t i = 0; i < raw.size(); i++) {
+        if (raw[i] != '\\') {
+            value += raw[i];
+            continue;
+        }
+        char c = raw[++i];
+        switch (c) {
+            case 'b':
+                value += '\b';
+                break;
+            case 'f':
+                value += '\f';
+                break;
+            case 'n':
+                value += '\n';
+                break;
+            case 'r':
+                value += '\r';
+                break;
+            case 't':
+                value += '\t';
+                break;
+            case '"':
+            case '\\':
+            case '/':
+                value += c;
+                break;
+            case 'u': {
+                unsigned long code = 0;
+                for (int digit = 0; digit < 4; digit++) {
+                    int hex = ++i < raw.size() ? hexValue(raw[i]) : -1;
+                    if (hex < 0) {
+                        throw std::invalid_argument("Invalid \\u escape sequence");
+                    }
+                    code = code << 4 | hex;
+                }
+                // Encoded in UTF-8, the surrogates are kept as they are.
+                if (code < 0x80) {
+                    value += static_cast<char>(code);
+                } else if (code < 0x800) {
+                    value += static_cast<char>(0xC0 | (code >> 6));
+                    value += static_cast<char>(0x80 | (code & 0x3F));
+                } else {
+                    value += static_cast<char>(0xE0 | (code >> 12));
+                    value += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                    value += static_cast<char>(0x80 | (code & 0x3F));
+                }
+                break;
+            }
+            default:
+                throw std::invalid_argument(std::string("Invalid escape sequence \\") + c);
+        }
+    }
+    return value;
+}
+
+void JsonTreeLoader::fail(const std::string& reason) const {
+    throw std::invalid_argument("Malformed tree at offset " + std::to_string(mOffset) + ": " + reason);
+}
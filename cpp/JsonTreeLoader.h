@@ -0,0 +1,213 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#pragma once
+
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Item.h"
+
+class ItemArena;
+
+/**
+ * Builds a tree of items from its JSON definition as the document streams in, without building
+ * a DOM first. Each node is an object whose members are the attributes of the item, named after
+ * their setters, and whose optional <code>children</code> member is the array of its children:
+ *
+ * <pre>
+ * {"type": "FlexLayout", "flexWrap": 1, "padding": 8, "children": [
+ *     {"type": "Item", "width": 100, "height": 40, "flexGrow": 1},
+ *     {"width": -1, "height": 40, "marginTop": 4}
+ * ]}
+ * </pre>
+ *
+ * <code>type</code> is one of <code>Item</code> (or <code>View</code>), <code>FlexLayout</code>,
+ * <code>LinearLayout</code> and <code>FlowLayout</code>, and defaults to <code>Item</code>. The
+ * item is created when the first member of its object arrives, so <code>type</code> has to be
+ * that first member. The attributes take numbers, with the values of the constants for the enums
+ * (e.g. {@link Item#LayoutParams#MATCH_PARENT}, {@link FlexWrap#WRAP}), or booleans; the members
+ * which aren't attributes, e.g. <code>id</code> or <code>className</code>, are skipped.
+ *
+ * The document can be fed in chunks split anywhere, e.g. as it is read from a socket. Every node
+ * is reported to the {@link SubtreeListener} as soon as its object is closed: its subtree is
+ * complete, so it can be measured while the rest of the document is still loading. A node is
+ * only added to its container then, so the attributes are set on detached items and don't
+ * invalidate the loaded ancestors one by one. Its values are checked as those of a
+ * {@link TreeFormat} record, e.g. the constants of the enums.
+ */
+class JsonTreeLoader {
+public:
+    /**
+     * Called when the subtree of an item has been loaded.
+     *
+     * @param item  the root of the subtree, already added to its container
+     * @param depth the depth of the item in the tree, 0 for the root
+     */
+    using SubtreeListener = std::function<void(Item* item, int depth)>;
+
+    /**
+     * @param arena the arena the items are created in, or null to allocate each one, in which
+     *              case they are owned by the caller
+     */
+    explicit JsonTreeLoader(ItemArena* arena = nullptr) : mArena(arena) {}
+
+    JsonTreeLoader(const JsonTreeLoader&) = delete;
+
+    JsonTreeLoader& operator=(const JsonTreeLoader&) = delete;
+
+    void setSubtreeListener(SubtreeListener listener) { mSubtreeListener = std::move(listener); }
+
+    /**
+     * Parses the next chunk of the document. After an error the partial tree is deleted, unless
+     * its items are in an arena, and the loader can't be fed any more.
+     *
+     * @throws std::invalid_argument if the document is malformed or an attribute is invalid,
+     * e.g. a number beyond {@link Item#MAX_SIZE} or an unknown constant
+     */
+    void feed(const char* data, size_t size);
+
+    /**
+     * Ends the document.
+     *
+     * @return the root of the tree
+     * @throws std::invalid_argument if the document is incomplete, the partial tree is then
+     * deleted as by {@link #feed(const char*, size_t)}
+     */
+    Item* finish();
+
+    /**
+     * @return the root of the tree, or null if it hasn't been created yet
+     */
+    Item* getRoot() const { return mRoot; }
+
+    /**
+     * Loads a whole document.
+     */
+    static Item* load(const std::string& json, ItemArena* arena = nullptr);
+
+    /**
+     * Sets an attribute of the item, e.g. <code>flexGrow</code>.
+     *
+     * @throws std::invalid_argument if the attribute isn't one of the class of the item
+     */
+    using Setter = void (*)(Item* item, double value);
+
+    /**
+     * @return the setter of the attribute, or null if the name isn't an attribute
+     */
+    static Setter findAttribute(const std::string& name);
+
+    /**
+     * @return the names of all the attributes, in no particular order
+     */
+    static std::vector<std::string> getAttributeNames();
+
+    /**
+     * Decodes the escape sequences of a JSON string.
+     *
+     * @param raw the characters between the quotes
+     * @throws std::invalid_argument for an unknown escape sequence or a unicode one without four
+     * hexadecimal digits
+     */
+    static std::string decodeString(const std::string& raw);
+
+    /**
+     * @return whether the character can be part of a literal, which ends at the first one which
+     *         can't
+     */
+    static bool isLiteralChar(char c);
+
+    /**
+     * @return whether the literal is true, false, null or a number of the JSON grammar, which
+     *         rejects hexadecimal numbers, infinities, leading zeros and a leading '+'
+     */
+    static bool isLiteral(const std::string& literal);
+
+private:
+    /** What the parser expects next */
+    enum State {
+        VALUE,
+        /** A value or the end of the array just opened */
+        FIRST_VALUE,
+        /** A key or the end of the object just opened */
+        FIRST_KEY,
+        KEY,
+        COLON,
+        /** A comma or the end of the enclosing object or array */
+        NEXT,
+        END
+    };
+
+    /** The token being scanned, which may span several chunks */
+    enum Lexeme {
+        NONE,
+        STRING,
+        LITERAL
+    };
+
+    /** What an open object or array stands for */
+    enum Role {
+        NODE,
+        CHILDREN,
+        /** Not part of the tree, e.g. the value of a member which isn't an attribute */
+        SKIPPED
+    };
+
+    struct Frame {
+        bool object;
+        Role role;
+        /** The item of a node, created when its first member arrives, added to its container when complete */
+        Item* item;
+        /** The key of the current member of an object */
+        std::string key;
+    };
+
+    ItemArena* mArena;
+    SubtreeListener mSubtreeListener;
+    Item* mRoot = nullptr;
+    std::vector<Frame> mFrames;
+    State mState = VALUE;
+    Lexeme mLexeme = NONE;
+    bool mEscaped = false;
+    std::string mToken;
+    /** The offset of the current character in the document, for the errors */
+    size_t mOffset = 0;
+
+    void parse(const char* data, size_t size);
+
+    /**
+     * Deletes the partial tree after an error, unless it is in an arena, and rejects anything
+     * fed afterwards.
+     */
+    void discard();
+
+    void onBeginContainer(bool object);
+
+    void onEndContainer(bool object);
+
+    void onString(const std::string& value);
+
+    void onLiteral(const std::string& literal);
+
+    /**
+     * Handles a number, a boolean or null, as the value of the current member or array element.
+     */
+    void onScalar(double value, bool isNull);
+
+    void onValueEnd() { mState = mFrames.empty() ? END : NEXT; }
+
+    /**
+     * Creates the item of the node if its first member, or its end, has arrived.
+     */
+    Item* ensureItem(Frame& frame, const std::string& type);
+
+    static const std::unordered_map<std::string, Setter>& getSetters();
+
+    [[noreturn]] void fail(const std::string& reason) const;
+};
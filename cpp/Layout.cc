@@ -5,8 +5,15 @@
  * found in the LICENSE file.
  */
 
+#include "ItemArena.h"
 #include "Layout.h"
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
 int Layout::getChildMeasureSpec(int spec, int padding, int childDimension, float percent) {
     int specMode = MeasureSpec::getMode(spec);
     int specSize = MeasureSpec::getSize(spec);
@@ -77,6 +84,130 @@ int Layout::getChildMeasureSpec(int spec, int padding, int childDimension, float
     return MeasureSpec::makeMeasureSpec(resultSize, resultMode);
 }
 
+/**
+ * The three cases of getChildMeasureSpec are disjoint masks, so the result is a select of the
+ * size and the mode of each case.
+ */
+static inline int getChildMeasureSpecBranchless(int specSize, float specSizeAsFloat, int matchMode,
+                                                int wrapMode, int padding, int childDimension,
+                                                float percent) {
+    int size = std::max(0, specSize - padding);
+    int matchSize = std::min(static_cast<int>(specSizeAsFloat * percent), size);
+    bool exact = childDimension >= 0;
+    bool match = childDimension == Item::LayoutParams::MATCH_PARENT;
+    bool wrap = childDimension == Item::LayoutParams::WRAP_CONTENT;
+    int resultSize = (exact ? childDimension : 0) | (match ? matchSize : 0) | (wrap ? size : 0);
+    int resultMode = (exact ? Item::MeasureSpec::EXACTLY : 0) | (match ? matchMode : 0)
+                     | (wrap ? wrapMode : 0);
+    return (resultSize & ~Item::MeasureSpec::MODE_MASK) | resultMode;
+}
+
+void Layout::getChildMeasureSpecs(int spec, const int* paddings, const int* childDimensions,
+                                  const float* percents, int* measureSpecs, int count) {
+    int specSize = MeasureSpec::getSize(spec);
+    float specSizeAsFloat = static_cast<float>(specSize);
+    // A child matching the parent gets the mode of the parent, a wrapping child can't be bigger
+    // than the parent unless the parent is unbounded.
+    int matchMode = MeasureSpec::getMode(spec);
+    int wrapMode = matchMode == MeasureSpec::UNSPECIFIED ? MeasureSpec::UNSPECIFIED : MeasureSpec::AT_MOST;
+
+    int i = 0;
+#if defined(__AVX2__)
+    const __m256i vSpecSize = _mm256_set1_epi32(specSize);
+    const __m256 vSpecSizeAsFloat = _mm256_set1_ps(specSizeAsFloat);
+    const __m256i vMatchMode = _mm256_set1_epi32(matchMode);
+    const __m256i vWrapMode = _mm256_set1_epi32(wrapMode);
+    const __m256i vExactly = _mm256_set1_epi32(MeasureSpec::EXACTLY);
+    const __m256i vMatchParent = _mm256_set1_epi32(LayoutParams::MATCH_PARENT);
+    const __m256i vWrapContent = _mm256_set1_epi32(LayoutParams::WRAP_CONTENT);
+    const __m256i vSizeMask = _mm256_set1_epi32(~MeasureSpec::MODE_MASK);
+    const __m256i vZero = _mm256_setzero_si256();
+    for (; i + 8 <= count; i += 8) {
+        __m256i padding = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(paddings + i));
+        __m256i dimension = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(childDimensions + i));
+        __m256 percent = _mm256_loadu_ps(percents + i);
+
+        __m256i size = _mm256_max_epi32(_mm256_sub_epi32(vSpecSize, padding), vZero);
+        __m256i matchSize = _mm256_min_epi32(
+                _mm256_cvttps_epi32(_mm256_mul_ps(vSpecSizeAsFloat, percent)), size);
+        __m256i exact = _mm256_cmpgt_epi32(dimension, _mm256_set1_epi32(-1));
+        __m256i match = _mm256_cmpeq_epi32(dimension, vMatchParent);
+        __m256i wrap = _mm256_cmpeq_epi32(dimension, vWrapContent);
+
+        __m256i resultSize = _mm256_or_si256(
+                _mm256_and_si256(exact, dimension),
+                _mm256_or_si256(_mm256_and_si256(match, matchSize), _mm256_and_si256(wrap, size)));
+        __m256i resultMode = _mm256_or_si256(
+                _mm256_and_si256(exact, vExactly),
+                _mm256_or_si256(_mm256_and_si256(match, vMatchMode), _mm256_and_si256(wrap, vWrapMode)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(measureSpecs + i),
+                            _mm256_or_si256(_mm256_and_si256(resultSize, vSizeMask), resultMode));
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    const __m128i vSpecSize = _mm_set1_epi32(specSize);
+    const __m128 vSpecSizeAsFloat = _mm_set1_ps(specSizeAsFloat);
+    const __m128i vMatchMode = _mm_set1_epi32(matchMode);
+    const __m128i vWrapMode = _mm_set1_epi32(wrapMode);
+    const __m128i vExactly = _mm_set1_epi32(MeasureSpec::EXACTLY);
+    const __m128i vMatchParent = _mm_set1_epi32(LayoutParams::MATCH_PARENT);
+    const __m128i vWrapContent = _mm_set1_epi32(LayoutParams::WRAP_CONTENT);
+    const __m128i vSizeMask = _mm_set1_epi32(~MeasureSpec::MODE_MASK);
+    const __m128i vZero = _mm_setzero_si128();
+    for (; i + 4 <= count; i += 4) {
+        __m128i padding = _mm_loadu_si128(reinterpret_cast<const __m128i*>(paddings + i));
+        __m128i dimension = _mm_loadu_si128(reinterpret_cast<const __m128i*>(childDimensions + i));
+        __m128 percent = _mm_loadu_ps(percents + i);
+
+        // SSE2 has no integer min/max, they are selects on a comparison.
+        __m128i size = _mm_sub_epi32(vSpecSize, padding);
+        size = _mm_and_si128(size, _mm_cmpgt_epi32(size, vZero));
+        __m128i scaled = _mm_cvttps_epi32(_mm_mul_ps(vSpecSizeAsFloat, percent));
+        __m128i scaledIsSmaller = _mm_cmplt_epi32(scaled, size);
+        __m128i matchSize = _mm_or_si128(_mm_and_si128(scaledIsSmaller, scaled),
+                                         _mm_andnot_si128(scaledIsSmaller, size));
+        __m128i exact = _mm_cmpgt_epi32(dimension, _mm_set1_epi32(-1));
+        __m128i match = _mm_cmpeq_epi32(dimension, vMatchParent);
+        __m128i wrap = _mm_cmpeq_epi32(dimension, vWrapContent);
+
+        __m128i resultSize = _mm_or_si128(
+                _mm_and_si128(exact, dimension),
+                _mm_or_si128(_mm_and_si128(match, matchSize), _mm_and_si128(wrap, size)));
+        __m128i resultMode = _mm_or_si128(
+                _mm_and_si128(exact, vExactly),
+                _mm_or_si128(_mm_and_si128(match, vMatchMode), _mm_and_si128(wrap, vWrapMode)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(measureSpecs + i),
+                         _mm_or_si128(_mm_and_si128(resultSize, vSizeMask), resultMode));
+    }
+#endif
+    for (; i < count; i++) {
+        measureSpecs[i] = getChildMeasureSpecBranchless(specSize, specSizeAsFloat, matchMode, wrapMode,
+                                                         paddings[i], childDimensions[i], percents[i]);
+    }
+}
+
+void Layout::getChildMeasureSpecs(int spec, int padding, bool horizontal, bool includeMargins,
+                                  std::vector<int>& measureSpecs) {
+    int count = mChildren.size();
+    mBatchDimensions.resize(count);
+    mBatchPaddings.resize(count);
+    mBatchPercents.resize(count);
+    measureSpecs.resize(count);
+    for (int i = 0; i < count; i++) {
+        Item* child = mChildren.get(i);
+        if (horizontal) {
+            mBatchDimensions[i] = child->getWidth();
+            mBatchPercents[i] = child->getWidthPercent();
+            mBatchPaddings[i] = includeMargins ? padding + child->getMarginHorizontal() : padding;
+        } else {
+            mBatchDimensions[i] = child->getHeight();
+            mBatchPercents[i] = child->getHeightPercent();
+            mBatchPaddings[i] = includeMargins ? padding + child->getMarginVertical() : padding;
+        }
+    }
+    getChildMeasureSpecs(spec, mBatchPaddings.data(), mBatchDimensions.data(), mBatchPercents.data(),
+                         measureSpecs.data(), count);
+}
+
 void Layout::measureChild(Item* child, int parentWidthMeasureSpec, int parentHeightMeasureSpec) {
 
     int childWidthMeasureSpec = getChildMeasureSpec(parentWidthMeasureSpec,
@@ -90,11 +221,11 @@ void Layout::measureChild(Item* child, int parentWidthMeasureSpec, int parentHei
 }
 
 void Layout::measureChildren(int widthMeasureSpec, int heightMeasureSpec) {
-    for (auto& child : mChildren) {
+    mChildren.forEach([&](Item* child) {
         if (child->getVisibility() != GONE) {
             measureChild(child, widthMeasureSpec, heightMeasureSpec);
         }
-    }
+    });
 }
 
 void Layout::measureChildWithMargins(Item* child, int parentWidthMeasureSpec, int widthUsed,
@@ -109,3 +240,143 @@ void Layout::measureChildWithMargins(Item* child, int parentWidthMeasureSpec, in
 
     child->measure(childWidthMeasureSpec, childHeightMeasureSpec);
 }
+
+bool Layout::isMeasurementValidFor(int /* widthMeasureSpec */, int /* heightMeasureSpec */) const {
+    return false;
+}
+
+void Layout::layoutChildrenIfNeeded() {
+    mChildren.forEach([](Item* child) { child->layoutIfNeeded(); });
+}
+
+Item* Layout::cloneItem(ItemArena* arena) const {
+    return arena != nullptr ? arena->copy(*this) : new Layout(*this);
+}
+
+void Layout::cloneChildren(const Item& prototype, ItemArena* arena) {
+    // Appended without notifying anything, this copy is new and has to be measured anyway.
+    static_cast<const Layout&>(prototype).mChildren.forEach([this, arena](Item* child) {
+        Item* clone = child->cloneSubtree(arena);
+        clone->mParent = this;
+        mChildren.insert(mChildren.size(), clone);
+        // The caches derived from a child which computes them again can't be kept either.
+        mPrivateFlags &= clone->mPrivateFlags | ~PFLAG_SUBTREE_CACHES;
+    });
+    mPrivateFlags |= PFLAG_CHILD_ORDER_CHANGED;
+}
+
+static int getOuterIntrinsicSize(Item* child, bool horizontal, int intrinsicSize) {
+    return horizontal
+           ? child->getIntrinsicWidth(intrinsicSize) + child->getMarginLeft() + child->getMarginRight()
+           : child->getIntrinsicHeight(intrinsicSize) + child->getMarginTop() + child->getMarginBottom();
+}
+
+int Layout::sumChildIntrinsicSizes(bool horizontal, int intrinsicSize, int spacing) {
+    int sum = 0;
+    int count = 0;
+    mChildren.forEach([&](Item* child) {
+        if (child->getVisibility() != GONE) {
+            sum += getOuterIntrinsicSize(child, horizontal, intrinsicSize);
+            count++;
+        }
+    });
+    return count > 0 ? sum + spacing * (count - 1) : 0;
+}
+
+int Layout::maxChildIntrinsicSize(bool horizontal, int intrinsicSize) {
+    int largest = 0;
+    mChildren.forEach([&](Item* child) {
+        if (child->getVisibility() != GONE) {
+            largest = std::max(largest, getOuterIntrinsicSize(child, horizontal, intrinsicSize));
+        }
+    });
+    return largest;
+}
+
+bool Layout::resetChildren(const Item& prototype) {
+    const Layout& layout = static_cast<const Layout&>(prototype);
+    if (mChildren.size() != layout.mChildren.size()) {
+        return false;
+    }
+    for (int i = 0; i < mChildren.size(); i++) {
+        if (!mChildren.get(i)->resetSubtree(*layout.mChildren.get(i))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const Item* Layout::findSharedLayout(Item* child, int widthMeasureSpec, int heightMeasureSpec) {
+    size_t layoutHash = child->getLayoutHash();
+    const Item* source = mLayoutResults.find(layoutHash, widthMeasureSpec, heightMeasureSpec);
+    // The entry is only a hint, the source may have changed or been measured again since.
+    if (source == nullptr || source == child || source->mParent != this || source->isMeasureRequested()
+        || source->mOldWidthMeasureSpec != widthMeasureSpec || source->mOldHeightMeasureSpec != heightMeasureSpec
+        || source->mLastOnMeasureWidthSpec != widthMeasureSpec
+        || source->mLastOnMeasureHeightSpec != heightMeasureSpec
+        || (source->mPrivateFlags & PFLAG_MEASURE_NEEDED_BEFORE_LAYOUT) != 0
+        || const_cast<Item*>(source)->getLayoutHash() != layoutHash) {
+        return nullptr;
+    }
+    return source;
+}
+
+void Layout::shareLayout(Item* child, int widthMeasureSpec, int heightMeasureSpec) {
+    if (child->mLastOnMeasureWidthSpec == widthMeasureSpec && child->mLastOnMeasureHeightSpec == heightMeasureSpec) {
+        mLayoutResults.put(child->getLayoutHash(), widthMeasureSpec, heightMeasureSpec, child);
+    }
+}
+
+size_t Layout::computeLayoutHash() const {
+    size_t hash = hashCombine(Item::computeLayoutHash(), mChildren.size());
+    mChildren.forEach([&hash](Item* child) { hash = hashCombine(hash, child->getLayoutHash()); });
+    return hash;
+}
+
+bool Layout::isChildBaselineUsed(const Item* child) {
+    for (int i = 0; i < getChildCount(); i++) {
+        Item* candidate = getChildAt(i);
+        if (candidate->getVisibility() != GONE) {
+            return candidate == child;
+        }
+    }
+    return false;
+}
+
+void Layout::copyMeasuredState(const Item& source) {
+    const Layout& layout = static_cast<const Layout&>(source);
+    for (int i = 0; i < mChildren.size(); i++) {
+        Item* child = mChildren.get(i);
+        const Item* sourceChild = layout.mChildren.get(i);
+        child->mOldWidthMeasureSpec = sourceChild->mOldWidthMeasureSpec;
+        child->mOldHeightMeasureSpec = sourceChild->mOldHeightMeasureSpec;
+        child->mLastOnMeasureWidthSpec = sourceChild->mLastOnMeasureWidthSpec;
+        child->mLastOnMeasureHeightSpec = sourceChild->mLastOnMeasureHeightSpec;
+        child->mMeasurePass = sMeasurePass;
+        int copiedFlags = PFLAG_RELAYOUT_BOUNDARY | PFLAG_MEASURE_NEEDED_BEFORE_LAYOUT;
+        child->mPrivateFlags = (child->mPrivateFlags & ~copiedFlags) | (sourceChild->mPrivateFlags & copiedFlags)
+                               | PFLAG_LAYOUT_REQUIRED;
+        child->mMeasureCache.clear();
+        child->copyLayout(*sourceChild);
+    }
+}
+
+bool Layout::layoutChildrenFrom(const Item& source) {
+    const Layout& layout = static_cast<const Layout&>(source);
+    for (int i = 0; i < layout.mChildren.size(); i++) {
+        const Item* sourceChild = layout.mChildren.get(i);
+        if (sourceChild->getVisibility() != GONE
+            && (sourceChild->mPrivateFlags & (PFLAG_FORCE_LAYOUT | PFLAG_LAYOUT_REQUIRED
+                                              | PFLAG_MEASURE_NEEDED_BEFORE_LAYOUT)) != 0) {
+            return false;
+        }
+    }
+    for (int i = 0; i < mChildren.size(); i++) {
+        Item* child = mChildren.get(i);
+        const Item* sourceChild = layout.mChildren.get(i);
+        if (child->getVisibility() != GONE) {
+            child->layout(sourceChild->mLeft, sourceChild->mTop, sourceChild->mRight, sourceChild->mBottom);
+        }
+    }
+    return true;
+}
@@ -7,12 +7,76 @@
 
 #pragma once
 
+#include <algorithm>
 #include <vector>
 #include "Item.h"
+#include "ChildList.h"
+#include "LayoutResultCache.h"
 
 class Layout : public Item {
+    friend class Item;
+    friend class LayoutResultWriter;
+
 private:
-    std::vector<Item*> mChildren;
+    ChildList mChildren;
+
+    /**
+     * The lowest index at which a child has been added, removed or has requested a layout since
+     * the last call to {@link #consumeFirstChangedChild()}.
+     */
+    int mFirstChangedChild = 0;
+
+    void onChildChanged(int index) {
+        mFirstChangedChild = std::min(mFirstChangedChild, index);
+    }
+
+    void onChildrenMutated(int index) {
+        ++sTreeMutations;
+        onChildChanged(index);
+        mPrivateFlags |= PFLAG_CHILD_ORDER_CHANGED;
+        invalidateSubtreeCaches();
+        invalidateLayout();
+    }
+
+    /**
+     * The children measured last for each layout hash and pair of specs, when the children share
+     * their layouts.
+     */
+    LayoutResultCache mLayoutResults;
+
+    /**
+     * The ids of the children removed since a {@link LayoutResultWriter} last reported them, in
+     * the damage set of the container.
+     */
+    std::vector<int> mRemovedIds;
+
+    void onChildRemoved(Item* child) {
+        child->mParent = nullptr;
+        if ((child->mPrivateFlags & PFLAG_FRAME_REPORTED) != 0) {
+            child->mPrivateFlags &= ~PFLAG_FRAME_REPORTED;
+            mRemovedIds.push_back(child->mId);
+            markChildFrameDamaged();
+        }
+    }
+
+    /**
+     * Returns a child whose measured layout the given child can copy: an equal subtree measured
+     * with the same specs and still in that state.
+     */
+    const Item* findSharedLayout(Item* child, int widthMeasureSpec, int heightMeasureSpec);
+
+    /**
+     * Records the child as measured with the given specs.
+     */
+    void shareLayout(Item* child, int widthMeasureSpec, int heightMeasureSpec);
+
+    /**
+     * Scratch arrays of the children's dimensions, paddings and percents used to compute their
+     * measure specs in one batch.
+     */
+    std::vector<int> mBatchDimensions;
+    std::vector<int> mBatchPaddings;
+    std::vector<float> mBatchPercents;
 
 protected:
     /**
@@ -56,14 +120,118 @@ protected:
                                            int parentWidthMeasureSpec, int widthUsed,
                                            int parentHeightMeasureSpec, int heightUsed);
 
+    void layoutChildrenIfNeeded() override;
+
+    Item* cloneItem(ItemArena* arena) const override;
+
+    void cloneChildren(const Item& prototype, ItemArena* arena) override;
+
+    bool resetChildren(const Item& prototype) override;
+
+    /**
+     * Returns the sum of the intrinsic sizes of the visible children along an axis, margins
+     * included, see {@link Item#getIntrinsicWidth(int)}.
+     *
+     * @param horizontal    true for the widths, false for the heights
+     * @param intrinsicSize {@link IntrinsicSize#MIN_CONTENT} or {@link IntrinsicSize#MAX_CONTENT}
+     * @param spacing       the space added between two visible children
+     */
+    int sumChildIntrinsicSizes(bool horizontal, int intrinsicSize, int spacing);
+
+    /**
+     * Returns the largest intrinsic size of the visible children along an axis, margins included.
+     *
+     * @param horizontal    true for the widths, false for the heights
+     * @param intrinsicSize {@link IntrinsicSize#MIN_CONTENT} or {@link IntrinsicSize#MAX_CONTENT}
+     */
+    int maxChildIntrinsicSize(bool horizontal, int intrinsicSize);
+
+    size_t computeLayoutHash() const override;
+
+    /**
+     * Returns whether the layout or the baseline of this container depends on the baseline of a
+     * child, in which case the child isn't a relayout boundary: a change inside it may move its
+     * baseline without changing its size. The baseline of a container is the one of its first
+     * visible child unless a subclass overrides it.
+     *
+     * @param child a child of this container
+     * @return true if the baseline of the child is used
+     */
+    virtual bool isChildBaselineUsed(const Item* child);
+
+    void copyMeasuredState(const Item& source) override;
+
+    bool layoutChildrenFrom(const Item& source) override;
+
+    /**
+     * Computes the measure specs of all the children along one axis in one batch, see
+     * {@link #getChildMeasureSpecs(int, const int*, const int*, const float*, int*, int)}.
+     *
+     * @param spec           the requirements of this item along the axis
+     * @param padding        the padding of this item along the axis and any extra space used
+     * @param horizontal     true for the width specs, false for the height specs
+     * @param includeMargins true to add the margins of each child to the padding
+     * @param measureSpecs   receives the spec of each child, indexed like the children
+     */
+    void getChildMeasureSpecs(int spec, int padding, bool horizontal, bool includeMargins,
+                              std::vector<int>& measureSpecs);
+
+    /**
+     * Carries the state of the last measure pass of a child over to the current pass, for a
+     * child whose measures of the last pass are reused instead of being repeated. The child
+     * remains a relayout boundary only if it was one in the last pass.
+     *
+     * @param child the child whose measures are reused
+     */
+    static void reuseChildMeasures(Item* child) { child->mMeasurePass = sMeasurePass; }
+
+    /**
+     * Returns the lowest index from which the children may have changed since the last call,
+     * which resets the state: the children before it have not been added, removed or requested
+     * a layout since. Any change of this container itself, e.g. a call to
+     * {@link #requestLayout()}, returns 0.
+     *
+     * @return the index of the first child which may have to be measured again
+     */
+    int consumeFirstChangedChild() {
+        int firstChangedChild = mFirstChangedChild;
+        if ((mPrivateFlags & PFLAG_LAYOUT_INVALIDATED) != 0) {
+            firstChangedChild = 0;
+            mPrivateFlags &= ~PFLAG_LAYOUT_INVALIDATED;
+        }
+        mFirstChangedChild = INT_MAX;
+        return firstChangedChild;
+    }
+
+    /**
+     * @return true if a child has been added or removed or has changed its order since the last
+     * call, which resets the state.
+     */
+    bool consumeChildOrderChanged() {
+        if ((mPrivateFlags & PFLAG_CHILD_ORDER_CHANGED) == 0) {
+            return false;
+        }
+        mPrivateFlags &= ~PFLAG_CHILD_ORDER_CHANGED;
+        return true;
+    }
+
 public:
+    Layout() = default;
+
+    /**
+     * Copies the attributes of the prototype but not its children, see
+     * {@link Item#cloneSubtree(ItemArena*)}.
+     */
+    Layout(const Layout& prototype) : Item(prototype) {}
 
     /**
      * Adds the item to the container.
      *
      * @param item the item to be added
      */
-    void addItem(Item* item) { mChildren.emplace_back(item); }
+    void addItem(Item* item) {
+        addItem(item, mChildren.size());
+    }
 
     /**
      * Adds the item to the specified index of the container.
@@ -72,15 +240,23 @@ public:
      * @param index the index for the item to be added
      */
     void addItem(Item* item, int index) {
-        auto iter = mChildren.begin();
-        mChildren.insert(iter + index, item);
+        mChildren.insert(index, item);
+        item->mParent = this;
+        // Its subtree is reported in the new container even if its frames don't change, it may
+        // have been reported removed from another one.
+        item->mPrivateFlags |= PFLAG_SUBTREE_FRAME_DAMAGED;
+        item->markFrameDamaged();
+        onChildrenMutated(index);
     }
 
     /**
      * Removes all the items contained in the container.
      */
     void removeAllItems() {
+        mChildren.forEach([this](Item* child) { onChildRemoved(child); });
         mChildren.clear();
+        mLayoutResults.clear();
+        onChildrenMutated(0);
     }
 
     /**
@@ -89,8 +265,9 @@ public:
      * @param index the index from which the item is removed.
      */
     void removeItemAt(int index) {
-        auto iter = mChildren.begin();
-        mChildren.erase(iter);
+        onChildRemoved(mChildren.removeAt(index));
+        mLayoutResults.clear();
+        onChildrenMutated(index);
     }
 
     /**
@@ -101,12 +278,7 @@ public:
      *         group, or -1 if the item does not exist in the group
      */
     int indexOfChild(Item* child) {
-        for (int i = 0; i < mChildren.size(); i++) {
-            if (mChildren[i] == child) {
-                return i;
-            }
-        }
-        return -1;
+        return child->mParent == this ? mChildren.indexOf(child) : -1;
     }
 
     /**
@@ -127,11 +299,87 @@ public:
      *         does not exist within the group
      */
     Item* getChildAt(int index) {
-        return mChildren[index];
+        return mChildren.get(index);
+    }
+
+    /**
+     * A container is always measured again for new specs, even if its own size can't change:
+     * the specs of its children are derived from them, e.g. a match_parent child fills a new
+     * AT_MOST bound.
+     */
+    bool isMeasurementValidFor(int widthMeasureSpec, int heightMeasureSpec) const override;
+
+    /**
+     * Sets whether the container is in resize mode. In this mode the size a child has been
+     * measured with is kept as its hypothetical size when a new spec can't change it, e.g. a
+     * child whose new bound is the size it already has, so that a resize of the container only
+     * re-runs the line breaking, the distribution of the free space and the positioning.
+     * Children are measured again when their final size actually changes.
+     * <p>
+     * A leaf without a measure function keeps its size for any spec which can't change it, see
+     * {@link Item#isMeasurementValidFor(int, int)}. Containers and texts, whose size along one
+     * axis depends on the other, keep the sizes they were measured with for their last specs,
+     * across passes: one of them measured again with specs it already had, e.g. on a resize back
+     * to a former width, reuses the size as long as nothing changed in its subtree.
+     *
+     * @param resizeMode true to reuse the measured size of the children
+     */
+    void setResizeMode(bool resizeMode) {
+        if (resizeMode) {
+            mPrivateFlags |= PFLAG_RESIZE_MODE;
+        } else {
+            mPrivateFlags &= ~PFLAG_RESIZE_MODE;
+        }
     }
 
+    /**
+     * @return true if the container reuses the measured size of its children when resized.
+     * @see #setResizeMode(bool)
+     */
+    bool isResizeMode() const { return (mPrivateFlags & PFLAG_RESIZE_MODE) == PFLAG_RESIZE_MODE; }
+
+    /**
+     * Sets whether the children share their layouts. A child whose subtree has the same layout
+     * hash as a sibling already measured with the same specs copies the measured sizes of that
+     * sibling's subtree instead of measuring it, and its frames when it is laid out with the
+     * same size. Suited to the rows or cells of a list built from the same template.
+     *
+     * @param layoutSharing true to share the layouts of equal children
+     * @see Item#getLayoutHash()
+     */
+    void setLayoutSharing(bool layoutSharing) {
+        if (layoutSharing) {
+            mPrivateFlags |= PFLAG_SHARE_CHILD_LAYOUTS;
+        } else {
+            mPrivateFlags &= ~PFLAG_SHARE_CHILD_LAYOUTS;
+            mLayoutResults.clear();
+        }
+    }
+
+    /**
+     * @return true if the children share their layouts.
+     * @see #setLayoutSharing(bool)
+     */
+    bool isLayoutSharing() const { return (mPrivateFlags & PFLAG_SHARE_CHILD_LAYOUTS) != 0; }
+
     static int getChildMeasureSpec(int spec, int padding, int childDimension, float percent);
 
+    /**
+     * Batch version of {@link #getChildMeasureSpec(int, int, int, float)} computing the specs of
+     * a range of siblings from arrays of their paddings, dimensions and percents. The spec of the
+     * parent is shared by the whole range, so the result is computed without branches, eight or
+     * four children at a time with AVX2 or SSE2 when available.
+     *
+     * @param spec            the requirements for this item
+     * @param paddings        the padding of this item along the axis plus the margins of each child
+     * @param childDimensions how big each child wants to be along the axis
+     * @param percents        the percent value of each child dimension
+     * @param measureSpecs    receives the spec of each child
+     * @param count           the number of children
+     */
+    static void getChildMeasureSpecs(int spec, const int* paddings, const int* childDimensions,
+                                     const float* percents, int* measureSpecs, int count);
+
     /**
      * Returns the child measure spec for its width.
      *
@@ -175,4 +423,23 @@ public:
      * @return the bottom padding of the flex container.
      */
     int getPaddingBottom() const { return mPaddingBottom; }
+
+    /**
+     * Sets the padding of the container. Only this container has to be measured again, the
+     * request stops here if it is a relayout boundary.
+     *
+     * @param left   the left padding
+     * @param top    the top padding
+     * @param right  the right padding
+     * @param bottom the bottom padding
+     */
+    void setPadding(int left, int top, int right, int bottom) {
+        if (mPaddingLeft != left || mPaddingTop != top || mPaddingRight != right || mPaddingBottom != bottom) {
+            mPaddingLeft = left;
+            mPaddingTop = top;
+            mPaddingRight = right;
+            mPaddingBottom = bottom;
+            requestLayout();
+        }
+    }
 };
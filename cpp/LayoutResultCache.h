@@ -0,0 +1,62 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#pragma once
+
+#include <unordered_map>
+
+class Item;
+
+/**
+ * Maps the layout hash of a subtree and the specs it has been measured with to the item whose
+ * measured layout can be copied by the equal subtrees measured with the same specs, see
+ * {@link Layout#setLayoutSharing(bool)}.
+ */
+class LayoutResultCache {
+public:
+    /**
+     * @param layoutHash        the layout hash of the subtree
+     * @param widthMeasureSpec  the horizontal space requirements
+     * @param heightMeasureSpec the vertical space requirements
+     * @return the item last stored for the key, or null
+     */
+    Item* find(size_t layoutHash, int widthMeasureSpec, int heightMeasureSpec) const {
+        auto it = mEntries.find({layoutHash, widthMeasureSpec, heightMeasureSpec});
+        return it != mEntries.end() ? it->second : nullptr;
+    }
+
+    /**
+     * Stores the item measured for the key, replacing the previous one.
+     */
+    void put(size_t layoutHash, int widthMeasureSpec, int heightMeasureSpec, Item* item) {
+        mEntries[{layoutHash, widthMeasureSpec, heightMeasureSpec}] = item;
+    }
+
+    void clear() { mEntries.clear(); }
+
+private:
+    struct Key {
+        size_t layoutHash;
+        int widthMeasureSpec;
+        int heightMeasureSpec;
+
+        bool operator==(const Key& other) const {
+            return layoutHash == other.layoutHash && widthMeasureSpec == other.widthMeasureSpec
+                   && heightMeasureSpec == other.heightMeasureSpec;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            size_t specs = static_cast<unsigned int>(key.widthMeasureSpec) * 31u
+                           + static_cast<unsigned int>(key.heightMeasureSpec);
+            return key.layoutHash ^ (specs + 0x9e3779b97f4a7c15ull + (key.layoutHash << 6) + (key.layoutHash >> 2));
+        }
+    };
+
+    std::unordered_map<Key, Item*, KeyHash> mEntries;
+};
@@ -0,0 +1,132 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <algorithm>
+#include <stdexcept>
+#include "LayoutResultWriter.h"
+#include "Layout.h"
+
+LayoutResultWriter::LayoutResultWriter(void* buffer, size_t capacity)
+        : mHeader(static_cast<Header*>(buffer)),
+          mRecords(reinterpret_cast<Record*>(static_cast<char*>(buffer) + sizeof(Header))),
+          mCapacity(capacity < sizeof(Header) ? 0 : (capacity - sizeof(Header)) / sizeof(Record)) {
+    if (buffer == nullptr || reinterpret_cast<uintptr_t>(buffer) % alignof(Record) != 0
+        || capacity < sizeof(Header)) {
+        throw std::invalid_argument("The result buffer is misaligned or too small");
+    }
+}
+
+size_t LayoutResultWriter::writeFrames(Item* root) {
+    begin();
+    mComplete = writeSubtree(root, false);
+    end();
+    return mRecordCount;
+}
+
+size_t LayoutResultWriter::writeDamagedFrames(Item* root) {
+    begin();
+    mComplete = writeRemovals(root) && writeSubtree(root, true);
+    end();
+    return mRecordCount;
+}
+
+void LayoutResultWriter::begin() {
+    mRecordCount = 0;
+}
+
+void LayoutResultWriter::end() {
+    mHeader->recordCount = static_cast<uint32_t>(mRecordCount);
+    mHeader->complete = mComplete ? 1 : 0;
+}
+
+bool LayoutResultWriter::writeRecord(Item* item) {
+    if (mRecordCount == mCapacity) {
+        return false;
+    }
+    Record& record = mRecords[mRecordCount++];
+    record.id = item->mId;
+    record.left = item->mLeft;
+    record.top = item->mTop;
+    record.width = item->mRight - item->mLeft;
+    record.height = item->mBottom - item->mTop;
+    item->mPrivateFlags = (item->mPrivateFlags & ~Item::PFLAG_FRAME_DAMAGED) | Item::PFLAG_FRAME_REPORTED;
+    return true;
+}
+
+bool LayoutResultWriter::writeRemovals(Item* item) {
+    if ((item->mPrivateFlags & Item::PFLAG_CHILD_FRAME_DAMAGED) == 0) {
+        return true;
+    }
+    auto layout = dynamic_cast<Layout*>(item);
+    if (layout == nullptr) {
+        return true;
+    }
+    if ((item->mPrivateFlags & Item::PFLAG_SUBTREE_FRAME_DAMAGED) != 0) {
+        // The renderer dropped the subtree when it was removed, and gets it whole again.
+        dropRemovals(layout);
+        return true;
+    }
+    std::vector<int>& removedIds = layout->mRemovedIds;
+    size_t written = std::min(removedIds.size(), mCapacity - mRecordCount);
+    for (size_t i = 0; i < written; i++) {
+        mRecords[mRecordCount++] = {removedIds[i], 0, 0, REMOVED, REMOVED};
+    }
+    removedIds.erase(removedIds.begin(), removedIds.begin() + static_cast<ptrdiff_t>(written));
+    if (!removedIds.empty()) {
+        return false;
+    }
+    for (int i = 0; i < layout->getChildCount(); i++) {
+        if (!writeRemovals(layout->getChildAt(i))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void LayoutResultWriter::dropRemovals(Layout* layout) {
+    layout->mRemovedIds.clear();
+    for (int i = 0; i < layout->getChildCount(); i++) {
+        auto child = dynamic_cast<Layout*>(layout->getChildAt(i));
+        if (child != nullptr && (child->mPrivateFlags & Item::PFLAG_CHILD_FRAME_DAMAGED) != 0) {
+            dropRemovals(child);
+        }
+    }
+}
+
+bool LayoutResultWriter::writeSubtree(Item* item, bool damagedOnly) {
+    if (damagedOnly && (item->mPrivateFlags & Item::PFLAG_SUBTREE_FRAME_DAMAGED) != 0) {
+        // Added to a container, the renderer may have dropped the whole subtree. The damage is
+        // pushed down level by level, so that a full buffer leaves only the rest of it.
+        item->mPrivateFlags = (item->mPrivateFlags & ~Item::PFLAG_SUBTREE_FRAME_DAMAGED)
+                              | Item::PFLAG_FRAME_DAMAGED | Item::PFLAG_CHILD_FRAME_DAMAGED;
+        if (auto layout = dynamic_cast<Layout*>(item)) {
+            for (int i = 0; i < layout->getChildCount(); i++) {
+                layout->getChildAt(i)->mPrivateFlags |= Item::PFLAG_SUBTREE_FRAME_DAMAGED;
+            }
+        }
+    }
+    if ((!damagedOnly || (item->mPrivateFlags & Item::PFLAG_FRAME_DAMAGED) != 0) && !writeRecord(item)) {
+        return false;
+    }
+    if (damagedOnly && (item->mPrivateFlags & Item::PFLAG_CHILD_FRAME_DAMAGED) == 0) {
+        return true;
+    }
+    if (auto layout = dynamic_cast<Layout*>(item)) {
+        if (!damagedOnly) {
+            // The frames written replace everything the renderer displays.
+            layout->mRemovedIds.clear();
+        }
+        for (int i = 0; i < layout->getChildCount(); i++) {
+            if (!writeSubtree(layout->getChildAt(i), damagedOnly)) {
+                // The rest of the subtree stays in the damage set.
+                return false;
+            }
+        }
+    }
+    item->mPrivateFlags &= ~(Item::PFLAG_CHILD_FRAME_DAMAGED | Item::PFLAG_SUBTREE_FRAME_DAMAGED);
+    return true;
+}
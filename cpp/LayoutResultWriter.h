@@ -0,0 +1,128 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include "Item.h"
+
+class Layout;
+
+/**
+ * Writes the frames of laid out items into a buffer supplied by the caller, e.g. a shared memory
+ * region read by a renderer in another process, without allocating or formatting anything per
+ * item. The buffer holds a {@link Header} followed by one {@link Record} per item, in pre-order,
+ * in the byte order of the writer.
+ *
+ * Either all the frames of a tree are written, or only the ones of its damage set: the items whose
+ * frame has changed since they were last written, the ones laid out for the first time, the
+ * subtrees added to a container and the items removed from one. Finding them only visits the
+ * branches containing changed frames.
+ */
+class LayoutResultWriter {
+public:
+    struct Header {
+        /** The number of records following the header */
+        uint32_t recordCount;
+        /** 1 if every record has been written, 0 if the buffer was too small */
+        uint32_t complete;
+    };
+
+    /**
+     * The frame of an item, relative to its container like {@link Item#getLeft()}, or the removal
+     * of an item from its container, whose width and height are {@link #REMOVED}: the item and its
+     * subtree aren't displayed any more. Removals are written before the frames, so that an item
+     * moved to another container is removed and then written again with its whole subtree.
+     */
+    struct Record {
+        /** See {@link Item#getId()} */
+        int32_t id;
+        int32_t left;
+        int32_t top;
+        int32_t width;
+        int32_t height;
+    };
+
+    /**
+     * The width and height of the record of a removed item.
+     */
+    static constexpr int32_t REMOVED = -1;
+
+    static_assert(std::is_trivially_copyable<Record>::value && sizeof(Record) == 5 * sizeof(int32_t),
+                  "The records are copied as they are");
+
+    /**
+     * @param buffer   the buffer, aligned on 4 bytes, it must outlive the writer
+     * @param capacity the size of the buffer in bytes
+     * @throws std::invalid_argument if the buffer is misaligned or can't hold the header
+     */
+    LayoutResultWriter(void* buffer, size_t capacity);
+
+    /**
+     * Writes the frames of every item of the tree, and clears its damage set. No removal is
+     * written: the items which aren't in the tree any more are left out.
+     *
+     * @return the number of records written, less than the number of items if the buffer is full
+     */
+    size_t writeFrames(Item* root);
+
+    /**
+     * Writes the frames of the damage set of the tree, and removes the items written from it. If
+     * the buffer is full, the items left are still in the damage set and written by the next call.
+     *
+     * @return the number of records written
+     */
+    size_t writeDamagedFrames(Item* root);
+
+    /**
+     * @return the size of the last results written, header included
+     */
+    size_t getSize() const { return sizeof(Header) + mRecordCount * sizeof(Record); }
+
+    /**
+     * @return false if the last results didn't fit in the buffer
+     */
+    bool isComplete() const { return mComplete; }
+
+private:
+    Header* mHeader;
+    Record* mRecords;
+    size_t mCapacity;
+    size_t mRecordCount = 0;
+    bool mComplete = true;
+
+    void begin();
+
+    void end();
+
+    /**
+     * Writes the record of the item.
+     *
+     * @return false if the buffer is full
+     */
+    bool writeRecord(Item* item);
+
+    /**
+     * Writes the removals in the damaged branches of the subtree, and removes the ones written
+     * from the damage set.
+     *
+     * @return false if the buffer is full before all of them have been written
+     */
+    bool writeRemovals(Item* item);
+
+    /**
+     * Removes the removals in the damaged branches of the subtree from the damage set.
+     */
+    void dropRemovals(Layout* layout);
+
+    /**
+     * @return false if the buffer is full before the whole subtree has been written
+     */
+    bool writeSubtree(Item* item, bool damagedOnly);
+};
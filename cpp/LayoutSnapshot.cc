@@ -0,0 +1,378 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "LayoutSnapshot.h"
+#include "TreeFormat.h"
+#include "FlexLayout.h"
+#include "FlowLayout.h"
+#include "LinearLayout.h"
+
+static const char MAGIC[4] = {'F', 'L', 'X', 'S'};
+
+/**
+ * Reads the words of a measured state, failing instead of reading past its end.
+ */
+class StateReader {
+public:
+    StateReader(const int32_t* state, size_t size) : mNext(state), mEnd(state + size) {}
+
+    int32_t next() {
+        if (mNext == mEnd) {
+            mValid = false;
+            return 0;
+        }
+        return *mNext++;
+    }
+
+    float nextFloat() {
+        int32_t word = next();
+        float value;
+        std::memcpy(&value, &word, sizeof(value));
+        return value;
+    }
+
+    std::vector<int> nextVector() {
+        int32_t size = next();
+        if (size < 0 || size > mEnd - mNext) {
+            mValid = false;
+            return {};
+        }
+        std::vector<int> values(mNext, mNext + size);
+        mNext += size;
+        return values;
+    }
+
+    /**
+     * @return false if a read went past the end
+     */
+    bool isValid() const { return mValid; }
+
+    /**
+     * @return true if every word has been read, and no more
+     */
+    bool isComplete() const { return mValid && mNext == mEnd; }
+
+private:
+    const int32_t* mNext;
+    const int32_t* mEnd;
+    bool mValid = true;
+};
+
+/**
+ * @return true if every value is in [0, size)
+ */
+static bool areIndices(const std::vector<int>& values, size_t size) {
+    return std::all_of(values.begin(), values.end(), [size](int value) {
+        return value >= 0 && static_cast<size_t>(value) < size;
+    });
+}
+
+static void appendFloat(std::vector<int32_t>& state, float value) {
+    int32_t word;
+    std::memcpy(&word, &value, sizeof(word));
+    state.push_back(word);
+}
+
+static void appendVector(std::vector<int32_t>& state, const std::vector<int>& values) {
+    state.push_back(static_cast<int32_t>(values.size()));
+    state.insert(state.end(), values.begin(), values.end());
+}
+
+void LayoutSnapshot::writeState(Item* item, uint32_t type, std::vector<int32_t>& state) {
+    if (type == TreeFormat::NodeType::FLEX_LAYOUT) {
+        auto flexLayout = static_cast<FlexLayout*>(item);
+        state.push_back(static_cast<int32_t>(flexLayout->mFlexLines.size()));
+        for (const FlexLine& flexLine : flexLayout->mFlexLines) {
+            for (int value : {flexLine.mLeft, flexLine.mTop, flexLine.mRight, flexLine.mBottom, flexLine.mMainSize,
+                              flexLine.mCrossSize, flexLine.mItemCount, flexLine.mGoneItemCount,
+                              flexLine.mMaxBaseline, flexLine.mSumCrossSizeBefore, flexLine.mFirstIndex,
+                              flexLine.mLastIndex, static_cast<int>(flexLine.mAnyItemsHaveFlexGrow),
+                              static_cast<int>(flexLine.mAnyItemsHaveFlexShrink)}) {
+                state.push_back(value);
+            }
+            appendFloat(state, flexLine.mTotalFlexGrow);
+            appendFloat(state, flexLine.mTotalFlexShrink);
+            appendVector(state, flexLine.mIndicesAlignSelfStretch);
+        }
+    } else if (type == TreeFormat::NodeType::FLOW_LAYOUT) {
+        auto flowLayout = static_cast<FlowLayout*>(item);
+        for (int value : {flowLayout->mRowCount, static_cast<int>(flowLayout->mLeadingBreak),
+                          flowLayout->mContentBottom, flowLayout->mRowsMinAvailable, flowLayout->mRowsMaxAvailable}) {
+            state.push_back(value);
+        }
+        for (const std::vector<int>* values : {&flowLayout->mAdvanceSums, &flowLayout->mChildEnds,
+                                               &flowLayout->mRowStarts, &flowLayout->mRowTops,
+                                               &flowLayout->mChildRows}) {
+            appendVector(state, *values);
+        }
+    }
+}
+
+bool LayoutSnapshot::readState(Item* item, uint32_t type, const int32_t* state, size_t size, bool apply) {
+    StateReader reader(state, size);
+    if (type == TreeFormat::NodeType::FLEX_LAYOUT) {
+        auto flexLayout = static_cast<FlexLayout*>(item);
+        int32_t lineCount = reader.next();
+        std::vector<FlexLine> flexLines;
+        for (int32_t i = 0; i < lineCount && reader.isValid(); i++) {
+            FlexLine flexLine;
+            flexLine.mLeft = reader.next();
+            flexLine.mTop = reader.next();
+            flexLine.mRight = reader.next();
+            flexLine.mBottom = reader.next();
+            flexLine.mMainSize = reader.next();
+            flexLine.mCrossSize = reader.next();
+            flexLine.mItemCount = reader.next();
+            flexLine.mGoneItemCount = reader.next();
+            flexLine.mMaxBaseline = reader.next();
+            flexLine.mSumCrossSizeBefore = reader.next();
+            flexLine.mFirstIndex = reader.next();
+            flexLine.mLastIndex = reader.next();
+            flexLine.mAnyItemsHaveFlexGrow = reader.next() != 0;
+            flexLine.mAnyItemsHaveFlexShrink = reader.next() != 0;
+            flexLine.mTotalFlexGrow = reader.nextFloat();
+            flexLine.mTotalFlexShrink = reader.nextFloat();
+            flexLine.mIndicesAlignSelfStretch = reader.nextVector();
+            flexLines.push_back(std::move(flexLine));
+        }
+        if (lineCount < 0 || !reader.isComplete()) {
+            return false;
+        }
+        // The lines index the flex items, in the order of the children.
+        int childCount = flexLayout->getChildCount();
+        for (const FlexLine& flexLine : flexLines) {
+            if (flexLine.mFirstIndex < 0 || flexLine.mItemCount < 0
+                || flexLine.mItemCount > childCount - flexLine.mFirstIndex
+                || flexLine.mLastIndex < 0 || flexLine.mLastIndex >= childCount
+                || !areIndices(flexLine.mIndicesAlignSelfStretch, childCount)) {
+                return false;
+            }
+        }
+        if (apply) {
+            flexLayout->mFlexLines = std::move(flexLines);
+            flexLayout->updateReorderedChildren();
+            // The state used to measure again incrementally isn't saved.
+            flexLayout->mLastWidthMeasureSpec = INT_MIN;
+            flexLayout->mLastHeightMeasureSpec = INT_MIN;
+        }
+        return true;
+    }
+    if (type == TreeFormat::NodeType::FLOW_LAYOUT) {
+        auto flowLayout = static_cast<FlowLayout*>(item);
+        int rowCount = reader.next();
+        bool leadingBreak = reader.next() != 0;
+        int contentBottom = reader.next();
+        int rowsMinAvailable = reader.next();
+        int rowsMaxAvailable = reader.next();
+        std::vector<int> advanceSums = reader.nextVector();
+        std::vector<int> childEnds = reader.nextVector();
+        std::vector<int> rowStarts = reader.nextVector();
+        std::vector<int> rowTops = reader.nextVector();
+        std::vector<int> childRows = reader.nextVector();
+        if (!reader.isComplete()) {
+            return false;
+        }
+        // One advance sum more than children, and a top for each row, unless the layout has
+        // never been measured, in which case its rows can't be reused.
+        size_t childCount = static_cast<size_t>(flowLayout->getChildCount());
+        bool measured = !advanceSums.empty();
+        size_t measuredCount = measured ? childCount : 0;
+        if (rowCount < 0 || (measured && advanceSums.size() != childCount + 1)
+            || (!measured && (!rowStarts.empty() || rowsMinAvailable <= rowsMaxAvailable))
+            || childEnds.size() != measuredCount || childRows.size() != measuredCount
+            || rowTops.size() != rowStarts.size() || !areIndices(rowStarts, childCount)) {
+            return false;
+        }
+        // There are no rows when all the children are gone.
+        for (size_t i = 0; i < measuredCount; i++) {
+            if (childRows[i] < 0 || (static_cast<size_t>(childRows[i]) >= rowStarts.size()
+                                     && flowLayout->getChildAt(static_cast<int>(i))->getVisibility() != Item::GONE)) {
+                return false;
+            }
+        }
+        if (apply) {
+            flowLayout->mRowCount = rowCount;
+            flowLayout->mLeadingBreak = leadingBreak;
+            flowLayout->mContentBottom = contentBottom;
+            flowLayout->mRowsMinAvailable = rowsMinAvailable;
+            flowLayout->mRowsMaxAvailable = rowsMaxAvailable;
+            flowLayout->mAdvanceSums = std::move(advanceSums);
+            flowLayout->mChildEnds = std::move(childEnds);
+            flowLayout->mFirstDecreasingEnd = static_cast<int>(
+                    std::is_sorted_until(flowLayout->mChildEnds.begin(), flowLayout->mChildEnds.end())
+                    - flowLayout->mChildEnds.begin());
+            flowLayout->mRowStarts = std::move(rowStarts);
+            flowLayout->mRowTops = std::move(rowTops);
+            flowLayout->mChildRows = std::move(childRows);
+            flowLayout->mLastWidthMeasureSpec = INT_MIN;
+            flowLayout->mLastHeightMeasureSpec = INT_MIN;
+        }
+        return true;
+    }
+    return reader.isComplete();
+}
+
+uint64_t LayoutSnapshot::computeStructureHash(Item* root) {
+    // FNV-1a over the attribute records of TreeFormat, in pre-order.
+    uint64_t hash = 0xcbf29ce484222325ull;
+    auto combine = [&hash](const void* data, size_t size) {
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ static_cast<const unsigned char*>(data)[i]) * 0x100000001b3ull;
+        }
+    };
+    std::vector<Item*> stack{root};
+    TreeFormat::NodeRecord record;
+    while (!stack.empty()) {
+        Item* item = stack.back();
+        stack.pop_back();
+        TreeFormat::writeRecord(item, record);
+        combine(&record, sizeof(record));
+        char measured = item->mMeasureFunction ? 1 : 0;
+        combine(&measured, sizeof(measured));
+        if (record.type != TreeFormat::NodeType::ITEM) {
+            auto layout = static_cast<Layout*>(item);
+            for (int i = layout->getChildCount() - 1; i >= 0; i--) {
+                stack.push_back(layout->getChildAt(i));
+            }
+        }
+    }
+    return hash;
+}
+
+std::vector<char> LayoutSnapshot::write(Item* root, uint64_t contentKey) {
+    Header header = {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.version = VERSION;
+    header.widthMeasureSpec = root->mOldWidthMeasureSpec;
+    header.heightMeasureSpec = root->mOldHeightMeasureSpec;
+    header.structureHash = computeStructureHash(root);
+    header.contentKey = contentKey;
+
+    std::vector<char> bytes(sizeof(Header));
+    std::vector<int32_t> state;
+    // Pre-order, the children are pushed in reverse.
+    std::vector<Item*> stack{root};
+    while (!stack.empty()) {
+        Item* item = stack.back();
+        stack.pop_back();
+        NodeRecord record = {};
+        record.type = TreeFormat::getNodeType(*item);
+        record.flags = static_cast<uint32_t>(item->mPrivateFlags & SAVED_FLAGS);
+        record.measuredWidth = item->mMeasuredWidth;
+        record.measuredHeight = item->mMeasuredHeight;
+        record.baseline = item->mBaseline;
+        record.oldWidthMeasureSpec = item->mOldWidthMeasureSpec;
+        record.oldHeightMeasureSpec = item->mOldHeightMeasureSpec;
+        record.lastOnMeasureWidthSpec = item->mLastOnMeasureWidthSpec;
+        record.lastOnMeasureHeightSpec = item->mLastOnMeasureHeightSpec;
+        record.left = item->mLeft;
+        record.top = item->mTop;
+        record.right = item->mRight;
+        record.bottom = item->mBottom;
+        state.clear();
+        writeState(item, record.type, state);
+        record.stateSize = static_cast<uint32_t>(state.size());
+
+        size_t offset = bytes.size();
+        bytes.resize(offset + sizeof(NodeRecord) + state.size() * sizeof(int32_t));
+        std::memcpy(bytes.data() + offset, &record, sizeof(NodeRecord));
+        std::memcpy(bytes.data() + offset + sizeof(NodeRecord), state.data(), state.size() * sizeof(int32_t));
+        header.nodeCount++;
+
+        if (record.type != TreeFormat::NodeType::ITEM) {
+            auto layout = static_cast<Layout*>(item);
+            for (int i = layout->getChildCount() - 1; i >= 0; i--) {
+                stack.push_back(layout->getChildAt(i));
+            }
+        }
+    }
+    std::memcpy(bytes.data(), &header, sizeof(Header));
+    return bytes;
+}
+
+bool LayoutSnapshot::restore(Item* root, const void* data, size_t size, int widthMeasureSpec,
+                             int heightMeasureSpec, uint64_t contentKey) {
+    if (size < sizeof(Header) || reinterpret_cast<uintptr_t>(data) % alignof(NodeRecord) != 0) {
+        throw std::invalid_argument("Not a layout snapshot, or not aligned");
+    }
+    auto header = static_cast<const Header*>(data);
+    if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0) {
+        throw std::invalid_argument("Not a layout snapshot");
+    }
+    if (header->byteOrder != BYTE_ORDER_MARK || header->version != VERSION
+        || header->widthMeasureSpec != widthMeasureSpec || header->heightMeasureSpec != heightMeasureSpec
+        || header->contentKey != contentKey || header->structureHash != computeStructureHash(root)) {
+        return false;
+    }
+
+    // Every record is matched with its item before anything is restored.
+    struct Node {
+        Item* item;
+        const NodeRecord* record;
+    };
+    std::vector<Node> nodes;
+    const char* next = static_cast<const char*>(data) + sizeof(Header);
+    const char* end = static_cast<const char*>(data) + size;
+    std::vector<Item*> stack{root};
+    while (!stack.empty()) {
+        Item* item = stack.back();
+        stack.pop_back();
+        if (static_cast<size_t>(end - next) < sizeof(NodeRecord)) {
+            throw std::invalid_argument("Truncated layout snapshot");
+        }
+        auto record = reinterpret_cast<const NodeRecord*>(next);
+        next += sizeof(NodeRecord);
+        if (record->stateSize > static_cast<size_t>(end - next) / sizeof(int32_t)) {
+            throw std::invalid_argument("Truncated layout snapshot");
+        }
+        auto state = reinterpret_cast<const int32_t*>(next);
+        next += record->stateSize * sizeof(int32_t);
+        if (record->type != TreeFormat::getNodeType(*item)) {
+            return false;
+        }
+        if (!readState(item, record->type, state, record->stateSize, false)) {
+            throw std::invalid_argument("Corrupted layout snapshot");
+        }
+        nodes.push_back({item, record});
+        if (record->type != TreeFormat::NodeType::ITEM) {
+            auto layout = static_cast<Layout*>(item);
+            for (int i = layout->getChildCount() - 1; i >= 0; i--) {
+                stack.push_back(layout->getChildAt(i));
+            }
+        }
+    }
+    if (nodes.size() != header->nodeCount) {
+        return false;
+    }
+
+    for (const Node& node : nodes) {
+        Item* item = node.item;
+        const NodeRecord* record = node.record;
+        item->mMeasuredWidth = record->measuredWidth;
+        item->mMeasuredHeight = record->measuredHeight;
+        item->mBaseline = record->baseline;
+        item->mOldWidthMeasureSpec = record->oldWidthMeasureSpec;
+        item->mOldHeightMeasureSpec = record->oldHeightMeasureSpec;
+        item->mLastOnMeasureWidthSpec = record->lastOnMeasureWidthSpec;
+        item->mLastOnMeasureHeightSpec = record->lastOnMeasureHeightSpec;
+        item->mMeasureCache.clear();
+        // The frame isn't set with setFrame, the item is still reported as damaged if it is new.
+        item->mLeft = record->left;
+        item->mTop = record->top;
+        item->mRight = record->right;
+        item->mBottom = record->bottom;
+        // A later measure of a container measures all its children again.
+        item->mPrivateFlags = (item->mPrivateFlags & ~SAVED_FLAGS) | (static_cast<int>(record->flags) & SAVED_FLAGS)
+                              | Item::PFLAG_LAYOUT_INVALIDATED;
+        readState(item, record->type, reinterpret_cast<const int32_t*>(record + 1), record->stateSize, true);
+    }
+    return true;
+}
@@ -0,0 +1,154 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+#include "Item.h"
+
+/**
+ * Saves the computed layout of a tree, so that the same screen shown by the next start of the
+ * process is laid out without measuring anything: a snapshot written after a layout, e.g. into a
+ * file which is mapped in memory by the next start, is restored into the freshly built tree, which
+ * then takes the measured sizes, frames and measured state of the containers from it (the same
+ * state an equal sibling hands over with {@link Layout#setLayoutSharing(bool)}).
+ *
+ * A snapshot only applies to a tree with the same structure hash, see
+ * {@link #computeStructureHash(Item*)}, measured with the same specs at its root. Unlike
+ * {@link Item#getLayoutHash()}, the structure hash doesn't depend on the addresses of the items,
+ * which differ from one process to the next. It can't tell what the measure functions measure
+ * though, e.g. texts: the caller passes a key of that content, e.g. a hash of the texts and of the
+ * fonts, and the snapshot only applies with the same key. The sizes cached for the other specs of
+ * a measure pass aren't kept, they are only valid within their pass.
+ *
+ * The snapshot is a {@link Header} followed by one {@link NodeRecord} per item in pre-order, each
+ * one followed by the measured state of its container, made of 32 bits words in the byte order of
+ * the writer.
+ */
+class LayoutSnapshot {
+public:
+    /** The version of the format, changed with the layout of the records */
+    static constexpr uint32_t VERSION = 2;
+
+    static constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+    struct Header {
+        /** "FLXS" */
+        char magic[4];
+
+        /** {@link #BYTE_ORDER_MARK} in the byte order of the writer */
+        uint32_t byteOrder;
+
+        uint32_t version;
+
+        uint32_t nodeCount;
+
+        /** The specs the root has been measured with */
+        int32_t widthMeasureSpec;
+        int32_t heightMeasureSpec;
+
+        /** See {@link #computeStructureHash(Item*)} */
+        uint64_t structureHash;
+
+        /** The key of the content measured by the measure functions, given by the caller */
+        uint64_t contentKey;
+    };
+
+    /**
+     * The layout state of an item.
+     */
+    struct NodeRecord {
+        /** See {@link TreeFormat#NodeType} */
+        uint32_t type;
+
+        /** The layout flags of the item */
+        uint32_t flags;
+
+        /** The number of words of measured state following the record */
+        uint32_t stateSize;
+
+        int32_t measuredWidth;
+        int32_t measuredHeight;
+        int32_t baseline;
+        int32_t oldWidthMeasureSpec;
+        int32_t oldHeightMeasureSpec;
+        int32_t lastOnMeasureWidthSpec;
+        int32_t lastOnMeasureHeightSpec;
+        int32_t left;
+        int32_t top;
+        int32_t right;
+        int32_t bottom;
+    };
+
+    static_assert(std::is_trivially_copyable<NodeRecord>::value && sizeof(NodeRecord) % 4 == 0
+                  && sizeof(Header) % 4 == 0, "The records are copied as bytes");
+
+    /**
+     * Takes a snapshot of the layout of the tree, once it has been laid out.
+     *
+     * @param root       the root of the tree, an Item, FlexLayout, LinearLayout or FlowLayout, as
+     *                   are its descendants
+     * @param contentKey the key of the content measured by the measure functions of the tree
+     * @return the bytes of the snapshot
+     * @throws std::invalid_argument if an item of the tree has another class
+     */
+    static std::vector<char> write(Item* root, uint64_t contentKey = 0);
+
+    /**
+     * Restores the layout of the tree from the snapshot if it has been taken from an equal tree
+     * measured with the given specs. The next {@link Item#measure(int, int)} of the root with
+     * these specs and its layout with the saved frame then measure and lay out nothing.
+     *
+     * @param root              the root of the tree
+     * @param data              the bytes of the snapshot, aligned on 4 bytes, e.g. a mapped file
+     * @param size              the number of bytes
+     * @param widthMeasureSpec  the horizontal specs the root is going to be measured with
+     * @param heightMeasureSpec the vertical specs the root is going to be measured with
+     * @param contentKey        the key of the content measured by the measure functions
+     * @return false, leaving the tree as it is, if the snapshot is for another tree, other specs,
+     * another content or another version
+     * @throws std::invalid_argument if the snapshot is truncated or corrupted, e.g. the measured
+     * state of a container refers to children it doesn't have
+     */
+    static bool restore(Item* root, const void* data, size_t size, int widthMeasureSpec, int heightMeasureSpec,
+                        uint64_t contentKey = 0);
+
+    /**
+     * Computes a hash of the classes, the attributes and the structure of the tree which is the
+     * same in every process, as opposed to {@link Item#getLayoutHash()}. Whether an item has a
+     * measure function is part of it, but not what the function measures.
+     *
+     * @param root the root of the tree, an Item, FlexLayout, LinearLayout or FlowLayout, as are
+     *             its descendants
+     * @return the hash
+     * @throws std::invalid_argument if an item of the tree has another class
+     */
+    static uint64_t computeStructureHash(Item* root);
+
+private:
+    /** The flags describing the layout state of an item, saved as they are */
+    static constexpr int SAVED_FLAGS = Item::PFLAG_FORCE_LAYOUT | Item::PFLAG_LAYOUT_REQUIRED
+                                       | Item::PFLAG_CHILD_NEEDS_LAYOUT | Item::PFLAG_RELAYOUT_BOUNDARY
+                                       | Item::PFLAG_MEASURE_NEEDED_BEFORE_LAYOUT;
+
+    /**
+     * Appends the measured state of the container, if the item is one.
+     *
+     * @param type the {@link TreeFormat#NodeType} of the item
+     */
+    static void writeState(Item* item, uint32_t type, std::vector<int32_t>& state);
+
+    /**
+     * Reads the measured state of the container, and restores it if apply is true.
+     *
+     * @return false if the state is malformed, or refers to children or rows out of range
+     */
+    static bool readState(Item* item, uint32_t type, const int32_t* state, size_t size, bool apply);
+};
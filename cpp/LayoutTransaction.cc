@@ -0,0 +1,50 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include "LayoutTransaction.h"
+
+thread_local LayoutTransaction* LayoutTransaction::sCurrent = nullptr;
+
+LayoutTransaction::LayoutTransaction() : mNested(sCurrent != nullptr) {
+    if (!mNested) {
+        sCurrent = this;
+    }
+}
+
+LayoutTransaction::~LayoutTransaction() {
+    commit();
+}
+
+void LayoutTransaction::commit() {
+    if (sCurrent != this) {
+        return;
+    }
+    // Closed first, so that the invalidations below are applied instead of recorded again.
+    sCurrent = nullptr;
+    for (Item* item : mChangedItems) {
+        int flags = item->mPrivateFlags;
+        item->mPrivateFlags &= ~(Item::PFLAG_PENDING_LAYOUT_REQUEST | Item::PFLAG_PENDING_PARAMS_CHANGE);
+        // A change of the attributes requests the layout of the item as well.
+        if ((flags & Item::PFLAG_PENDING_PARAMS_CHANGE) != 0) {
+            item->onLayoutParamsChanged();
+        } else {
+            item->requestLayout();
+        }
+    }
+    mChangedItems.clear();
+}
+
+bool LayoutTransaction::record(Item* item, int flag) {
+    if (sCurrent == nullptr) {
+        return false;
+    }
+    if ((item->mPrivateFlags & (Item::PFLAG_PENDING_LAYOUT_REQUEST | Item::PFLAG_PENDING_PARAMS_CHANGE)) == 0) {
+        sCurrent->mChangedItems.push_back(item);
+    }
+    item->mPrivateFlags |= flag;
+    return true;
+}
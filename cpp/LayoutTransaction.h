@@ -0,0 +1,76 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#pragma once
+
+#include <vector>
+#include "Item.h"
+
+/**
+ * Batches the changes made to items on the calling thread, e.g. a theme switch changing many
+ * attributes of many items. While a transaction is open, the setters still store the new values
+ * but their invalidations are only recorded, once per item. They are applied when the
+ * transaction commits: each item is marked dirty once and the walk towards the root stops at
+ * the first ancestor already requested, so an ancestor is invalidated at most once however many
+ * of its descendants changed.
+ *
+ * <pre>
+ * {
+ *     LayoutTransaction transaction;
+ *     item->setWidth(200);
+ *     item->setMargins(8, 8, 8, 8);
+ * } // committed here
+ * </pre>
+ *
+ * Transactions nest: the changes made inside an inner transaction are committed with the
+ * outermost one. The recorded items must not be destroyed before the transaction commits.
+ */
+class LayoutTransaction {
+public:
+    LayoutTransaction();
+
+    /**
+     * Commits the transaction if it hasn't been committed yet.
+     */
+    ~LayoutTransaction();
+
+    LayoutTransaction(const LayoutTransaction&) = delete;
+
+    LayoutTransaction& operator=(const LayoutTransaction&) = delete;
+
+    /**
+     * Applies the recorded invalidations and closes the transaction. Does nothing for a nested
+     * transaction, whose changes are applied by the outermost one.
+     */
+    void commit();
+
+    /**
+     * Records a deferred invalidation of the item if a transaction is open on the calling thread.
+     *
+     * @param item the changed item
+     * @param flag {@link Item#PFLAG_PENDING_LAYOUT_REQUEST} or
+     *             {@link Item#PFLAG_PENDING_PARAMS_CHANGE}
+     * @return true if the invalidation has been recorded, false if it has to be applied now
+     */
+    static bool record(Item* item, int flag);
+
+private:
+    /**
+     * The open transaction of the calling thread, i.e. the outermost one.
+     */
+    static thread_local LayoutTransaction* sCurrent;
+
+    /**
+     * Whether this transaction has been opened inside another one.
+     */
+    bool mNested;
+
+    /**
+     * The items with pending invalidations, each recorded once.
+     */
+    std::vector<Item*> mChangedItems;
+};
@@ -6,14 +6,27 @@
  */
 
 
+#include "ItemArena.h"
 #include "LinearLayout.h"
 
 void LinearLayout::onMeasure(int widthMeasureSpec, int heightMeasureSpec) {
-    if (mOrientation == VERTICAL) {
+    if (canMeasureWeightsInOnePass(mOrientation == VERTICAL ? heightMeasureSpec : widthMeasureSpec)) {
+        measureWeightsInOnePass(widthMeasureSpec, heightMeasureSpec);
+    } else if (mOrientation == VERTICAL) {
         measureVertical(widthMeasureSpec, heightMeasureSpec);
     } else {
         measureHorizontal(widthMeasureSpec, heightMeasureSpec);
     }
+    // The baseline of the first child, which is at the start of both axes.
+    int baseline = 0;
+    for (int i = 0; i < getChildCount(); i++) {
+        Item* child = getChildAt(i);
+        if (child->getVisibility() != Item::GONE) {
+            baseline = getPaddingTop() + child->getMarginTop() + child->getBaseline();
+            break;
+        }
+    }
+    setMeasuredBaseline(baseline);
 }
 
 static int measureNullChild(int childIndex) {
@@ -28,6 +41,184 @@ static int getNextLocationOffset(Item* child) {
     return 0;
 }
 
+size_t LinearLayout::computeLayoutHash() const {
+    size_t hash = hashCombine(Layout::computeLayoutHash(), mOrientation);
+    hash = hashCombine(hash, mWeightSum);
+    hash = hashCombine(hash, mUseLargestChild);
+    for (int value : {mShowDividers, mDividerWidth, mDividerHeight}) {
+        hash = hashCombine(hash, value);
+    }
+    return hash;
+}
+
+Item* LinearLayout::cloneItem(ItemArena* arena) const {
+    return arena != nullptr ? arena->copy(*this) : new LinearLayout(*this);
+}
+
+bool LinearLayout::copyAttributes(const Item& prototype) {
+    const LinearLayout& linearLayout = static_cast<const LinearLayout&>(prototype);
+    bool changed = Layout::copyAttributes(prototype);
+    changed |= assignAttribute(mOrientation, linearLayout.mOrientation);
+    changed |= assignAttribute(mWeightSum, linearLayout.mWeightSum);
+    changed |= assignAttribute(mUseLargestChild, linearLayout.mUseLargestChild);
+    changed |= assignAttribute(mShowDividers, linearLayout.mShowDividers);
+    changed |= assignAttribute(mDividerWidth, linearLayout.mDividerWidth);
+    changed |= assignAttribute(mDividerHeight, linearLayout.mDividerHeight);
+    return changed;
+}
+
+int LinearLayout::computeIntrinsicSize(bool horizontal, int intrinsicSize) {
+    int content = horizontal == (mOrientation == HORIZONTAL) ? sumChildIntrinsicSizes(horizontal, intrinsicSize, 0)
+                                                             : maxChildIntrinsicSize(horizontal, intrinsicSize);
+    return content + (horizontal ? getPaddingLeft() + getPaddingRight() : getPaddingTop() + getPaddingBottom());
+}
+
+bool LinearLayout::canMeasureWeightsInOnePass(int mainMeasureSpec) {
+    if (MeasureSpec::getMode(mainMeasureSpec) != MeasureSpec::EXACTLY) {
+        return false;
+    }
+    bool hasWeight = false;
+    for (int i = 0, count = getChildCount(); i < count; i++) {
+        Item* child = getChildAt(i);
+        if (child == nullptr || child->getVisibility() == GONE || child->getWeight() <= 0) {
+            continue;
+        }
+        int size = mOrientation == VERTICAL ? child->getHeight() : child->getWidth();
+        if (size != 0) {
+            return false;
+        }
+        hasWeight = true;
+    }
+    return hasWeight;
+}
+
+void LinearLayout::measureWeightsInOnePass(int widthMeasureSpec, int heightMeasureSpec) {
+    const bool horizontal = mOrientation == HORIZONTAL;
+    const int mainMeasureSpec = horizontal ? widthMeasureSpec : heightMeasureSpec;
+    const int crossMeasureSpec = horizontal ? heightMeasureSpec : widthMeasureSpec;
+    const int crossMode = MeasureSpec::getMode(crossMeasureSpec);
+    const int count = getChildCount();
+
+    mTotalLength = 0;
+    int maxCross = 0;
+    int alternativeMaxCross = 0;
+    int childState = 0;
+    bool allFillParent = true;
+    bool matchCross = false;
+    float totalWeight = 0;
+    int nonSkippedChildCount = 0;
+    mWeightedChildren.clear();
+
+    getChildMeasureSpecs(crossMeasureSpec, horizontal ? mPaddingTop + mPaddingBottom : mPaddingLeft + mPaddingRight,
+                         !horizontal, true, mChildCrossMeasureSpecs);
+
+    // Vertical layouts don't let negative margins shrink the total length, as in measureVertical.
+    auto advance = [this, horizontal](int length) {
+        mTotalLength = horizontal ? mTotalLength + length : std::max(mTotalLength, mTotalLength + length);
+    };
+    auto accumulateCross = [&](Item* child) {
+        int crossMargin = horizontal ? child->getMarginVertical() : child->getMarginHorizontal();
+        int crossSize = (horizontal ? child->getMeasuredHeight() : child->getMeasuredWidth()) + crossMargin;
+        int crossDimension = horizontal ? child->getHeight() : child->getWidth();
+        bool matchCrossLocally = crossMode != MeasureSpec::EXACTLY
+                                 && crossDimension == LayoutParams::MATCH_PARENT;
+        matchCross = matchCross || matchCrossLocally;
+        maxCross = std::max(maxCross, crossSize);
+        alternativeMaxCross = std::max(alternativeMaxCross, matchCrossLocally ? crossMargin : crossSize);
+        allFillParent = allFillParent && crossDimension == LayoutParams::MATCH_PARENT;
+        childState = combineMeasuredStates(childState, child->getMeasuredState());
+    };
+
+    // Measure the children without weight, the weighted ones only take a share of what is left
+    // and are measured once the excess space is known.
+    for (int i = 0; i < count; ++i) {
+        Item* child = getChildAt(i);
+        if (child == nullptr) {
+            mTotalLength += measureNullChild(i);
+            continue;
+        }
+        if (child->getVisibility() == GONE) {
+            i += getChildrenSkipCount(child, i);
+            continue;
+        }
+
+        nonSkippedChildCount++;
+        if (hasDividerBeforeChildAt(i)) {
+            mTotalLength += horizontal ? mDividerWidth : mDividerHeight;
+        }
+
+        const int mainMargin = horizontal ? child->getMarginHorizontal() : child->getMarginVertical();
+        const float weight = child->getWeight();
+        if (weight > 0) {
+            totalWeight += weight;
+            advance(mainMargin);
+            mWeightedChildren.push_back(i);
+            continue;
+        }
+
+        const int used = totalWeight == 0 ? mTotalLength : 0;
+        if (horizontal) {
+            measureChildBeforeLayout(child, i, widthMeasureSpec, used, heightMeasureSpec, 0);
+        } else {
+            measureChildBeforeLayout(child, i, widthMeasureSpec, 0, heightMeasureSpec, used);
+        }
+        advance((horizontal ? child->getMeasuredWidth() : child->getMeasuredHeight()) + mainMargin
+                + getNextLocationOffset(child));
+        accumulateCross(child);
+
+        i += getChildrenSkipCount(child, i);
+    }
+
+    if (nonSkippedChildCount > 0 && hasDividerBeforeChildAt(count)) {
+        mTotalLength += horizontal ? mDividerWidth : mDividerHeight;
+    }
+
+    mTotalLength += horizontal ? mPaddingLeft + mPaddingRight : mPaddingTop + mPaddingBottom;
+    int mainSize = std::max(mTotalLength, horizontal ? getMinWidth() : getMinHeight());
+    const int mainSizeAndState = resolveSizeAndState(mainSize, mainMeasureSpec, 0);
+    mainSize = mainSizeAndState & MEASURED_SIZE_MASK;
+
+    // Split the excess space by weight, in the order of the children as in the two pass path.
+    int remainingExcess = mainSize - mTotalLength;
+    float remainingWeightSum = mWeightSum > 0.0f ? mWeightSum : totalWeight;
+    for (int i : mWeightedChildren) {
+        Item* child = getChildAt(i);
+        const float weight = child->getWeight();
+        const int share = static_cast<int>(weight * remainingExcess / remainingWeightSum);
+        remainingExcess -= share;
+        remainingWeightSum -= weight;
+
+        const int childMainMeasureSpec = MeasureSpec::makeMeasureSpec(std::max(0, share), MeasureSpec::EXACTLY);
+        if (horizontal) {
+            child->measure(childMainMeasureSpec, mChildCrossMeasureSpecs[i]);
+        } else {
+            child->measure(mChildCrossMeasureSpecs[i], childMainMeasureSpec);
+        }
+        advance((horizontal ? child->getMeasuredWidth() : child->getMeasuredHeight()) + getNextLocationOffset(child));
+        accumulateCross(child);
+    }
+
+    if (!allFillParent && crossMode != MeasureSpec::EXACTLY) {
+        maxCross = alternativeMaxCross;
+    }
+    maxCross += horizontal ? mPaddingTop + mPaddingBottom : mPaddingLeft + mPaddingRight;
+    maxCross = std::max(maxCross, horizontal ? getMinHeight() : getMinWidth());
+
+    if (horizontal) {
+        setMeasuredDimension(mainSizeAndState | (childState & MEASURED_STATE_MASK),
+                             resolveSizeAndState(maxCross, heightMeasureSpec,
+                                                 (childState << MEASURED_HEIGHT_STATE_SHIFT)));
+        if (matchCross) {
+            forceUniformHeight(count, widthMeasureSpec);
+        }
+    } else {
+        setMeasuredDimension(resolveSizeAndState(maxCross, widthMeasureSpec, childState), mainSizeAndState);
+        if (matchCross) {
+            forceUniformWidth(count, heightMeasureSpec);
+        }
+    }
+}
+
 void LinearLayout::measureVertical(int widthMeasureSpec, int heightMeasureSpec) {
     mTotalLength = 0;
     int maxWidth = 0;
@@ -52,6 +243,9 @@ void LinearLayout::measureVertical(int widthMeasureSpec, int heightMeasureSpec)
 
     int nonSkippedChildCount = 0;
 
+    // The width specs don't depend on the space used by the other children.
+    getChildMeasureSpecs(widthMeasureSpec, mPaddingLeft + mPaddingRight, true, true, mChildCrossMeasureSpecs);
+
     // See how tall everyone is. Also remember max width.
     for (int i = 0; i < count; ++i) {
         Item* child = getChildAt(i);
@@ -73,7 +267,8 @@ void LinearLayout::measureVertical(int widthMeasureSpec, int heightMeasureSpec)
         totalWeight += child->getWeight();
 
         bool useExcessSpace = child->getHeight() == 0 && child->getWeight() > 0;
-        if (heightMode == MeasureSpec::EXACTLY && useExcessSpace) {
+        bool skipped = heightMode == MeasureSpec::EXACTLY && useExcessSpace;
+        if (skipped) {
             // Optimization: don't bother measuring children who are only
             // laid out using excess space. These views will get measured
             // later if we have space to distribute.
@@ -81,15 +276,6 @@ void LinearLayout::measureVertical(int widthMeasureSpec, int heightMeasureSpec)
             mTotalLength = std::max(totalLength, totalLength + child->getMarginVertical());
             skippedMeasure = true;
         } else {
-            if (useExcessSpace) {
-                // The heightMode is either UNSPECIFIED or AT_MOST, and
-                // this child is only laid out using excess space. Measure
-                // using WRAP_CONTENT so that we can find out the view's
-                // optimal height. We'll restore the original height of 0
-                // after measurement.
-                child->setHeight(LayoutParams::WRAP_CONTENT);
-            }
-
             // Determine how big this child would like to be. If this or
             // previous children have given a weight, then we allow it to
             // use all available space (and we will shrink things later
@@ -100,10 +286,9 @@ void LinearLayout::measureVertical(int widthMeasureSpec, int heightMeasureSpec)
 
             int childHeight = child->getMeasuredHeight();
             if (useExcessSpace) {
-                // Restore the original height and record how much space
-                // we've allocated to excess-only children so that we can
-                // match the behavior of EXACTLY measurement.
-                child->setHeight(0);
+                // Record how much space we've allocated to excess-only
+                // children so that we can match the behavior of EXACTLY
+                // measurement.
                 consumedExcessSpace += childHeight;
             }
 
@@ -127,9 +312,12 @@ void LinearLayout::measureVertical(int widthMeasureSpec, int heightMeasureSpec)
         }
 
         int margin = child->getMarginHorizontal();
-        int measuredWidth = child->getMeasuredWidth() + margin;
+        // A skipped child still has the width of an earlier pass, it counts once measured below.
+        int measuredWidth = (skipped ? 0 : child->getMeasuredWidth()) + margin;
         maxWidth = std::max(maxWidth, measuredWidth);
-        childState = combineMeasuredStates(childState, child->getMeasuredState());
+        if (!skipped) {
+            childState = combineMeasuredStates(childState, child->getMeasuredState());
+        }
 
         allFillParent = allFillParent && child->getWidth() == LayoutParams::MATCH_PARENT;
         if (child->getWeight() > 0) {
@@ -221,11 +409,7 @@ void LinearLayout::measureVertical(int widthMeasureSpec, int heightMeasureSpec)
 
                 int childHeightMeasureSpec = MeasureSpec::makeMeasureSpec(
                         std::max(0, childHeight), MeasureSpec::EXACTLY);
-                int childWidthMeasureSpec = getChildMeasureSpec(widthMeasureSpec,
-                                                                mPaddingLeft + mPaddingRight +
-                                                                child->getMarginHorizontal(),
-                                                                child->getWidth(), child->getWidthPercent());
-                child->measure(childWidthMeasureSpec, childHeightMeasureSpec);
+                child->measure(mChildCrossMeasureSpecs[i], childHeightMeasureSpec);
 
                 // Child may now not fit in vertical dimension.
                 childState = combineMeasuredStates(childState, child->getMeasuredState()
@@ -320,6 +504,9 @@ void LinearLayout::measureHorizontal(int widthMeasureSpec, int heightMeasureSpec
 
     int nonSkippedChildCount = 0;
 
+    // The height specs don't depend on the space used by the other children.
+    getChildMeasureSpecs(heightMeasureSpec, mPaddingTop + mPaddingBottom, false, true, mChildCrossMeasureSpecs);
+
     // See how wide everyone is. Also remember max height.
     for (int i = 0; i < count; ++i) {
         auto child = getChildAt(i);
@@ -341,29 +528,21 @@ void LinearLayout::measureHorizontal(int widthMeasureSpec, int heightMeasureSpec
         totalWeight += child->getWeight();
 
         const bool useExcessSpace = child->getWidth() == 0 && child->getWeight() > 0;
-        if (widthMode == MeasureSpec::EXACTLY && useExcessSpace) {
+        const bool skipped = widthMode == MeasureSpec::EXACTLY && useExcessSpace;
+        if (skipped) {
             // Optimization: don't bother measuring children who are only
             // laid out using excess space. These views will get measured
             // later if we have space to distribute.
             if (isExactly) {
-                mTotalLength += getMarginHorizontal();
+                mTotalLength += child->getMarginHorizontal();
             } else {
                 const int totalLength = mTotalLength;
-                mTotalLength = std::max(totalLength, totalLength + getMarginHorizontal());
+                mTotalLength = std::max(totalLength, totalLength + child->getMarginHorizontal());
             }
 
 
             skippedMeasure = true;
         } else {
-            if (useExcessSpace) {
-                // The widthMode is either UNSPECIFIED or AT_MOST, and
-                // this child is only laid out using excess space. Measure
-                // using WRAP_CONTENT so that we can find out the view's
-                // optimal width. We'll restore the original width of 0
-                // after measurement.
-                setWidth(LayoutParams::WRAP_CONTENT);
-            }
-
             // Determine how big this child would like to be. If this or
             // previous children have given a weight, then we allow it to
             // use all available space (and we will shrink things later
@@ -374,10 +553,9 @@ void LinearLayout::measureHorizontal(int widthMeasureSpec, int heightMeasureSpec
 
             const int childWidth = child->getMeasuredWidth();
             if (useExcessSpace) {
-                // Restore the original width and record how much space
-                // we've allocated to excess-only children so that we can
-                // match the behavior of EXACTLY measurement.
-                child->setWidth(0);
+                // Record how much space we've allocated to excess-only
+                // children so that we can match the behavior of EXACTLY
+                // measurement.
                 usedExcessSpace += childWidth;
             }
 
@@ -404,8 +582,11 @@ void LinearLayout::measureHorizontal(int widthMeasureSpec, int heightMeasureSpec
         }
 
         const int margin = child->getMarginVertical();
-        const int childHeight = child->getMeasuredHeight() + margin;
-        childState = combineMeasuredStates(childState, child->getMeasuredState());
+        // A skipped child still has the height of an earlier pass, it counts once measured below.
+        const int childHeight = (skipped ? 0 : child->getMeasuredHeight()) + margin;
+        if (!skipped) {
+            childState = combineMeasuredStates(childState, child->getMeasuredState());
+        }
 
         maxHeight = std::max(maxHeight, childHeight);
 
@@ -508,11 +689,7 @@ void LinearLayout::measureHorizontal(int widthMeasureSpec, int heightMeasureSpec
 
                 const int childWidthMeasureSpec = MeasureSpec::makeMeasureSpec(
                         std::max(0, childWidth), MeasureSpec::EXACTLY);
-                const int childHeightMeasureSpec = getChildMeasureSpec(heightMeasureSpec,
-                                                                       mPaddingTop + mPaddingBottom +
-                                                                       child->getMarginVertical(),
-                                                                       child->getHeight(), child->getHeightPercent());
-                child->measure(childWidthMeasureSpec, childHeightMeasureSpec);
+                child->measure(childWidthMeasureSpec, mChildCrossMeasureSpecs[i]);
 
                 // Child may now not fit in horizontal dimension.
                 childState = combineMeasuredStates(childState,
@@ -588,7 +765,10 @@ void LinearLayout::measureHorizontal(int widthMeasureSpec, int heightMeasureSpec
 }
 
 bool LinearLayout::hasDividerBeforeChildAt(int childIndex) {
-
+    if (mShowDividers == SHOW_DIVIDER_NONE) {
+        // Skips the scan of the preceding children, which makes a measure pass quadratic.
+        return false;
+    }
     if (childIndex == getChildCount()) {
         // Check whether the end divider should draw.
         return (mShowDividers & SHOW_DIVIDER_END) != 0;
@@ -604,8 +784,24 @@ bool LinearLayout::hasDividerBeforeChildAt(int childIndex) {
 
 void LinearLayout::measureChildBeforeLayout(Item* child, int childIndex, int widthMeasureSpec, int totalWidth,
                                             int heightMeasureSpec, int totalHeight) {
-    measureChildWithMargins(child, widthMeasureSpec, totalWidth,
-                            heightMeasureSpec, totalHeight);
+    // The spec along the cross axis has been computed for all the children at the start of the
+    // measure pass, when nothing has been used up on that axis yet.
+    // A child only laid out using excess space is measured with WRAP_CONTENT so that we can find
+    // out its optimal size, the main axis being either UNSPECIFIED or AT_MOST.
+    bool useExcessSpace = child->getWeight() > 0;
+    if (mOrientation == VERTICAL) {
+        int childHeight = useExcessSpace && child->getHeight() == 0 ? LayoutParams::WRAP_CONTENT : child->getHeight();
+        int childHeightMeasureSpec = getChildMeasureSpec(heightMeasureSpec,
+                                                         mPaddingTop + mPaddingBottom + child->getMarginVertical()
+                                                         + totalHeight, childHeight, child->getHeightPercent());
+        child->measure(mChildCrossMeasureSpecs[childIndex], childHeightMeasureSpec);
+    } else {
+        int childWidth = useExcessSpace && child->getWidth() == 0 ? LayoutParams::WRAP_CONTENT : child->getWidth();
+        int childWidthMeasureSpec = getChildMeasureSpec(widthMeasureSpec,
+                                                        mPaddingLeft + mPaddingRight + child->getMarginHorizontal()
+                                                        + totalWidth, childWidth, child->getWidthPercent());
+        child->measure(childWidthMeasureSpec, mChildCrossMeasureSpecs[childIndex]);
+    }
 }
 
 void LinearLayout::forceUniformHeight(int count, int widthMeasureSpec) {
@@ -619,13 +815,16 @@ void LinearLayout::forceUniformHeight(int count, int widthMeasureSpec) {
         if (child != nullptr && child->getVisibility() != GONE) {
 
             if (child->getHeight() == LayoutParams::MATCH_PARENT) {
-                // Temporarily force children to reuse their old measured width
+                // Force children to reuse their old measured width
                 // FIXME: this may not be right for something like wrapping text?
-                int oldWidth = child->getWidth();
-                child->setWidth(child->getMeasuredWidth());
+                int childWidthMeasureSpec = MeasureSpec::makeMeasureSpec(child->getMeasuredWidth(),
+                                                                         MeasureSpec::EXACTLY);
                 // Remeasure with new dimensions
-                measureChildWithMargins(child, widthMeasureSpec, 0, uniformMeasureSpec, 0);
-                child->setWidth(oldWidth);
+                int childHeightMeasureSpec = getChildMeasureSpec(uniformMeasureSpec,
+                                                                 mPaddingTop + mPaddingBottom
+                                                                 + child->getMarginVertical(),
+                                                                 child->getHeight(), child->getHeightPercent());
+                child->measure(childWidthMeasureSpec, childHeightMeasureSpec);
 
             }
         }
@@ -641,14 +840,17 @@ void LinearLayout::forceUniformWidth(int count, int heightMeasureSpec) {
         if (child != nullptr && child->getVisibility() != GONE) {
 
             if (child->getWidth() == LayoutParams::MATCH_PARENT) {
-                // Temporarily force children to reuse their old measured height
+                // Force children to reuse their old measured height
                 // FIXME: this may not be right for something like wrapping text?
-                int oldHeight = child->getHeight();
-                child->setHeight(child->getMeasuredHeight());
+                int childHeightMeasureSpec = MeasureSpec::makeMeasureSpec(child->getMeasuredHeight(),
+                                                                          MeasureSpec::EXACTLY);
 
                 // Remeasue with new dimensions
-                measureChildWithMargins(child, uniformMeasureSpec, 0, heightMeasureSpec, 0);
-                child->setHeight(oldHeight);
+                int childWidthMeasureSpec = getChildMeasureSpec(uniformMeasureSpec,
+                                                                mPaddingLeft + mPaddingRight
+                                                                + child->getMarginHorizontal(),
+                                                                child->getWidth(), child->getWidthPercent());
+                child->measure(childWidthMeasureSpec, childHeightMeasureSpec);
             }
         }
     }
@@ -11,6 +11,9 @@
 #include "Layout.h"
 
 class LinearLayout : public Layout {
+    friend class TreeFormat;
+    friend class JsonTreeLoader;
+
 public:
     static constexpr int HORIZONTAL = 0;
     static constexpr int VERTICAL = 1;
@@ -32,16 +35,39 @@ public:
      */
     static constexpr int SHOW_DIVIDER_END = 4;
 
+    LinearLayout() = default;
+
+    /**
+     * Copies the attributes of the prototype but not its children, see
+     * {@link Item#cloneSubtree(ItemArena*)}.
+     */
+    LinearLayout(const LinearLayout& prototype)
+            : Layout(prototype),
+              mOrientation(prototype.mOrientation),
+              mWeightSum(prototype.mWeightSum),
+              mUseLargestChild(prototype.mUseLargestChild),
+              mShowDividers(prototype.mShowDividers),
+              mDividerWidth(prototype.mDividerWidth),
+              mDividerHeight(prototype.mDividerHeight) {}
 
     void setOrientation(int orientation) {
         if (mOrientation != orientation) {
             mOrientation = orientation;
+            requestLayout();
         }
     }
 
 protected:
     void onMeasure(int widthMeasureSpec, int heightMeasureSpec) override;
 
+    size_t computeLayoutHash() const override;
+
+    Item* cloneItem(ItemArena* arena) const override;
+
+    bool copyAttributes(const Item& prototype) override;
+
+    int computeIntrinsicSize(bool horizontal, int intrinsicSize) override;
+
 
     /**
      * <p>Measure the child according to the parent's measure specs. This
@@ -60,6 +86,15 @@ protected:
                                   int widthMeasureSpec, int totalWidth, int heightMeasureSpec,
                                   int totalHeight);
 
+    /**
+     * The generic measures along each orientation, which measure the weighted children in a
+     * second pass. {@link #onMeasure(int, int)} measures in one pass instead when it can, see
+     * {@link #measureWeightsInOnePass(int, int)}.
+     */
+    void measureVertical(int widthMeasureSpec, int heightMeasureSpec);
+
+    void measureHorizontal(int widthMeasureSpec, int heightMeasureSpec);
+
 private:
     int mOrientation = 0;
     int mTotalLength = 0;
@@ -69,9 +104,31 @@ private:
     int mDividerWidth = 0;
     int mDividerHeight = 0;
 
-    void measureVertical(int widthMeasureSpec, int heightMeasureSpec);
+    /**
+     * The measure specs of the children along the cross axis, computed in one batch at the start
+     * of each measure pass.
+     */
+    std::vector<int> mChildCrossMeasureSpecs;
 
-    void measureHorizontal(int widthMeasureSpec, int heightMeasureSpec);
+    /**
+     * The indices of the weighted children, measured after the others by
+     * {@link #measureWeightsInOnePass(int, int)}.
+     */
+    std::vector<int> mWeightedChildren;
+
+    /**
+     * Returns true if the main axis is exact and every weighted child only takes a share of the
+     * excess space (its size along the main axis is 0). All the space they get is then known once
+     * the other children have been measured.
+     */
+    bool canMeasureWeightsInOnePass(int mainMeasureSpec);
+
+    /**
+     * Measures the children without weight, then splits the remaining space between the weighted
+     * children and measures each of them once with its share, instead of the two passes of
+     * {@link #measureVertical(int, int)} and {@link #measureHorizontal(int, int)}.
+     */
+    void measureWeightsInOnePass(int widthMeasureSpec, int heightMeasureSpec);
 
     bool hasDividerBeforeChildAt(int childIndex);
 
@@ -0,0 +1,437 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include "SelectorMatcher.h"
+#include "FlexLayout.h"
+#include "LayoutTransaction.h"
+
+static constexpr int ID_SPECIFICITY = 0x10000;
+static constexpr int CLASS_SPECIFICITY = 0x100;
+static constexpr int TYPE_SPECIFICITY = 1;
+
+static bool isIdentifierChar(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '-' || c == '_' || static_cast<unsigned char>(c) >= 0x80;
+}
+
+static std::string readIdentifier(const std::string& text, size_t& position) {
+    size_t start = position;
+    while (position < text.size() && isIdentifierChar(text[position])) {
+        position++;
+    }
+    return text.substr(start, position - start);
+}
+
+/**
+ * @return true if there were spaces
+ */
+static bool skipSpaces(const std::string& text, size_t& position) {
+    size_t start = position;
+    while (position < text.size() && std::isspace(static_cast<unsigned char>(text[position]))) {
+        position++;
+    }
+    return position > start;
+}
+
+SelectorMatcher::SelectorMatcher(const StyleSheet& sheet, AtomTable* atoms, ItemStylePool* pool)
+        : mAtoms(atoms), mPool(pool), mEmptyStyle(pool->intern(ItemStyle())) {
+    for (auto& rule : sheet.getRules()) {
+        for (auto& text : rule.selectors) {
+            Selector selector;
+            if (parse(text, selector)) {
+                selector.style = rule.style;
+                add(std::move(selector));
+            }
+        }
+    }
+}
+
+void SelectorMatcher::resolve(StyleElement* root) {
+    // The invalidations of the items are applied once the whole tree is styled.
+    LayoutTransaction transaction;
+    std::vector<StyleElement*> ancestors;
+    for (StyleElement* ancestor = root->mParent; ancestor != nullptr; ancestor = ancestor->mParent) {
+        ancestors.push_back(ancestor);
+    }
+    for (auto it = ancestors.rbegin(); it != ancestors.rend(); ++it) {
+        mFilter.push(**it);
+    }
+    struct Frame {
+        StyleElement* element;
+        size_t next;
+        /** The last styled children, as a ring */
+        StyleElement* styled[MAX_STYLE_SIBLINGS];
+        size_t styledCount;
+        /** Whether the main axis of the item changed, so that the flex-basis lengths of the children move */
+        bool axisChanged;
+    };
+    std::vector<Frame> stack;
+    auto enter = [&](StyleElement* element, Frame* parent) {
+        const ItemStyle* style = nullptr;
+        if (parent != nullptr) {
+            size_t count = std::min<size_t>(parent->styledCount, MAX_STYLE_SIBLINGS);
+            style = findSharedStyle(*element, parent->styled, count);
+            mSharedStyleCount += style != nullptr ? 1 : 0;
+            parent->styled[parent->styledCount++ % MAX_STYLE_SIBLINGS] = element;
+        }
+        if (style == nullptr) {
+            style = computeStyle(*element, &mFilter);
+        }
+        auto flexLayout = dynamic_cast<FlexLayout*>(element->mItem);
+        bool horizontal = flexLayout != nullptr && flexLayout->isMainAxisDirectionHorizontal();
+        if (element->mItem != nullptr && parent != nullptr && parent->axisChanged) {
+            style->resolveFlexBasis(element->mItem, element->mStyle);
+        }
+        if (style != element->mStyle) {
+            if (element->mItem != nullptr) {
+                style->apply(element->mItem, element->mStyle);
+            }
+            element->mStyle = style;
+        }
+        bool axisChanged = flexLayout != nullptr && flexLayout->isMainAxisDirectionHorizontal() != horizontal;
+        mFilter.push(*element);
+        stack.push_back({element, 0, {}, 0, axisChanged});
+    };
+    enter(root, nullptr);
+    while (!stack.empty()) {
+        Frame& frame = stack.back();
+        if (frame.next < frame.element->mChildren.size()) {
+            enter(frame.element->mChildren[frame.next++], &frame);
+        } else {
+            mFilter.pop(*frame.element);
+            stack.pop_back();
+        }
+    }
+    for (StyleElement* ancestor : ancestors) {
+        mFilter.pop(*ancestor);
+    }
+}
+
+const ItemStyle* SelectorMatcher::findSharedStyle(const StyleElement& element, StyleElement* const* siblings,
+                                                  size_t count) const {
+    if (!mStyleSharing || mHasSiblingSelectors) {
+        return nullptr;
+    }
+    // The names of an element are sets, in the order they have been added.
+    auto sameNames = [](const auto& a, const auto& b) {
+        return std::is_permutation(a.begin(), a.end(), b.begin(), b.end());
+    };
+    for (size_t i = 0; i < count; i++) {
+        const StyleElement& sibling = *siblings[i];
+        if (sibling.mType == element.mType && sibling.mId == element.mId
+            && sameNames(sibling.mClasses, element.mClasses)
+            && sameNames(sibling.mPseudoClasses, element.mPseudoClasses)
+            && sameNames(sibling.mAttributes, element.mAttributes)) {
+            return sibling.mStyle;
+        }
+    }
+    return nullptr;
+}
+
+const ItemStyle* SelectorMatcher::match(const StyleElement& element) {
+    return computeStyle(element, nullptr);
+}
+
+const ItemStyle* SelectorMatcher::computeStyle(const StyleElement& element, const AncestorFilter* filter) {
+    mMatched.clear();
+    collect(mUniversal, element, filter);
+    if (element.mId != AtomTable::NONE) {
+        collect(getBucket(mIdBuckets, element.mId), element, filter);
+    }
+    for (int cssClass : element.mClasses) {
+        collect(getBucket(mClassBuckets, cssClass), element, filter);
+    }
+    if (element.mType != AtomTable::NONE) {
+        collect(getBucket(mTypeBuckets, element.mType), element, filter);
+    }
+    // The cascade: the more specific selectors, then the later ones, win.
+    std::sort(mMatched.begin(), mMatched.end(), [this](int a, int b) {
+        return mSelectors[a].specificity != mSelectors[b].specificity
+               ? mSelectors[a].specificity < mSelectors[b].specificity : a < b;
+    });
+    if (mMatched.empty()) {
+        return mEmptyStyle;
+    }
+    const ItemStyle* style = mSelectors[mMatched[0]].style;
+    for (size_t i = 1; i < mMatched.size(); i++) {
+        const ItemStyle*& merged = mCascade[{style, mMatched[i]}];
+        if (merged == nullptr) {
+            ItemStyle cascaded = *style;
+            cascaded.merge(*mSelectors[mMatched[i]].style);
+            merged = mPool->intern(cascaded);
+        }
+        style = merged;
+    }
+    return style;
+}
+
+const std::vector<SelectorMatcher::Candidate>& SelectorMatcher::getBucket(
+        const std::vector<std::vector<Candidate>>& buckets, int atom) {
+    static const std::vector<Candidate> EMPTY;
+    return static_cast<size_t>(atom) < buckets.size() ? buckets[atom] : EMPTY;
+}
+
+void SelectorMatcher::addToBucket(std::vector<std::vector<Candidate>>& buckets, int atom, const Candidate& candidate) {
+    if (static_cast<size_t>(atom) >= buckets.size()) {
+        buckets.resize(atom + 1);
+    }
+    buckets[atom].push_back(candidate);
+}
+
+void SelectorMatcher::collect(const std::vector<Candidate>& bucket, const StyleElement& element,
+                              const AncestorFilter* filter) {
+    for (auto& candidate : bucket) {
+        if (filter != nullptr) {
+            bool rejected = false;
+            for (int i = 0; i < candidate.ancestorHashCount && !rejected; i++) {
+                rejected = !filter->mayContain(candidate.ancestorHashes[i]);
+            }
+            if (rejected) {
+                continue;
+            }
+        }
+        if (matches(mSelectors[candidate.selector], 0, element)) {
+            mMatched.push_back(candidate.selector);
+        }
+    }
+}
+
+bool SelectorMatcher::matches(const Selector& selector, size_t index, const StyleElement& element) {
+    const Compound& compound = selector.compounds[index];
+    if (!matches(compound, element)) {
+        return false;
+    }
+    if (index + 1 == selector.compounds.size()) {
+        return true;
+    }
+    switch (compound.combinator) {
+        case '>':
+            return element.mParent != nullptr && matches(selector, index + 1, *element.mParent);
+        case '+':
+            return element.mPreviousSibling != nullptr && matches(selector, index + 1, *element.mPreviousSibling);
+        default:
+            for (StyleElement* ancestor = element.mParent; ancestor != nullptr; ancestor = ancestor->mParent) {
+                if (matches(selector, index + 1, *ancestor)) {
+                    return true;
+                }
+            }
+            return false;
+    }
+}
+
+bool SelectorMatcher::matches(const Compound& compound, const StyleElement& element) {
+    for (auto& selector : compound.selectors) {
+        if (!matches(selector, element)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SelectorMatcher::matches(const SimpleSelector& selector, const StyleElement& element) {
+    switch (selector.kind) {
+        case TYPE:
+            return element.mType == selector.atom;
+        case ID:
+            return element.mId == selector.atom;
+        case CLASS:
+            return element.hasClass(selector.atom);
+        case PSEUDO_CLASS:
+            return element.hasPseudoClass(selector.atom);
+        default:
+            break;
+    }
+    const std::string* value = element.getAttribute(selector.atom);
+    if (value == nullptr) {
+        return false;
+    }
+    const std::string& expected = selector.value;
+    switch (selector.test) {
+        case NONE:
+            return true;
+        case '=':
+            return *value == expected;
+        case '~': {
+            size_t start = 0;
+            while (start <= value->size()) {
+                size_t end = value->find(' ', start);
+                end = end == std::string::npos ? value->size() : end;
+                if (value->compare(start, end - start, expected) == 0) {
+                    return true;
+                }
+                start = end + 1;
+            }
+            return false;
+        }
+        case '|':
+            return *value == expected || value->compare(0, expected.size() + 1, expected + "-") == 0;
+        case '^':
+            return value->compare(0, expected.size(), expected) == 0;
+        case '$':
+            return value->size() >= expected.size()
+                   && value->compare(value->size() - expected.size(), expected.size(), expected) == 0;
+        default:
+            return value->find(expected) != std::string::npos;
+    }
+}
+
+bool SelectorMatcher::parse(const std::string& text, Selector& selector) {
+    size_t position = 0;
+    char combinator = NONE;
+    skipSpaces(text, position);
+    while (true) {
+        Compound compound;
+        compound.combinator = combinator;
+        if (!parseCompound(text, position, compound)) {
+            return false;
+        }
+        selector.compounds.push_back(std::move(compound));
+        bool spaced = skipSpaces(text, position);
+        if (position == text.size()) {
+            break;
+        }
+        if (text[position] == '>' || text[position] == '+') {
+            combinator = text[position++];
+            skipSpaces(text, position);
+        } else if (spaced) {
+            combinator = ' ';
+        } else {
+            // The general sibling combinator isn't supported, as in css-selector.js.
+            return false;
+        }
+    }
+    // The combinator of a compound relates it to the compound on its left, which comes next.
+    std::reverse(selector.compounds.begin(), selector.compounds.end());
+    selector.specificity = 0;
+    for (auto& compound : selector.compounds) {
+        for (auto& simple : compound.selectors) {
+            selector.specificity += simple.kind == ID ? ID_SPECIFICITY
+                                                      : simple.kind == TYPE ? TYPE_SPECIFICITY : CLASS_SPECIFICITY;
+        }
+    }
+    return true;
+}
+
+bool SelectorMatcher::parseCompound(const std::string& text, size_t& position, Compound& compound) {
+    size_t start = position;
+    if (position < text.size() && text[position] == '*') {
+        position++;
+    } else {
+        std::string type = readIdentifier(text, position);
+        if (!type.empty()) {
+            // Normalized as by the TypeSelector of css-selector.js.
+            size_t dash = type.find('-');
+            if (dash != std::string::npos) {
+                type.erase(dash, 1);
+            }
+            std::transform(type.begin(), type.end(), type.begin(), ::tolower);
+            compound.selectors.push_back({TYPE, mAtoms->intern(type), NONE, ""});
+        }
+    }
+    while (position < text.size()) {
+        char c = text[position];
+        if (c == '#' || c == '.' || c == ':') {
+            position++;
+            std::string name = readIdentifier(text, position);
+            // The pseudo-elements and the functional pseudo-classes aren't supported.
+            if (name.empty() || (position < text.size() && text[position] == '(')) {
+                return false;
+            }
+            compound.selectors.push_back({c == '#' ? ID : c == '.' ? CLASS : PSEUDO_CLASS, mAtoms->intern(name),
+                                          NONE, ""});
+        } else if (c == '[') {
+            position++;
+            skipSpaces(text, position);
+            std::string name = readIdentifier(text, position);
+            skipSpaces(text, position);
+            if (name.empty() || position >= text.size()) {
+                return false;
+            }
+            SimpleSelector attribute = {ATTRIBUTE, mAtoms->intern(name), NONE, ""};
+            if (text[position] != ']') {
+                if (text[position] == '=') {
+                    attribute.test = '=';
+                    position++;
+                } else if (std::strchr("~|^$*", text[position]) != nullptr && position + 1 < text.size()
+                           && text[position + 1] == '=') {
+                    attribute.test = text[position];
+                    position += 2;
+                } else {
+                    return false;
+                }
+                skipSpaces(text, position);
+                if (position < text.size() && (text[position] == '"' || text[position] == '\'')) {
+                    size_t end = text.find(text[position], position + 1);
+                    if (end == std::string::npos) {
+                        return false;
+                    }
+                    attribute.value = text.substr(position + 1, end - position - 1);
+                    position = end + 1;
+                } else {
+                    attribute.value = readIdentifier(text, position);
+                }
+                skipSpaces(text, position);
+                if (position >= text.size() || text[position] != ']') {
+                    return false;
+                }
+            }
+            position++;
+            compound.selectors.push_back(std::move(attribute));
+        } else {
+            break;
+        }
+    }
+    return position > start;
+}
+
+void SelectorMatcher::add(Selector&& selector) {
+    Candidate candidate;
+    candidate.selector = static_cast<int>(mSelectors.size());
+    // The compounds on the left of a descendant or a child combinator match ancestors of the
+    // element, so must their keys be in the filter. Those on the left of a sibling combinator
+    // have the same ancestors as the compound on its right.
+    candidate.ancestorHashCount = 0;
+    for (size_t i = 0; i + 1 < selector.compounds.size(); i++) {
+        if (selector.compounds[i].combinator == '+') {
+            mHasSiblingSelectors = true;
+            continue;
+        }
+        for (auto& simple : selector.compounds[i + 1].selectors) {
+            if (candidate.ancestorHashCount == MAX_ANCESTOR_HASHES || simple.kind > CLASS) {
+                continue;
+            }
+            uint32_t kind = simple.kind == TYPE ? AncestorFilter::TYPE_KEY
+                            : simple.kind == ID ? AncestorFilter::ID_KEY
+                            : AncestorFilter::CLASS_KEY;
+            candidate.ancestorHashes[candidate.ancestorHashCount++] = AncestorFilter::hash(kind, simple.atom);
+        }
+    }
+    int id = AtomTable::NONE;
+    int cssClass = AtomTable::NONE;
+    int type = AtomTable::NONE;
+    for (auto& simple : selector.compounds[0].selectors) {
+        if (simple.kind == ID) {
+            id = simple.atom;
+        } else if (simple.kind == CLASS && cssClass == AtomTable::NONE) {
+            cssClass = simple.atom;
+        } else if (simple.kind == TYPE) {
+            type = simple.atom;
+        }
+    }
+    if (id != AtomTable::NONE) {
+        addToBucket(mIdBuckets, id, candidate);
+    } else if (cssClass != AtomTable::NONE) {
+        addToBucket(mClassBuckets, cssClass, candidate);
+    } else if (type != AtomTable::NONE) {
+        addToBucket(mTypeBuckets, type, candidate);
+    } else {
+        mUniversal.push_back(candidate);
+    }
+    mSelectors.push_back(std::move(selector));
+}
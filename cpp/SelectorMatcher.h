@@ -0,0 +1,209 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "AncestorFilter.h"
+#include "AtomTable.h"
+#include "StyleElement.h"
+#include "StyleSheet.h"
+
+/**
+ * Matches the selectors of a {@link StyleSheet} against trees of {@link StyleElement}s and
+ * applies the computed styles to their items, as css-selector.js and css-state.js do for the
+ * views.
+ *
+ * The selectors are bucketed like in the SelectorsMap of css-selector.js, by the id, else a
+ * class, else the type of their rightmost compound, so an element is only tested against the
+ * selectors of its own id, classes and type and the universal ones. While a tree is resolved the
+ * keys of the ancestors are kept in an {@link AncestorFilter}, which rejects most of the
+ * selectors with descendant and child combinators without walking up the tree.
+ *
+ * The supported selectors are the type, universal, id, class, attribute and pseudo-class ones
+ * with the descendant, child (&gt;) and next-sibling (+) combinators; the other selectors never
+ * match, like the InvalidSelector of css-selector.js. The computed style of an element merges
+ * the styles of the rules it matches, ordered by specificity then by their order in the
+ * stylesheet, and is interned, so the elements with the same computed style share it.
+ *
+ * An element whose type, id, classes, pseudo-classes and attributes, in any order, are those of
+ * one of the last styled siblings, e.g. the items of a list or a tabbar, matches the same
+ * selectors, as they have the same ancestors: it shares the style of the sibling without being
+ * matched. Unless the stylesheet has next-sibling combinators, which can tell the siblings apart.
+ */
+class SelectorMatcher {
+public:
+    /**
+     * @param sheet the compiled stylesheet, whose rules are copied
+     * @param atoms the atoms of the names of the elements, which the names of the selectors are
+     *              added to
+     * @param pool  the pool of the styles of the sheet, which the computed styles are interned in
+     */
+    SelectorMatcher(const StyleSheet& sheet, AtomTable* atoms, ItemStylePool* pool);
+
+    /**
+     * Computes the styles of the subtree of the element and applies them to the items of the
+     * elements whose style has changed since the last resolution. The flex-basis lengths of the
+     * children of a {@link FlexLayout} whose direction has changed are resolved again.
+     */
+    void resolve(StyleElement* root);
+
+    /**
+     * Computes the style of a single element, without the ancestor filter.
+     *
+     * @return the interned style, empty if no rule matches
+     */
+    const ItemStyle* match(const StyleElement& element);
+
+    /**
+     * @return the number of selectors which can match
+     */
+    size_t getSelectorCount() const { return mSelectors.size(); }
+
+    /**
+     * Enables or disables the sharing of the styles between siblings, enabled by default. Every
+     * element is matched when it's disabled, e.g. to check the styles shared.
+     */
+    void setStyleSharing(bool enabled) { mStyleSharing = enabled; }
+
+    /**
+     * @return the number of elements which have shared the style of a sibling
+     */
+    size_t getSharedStyleCount() const { return mSharedStyleCount; }
+
+private:
+    static constexpr int TYPE = 0;
+    static constexpr int ID = 1;
+    static constexpr int CLASS = 2;
+    static constexpr int PSEUDO_CLASS = 3;
+    static constexpr int ATTRIBUTE = 4;
+
+    /** The attribute operators, NONE testing that the attribute is set */
+    static constexpr char NONE = 0;
+
+    /** The maximum number of ancestor keys tested against the filter per selector */
+    static constexpr int MAX_ANCESTOR_HASHES = 4;
+
+    /** The number of the last styled siblings an element may share its style with */
+    static constexpr int MAX_STYLE_SIBLINGS = 4;
+
+    struct SimpleSelector {
+        int kind;
+        int atom;
+        /** The operator of an attribute selector: NONE, '=', '~', '|', '^', '$' or '*' */
+        char test;
+        std::string value;
+    };
+
+    struct Compound {
+        std::vector<SimpleSelector> selectors;
+        /** How the element of the next compound relates to this one: ' ', '>' or '+' */
+        char combinator;
+    };
+
+    struct Selector {
+        /** From the rightmost compound, the one the element is matched against */
+        std::vector<Compound> compounds;
+        int specificity;
+        const ItemStyle* style;
+    };
+
+    /**
+     * The entry of a selector in a bucket, with the hashes of the keys of the ancestors it
+     * requires, so that the filter rejects it without touching the selector.
+     */
+    struct Candidate {
+        int selector;
+        int ancestorHashCount;
+        uint32_t ancestorHashes[MAX_ANCESTOR_HASHES];
+    };
+
+    struct CascadeKey {
+        const ItemStyle* style;
+        int selector;
+
+        bool operator==(const CascadeKey& other) const {
+            return style == other.style && selector == other.selector;
+        }
+    };
+
+    struct CascadeHash {
+        size_t operator()(const CascadeKey& key) const {
+            return std::hash<const ItemStyle*>()(key.style) * 31 + key.selector;
+        }
+    };
+
+    AtomTable* mAtoms;
+
+    ItemStylePool* mPool;
+
+    const ItemStyle* mEmptyStyle;
+
+    /** In the order of the stylesheet */
+    std::vector<Selector> mSelectors;
+
+    /** The selectors by the atom of their key, the atoms being dense */
+    std::vector<std::vector<Candidate>> mIdBuckets;
+
+    std::vector<std::vector<Candidate>> mClassBuckets;
+
+    std::vector<std::vector<Candidate>> mTypeBuckets;
+
+    std::vector<Candidate> mUniversal;
+
+    AncestorFilter mFilter;
+
+    /** Whether a selector has a next-sibling combinator, so that siblings can't share styles */
+    bool mHasSiblingSelectors = false;
+
+    bool mStyleSharing = true;
+
+    size_t mSharedStyleCount = 0;
+
+    /** The selectors matched by the element being styled */
+    std::vector<int> mMatched;
+
+    /**
+     * The style of the cascade of the styles of some selectors, merged with the style of the next
+     * one, so that the elements matching the same selectors don't merge and intern their style.
+     */
+    std::unordered_map<CascadeKey, const ItemStyle*, CascadeHash> mCascade;
+
+    /**
+     * @return false if the selector isn't supported
+     */
+    bool parse(const std::string& text, Selector& selector);
+
+    bool parseCompound(const std::string& text, size_t& position, Compound& compound);
+
+    void add(Selector&& selector);
+
+    /**
+     * @param siblings the last styled siblings of the element
+     * @return the style of the sibling the element can share it with, or null
+     */
+    const ItemStyle* findSharedStyle(const StyleElement& element, StyleElement* const* siblings, size_t count) const;
+
+    /**
+     * @param filter the keys of the ancestors of the element, or null to walk up the tree
+     */
+    const ItemStyle* computeStyle(const StyleElement& element, const AncestorFilter* filter);
+
+    static const std::vector<Candidate>& getBucket(const std::vector<std::vector<Candidate>>& buckets, int atom);
+
+    static void addToBucket(std::vector<std::vector<Candidate>>& buckets, int atom, const Candidate& candidate);
+
+    void collect(const std::vector<Candidate>& bucket, const StyleElement& element, const AncestorFilter* filter);
+
+    static bool matches(const Selector& selector, size_t index, const StyleElement& element);
+
+    static bool matches(const Compound& compound, const StyleElement& element);
+
+    static bool matches(const SimpleSelector& selector, const StyleElement& element);
+};
@@ -0,0 +1,141 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+#include "AtomTable.h"
+
+class Item;
+class ItemStyle;
+
+/**
+ * The node of a styled tree, e.g. a View of View.js: what the selectors match, its type, id,
+ * classes, pseudo-classes and attributes, and the item its computed style is applied to. The
+ * names are atoms of the {@link AtomTable} of the {@link SelectorMatcher}, the type being the
+ * lowercase name of the class of the node, e.g. <code>view</code>.
+ *
+ * The elements don't own their children.
+ */
+class StyleElement {
+    friend class SelectorMatcher;
+
+public:
+    /**
+     * @param item the item the computed style is applied to, or null
+     */
+    explicit StyleElement(Item* item = nullptr) : mItem(item) {}
+
+    StyleElement(const StyleElement&) = delete;
+
+    StyleElement& operator=(const StyleElement&) = delete;
+
+    Item* getItem() const { return mItem; }
+
+    int getType() const { return mType; }
+
+    void setType(int type) { mType = type; }
+
+    int getId() const { return mId; }
+
+    void setId(int id) { mId = id; }
+
+    const std::vector<int>& getClasses() const { return mClasses; }
+
+    void addClass(int cssClass) {
+        if (!hasClass(cssClass)) {
+            mClasses.push_back(cssClass);
+        }
+    }
+
+    bool hasClass(int cssClass) const {
+        return std::find(mClasses.begin(), mClasses.end(), cssClass) != mClasses.end();
+    }
+
+    void clearClasses() { mClasses.clear(); }
+
+    void addPseudoClass(int pseudoClass) {
+        if (!hasPseudoClass(pseudoClass)) {
+            mPseudoClasses.push_back(pseudoClass);
+        }
+    }
+
+    bool hasPseudoClass(int pseudoClass) const {
+        return std::find(mPseudoClasses.begin(), mPseudoClasses.end(), pseudoClass) != mPseudoClasses.end();
+    }
+
+    void removePseudoClass(int pseudoClass) {
+        mPseudoClasses.erase(std::remove(mPseudoClasses.begin(), mPseudoClasses.end(), pseudoClass),
+                             mPseudoClasses.end());
+    }
+
+    void setAttribute(int name, const std::string& value) {
+        for (auto& attribute : mAttributes) {
+            if (attribute.first == name) {
+                attribute.second = value;
+                return;
+            }
+        }
+        mAttributes.emplace_back(name, value);
+    }
+
+    /**
+     * @return the value of the attribute, or null if it isn't set
+     */
+    const std::string* getAttribute(int name) const {
+        for (auto& attribute : mAttributes) {
+            if (attribute.first == name) {
+                return &attribute.second;
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * Appends the child.
+     */
+    void addChild(StyleElement* child) {
+        child->mParent = this;
+        child->mPreviousSibling = mChildren.empty() ? nullptr : mChildren.back();
+        mChildren.push_back(child);
+    }
+
+    StyleElement* getParent() const { return mParent; }
+
+    StyleElement* getPreviousSibling() const { return mPreviousSibling; }
+
+    const std::vector<StyleElement*>& getChildren() const { return mChildren; }
+
+    /**
+     * @return the style computed by the last resolution, or null
+     */
+    const ItemStyle* getStyle() const { return mStyle; }
+
+private:
+    Item* mItem;
+
+    int mType = AtomTable::NONE;
+
+    int mId = AtomTable::NONE;
+
+    std::vector<int> mClasses;
+
+    std::vector<int> mPseudoClasses;
+
+    std::vector<std::pair<int, std::string>> mAttributes;
+
+    StyleElement* mParent = nullptr;
+
+    StyleElement* mPreviousSibling = nullptr;
+
+    std::vector<StyleElement*> mChildren;
+
+    const ItemStyle* mStyle = nullptr;
+};
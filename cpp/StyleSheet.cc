@@ -0,0 +1,224 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+#include <stdexcept>
+#include "StyleSheet.h"
+#include "JsonTreeLoader.h"
+
+/**
+ * Reads a JSON document in place, the values of the members not asked for being skipped.
+ */
+class AstReader {
+public:
+    explicit AstReader(const std::string& json) : mJson(json) {}
+
+    /**
+     * Reads an object, calling onMember(key) to read or skip the value of each member.
+     */
+    template<typename OnMember>
+    void readObject(OnMember onMember) {
+        expect('{');
+        enter();
+        if (!consume('}')) {
+            do {
+                std::string key = readString();
+                expect(':');
+                onMember(key);
+            } while (consume(','));
+            expect('}');
+        }
+        mDepth--;
+    }
+
+    /**
+     * Reads an array, calling onElement() to read or skip each element.
+     */
+    template<typename OnElement>
+    void readArray(OnElement onElement) {
+        expect('[');
+        enter();
+        if (!consume(']')) {
+            do {
+                onElement();
+            } while (consume(','));
+            expect(']');
+        }
+        mDepth--;
+    }
+
+    std::string readString() {
+        size_t start = skipString();
+        std::string raw = mJson.substr(start, mPosition - 1 - start);
+        return raw.find('\\') == std::string::npos ? raw : JsonTreeLoader::decodeString(raw);
+    }
+
+    void skipValue() {
+        switch (peek()) {
+            case '{':
+                readObject([this](const std::string&) { skipValue(); });
+                break;
+            case '[':
+                readArray([this] { skipValue(); });
+                break;
+            case '"':
+                skipString();
+                break;
+            default:
+                skipLiteral();
+                break;
+        }
+    }
+
+    /**
+     * Checks that nothing but whitespace follows the document.
+     */
+    void finish() {
+        if (peek() != '\0') {
+            fail("unexpected content after the document");
+        }
+    }
+
+private:
+    /** The maximum nesting of the arrays and objects, so that skipping can't overflow the stack */
+    static constexpr int MAX_DEPTH = 256;
+
+    const std::string& mJson;
+
+    size_t mPosition = 0;
+
+    int mDepth = 0;
+
+    char peek() {
+        while (mPosition < mJson.size() && std::isspace(static_cast<unsigned char>(mJson[mPosition]))) {
+            mPosition++;
+        }
+        return mPosition < mJson.size() ? mJson[mPosition] : '\0';
+    }
+
+    bool consume(char c) {
+        if (peek() != c) {
+            return false;
+        }
+        mPosition++;
+        return true;
+    }
+
+    void expect(char c) {
+        if (!consume(c)) {
+            fail(std::string("expected '") + c + "'");
+        }
+    }
+
+    void enter() {
+        if (++mDepth > MAX_DEPTH) {
+            fail("too deeply nested");
+        }
+    }
+
+    /**
+     * Skips a string without decoding it.
+     *
+     * @return the position of its first character
+     */
+    size_t skipString() {
+        expect('"');
+        size_t start = mPosition;
+        while (mPosition < mJson.size() && mJson[mPosition] != '"') {
+            mPosition += mJson[mPosition] == '\\' ? 2 : 1;
+        }
+        if (mPosition >= mJson.size()) {
+            fail("unterminated string");
+        }
+        mPosition++;
+        return start;
+    }
+
+    /**
+     * Skips true, false, null or a number, with the rules of {@link JsonTreeLoader}.
+     */
+    void skipLiteral() {
+        size_t start = mPosition;
+        while (mPosition < mJson.size() && JsonTreeLoader::isLiteralChar(mJson[mPosition])) {
+            mPosition++;
+        }
+        if (!JsonTreeLoader::isLiteral(mJson.substr(start, mPosition - start))) {
+            mPosition = start;
+            fail("invalid value");
+        }
+    }
+
+    [[noreturn]] void fail(const std::string& reason) const {
+        throw std::invalid_argument("Malformed stylesheet at offset " + std::to_string(mPosition) + ": " + reason);
+    }
+};
+
+void StyleSheet::load(const std::string& ast) {
+    AstReader reader(ast);
+    // Read apart, so that a malformed document leaves the rules as they were.
+    std::vector<Rule> rules;
+    int ruleCount = mRuleCount;
+    auto readDeclaration = [&reader](ItemStyle& style) {
+        std::string type;
+        std::string property;
+        std::string value;
+        reader.readObject([&](const std::string& key) {
+            if (key == "type") {
+                type = reader.readString();
+            } else if (key == "property") {
+                property = reader.readString();
+            } else if (key == "value") {
+                value = reader.readString();
+            } else {
+                reader.skipValue();
+            }
+        });
+        if (type == "declaration") {
+            std::transform(property.begin(), property.end(), property.begin(),
+                           [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+            style.compile(property, value);
+        }
+    };
+    auto readRule = [&]() {
+        std::string type;
+        std::vector<std::string> selectors;
+        ItemStyle style;
+        reader.readObject([&](const std::string& key) {
+            if (key == "type") {
+                type = reader.readString();
+            } else if (key == "selectors") {
+                reader.readArray([&] { selectors.push_back(reader.readString()); });
+            } else if (key == "declarations") {
+                reader.readArray([&] { readDeclaration(style); });
+            } else {
+                reader.skipValue();
+            }
+        });
+        int index = ruleCount++;
+        if (type == "rule" && !selectors.empty() && !style.isEmpty()) {
+            rules.push_back({std::move(selectors), mPool->intern(style), index});
+        }
+    };
+    reader.readObject([&](const std::string& key) {
+        if (key != "stylesheet") {
+            reader.skipValue();
+            return;
+        }
+        reader.readObject([&](const std::string& key) {
+            if (key == "rules") {
+                reader.readArray(readRule);
+            } else {
+                reader.skipValue();
+            }
+        });
+    });
+    reader.finish();
+    mRules.insert(mRules.end(), std::make_move_iterator(rules.begin()), std::make_move_iterator(rules.end()));
+    mRuleCount = ruleCount;
+}
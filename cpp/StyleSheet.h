@@ -0,0 +1,66 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "ItemStyle.h"
+
+/**
+ * The layout part of a stylesheet, compiled from the AST css-parser.js produces:
+ *
+ * <pre>
+ * {"type": "stylesheet", "stylesheet": {"rules": [
+ *     {"type": "rule", "selectors": [".tabbar__item"], "declarations": [
+ *         {"type": "declaration", "property": "padding", "value": "20 0", "position": {...}},
+ *         {"type": "declaration", "property": "width", "value": "50%", "position": {...}}
+ *     ], "position": {...}}
+ * ]}}
+ * </pre>
+ *
+ * The position members, and their copies of the source, are skipped without being decoded. Only
+ * the rules are compiled, the at-rules (keyframes, media...) are skipped, and so are the
+ * declarations which aren't layout ones, see {@link ItemStyle#compile}. A rule left without
+ * layout declarations is dropped. The styles of the rules are interned by the pool given to the
+ * stylesheet, so the rules with the same declarations share their style.
+ */
+class StyleSheet {
+public:
+    struct Rule {
+        std::vector<std::string> selectors;
+
+        const ItemStyle* style;
+
+        /** The index of the rule in the AST, the later rules winning in the cascade */
+        int index;
+    };
+
+    /**
+     * @param pool the pool the styles are interned in, which has to outlive the stylesheet
+     */
+    explicit StyleSheet(ItemStylePool* pool) : mPool(pool) {}
+
+    /**
+     * Compiles the rules of an AST, appended to the rules of the stylesheet.
+     *
+     * @param ast the JSON document
+     * @throws std::invalid_argument if the document is malformed, the rules of the stylesheet
+     * are then left as they were
+     */
+    void load(const std::string& ast);
+
+    const std::vector<Rule>& getRules() const { return mRules; }
+
+private:
+    ItemStylePool* mPool;
+
+    std::vector<Rule> mRules;
+
+    /** The number of rules of the ASTs loaded, including the dropped ones */
+    int mRuleCount = 0;
+};
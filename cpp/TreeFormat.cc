@@ -0,0 +1,343 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <typeinfo>
+#include "TreeFormat.h"
+#include "ItemArena.h"
+#include "FlexLayout.h"
+#include "FlowLayout.h"
+#include "LinearLayout.h"
+
+static const char MAGIC[4] = {'F', 'L', 'X', 'T'};
+
+template<typename T>
+static T* newItem(ItemArena* arena) {
+    return arena != nullptr ? arena->create<T>() : new T();
+}
+
+uint32_t TreeFormat::getNodeType(const Item& item) {
+    const std::type_info& type = typeid(item);
+    if (type == typeid(Item)) {
+        return NodeType::ITEM;
+    } else if (type == typeid(FlexLayout)) {
+        return NodeType::FLEX_LAYOUT;
+    } else if (type == typeid(LinearLayout)) {
+        return NodeType::LINEAR_LAYOUT;
+    } else if (type == typeid(FlowLayout)) {
+        return NodeType::FLOW_LAYOUT;
+    }
+    throw std::invalid_argument(std::string("The item class can't be written: ") + type.name());
+}
+
+void TreeFormat::writeRecord(Item* item, NodeRecord& record) {
+    std::memset(&record, 0, sizeof(record));
+    record.type = getNodeType(*item);
+    if (record.type == NodeType::FLEX_LAYOUT) {
+        auto flexLayout = static_cast<FlexLayout*>(item);
+        record.flexDirection = flexLayout->mFlexDirection;
+        record.flexWrap = flexLayout->mFlexWrap;
+        record.justifyContent = flexLayout->mJustifyContent;
+        record.alignItems = flexLayout->mAlignItems;
+        record.alignContent = flexLayout->mAlignContent;
+        record.maxLine = flexLayout->mMaxLine;
+    } else if (record.type == NodeType::LINEAR_LAYOUT) {
+        auto linearLayout = static_cast<LinearLayout*>(item);
+        record.orientation = linearLayout->mOrientation;
+        record.weightSum = linearLayout->mWeightSum;
+        record.useLargestChild = linearLayout->mUseLargestChild;
+        record.showDividers = linearLayout->mShowDividers;
+        record.dividerWidth = linearLayout->mDividerWidth;
+        record.dividerHeight = linearLayout->mDividerHeight;
+    } else if (record.type == NodeType::FLOW_LAYOUT) {
+        auto flowLayout = static_cast<FlowLayout*>(item);
+        record.lineSpacing = flowLayout->mLineSpacing;
+        record.itemSpacing = flowLayout->mItemSpacing;
+        record.singleLine = flowLayout->mSingleLine;
+    }
+    if (record.type != NodeType::ITEM) {
+        auto layout = static_cast<Layout*>(item);
+        record.childCount = layout->getChildCount();
+        record.resizeMode = layout->isResizeMode();
+        record.layoutSharing = layout->isLayoutSharing();
+    }
+    record.order = item->mOrder;
+    record.alignSelf = item->mAlignSelf;
+    record.minWidth = item->mMinWidth;
+    record.minHeight = item->mMinHeight;
+    record.maxWidth = item->mMaxWidth;
+    record.maxHeight = item->mMaxHeight;
+    record.width = item->mWidth;
+    record.height = item->mHeight;
+    record.marginLeft = item->mLeftMargin;
+    record.marginTop = item->mTopMargin;
+    record.marginRight = item->mRightMargin;
+    record.marginBottom = item->mBottomMargin;
+    record.paddingLeft = item->mPaddingLeft;
+    record.paddingTop = item->mPaddingTop;
+    record.paddingRight = item->mPaddingRight;
+    record.paddingBottom = item->mPaddingBottom;
+    record.visibility = item->getVisibility();
+    record.wrapBefore = item->mWrapBefore;
+    record.flexGrow = item->mFlexGrow;
+    record.flexShrink = item->mFlexShrink;
+    record.flexBasisPercent = item->mFlexBasisPercent;
+    record.widthPercent = item->mWidthPercent;
+    record.heightPercent = item->mHeightPercent;
+    record.weight = item->mWeight;
+}
+
+std::vector<char> TreeFormat::write(Item* root) {
+    std::vector<NodeRecord> records;
+    // Pre-order, the children are pushed in reverse.
+    std::vector<Item*> stack{root};
+    while (!stack.empty()) {
+        Item* item = stack.back();
+        stack.pop_back();
+        records.emplace_back();
+        writeRecord(item, records.back());
+        if (records.back().type != NodeType::ITEM) {
+            auto layout = static_cast<Layout*>(item);
+            for (int i = layout->getChildCount() - 1; i >= 0; i--) {
+                stack.push_back(layout->getChildAt(i));
+            }
+        }
+    }
+
+    Header header = {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.version = VERSION;
+    header.recordSize = sizeof(NodeRecord);
+    header.nodeCount = records.size();
+    std::vector<char> bytes(sizeof(Header) + records.size() * sizeof(NodeRecord));
+    std::memcpy(bytes.data(), &header, sizeof(Header));
+    std::memcpy(bytes.data() + sizeof(Header), records.data(), records.size() * sizeof(NodeRecord));
+    return bytes;
+}
+
+const TreeFormat::NodeRecord* TreeFormat::getRecords(const void* data, size_t size) {
+    if (size < sizeof(Header) || reinterpret_cast<uintptr_t>(data) % alignof(NodeRecord) != 0) {
+        throw std::invalid_argument("Not a tree file, or not aligned");
+    }
+    auto header = static_cast<const Header*>(data);
+    if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0) {
+        throw std::invalid_argument("Not a tree file");
+    }
+    if (header->byteOrder != BYTE_ORDER_MARK || header->version != VERSION
+        || header->recordSize != sizeof(NodeRecord)) {
+        throw std::invalid_argument("Unsupported tree file version: " + std::to_string(header->version));
+    }
+    if (header->nodeCount == 0 || (size - sizeof(Header)) / sizeof(NodeRecord) < header->nodeCount) {
+        throw std::invalid_argument("Truncated tree file");
+    }
+    auto records = reinterpret_cast<const NodeRecord*>(static_cast<const char*>(data) + sizeof(Header));
+    // The number of children left to read for each open container.
+    std::vector<uint32_t> pending;
+    for (uint32_t i = 0; i < header->nodeCount; i++) {
+        const NodeRecord& record = records[i];
+        if (i > 0 && pending.empty()) {
+            throw std::invalid_argument("The tree file has several roots");
+        }
+        if (!pending.empty()) {
+            pending.back()--;
+        }
+        try {
+            checkRecord(record);
+        } catch (const std::invalid_argument& e) {
+            throw std::invalid_argument("Invalid record in the tree file at " + std::to_string(i) + ": " + e.what());
+        }
+        if (record.childCount != 0) {
+            pending.push_back(record.childCount);
+        }
+        while (!pending.empty() && pending.back() == 0) {
+            pending.pop_back();
+        }
+    }
+    if (!pending.empty()) {
+        throw std::invalid_argument("Truncated tree file");
+    }
+    return records;
+}
+
+/**
+ * Throws if the value isn't within [min, max].
+ */
+static void checkRange(const char* field, int32_t value, int32_t min, int32_t max) {
+    if (value < min || value > max) {
+        throw std::invalid_argument(std::string(field) + " out of range: " + std::to_string(value));
+    }
+}
+
+static void checkFinite(const char* field, float value) {
+    if (!std::isfinite(value)) {
+        throw std::invalid_argument(std::string(field) + " isn't finite");
+    }
+}
+
+void TreeFormat::checkRecord(const NodeRecord& record) {
+    if (record.type > NodeType::FLOW_LAYOUT) {
+        throw std::invalid_argument("Unknown node type: " + std::to_string(record.type));
+    }
+    if (record.type == NodeType::ITEM && record.childCount != 0) {
+        throw std::invalid_argument("An item without children has " + std::to_string(record.childCount));
+    }
+    checkRange("order", record.order, -Item::MAX_SIZE, Item::MAX_SIZE);
+    checkRange("alignSelf", record.alignSelf, AlignSelf::AUTO, AlignSelf::STRETCH);
+    checkRange("minWidth", record.minWidth, Item::NOT_SET, Item::MAX_SIZE);
+    checkRange("minHeight", record.minHeight, Item::NOT_SET, Item::MAX_SIZE);
+    checkRange("maxWidth", record.maxWidth, 0, Item::MAX_SIZE);
+    checkRange("maxHeight", record.maxHeight, 0, Item::MAX_SIZE);
+    checkRange("width", record.width, Item::LayoutParams::WRAP_CONTENT, Item::MAX_SIZE);
+    checkRange("height", record.height, Item::LayoutParams::WRAP_CONTENT, Item::MAX_SIZE);
+    // Negative margins and paddings are valid, but not ones whose negation overflows.
+    for (int32_t value : {record.marginLeft, record.marginTop, record.marginRight, record.marginBottom}) {
+        checkRange("margin", value, -Item::MAX_SIZE, Item::MAX_SIZE);
+    }
+    for (int32_t value : {record.paddingLeft, record.paddingTop, record.paddingRight, record.paddingBottom}) {
+        checkRange("padding", value, -Item::MAX_SIZE, Item::MAX_SIZE);
+    }
+    if (record.visibility != Item::VISIBLE && record.visibility != Item::INVISIBLE
+        && record.visibility != Item::GONE) {
+        throw std::invalid_argument("Unknown visibility: " + std::to_string(record.visibility));
+    }
+    checkFinite("flexGrow", record.flexGrow);
+    checkFinite("flexShrink", record.flexShrink);
+    checkFinite("flexBasisPercent", record.flexBasisPercent);
+    checkFinite("widthPercent", record.widthPercent);
+    checkFinite("heightPercent", record.heightPercent);
+    checkFinite("weight", record.weight);
+    if (record.type == NodeType::FLEX_LAYOUT) {
+        checkRange("flexDirection", record.flexDirection, FlexDirection::ROW, FlexDirection::COLUMN_REVERSE);
+        checkRange("flexWrap", record.flexWrap, FlexWrap::NOWRAP, FlexWrap::WRAP_REVERSE);
+        checkRange("justifyContent", record.justifyContent, JustifyContent::FLEX_START, JustifyContent::SPACE_EVENLY);
+        checkRange("alignItems", record.alignItems, AlignItems::FLEX_START, AlignItems::STRETCH);
+        checkRange("alignContent", record.alignContent, AlignContent::FLEX_START, AlignContent::STRETCH);
+        checkRange("maxLine", record.maxLine, FlexLayout::NOT_SET, Item::MAX_SIZE);
+    } else if (record.type == NodeType::LINEAR_LAYOUT) {
+        checkRange("orientation", record.orientation, LinearLayout::HORIZONTAL, LinearLayout::VERTICAL);
+        checkFinite("weightSum", record.weightSum);
+        checkRange("showDividers", record.showDividers, LinearLayout::SHOW_DIVIDER_NONE,
+                   LinearLayout::SHOW_DIVIDER_BEGINNING | LinearLayout::SHOW_DIVIDER_MIDDLE
+                   | LinearLayout::SHOW_DIVIDER_END);
+        checkRange("dividerWidth", record.dividerWidth, 0, Item::MAX_SIZE);
+        checkRange("dividerHeight", record.dividerHeight, 0, Item::MAX_SIZE);
+    } else if (record.type == NodeType::FLOW_LAYOUT) {
+        checkRange("lineSpacing", record.lineSpacing, -Item::MAX_SIZE, Item::MAX_SIZE);
+        checkRange("itemSpacing", record.itemSpacing, -Item::MAX_SIZE, Item::MAX_SIZE);
+    }
+}
+
+Item* TreeFormat::createItem(const NodeRecord& record, ItemArena* arena) {
+    Item* item;
+    switch (record.type) {
+        case NodeType::FLEX_LAYOUT: {
+            auto flexLayout = newItem<FlexLayout>(arena);
+            flexLayout->mFlexDirection = record.flexDirection;
+            flexLayout->mFlexWrap = record.flexWrap;
+            flexLayout->mJustifyContent = record.justifyContent;
+            flexLayout->mAlignItems = record.alignItems;
+            flexLayout->mAlignContent = record.alignContent;
+            flexLayout->mMaxLine = record.maxLine;
+            item = flexLayout;
+            break;
+        }
+        case NodeType::LINEAR_LAYOUT: {
+            auto linearLayout = newItem<LinearLayout>(arena);
+            linearLayout->mOrientation = record.orientation;
+            linearLayout->mWeightSum = record.weightSum;
+            linearLayout->mUseLargestChild = record.useLargestChild != 0;
+            linearLayout->mShowDividers = record.showDividers;
+            linearLayout->mDividerWidth = record.dividerWidth;
+            linearLayout->mDividerHeight = record.dividerHeight;
+            item = linearLayout;
+            break;
+        }
+        case NodeType::FLOW_LAYOUT: {
+            auto flowLayout = newItem<FlowLayout>(arena);
+            flowLayout->mLineSpacing = record.lineSpacing;
+            flowLayout->mItemSpacing = record.itemSpacing;
+            flowLayout->mSingleLine = record.singleLine != 0;
+            item = flowLayout;
+            break;
+        }
+        default:
+            item = newItem<Item>(arena);
+            break;
+    }
+    if (record.type != NodeType::ITEM) {
+        auto layout = static_cast<Layout*>(item);
+        layout->setResizeMode(record.resizeMode != 0);
+        layout->setLayoutSharing(record.layoutSharing != 0);
+    }
+    item->mOrder = record.order;
+    item->mAlignSelf = record.alignSelf;
+    item->mMinWidth = record.minWidth;
+    item->mMinHeight = record.minHeight;
+    item->mMaxWidth = record.maxWidth;
+    item->mMaxHeight = record.maxHeight;
+    item->mWidth = record.width;
+    item->mHeight = record.height;
+    item->mLeftMargin = record.marginLeft;
+    item->mTopMargin = record.marginTop;
+    item->mRightMargin = record.marginRight;
+    item->mBottomMargin = record.marginBottom;
+    item->mPaddingLeft = record.paddingLeft;
+    item->mPaddingTop = record.paddingTop;
+    item->mPaddingRight = record.paddingRight;
+    item->mPaddingBottom = record.paddingBottom;
+    item->mViewFlags = (item->mViewFlags & ~Item::VISIBILITY_MASK) | (record.visibility & Item::VISIBILITY_MASK);
+    item->mWrapBefore = record.wrapBefore != 0;
+    item->mFlexGrow = record.flexGrow;
+    item->mFlexShrink = record.flexShrink;
+    item->mFlexBasisPercent = record.flexBasisPercent;
+    item->mWidthPercent = record.widthPercent;
+    item->mHeightPercent = record.heightPercent;
+    item->mWeight = record.weight;
+    // A new item, nothing to invalidate.
+    item->mPrivateFlags |= Item::PFLAG_FORCE_LAYOUT | Item::PFLAG_LAYOUT_INVALIDATED;
+    return item;
+}
+
+Item* TreeFormat::read(const void* data, size_t size, ItemArena* arena) {
+    const NodeRecord* records = getRecords(data, size);
+    uint32_t nodeCount = static_cast<const Header*>(data)->nodeCount;
+    Item* root = nullptr;
+    // Without an arena, the items created are destroyed if the tree can't be completed.
+    std::vector<std::unique_ptr<Item>> created;
+    if (arena == nullptr) {
+        created.reserve(nodeCount);
+    }
+    // The open containers and the number of children each one still has to receive.
+    std::vector<std::pair<Layout*, uint32_t>> stack;
+    for (uint32_t i = 0; i < nodeCount; i++) {
+        Item* item = createItem(records[i], arena);
+        if (arena == nullptr) {
+            created.emplace_back(item);
+        }
+        if (stack.empty()) {
+            root = item;
+        } else {
+            stack.back().first->addItem(item);
+            stack.back().second--;
+        }
+        if (records[i].childCount != 0) {
+            stack.emplace_back(static_cast<Layout*>(item), records[i].childCount);
+        }
+        while (!stack.empty() && stack.back().second == 0) {
+            stack.pop_back();
+        }
+    }
+    for (auto& item : created) {
+        item.release();
+    }
+    return root;
+}
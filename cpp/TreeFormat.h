@@ -0,0 +1,189 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+#include "Item.h"
+
+class ItemArena;
+
+/**
+ * A flat binary format for trees of items with all their attributes, so that large saved UIs
+ * are loaded without building each item with the setters.
+ *
+ * The file is a {@link Header} followed by one fixed size {@link NodeRecord} per item, in
+ * pre-order: each record is followed by the records of its children's subtrees. There are no
+ * pointers nor offsets, the records are only made of 32 bits fields in the byte order of the
+ * writer, so a file can be mapped in memory and its records read in place with
+ * {@link #getRecords(const void*, size_t)}, or converted to items with
+ * {@link #read(const void*, size_t, ItemArena*)} by copying each record into an item.
+ *
+ * A file is rejected if its version, byte order or record size differ from the reader's; files
+ * of an older version have to be converted.
+ */
+class TreeFormat {
+public:
+    /** The version of the format, changed with the layout of the records */
+    static constexpr uint32_t VERSION = 1;
+
+    /** The class of the item of a record */
+    struct NodeType {
+        static constexpr uint32_t ITEM = 0;
+        static constexpr uint32_t FLEX_LAYOUT = 1;
+        static constexpr uint32_t LINEAR_LAYOUT = 2;
+        static constexpr uint32_t FLOW_LAYOUT = 3;
+    };
+
+    struct Header {
+        /** "FLXT" */
+        char magic[4];
+
+        /** {@link #BYTE_ORDER_MARK} in the byte order of the writer */
+        uint32_t byteOrder;
+
+        uint32_t version;
+
+        /** sizeof(NodeRecord) for the version */
+        uint32_t recordSize;
+
+        uint32_t nodeCount;
+
+        uint32_t reserved;
+    };
+
+    static constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+    /**
+     * The attributes of an item. The attributes of the containers are only meaningful for their
+     * type and are 0 otherwise.
+     */
+    struct NodeRecord {
+        uint32_t type;
+        uint32_t childCount;
+
+        int32_t order;
+        int32_t alignSelf;
+        int32_t minWidth;
+        int32_t minHeight;
+        int32_t maxWidth;
+        int32_t maxHeight;
+        int32_t width;
+        int32_t height;
+        int32_t marginLeft;
+        int32_t marginTop;
+        int32_t marginRight;
+        int32_t marginBottom;
+        int32_t paddingLeft;
+        int32_t paddingTop;
+        int32_t paddingRight;
+        int32_t paddingBottom;
+        int32_t visibility;
+        int32_t wrapBefore;
+        float flexGrow;
+        float flexShrink;
+        float flexBasisPercent;
+        float widthPercent;
+        float heightPercent;
+        float weight;
+
+        /** {@link Layout#setResizeMode(bool)} and {@link Layout#setLayoutSharing(bool)} */
+        int32_t resizeMode;
+        int32_t layoutSharing;
+
+        /** FlexLayout */
+        int32_t flexDirection;
+        int32_t flexWrap;
+        int32_t justifyContent;
+        int32_t alignItems;
+        int32_t alignContent;
+        int32_t maxLine;
+
+        /** LinearLayout */
+        int32_t orientation;
+        float weightSum;
+        int32_t useLargestChild;
+        int32_t showDividers;
+        int32_t dividerWidth;
+        int32_t dividerHeight;
+
+        /** FlowLayout */
+        int32_t lineSpacing;
+        int32_t itemSpacing;
+        int32_t singleLine;
+    };
+
+    static_assert(std::is_trivially_copyable<NodeRecord>::value && sizeof(NodeRecord) % 4 == 0,
+                  "The records are copied as bytes");
+
+    /**
+     * @return the {@link NodeType} of the class of the item
+     * @throws std::invalid_argument if the item has another class
+     */
+    static uint32_t getNodeType(const Item& item);
+
+    /**
+     * Writes the subtree in the format.
+     *
+     * @param root the root of the subtree, an Item, FlexLayout, LinearLayout or FlowLayout, as
+     *             are its descendants
+     * @return the bytes of the file
+     * @throws std::invalid_argument if an item of the subtree has another class
+     */
+    static std::vector<char> write(Item* root);
+
+    /**
+     * Checks the header, the structure and the records of the file and returns its records, to
+     * be read in place.
+     *
+     * @param data the bytes of the file, aligned on 4 bytes, e.g. a mapped file
+     * @param size the size of the file
+     * @return the records, whose number is in the header
+     * @throws std::invalid_argument if the file isn't a valid file of this version
+     */
+    static const NodeRecord* getRecords(const void* data, size_t size);
+
+    /**
+     * Builds the tree of a file.
+     *
+     * @param data  the bytes of the file, aligned on 4 bytes, e.g. a mapped file
+     * @param size  the size of the file
+     * @param arena the arena owning the items, or null to allocate each one with new
+     * @return the root of the tree, which has to be measured
+     * @throws std::invalid_argument if the file isn't a valid file of this version
+     */
+    static Item* read(const void* data, size_t size, ItemArena* arena);
+
+    /**
+     * Checks that the values of a record are ones its item can hold: a known type, no children
+     * for an Item, constants within their enumerations, sizes, margins, paddings and spacings
+     * within {@link Item#MAX_SIZE}, finite factors and percents. The container attributes are
+     * only checked for their type.
+     *
+     * @param record the record, e.g. read from a file or received from another process
+     * @throws std::invalid_argument naming the first invalid field
+     */
+    static void checkRecord(const NodeRecord& record);
+
+    /**
+     * Fills the record with the class, the child count and the attributes of the item.
+     *
+     * @throws std::invalid_argument if the item has another class than the ones of the format
+     */
+    static void writeRecord(Item* item, NodeRecord& record);
+
+    /**
+     * Creates an item with the attributes of the record, without children.
+     *
+     * @param record a record checked by {@link #checkRecord(const NodeRecord&)}
+     * @param arena  the arena owning the item, or null to allocate it with new
+     */
+    static Item* createItem(const NodeRecord& record, ItemArena* arena);
+};
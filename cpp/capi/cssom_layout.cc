@@ -0,0 +1,235 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "cssom_layout.h"
+#include "FlexLayout.h"
+#include "FlowLayout.h"
+#include "ItemArena.h"
+#include "LinearLayout.h"
+#include "TreeFormat.h"
+
+// A description is a record of the tree format whose child count is the parent.
+static_assert(sizeof(cssom_node_desc) == sizeof(TreeFormat::NodeRecord)
+              && offsetof(cssom_node_desc, parent) == offsetof(TreeFormat::NodeRecord, childCount)
+              && offsetof(cssom_node_desc, order) == offsetof(TreeFormat::NodeRecord, order)
+              && offsetof(cssom_node_desc, weight) == offsetof(TreeFormat::NodeRecord, weight)
+              && offsetof(cssom_node_desc, single_line) == offsetof(TreeFormat::NodeRecord, singleLine),
+              "cssom_node_desc has the layout of TreeFormat::NodeRecord");
+
+static_assert(CSSOM_SPEC_EXACTLY == Item::MeasureSpec::EXACTLY && CSSOM_SPEC_AT_MOST == Item::MeasureSpec::AT_MOST
+              && CSSOM_MATCH_PARENT == Item::LayoutParams::MATCH_PARENT
+              && CSSOM_WRAP_CONTENT == Item::LayoutParams::WRAP_CONTENT, "The constants match the engine's");
+
+struct cssom_tree {
+    ItemArena arena;
+    std::vector<Item*> nodes;
+    mutable std::string error;
+
+    Item* getNode(cssom_node node) const {
+        if (node < 0 || static_cast<size_t>(node) >= nodes.size()) {
+            throw std::invalid_argument("Invalid node " + std::to_string(node));
+        }
+        return nodes[node];
+    }
+};
+
+/**
+ * @throws std::invalid_argument if a value of the description is out of range, see
+ *                               TreeFormat::checkRecord()
+ */
+static TreeFormat::NodeRecord toRecord(const cssom_node_desc& desc) {
+    TreeFormat::NodeRecord record;
+    std::memcpy(&record, &desc, sizeof(record));
+    record.childCount = 0;
+    TreeFormat::checkRecord(record);
+    return record;
+}
+
+/**
+ * @throws std::invalid_argument if the array of count elements is null
+ */
+static void checkArray(const void* array, size_t count, const char* name) {
+    if (array == nullptr && count > 0) {
+        throw std::invalid_argument(std::string("Null ") + name);
+    }
+}
+
+/**
+ * @throws std::invalid_argument if the mode of the spec isn't a CSSOM_SPEC_ one or its size is
+ *                               beyond Item::MAX_SIZE
+ */
+static void checkMeasureSpec(int32_t measureSpec) {
+    int mode = Item::MeasureSpec::getMode(measureSpec);
+    if ((mode != CSSOM_SPEC_UNSPECIFIED && mode != CSSOM_SPEC_EXACTLY && mode != CSSOM_SPEC_AT_MOST)
+        || Item::MeasureSpec::getSize(measureSpec) > Item::MAX_SIZE) {
+        throw std::invalid_argument("Invalid measure spec " + std::to_string(measureSpec));
+    }
+}
+
+/**
+ * Runs the call, turning its exceptions into the error of the tree.
+ */
+template<typename Call>
+static int guard(const cssom_tree* tree, Call call) {
+    try {
+        call();
+        return CSSOM_OK;
+    } catch (const std::exception& e) {
+        tree->error = e.what();
+        return CSSOM_INVALID_ARGUMENT;
+    }
+}
+
+int cssom_layout_abi_version(void) {
+    return CSSOM_LAYOUT_ABI_VERSION;
+}
+
+int32_t cssom_make_measure_spec(int32_t size, int32_t mode) {
+    return Item::MeasureSpec::makeMeasureSpec(size, mode);
+}
+
+int cssom_node_desc_init(cssom_node_desc* desc, uint32_t type) {
+    static const std::vector<TreeFormat::NodeRecord> defaults = [] {
+        Item item;
+        FlexLayout flexLayout;
+        LinearLayout linearLayout;
+        FlowLayout flowLayout;
+        std::vector<TreeFormat::NodeRecord> records(4);
+        TreeFormat::writeRecord(&item, records[CSSOM_NODE_ITEM]);
+        TreeFormat::writeRecord(&flexLayout, records[CSSOM_NODE_FLEX_LAYOUT]);
+        TreeFormat::writeRecord(&linearLayout, records[CSSOM_NODE_LINEAR_LAYOUT]);
+        TreeFormat::writeRecord(&flowLayout, records[CSSOM_NODE_FLOW_LAYOUT]);
+        return records;
+    }();
+    if (desc == nullptr || type >= defaults.size()) {
+        return CSSOM_INVALID_ARGUMENT;
+    }
+    std::memcpy(desc, &defaults[type], sizeof(*desc));
+    desc->parent = CSSOM_NO_NODE;
+    return CSSOM_OK;
+}
+
+cssom_tree* cssom_tree_create(void) {
+    return new cssom_tree();
+}
+
+void cssom_tree_destroy(cssom_tree* tree) {
+    delete tree;
+}
+
+const char* cssom_tree_last_error(const cssom_tree* tree) {
+    return tree->error.c_str();
+}
+
+size_t cssom_tree_node_count(const cssom_tree* tree) {
+    return tree->nodes.size();
+}
+
+int cssom_tree_create_nodes(cssom_tree* tree, const cssom_node_desc* descs, size_t count, cssom_node* nodes) {
+    return guard(tree, [&] {
+        // The whole batch is checked before any node is created.
+        checkArray(descs, count, "descriptions");
+        size_t first = tree->nodes.size();
+        std::vector<TreeFormat::NodeRecord> records;
+        records.reserve(count);
+        for (size_t i = 0; i < count; i++) {
+            records.push_back(toRecord(descs[i]));
+            cssom_node parent = descs[i].parent;
+            if (parent == CSSOM_NO_NODE) {
+                continue;
+            }
+            if (parent < 0 || static_cast<size_t>(parent) >= first + i) {
+                throw std::invalid_argument("Invalid parent " + std::to_string(parent));
+            }
+            bool isContainer = static_cast<size_t>(parent) < first
+                               ? dynamic_cast<Layout*>(tree->nodes[parent]) != nullptr
+                               : descs[parent - first].type != CSSOM_NODE_ITEM;
+            if (!isContainer) {
+                throw std::invalid_argument("The parent of a node isn't a container");
+            }
+        }
+
+        tree->nodes.reserve(first + count);
+        for (size_t i = 0; i < count; i++) {
+            Item* item = TreeFormat::createItem(records[i], &tree->arena);
+            if (descs[i].parent != CSSOM_NO_NODE) {
+                static_cast<Layout*>(tree->nodes[descs[i].parent])->addItem(item);
+            }
+            if (nodes != nullptr) {
+                nodes[i] = static_cast<cssom_node>(tree->nodes.size());
+            }
+            tree->nodes.push_back(item);
+        }
+    });
+}
+
+int cssom_tree_update_nodes(cssom_tree* tree, const cssom_node* nodes, const cssom_node_desc* descs, size_t count) {
+    return guard(tree, [&] {
+        // The whole batch is checked before any node is updated.
+        checkArray(nodes, count, "nodes");
+        checkArray(descs, count, "descriptions");
+        std::vector<std::unique_ptr<Item>> prototypes;
+        prototypes.reserve(count);
+        for (size_t i = 0; i < count; i++) {
+            Item* item = tree->getNode(nodes[i]);
+            TreeFormat::NodeRecord record = toRecord(descs[i]);
+            if (record.type != TreeFormat::getNodeType(*item)) {
+                throw std::invalid_argument("The type of node " + std::to_string(nodes[i]) + " can't change");
+            }
+            prototypes.emplace_back(TreeFormat::createItem(record, nullptr));
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            tree->getNode(nodes[i])->resetAttributes(*prototypes[i]);
+        }
+    });
+}
+
+int cssom_tree_layout(cssom_tree* tree, const cssom_node* roots, const int32_t* width_specs,
+                      const int32_t* height_specs, size_t count) {
+    return guard(tree, [&] {
+        // The whole batch is checked before any root is laid out.
+        checkArray(roots, count, "roots");
+        checkArray(width_specs, count, "width specs");
+        checkArray(height_specs, count, "height specs");
+        for (size_t i = 0; i < count; i++) {
+            tree->getNode(roots[i]);
+            checkMeasureSpec(width_specs[i]);
+            checkMeasureSpec(height_specs[i]);
+        }
+        for (size_t i = 0; i < count; i++) {
+            Item* root = tree->nodes[roots[i]];
+            root->measure(width_specs[i], height_specs[i]);
+            root->layout(0, 0, root->getMeasuredWidth() & Item::MEASURED_SIZE_MASK,
+                         root->getMeasuredHeight() & Item::MEASURED_SIZE_MASK);
+        }
+    });
+}
+
+int cssom_tree_get_frames(const cssom_tree* tree, const cssom_node* nodes, size_t count, cssom_frame* frames) {
+    return guard(tree, [&] {
+        // The whole batch is checked before any frame is written.
+        checkArray(frames, count, "frames");
+        if (nodes == nullptr && count > tree->nodes.size()) {
+            throw std::invalid_argument("Only " + std::to_string(tree->nodes.size()) + " nodes");
+        }
+        for (size_t i = 0; nodes != nullptr && i < count; i++) {
+            tree->getNode(nodes[i]);
+        }
+        for (size_t i = 0; i < count; i++) {
+            const Item* item = tree->nodes[nodes != nullptr ? nodes[i] : i];
+            frames[i] = {item->getLeft(), item->getTop(), item->getRight() - item->getLeft(),
+                         item->getBottom() - item->getTop()};
+        }
+    });
+}
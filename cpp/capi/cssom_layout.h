@@ -0,0 +1,189 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+/*
+ * The C API of the layout engine, for hosts embedding it through an FFI.
+ *
+ * The calls work on batches: nodes are created and updated from arrays of descriptions, many
+ * roots are laid out in one call and the frames are read back into an array, so that the cost of
+ * crossing the FFI is paid per batch rather than per node. The nodes of a tree are identified by
+ * handles, their index in the order of creation, and all live until the tree is destroyed.
+ *
+ * The functions returning an int return CSSOM_OK, or CSSOM_INVALID_ARGUMENT after which
+ * cssom_tree_last_error() describes the error: an unknown handle, class or constant, a value out
+ * of range or a null array. A batch is checked as a whole before any node is created, updated or
+ * laid out and before any frame is read, so a call failing changes nothing. A tree must only be
+ * used by one thread at a time, always the same one.
+ */
+
+#ifndef CSSOM_LAYOUT_H
+#define CSSOM_LAYOUT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#  if defined(CSSOM_LAYOUT_BUILD)
+#    define CSSOM_LAYOUT_API __declspec(dllexport)
+#  else
+#    define CSSOM_LAYOUT_API __declspec(dllimport)
+#  endif
+#else
+#  define CSSOM_LAYOUT_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Changed whenever a struct or a function changes in an incompatible way. */
+#define CSSOM_LAYOUT_ABI_VERSION 1
+
+#define CSSOM_OK 0
+#define CSSOM_INVALID_ARGUMENT 1
+
+/** The handle of no node, e.g. the parent of a root. */
+#define CSSOM_NO_NODE (-1)
+
+/* The classes of the nodes. */
+#define CSSOM_NODE_ITEM 0
+#define CSSOM_NODE_FLEX_LAYOUT 1
+#define CSSOM_NODE_LINEAR_LAYOUT 2
+#define CSSOM_NODE_FLOW_LAYOUT 3
+
+/* The modes of the measure specs. */
+#define CSSOM_SPEC_UNSPECIFIED 0
+#define CSSOM_SPEC_EXACTLY (1 << 30)
+#define CSSOM_SPEC_AT_MOST (2 << 30)
+
+/* The sizes a node asks for, besides a number of pixels. */
+#define CSSOM_MATCH_PARENT (-1)
+#define CSSOM_WRAP_CONTENT (-2)
+
+typedef struct cssom_tree cssom_tree;
+
+typedef int32_t cssom_node;
+
+/**
+ * The class and the attributes of a node, initialized to the defaults of its class by
+ * cssom_node_desc_init(). The attributes of the containers are ignored for the other classes.
+ */
+typedef struct cssom_node_desc {
+    uint32_t type;
+
+    /** The container the node is added to, last, when created; ignored by the updates. */
+    cssom_node parent;
+
+    int32_t order;
+    int32_t align_self;
+    int32_t min_width;
+    int32_t min_height;
+    int32_t max_width;
+    int32_t max_height;
+    int32_t width;
+    int32_t height;
+    int32_t margin_left;
+    int32_t margin_top;
+    int32_t margin_right;
+    int32_t margin_bottom;
+    int32_t padding_left;
+    int32_t padding_top;
+    int32_t padding_right;
+    int32_t padding_bottom;
+    int32_t visibility;
+    int32_t wrap_before;
+    float flex_grow;
+    float flex_shrink;
+    float flex_basis_percent;
+    float width_percent;
+    float height_percent;
+    float weight;
+    int32_t resize_mode;
+    int32_t layout_sharing;
+
+    /* CSSOM_NODE_FLEX_LAYOUT */
+    int32_t flex_direction;
+    int32_t flex_wrap;
+    int32_t justify_content;
+    int32_t align_items;
+    int32_t align_content;
+    int32_t max_line;
+
+    /* CSSOM_NODE_LINEAR_LAYOUT */
+    int32_t orientation;
+    float weight_sum;
+    int32_t use_largest_child;
+    int32_t show_dividers;
+    int32_t divider_width;
+    int32_t divider_height;
+
+    /* CSSOM_NODE_FLOW_LAYOUT */
+    int32_t line_spacing;
+    int32_t item_spacing;
+    int32_t single_line;
+} cssom_node_desc;
+
+/** The frame of a node, relative to its container. */
+typedef struct cssom_frame {
+    int32_t left;
+    int32_t top;
+    int32_t width;
+    int32_t height;
+} cssom_frame;
+
+/** Returns CSSOM_LAYOUT_ABI_VERSION as the library was built. */
+CSSOM_LAYOUT_API int cssom_layout_abi_version(void);
+
+CSSOM_LAYOUT_API int32_t cssom_make_measure_spec(int32_t size, int32_t mode);
+
+/**
+ * Sets the description to the defaults of the class, e.g. a size wrapping the content, with no
+ * parent.
+ */
+CSSOM_LAYOUT_API int cssom_node_desc_init(cssom_node_desc* desc, uint32_t type);
+
+CSSOM_LAYOUT_API cssom_tree* cssom_tree_create(void);
+
+CSSOM_LAYOUT_API void cssom_tree_destroy(cssom_tree* tree);
+
+/** Returns the message of the last error of the tree, valid until its next call. */
+CSSOM_LAYOUT_API const char* cssom_tree_last_error(const cssom_tree* tree);
+
+CSSOM_LAYOUT_API size_t cssom_tree_node_count(const cssom_tree* tree);
+
+/**
+ * Creates count nodes, in order, and stores their handles into nodes if it isn't null. The handles
+ * are allocated in sequence from cssom_tree_node_count(), so a node can be the parent of the ones
+ * following it in the same batch.
+ */
+CSSOM_LAYOUT_API int cssom_tree_create_nodes(cssom_tree* tree, const cssom_node_desc* descs, size_t count,
+                                             cssom_node* nodes);
+
+/**
+ * Sets the attributes of count nodes; the class of a node can't change. Only the nodes whose
+ * attributes differ are laid out again.
+ */
+CSSOM_LAYOUT_API int cssom_tree_update_nodes(cssom_tree* tree, const cssom_node* nodes,
+                                             const cssom_node_desc* descs, size_t count);
+
+/**
+ * Measures and lays out count roots with their specs, each one at the origin.
+ */
+CSSOM_LAYOUT_API int cssom_tree_layout(cssom_tree* tree, const cssom_node* roots, const int32_t* width_specs,
+                                       const int32_t* height_specs, size_t count);
+
+/**
+ * Reads the frames of count nodes into frames, or of the count first nodes if nodes is null.
+ */
+CSSOM_LAYOUT_API int cssom_tree_get_frames(const cssom_tree* tree, const cssom_node* nodes, size_t count,
+                                           cssom_frame* frames);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CSSOM_LAYOUT_H */
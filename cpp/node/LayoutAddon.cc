@@ -0,0 +1,176 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <exception>
+#include <node_api.h>
+#include "NativeTree.h"
+
+/*
+ * The Node.js binding of NativeTree:
+ *
+ *   const tree = new addon.LayoutTree();
+ *   tree.apply(ops);                                  // a Float64Array
+ *   const frames = tree.layout(root, widthSpec, heightSpec); // an Int32Array
+ *
+ * The addon also exports the constants of the messages: ops, types, attributes (the names of
+ * the attribute indices) and MeasureSpec. See native-layout.js for the encoder of the messages.
+ */
+
+#define NAPI_CALL(env, call)                                               \
+    do {                                                                   \
+        if ((call) != napi_ok) {                                           \
+            napi_throw_error((env), nullptr, "N-API call failed: " #call); \
+            return nullptr;                                                \
+        }                                                                  \
+    } while (0)
+
+/**
+ * Gets the tree and the arguments of a method call.
+ */
+static NativeTree* getTree(napi_env env, napi_callback_info info, size_t count, napi_value* args) {
+    napi_value self;
+    size_t argc = count;
+    NAPI_CALL(env, napi_get_cb_info(env, info, &argc, args, &self, nullptr));
+    if (argc < count) {
+        napi_throw_type_error(env, nullptr, "Missing arguments");
+        return nullptr;
+    }
+    void* tree = nullptr;
+    NAPI_CALL(env, napi_unwrap(env, self, &tree));
+    return static_cast<NativeTree*>(tree);
+}
+
+/**
+ * Runs a call on the tree, turning its exceptions into JS errors.
+ */
+template<typename Call>
+static bool run(napi_env env, Call call) {
+    try {
+        call();
+        return true;
+    } catch (const std::exception& e) {
+        napi_throw_error(env, nullptr, e.what());
+        return false;
+    }
+}
+
+static napi_value construct(napi_env env, napi_callback_info info) {
+    napi_value self;
+    NAPI_CALL(env, napi_get_cb_info(env, info, nullptr, nullptr, &self, nullptr));
+    auto tree = new NativeTree();
+    napi_status status = napi_wrap(env, self, tree, [](napi_env, void* data, void*) {
+        delete static_cast<NativeTree*>(data);
+    }, nullptr, nullptr);
+    if (status != napi_ok) {
+        delete tree;
+        napi_throw_error(env, nullptr, "Can't wrap the layout tree");
+        return nullptr;
+    }
+    return self;
+}
+
+static napi_value apply(napi_env env, napi_callback_info info) {
+    napi_value args[1];
+    NativeTree* tree = getTree(env, info, 1, args);
+    if (tree == nullptr) {
+        return nullptr;
+    }
+    napi_typedarray_type type;
+    size_t length = 0;
+    void* data = nullptr;
+    bool isTypedArray = false;
+    NAPI_CALL(env, napi_is_typedarray(env, args[0], &isTypedArray));
+    if (isTypedArray) {
+        NAPI_CALL(env, napi_get_typedarray_info(env, args[0], &type, &length, &data, nullptr, nullptr));
+    }
+    if (!isTypedArray || type != napi_float64_array) {
+        napi_throw_type_error(env, nullptr, "The operations aren't a Float64Array");
+        return nullptr;
+    }
+    run(env, [&] { tree->apply(static_cast<const double*>(data), length); });
+    return nullptr;
+}
+
+static napi_value layout(napi_env env, napi_callback_info info) {
+    napi_value args[3];
+    NativeTree* tree = getTree(env, info, 3, args);
+    if (tree == nullptr) {
+        return nullptr;
+    }
+    int32_t root;
+    int32_t widthMeasureSpec;
+    int32_t heightMeasureSpec;
+    NAPI_CALL(env, napi_get_value_int32(env, args[0], &root));
+    NAPI_CALL(env, napi_get_value_int32(env, args[1], &widthMeasureSpec));
+    NAPI_CALL(env, napi_get_value_int32(env, args[2], &heightMeasureSpec));
+    if (!run(env, [&] { tree->layout(root, widthMeasureSpec, heightMeasureSpec); })) {
+        return nullptr;
+    }
+    size_t length = tree->getFrameCount() * NativeTree::FRAME_SIZE;
+    void* data = nullptr;
+    napi_value buffer;
+    napi_value frames;
+    NAPI_CALL(env, napi_create_arraybuffer(env, length * sizeof(int32_t), &data, &buffer));
+    tree->getFrames(static_cast<int32_t*>(data));
+    NAPI_CALL(env, napi_create_typedarray(env, napi_int32_array, length, buffer, 0, &frames));
+    return frames;
+}
+
+static napi_status setInt(napi_env env, napi_value object, const char* name, int32_t value) {
+    napi_value number;
+    napi_status status = napi_create_int32(env, value, &number);
+    return status != napi_ok ? status : napi_set_named_property(env, object, name, number);
+}
+
+static napi_value init(napi_env env, napi_value exports) {
+    napi_property_descriptor methods[] = {
+            {"apply", nullptr, apply, nullptr, nullptr, nullptr, napi_default, nullptr},
+            {"layout", nullptr, layout, nullptr, nullptr, nullptr, napi_default, nullptr},
+    };
+    napi_value layoutTree;
+    NAPI_CALL(env, napi_define_class(env, "LayoutTree", NAPI_AUTO_LENGTH, construct, nullptr, 2, methods,
+                                     &layoutTree));
+    NAPI_CALL(env, napi_set_named_property(env, exports, "LayoutTree", layoutTree));
+
+    napi_value ops;
+    NAPI_CALL(env, napi_create_object(env, &ops));
+    NAPI_CALL(env, setInt(env, ops, "CREATE", NativeTree::CREATE));
+    NAPI_CALL(env, setInt(env, ops, "SET", NativeTree::SET));
+    NAPI_CALL(env, setInt(env, ops, "INSERT", NativeTree::INSERT));
+    NAPI_CALL(env, setInt(env, ops, "REMOVE", NativeTree::REMOVE));
+    NAPI_CALL(env, setInt(env, ops, "DESTROY", NativeTree::DESTROY));
+    NAPI_CALL(env, napi_set_named_property(env, exports, "ops", ops));
+
+    napi_value types;
+    NAPI_CALL(env, napi_create_object(env, &types));
+    NAPI_CALL(env, setInt(env, types, "Item", NativeTree::TYPE_ITEM));
+    NAPI_CALL(env, setInt(env, types, "FlexLayout", NativeTree::TYPE_FLEX_LAYOUT));
+    NAPI_CALL(env, setInt(env, types, "LinearLayout", NativeTree::TYPE_LINEAR_LAYOUT));
+    NAPI_CALL(env, setInt(env, types, "FlowLayout", NativeTree::TYPE_FLOW_LAYOUT));
+    NAPI_CALL(env, napi_set_named_property(env, exports, "types", types));
+
+    napi_value measureSpec;
+    NAPI_CALL(env, napi_create_object(env, &measureSpec));
+    NAPI_CALL(env, setInt(env, measureSpec, "UNSPECIFIED", Item::MeasureSpec::UNSPECIFIED));
+    NAPI_CALL(env, setInt(env, measureSpec, "EXACTLY", Item::MeasureSpec::EXACTLY));
+    NAPI_CALL(env, setInt(env, measureSpec, "AT_MOST", Item::MeasureSpec::AT_MOST));
+    NAPI_CALL(env, setInt(env, measureSpec, "MODE_MASK", Item::MeasureSpec::MODE_MASK));
+    NAPI_CALL(env, napi_set_named_property(env, exports, "MeasureSpec", measureSpec));
+
+    auto& names = NativeTree::getAttributeNames();
+    napi_value attributes;
+    NAPI_CALL(env, napi_create_array_with_length(env, names.size(), &attributes));
+    for (size_t i = 0; i < names.size(); i++) {
+        napi_value name;
+        NAPI_CALL(env, napi_create_string_utf8(env, names[i].c_str(), names[i].size(), &name));
+        NAPI_CALL(env, napi_set_element(env, attributes, static_cast<uint32_t>(i), name));
+    }
+    NAPI_CALL(env, napi_set_named_property(env, exports, "attributes", attributes));
+    return exports;
+}
+
+NAPI_MODULE(NODE_GYP_MODULE_NAME, init)
@@ -0,0 +1,327 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <stdexcept>
+#include <unordered_map>
+#include "NativeTree.h"
+#include "FlexLayout.h"
+#include "FlowLayout.h"
+#include "JsonTreeLoader.h"
+#include "LayoutTransaction.h"
+#include "LinearLayout.h"
+#include "TreeFormat.h"
+
+static_assert(NativeTree::TYPE_ITEM == TreeFormat::NodeType::ITEM
+              && NativeTree::TYPE_FLEX_LAYOUT == TreeFormat::NodeType::FLEX_LAYOUT
+              && NativeTree::TYPE_LINEAR_LAYOUT == TreeFormat::NodeType::LINEAR_LAYOUT
+              && NativeTree::TYPE_FLOW_LAYOUT == TreeFormat::NodeType::FLOW_LAYOUT,
+              "The types of the nodes are the ones of the tree format");
+
+static void detach(Item* item) {
+    auto parent = static_cast<Layout*>(item->getParent());
+    if (parent != nullptr) {
+        parent->removeItemAt(parent->indexOfChild(item));
+    }
+}
+
+static const std::vector<JsonTreeLoader::Setter>& getSetters() {
+    static const std::vector<JsonTreeLoader::Setter> setters = [] {
+        std::vector<JsonTreeLoader::Setter> result;
+        for (auto& name : NativeTree::getAttributeNames()) {
+            result.push_back(JsonTreeLoader::findAttribute(name));
+        }
+        return result;
+    }();
+    return setters;
+}
+
+/**
+ * @return a new item of the type, or null if the type is unknown
+ */
+static Item* newNode(int type) {
+    switch (type) {
+        case NativeTree::TYPE_ITEM:
+            return new Item();
+        case NativeTree::TYPE_FLEX_LAYOUT:
+            return new FlexLayout();
+        case NativeTree::TYPE_LINEAR_LAYOUT:
+            return new LinearLayout();
+        case NativeTree::TYPE_FLOW_LAYOUT:
+            return new FlowLayout();
+        default:
+            return nullptr;
+    }
+}
+
+bool NativeTree::hasAttribute(int type, int attribute) {
+    static const std::vector<std::vector<bool>> attributes = [] {
+        std::vector<std::vector<bool>> result;
+        for (int type = TYPE_ITEM; type <= TYPE_FLOW_LAYOUT; type++) {
+            std::unique_ptr<Item> item(newNode(type));
+            result.emplace_back();
+            for (auto setter : getSetters()) {
+                // 0 is a valid value of every attribute, a setter only rejects it for another class.
+                try {
+                    setter(item.get(), 0);
+                    result.back().push_back(true);
+                } catch (const std::invalid_argument&) {
+                    result.back().push_back(false);
+                }
+            }
+        }
+        return result;
+    }();
+    return attributes[type][attribute];
+}
+
+const std::vector<std::string>& NativeTree::getAttributeNames() {
+    static const std::vector<std::string> names = JsonTreeLoader::getAttributeNames();
+    return names;
+}
+
+void NativeTree::check(const double* ops, size_t count) const {
+    /** A node as the operations checked so far leave it */
+    struct State {
+        bool exists = false;
+        int type = TYPE_ITEM;
+        /** Incremented when the node is created or released, which detaches its children */
+        unsigned int generation = 0;
+        int parent = -1;
+        unsigned int parentGeneration = 0;
+        int childCount = 0;
+    };
+    std::unordered_map<int, State> states;
+    auto stateOf = [&](double operand) -> State& {
+        int node = toInt(operand);
+        if (node < 0 || static_cast<size_t>(node) > mNodes.size() + count) {
+            throw std::invalid_argument("Invalid node " + std::to_string(node));
+        }
+        auto it = states.find(node);
+        if (it != states.end()) {
+            return it->second;
+        }
+        State state;
+        if (static_cast<size_t>(node) < mNodes.size() && mNodes[node] != nullptr) {
+            Item* item = mNodes[node].get();
+            state.exists = true;
+            state.type = static_cast<int>(TreeFormat::getNodeType(*item));
+            state.parent = item->getParent() != nullptr ? item->getParent()->getId() : -1;
+            auto layout = dynamic_cast<Layout*>(item);
+            state.childCount = layout != nullptr ? layout->getChildCount() : 0;
+        }
+        return states.emplace(node, state).first->second;
+    };
+    auto existing = [&](double operand) -> State& {
+        State& state = stateOf(operand);
+        if (!state.exists) {
+            throw std::invalid_argument("Invalid node " + std::to_string(toInt(operand)));
+        }
+        return state;
+    };
+    // The container of a node, unless it has been released since the node was inserted.
+    auto parentOf = [&](const State& state) -> State* {
+        if (state.parent == -1) {
+            return nullptr;
+        }
+        State& parent = stateOf(state.parent);
+        return parent.exists && parent.generation == state.parentGeneration ? &parent : nullptr;
+    };
+    auto detach = [&](State& state) {
+        if (State* parent = parentOf(state)) {
+            parent->childCount--;
+        }
+        state.parent = -1;
+    };
+
+    // The attributes are set on scratch nodes, whose records must stay valid.
+    std::vector<std::unique_ptr<Item>> scratch;
+    for (int type = TYPE_ITEM; type <= TYPE_FLOW_LAYOUT; type++) {
+        scratch.emplace_back(newNode(type));
+    }
+    size_t i = 0;
+    auto operands = [&](size_t n) {
+        if (count - i < n + 1) {
+            throw std::invalid_argument("Truncated operation at " + std::to_string(i));
+        }
+        const double* operation = ops + i + 1;
+        i += n + 1;
+        return operation;
+    };
+    while (i < count) {
+        switch (toInt(ops[i])) {
+            case CREATE: {
+                const double* args = operands(2);
+                State& state = stateOf(args[0]);
+                if (state.exists) {
+                    throw std::invalid_argument("The node " + std::to_string(toInt(args[0])) + " already exists");
+                }
+                int type = toInt(args[1]);
+                if (type < TYPE_ITEM || type > TYPE_FLOW_LAYOUT) {
+                    throw std::invalid_argument("Invalid type " + std::to_string(type));
+                }
+                state.exists = true;
+                state.type = type;
+                state.generation++;
+                state.parent = -1;
+                state.childCount = 0;
+                break;
+            }
+            case SET: {
+                const double* args = operands(3);
+                const State& state = existing(args[0]);
+                int attribute = toInt(args[1]);
+                if (attribute < 0 || static_cast<size_t>(attribute) >= getSetters().size()) {
+                    throw std::invalid_argument("Invalid attribute " + std::to_string(attribute));
+                }
+                if (!hasAttribute(state.type, attribute)) {
+                    break;
+                }
+                // The attributes are ints or floats, converting a larger value is undefined.
+                if (!(args[2] >= INT32_MIN && args[2] <= INT32_MAX)) {
+                    throw std::invalid_argument("The value of the attribute " + getAttributeNames()[attribute]
+                                                + " is out of range");
+                }
+                Item* item = scratch[state.type].get();
+                getSetters()[attribute](item, args[2]);
+                TreeFormat::NodeRecord record;
+                TreeFormat::writeRecord(item, record);
+                record.childCount = 0;
+                TreeFormat::checkRecord(record);
+                break;
+            }
+            case INSERT: {
+                const double* args = operands(3);
+                State& parent = existing(args[0]);
+                State& state = existing(args[1]);
+                int index = toInt(args[2]);
+                if (parent.type == TYPE_ITEM) {
+                    throw std::invalid_argument("The parent of a node isn't a container");
+                }
+                if (parentOf(state) != nullptr) {
+                    throw std::invalid_argument("The node " + std::to_string(toInt(args[1])) + " already has a parent");
+                }
+                for (State* ancestor = &parent; ancestor != nullptr; ancestor = parentOf(*ancestor)) {
+                    if (ancestor == &state) {
+                        throw std::invalid_argument("The node " + std::to_string(toInt(args[1]))
+                                                    + " contains its parent");
+                    }
+                }
+                if (index < -1 || index > parent.childCount) {
+                    throw std::invalid_argument("Invalid index " + std::to_string(index));
+                }
+                state.parent = toInt(args[0]);
+                state.parentGeneration = parent.generation;
+                parent.childCount++;
+                break;
+            }
+            case REMOVE:
+                detach(existing(operands(1)[0]));
+                break;
+            case DESTROY: {
+                State& state = existing(operands(1)[0]);
+                detach(state);
+                state.exists = false;
+                state.generation++;
+                break;
+            }
+            default:
+                throw std::invalid_argument("Invalid operation at " + std::to_string(i));
+        }
+    }
+}
+
+void NativeTree::apply(const double* ops, size_t count) {
+    check(ops, count);
+    // The released nodes are deleted after the transaction, which may still refer to them.
+    std::vector<std::unique_ptr<Item>> released;
+    LayoutTransaction transaction;
+    for (size_t i = 0; i < count;) {
+        const double* args = ops + i + 1;
+        switch (toInt(ops[i])) {
+            case CREATE: {
+                int node = toInt(args[0]);
+                if (static_cast<size_t>(node) >= mNodes.size()) {
+                    mNodes.resize(node + 1);
+                }
+                mNodes[node].reset(newNode(toInt(args[1])));
+                // The container of a node is found by its id when a message is checked.
+                mNodes[node]->setId(node);
+                i += 3;
+                break;
+            }
+            case SET: {
+                Item* item = getNode(args[0]);
+                int attribute = toInt(args[1]);
+                // Not an attribute of the class of the node, e.g. a padding set on an item.
+                if (hasAttribute(static_cast<int>(TreeFormat::getNodeType(*item)), attribute)) {
+                    getSetters()[attribute](item, args[2]);
+                }
+                i += 4;
+                break;
+            }
+            case INSERT: {
+                auto parent = static_cast<Layout*>(getNode(args[0]));
+                int index = toInt(args[2]);
+                parent->addItem(getNode(args[1]), index == -1 ? parent->getChildCount() : index);
+                i += 4;
+                break;
+            }
+            case REMOVE:
+                detach(getNode(args[0]));
+                i += 2;
+                break;
+            default: {
+                int node = toInt(args[0]);
+                Item* item = getNode(node);
+                detach(item);
+                if (auto layout = dynamic_cast<Layout*>(item)) {
+                    layout->removeAllItems();
+                }
+                released.push_back(std::move(mNodes[node]));
+                i += 2;
+                break;
+            }
+        }
+    }
+}
+
+void NativeTree::layout(int root, int widthMeasureSpec, int heightMeasureSpec) {
+    Item* item = getNode(root);
+    item->measure(widthMeasureSpec, heightMeasureSpec);
+    item->layout(0, 0, item->getMeasuredWidth() & Item::MEASURED_SIZE_MASK,
+                 item->getMeasuredHeight() & Item::MEASURED_SIZE_MASK);
+}
+
+void NativeTree::getFrames(int32_t* frames) const {
+    for (auto& node : mNodes) {
+        if (node != nullptr) {
+            frames[0] = node->getLeft();
+            frames[1] = node->getTop();
+            frames[2] = node->getRight() - node->getLeft();
+            frames[3] = node->getBottom() - node->getTop();
+        } else {
+            frames[0] = frames[1] = frames[2] = frames[3] = 0;
+        }
+        frames += FRAME_SIZE;
+    }
+}
+
+Item* NativeTree::getNode(double node) const {
+    int index = toInt(node);
+    if (index < 0 || static_cast<size_t>(index) >= mNodes.size() || mNodes[index] == nullptr) {
+        throw std::invalid_argument("Invalid node " + std::to_string(index));
+    }
+    return mNodes[index].get();
+}
+
+int NativeTree::toInt(double value) {
+    // Also rejects NaN.
+    if (!(value >= INT32_MIN && value <= INT32_MAX)) {
+        throw std::invalid_argument("Invalid operand " + std::to_string(value));
+    }
+    return static_cast<int>(value);
+}
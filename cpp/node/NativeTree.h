@@ -0,0 +1,107 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Item.h"
+
+/**
+ * The native mirror of a tree of views, updated by batched diff messages rather than a call per
+ * attribute. A message is a sequence of operations packed in doubles, each an opcode followed by
+ * its operands:
+ *
+ * <pre>
+ * CREATE  node type            the node is new, type is one of the TYPE_ constants
+ * SET     node attribute value the attribute is an index in {@link #getAttributeNames()}
+ * INSERT  parent node index    index is -1 to append the node
+ * REMOVE  node                 removes the node from its container
+ * DESTROY node                 the node is removed from its container and released
+ * </pre>
+ *
+ * A SET of an attribute the class of the node doesn't have is ignored, as CSS ignores the
+ * properties which don't apply to an element.
+ *
+ * The nodes are small integers chosen by the sender, so the frames of a layout can be returned
+ * as an array indexed by node: a node created by a message is at most the frame count plus the
+ * number of doubles of the message. A message is checked as a whole before any of it is applied,
+ * and its invalidations are applied once when it has been applied, see {@link LayoutTransaction}.
+ */
+class NativeTree {
+public:
+    static constexpr int CREATE = 0;
+    static constexpr int SET = 1;
+    static constexpr int INSERT = 2;
+    static constexpr int REMOVE = 3;
+    static constexpr int DESTROY = 4;
+
+    static constexpr int TYPE_ITEM = 0;
+    static constexpr int TYPE_FLEX_LAYOUT = 1;
+    static constexpr int TYPE_LINEAR_LAYOUT = 2;
+    static constexpr int TYPE_FLOW_LAYOUT = 3;
+
+    /**
+     * The number of ints of a frame: left, top, width and height.
+     */
+    static constexpr int FRAME_SIZE = 4;
+
+    /**
+     * Applies a message, or nothing of it if one of its operations is invalid.
+     *
+     * @param ops   the operations
+     * @param count the number of doubles of the message
+     * @throws std::invalid_argument if an operation is truncated or invalid, e.g. a node too
+     * large, an insertion making a cycle or the value of an attribute out of its range
+     */
+    void apply(const double* ops, size_t count);
+
+    /**
+     * Measures and lays out the subtree of the node, placed at the origin.
+     */
+    void layout(int root, int widthMeasureSpec, int heightMeasureSpec);
+
+    /**
+     * @return the number of frames {@link #getFrames(int32_t*)} writes, one more than the largest
+     *         node created
+     */
+    size_t getFrameCount() const { return mNodes.size(); }
+
+    /**
+     * Writes the frames of the nodes, those of the released nodes being zero.
+     *
+     * @param frames {@link #FRAME_SIZE} ints per frame
+     */
+    void getFrames(int32_t* frames) const;
+
+    /**
+     * @return the names of the attributes of the SET operation, in the order of their indices
+     */
+    static const std::vector<std::string>& getAttributeNames();
+
+private:
+    std::vector<std::unique_ptr<Item>> mNodes;
+
+    /**
+     * Runs the operations of the message against the state of the nodes they touch, as they
+     * would be applied, without changing any node.
+     *
+     * @throws std::invalid_argument as {@link #apply(const double*, size_t)}
+     */
+    void check(const double* ops, size_t count) const;
+
+    Item* getNode(double node) const;
+
+    /**
+     * @return whether the attribute applies to the nodes of the type
+     */
+    static bool hasAttribute(int type, int attribute);
+
+    static int toInt(double value);
+};
@@ -0,0 +1,69 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+/**
+ * The messages exchanged with the layout server, in the byte order of the host.
+ *
+ * A request is a {@link RequestHeader} followed by a tree in the {@link TreeFormat}, which may
+ * be omitted to lay out the tree last sent for the same template again. The response is a
+ * {@link ResponseHeader} followed, on success, by the frames of every item of the tree as
+ * written by {@link LayoutResultWriter}, the id of each item being its index in pre-order, or
+ * by the error message otherwise.
+ */
+struct LayoutProtocol {
+    struct Status {
+        static constexpr uint32_t OK = 0;
+        static constexpr uint32_t ERROR = 1;
+    };
+
+    struct RequestHeader {
+        /** "FLXQ" */
+        char magic[4];
+
+        /** Chosen by the client, returned in the response */
+        uint32_t requestId;
+
+        /**
+         * Identifies the tree, whose layout is kept between the requests. The templates are
+         * shared by all the connections of the server: the clients agree on their ids, and a
+         * tree sent for an id replaces the one another client sent for it.
+         */
+        uint32_t templateId;
+
+        int32_t widthMeasureSpec;
+        int32_t heightMeasureSpec;
+
+        /** The size of the tree following the header, 0 to reuse the tree of the template */
+        uint32_t treeSize;
+    };
+
+    struct ResponseHeader {
+        /** "FLXA" */
+        char magic[4];
+
+        uint32_t requestId;
+
+        /** One of {@link Status} */
+        uint32_t status;
+
+        /** The size of the payload following the header */
+        uint32_t size;
+    };
+
+    static constexpr char REQUEST_MAGIC[4] = {'F', 'L', 'X', 'Q'};
+    static constexpr char RESPONSE_MAGIC[4] = {'F', 'L', 'X', 'A'};
+
+    /**
+     * The largest tree accepted, about 80000 items: larger requests are rejected before being
+     * read, and close the connection.
+     */
+    static constexpr uint32_t MAX_TREE_SIZE = 16 * 1024 * 1024;
+};
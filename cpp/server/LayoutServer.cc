@@ -0,0 +1,267 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include "LayoutServer.h"
+#include "ItemArena.h"
+#include "Layout.h"
+#include "LayoutResultWriter.h"
+#include "TreeFormat.h"
+
+constexpr char LayoutProtocol::REQUEST_MAGIC[4];
+constexpr char LayoutProtocol::RESPONSE_MAGIC[4];
+
+/**
+ * The two ends of a client, closed once the requests read from it have all been answered.
+ */
+struct Connection {
+    int input;
+    int output;
+    bool ownsDescriptors;
+    std::mutex writeMutex;
+
+    Connection(int input, int output, bool ownsDescriptors)
+            : input(input), output(output), ownsDescriptors(ownsDescriptors) {}
+
+    ~Connection() {
+        if (ownsDescriptors) {
+            close(input);
+        }
+    }
+};
+
+static bool readFully(int fd, void* data, size_t size) {
+    char* next = static_cast<char*>(data);
+    while (size > 0) {
+        ssize_t count = read(fd, next, size);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            return false;
+        }
+        next += count;
+        size -= count;
+    }
+    return true;
+}
+
+static bool writeFully(int fd, const void* data, size_t size) {
+    const char* next = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t count = write(fd, next, size);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            return false;
+        }
+        next += count;
+        size -= count;
+    }
+    return true;
+}
+
+LayoutServer::Template::Template() = default;
+
+LayoutServer::Template::~Template() = default;
+
+/**
+ * Gives the items their index in pre-order as id.
+ *
+ * @return the number of items
+ */
+static size_t assignIds(Item* root) {
+    int id = 0;
+    std::vector<Item*> stack{root};
+    while (!stack.empty()) {
+        Item* item = stack.back();
+        stack.pop_back();
+        item->setId(id++);
+        if (auto layout = dynamic_cast<Layout*>(item)) {
+            for (int i = layout->getChildCount() - 1; i >= 0; i--) {
+                stack.push_back(layout->getChildAt(i));
+            }
+        }
+    }
+    return id;
+}
+
+/**
+ * @throws std::invalid_argument if the mode of the spec isn't one of Item::MeasureSpec, or its
+ *                               size is beyond Item::MAX_SIZE
+ */
+static void checkMeasureSpec(int measureSpec) {
+    int mode = Item::MeasureSpec::getMode(measureSpec);
+    if ((mode != Item::MeasureSpec::UNSPECIFIED && mode != Item::MeasureSpec::EXACTLY
+         && mode != Item::MeasureSpec::AT_MOST) || Item::MeasureSpec::getSize(measureSpec) > Item::MAX_SIZE) {
+        throw std::invalid_argument("Malformed measure spec " + std::to_string(measureSpec));
+    }
+}
+
+LayoutServer::LayoutServer(int workerCount) {
+    for (int i = 0; i < std::max(workerCount, 1); i++) {
+        mWorkers.emplace_back(new Worker());
+        Worker* worker = mWorkers.back().get();
+        worker->thread = std::thread(run, worker);
+    }
+}
+
+LayoutServer::~LayoutServer() {
+    for (auto& worker : mWorkers) {
+        {
+            std::lock_guard<std::mutex> lock(worker->mutex);
+            worker->stopping = true;
+        }
+        worker->condition.notify_one();
+    }
+    for (auto& worker : mWorkers) {
+        worker->thread.join();
+    }
+}
+
+void LayoutServer::submit(Request request) {
+    Worker* worker = mWorkers[request.header.templateId % mWorkers.size()].get();
+    {
+        std::unique_lock<std::mutex> lock(worker->mutex);
+        size_t size = request.tree.size();
+        worker->drained.wait(lock, [worker, size] {
+            return worker->queue.empty()
+                   || (worker->queue.size() < MAX_QUEUED_REQUESTS_PER_WORKER
+                       && worker->queuedBytes + size <= MAX_QUEUED_BYTES_PER_WORKER);
+        });
+        worker->queue.push_back(std::move(request));
+        worker->queuedBytes += size;
+    }
+    worker->condition.notify_one();
+}
+
+void LayoutServer::serve(int input, int output, bool ownsDescriptors) {
+    auto connection = std::make_shared<Connection>(input, output, ownsDescriptors);
+    for (;;) {
+        Request request;
+        if (!readFully(connection->input, &request.header, sizeof(request.header))) {
+            return;
+        }
+        if (std::memcmp(request.header.magic, LayoutProtocol::REQUEST_MAGIC, sizeof(request.header.magic)) != 0
+            || request.header.treeSize > LayoutProtocol::MAX_TREE_SIZE) {
+            std::cerr << "layout_server: malformed request, closing the connection" << std::endl;
+            return;
+        }
+        request.tree.resize(request.header.treeSize);
+        if (!readFully(connection->input, request.tree.data(), request.tree.size())) {
+            return;
+        }
+        request.reply = [connection](const LayoutProtocol::ResponseHeader& header, const std::vector<char>& payload) {
+            std::lock_guard<std::mutex> lock(connection->writeMutex);
+            writeFully(connection->output, &header, sizeof(header))
+            && writeFully(connection->output, payload.data(), payload.size());
+        };
+        submit(std::move(request));
+    }
+}
+
+void LayoutServer::run(Worker* worker) {
+    std::vector<Request> batch;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(worker->mutex);
+            worker->condition.wait(lock, [worker] { return !worker->queue.empty() || worker->stopping; });
+            if (worker->queue.empty()) {
+                return;
+            }
+            batch.swap(worker->queue);
+            worker->queuedBytes = 0;
+        }
+        worker->drained.notify_all();
+        for (Request& request : batch) {
+            process(worker, request);
+        }
+        batch.clear();
+    }
+}
+
+void LayoutServer::process(Worker* worker, Request& request) {
+    LayoutProtocol::ResponseHeader header = {};
+    std::memcpy(header.magic, LayoutProtocol::RESPONSE_MAGIC, sizeof(header.magic));
+    header.requestId = request.header.requestId;
+    try {
+        const Template& laidOut = layoutTemplate(worker, request);
+        header.status = LayoutProtocol::Status::OK;
+        header.size = static_cast<uint32_t>(laidOut.frames.size());
+        request.reply(header, laidOut.frames);
+    } catch (const std::exception& e) {
+        // A malformed tree, or a failure such as std::bad_alloc, doesn't take the worker down.
+        std::vector<char> message(e.what(), e.what() + std::strlen(e.what()));
+        header.status = LayoutProtocol::Status::ERROR;
+        header.size = static_cast<uint32_t>(message.size());
+        request.reply(header, message);
+    }
+}
+
+LayoutServer::Template& LayoutServer::layoutTemplate(Worker* worker, const Request& request) {
+    checkMeasureSpec(request.header.widthMeasureSpec);
+    checkMeasureSpec(request.header.heightMeasureSpec);
+    uint32_t templateId = request.header.templateId;
+    auto it = worker->templates.find(templateId);
+    if (!request.tree.empty() && (it == worker->templates.end() || it->second.tree != request.tree)) {
+        // Read, and its records checked, before anything is replaced: a malformed tree leaves the
+        // template as it was.
+        std::unique_ptr<ItemArena> arena(new ItemArena());
+        Item* root = TreeFormat::read(request.tree.data(), request.tree.size(), arena.get());
+        if (it == worker->templates.end()) {
+            if (worker->templates.size() >= MAX_TEMPLATES_PER_WORKER) {
+                evictLeastRecentlyUsed(worker);
+            }
+            it = worker->templates.emplace(std::piecewise_construct, std::forward_as_tuple(templateId),
+                                           std::forward_as_tuple()).first;
+        }
+        Template& changed = it->second;
+        changed.tree = request.tree;
+        changed.arena = std::move(arena);
+        changed.root = root;
+        changed.itemCount = assignIds(root);
+        changed.frames.clear();
+    } else if (it == worker->templates.end()) {
+        throw std::invalid_argument("Unknown template " + std::to_string(templateId));
+    }
+
+    Template& laidOut = it->second;
+    laidOut.lastUse = ++worker->useCount;
+    int widthMeasureSpec = request.header.widthMeasureSpec;
+    int heightMeasureSpec = request.header.heightMeasureSpec;
+    if (laidOut.frames.empty() || widthMeasureSpec != laidOut.widthMeasureSpec
+        || heightMeasureSpec != laidOut.heightMeasureSpec) {
+        Item* root = laidOut.root;
+        root->measure(widthMeasureSpec, heightMeasureSpec);
+        root->layout(0, 0, root->getMeasuredWidth() & Item::MEASURED_SIZE_MASK,
+                     root->getMeasuredHeight() & Item::MEASURED_SIZE_MASK);
+        laidOut.frames.resize(sizeof(LayoutResultWriter::Header)
+                              + laidOut.itemCount * sizeof(LayoutResultWriter::Record));
+        LayoutResultWriter writer(laidOut.frames.data(), laidOut.frames.size());
+        writer.writeFrames(root);
+        laidOut.widthMeasureSpec = widthMeasureSpec;
+        laidOut.heightMeasureSpec = heightMeasureSpec;
+    }
+    return laidOut;
+}
+
+void LayoutServer::evictLeastRecentlyUsed(Worker* worker) {
+    auto leastRecent = worker->templates.begin();
+    for (auto it = worker->templates.begin(); it != worker->templates.end(); ++it) {
+        if (it->second.lastUse < leastRecent->second.lastUse) {
+            leastRecent = it;
+        }
+    }
+    worker->templates.erase(leastRecent);
+}
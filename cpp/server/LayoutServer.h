@@ -0,0 +1,139 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "LayoutProtocol.h"
+
+class Item;
+class ItemArena;
+
+/**
+ * Lays out the trees of the requests on a pool of worker threads, keeping each template's tree
+ * laid out between the requests.
+ *
+ * The requests of a template always go to the same worker, which owns its tree: the caches of
+ * the items, e.g. their measure caches, are tied to the measure passes of the thread measuring
+ * them. A worker takes all the requests queued since its last batch at once, and the requests
+ * for a template whose tree and specs haven't changed get the frames of the previous layout
+ * without measuring anything.
+ */
+class LayoutServer {
+public:
+    /**
+     * Called on a worker thread with the response to a request.
+     *
+     * @param header  the header of the response
+     * @param payload the frames or the error message
+     */
+    using Reply = std::function<void(const LayoutProtocol::ResponseHeader& header, const std::vector<char>& payload)>;
+
+    struct Request {
+        LayoutProtocol::RequestHeader header;
+        std::vector<char> tree;
+        Reply reply;
+    };
+
+    /** The number of templates a worker keeps laid out, the least recently used is dropped */
+    static constexpr size_t MAX_TEMPLATES_PER_WORKER = 256;
+
+    /**
+     * The number of requests and the bytes of trees queued for a worker, beyond which
+     * {@link #submit(Request)} waits for the worker to take its next batch.
+     */
+    static constexpr size_t MAX_QUEUED_REQUESTS_PER_WORKER = 1024;
+    static constexpr size_t MAX_QUEUED_BYTES_PER_WORKER = 4 * size_t(LayoutProtocol::MAX_TREE_SIZE);
+
+    /**
+     * @param workerCount the number of worker threads, at least 1
+     */
+    explicit LayoutServer(int workerCount);
+
+    /**
+     * Answers the requests already submitted, then stops the workers.
+     */
+    ~LayoutServer();
+
+    LayoutServer(const LayoutServer&) = delete;
+
+    LayoutServer& operator=(const LayoutServer&) = delete;
+
+    /**
+     * Queues the request, thread safe. Waits while the queue of its worker is full, so that a
+     * client sending requests faster than they are laid out stops being read.
+     */
+    void submit(Request request);
+
+    /**
+     * Reads the requests of a client and replies to them, until the client closes its end or
+     * sends a malformed request.
+     *
+     * @param input           the end the requests are read from
+     * @param output          the end the responses are written to
+     * @param ownsDescriptors whether to close the input once every request read is answered, the
+     *                        output being the same descriptor or owned by the caller
+     */
+    void serve(int input, int output, bool ownsDescriptors);
+
+private:
+    /** The tree of a template and its last layout */
+    struct Template {
+        std::vector<char> tree;
+        std::unique_ptr<ItemArena> arena;
+        Item* root = nullptr;
+        size_t itemCount = 0;
+        int widthMeasureSpec = 0;
+        int heightMeasureSpec = 0;
+        /** The frames of the last layout, empty if the tree has changed since */
+        std::vector<char> frames;
+        uint64_t lastUse = 0;
+
+        Template();
+
+        ~Template();
+    };
+
+    struct Worker {
+        std::mutex mutex;
+        std::condition_variable condition;
+        /** Notified when the worker takes the queue */
+        std::condition_variable drained;
+        std::vector<Request> queue;
+        size_t queuedBytes = 0;
+        bool stopping = false;
+        std::unordered_map<uint32_t, Template> templates;
+        uint64_t useCount = 0;
+        std::thread thread;
+    };
+
+    std::vector<std::unique_ptr<Worker>> mWorkers;
+
+    static void run(Worker* worker);
+
+    /**
+     * Replies with the frames of the tree, or with {@link LayoutProtocol#Status#ERROR} and the
+     * message of any exception thrown while reading or laying it out.
+     */
+    static void process(Worker* worker, Request& request);
+
+    /**
+     * @return the template of the request with its tree laid out for the specs
+     * @throws std::invalid_argument if the tree or the specs are malformed, or the tree is missing
+     *                               for a new template
+     */
+    static Template& layoutTemplate(Worker* worker, const Request& request);
+
+    static void evictLeastRecentlyUsed(Worker* worker);
+};
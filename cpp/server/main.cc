@@ -0,0 +1,96 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "LayoutServer.h"
+
+/**
+ * The most clients served at once, the next ones wait in the backlog of the socket.
+ */
+static constexpr int MAX_CONNECTIONS = 64;
+
+static int listenOn(const std::string& path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (fd < 0 || path.size() >= sizeof(address.sun_path)) {
+        return -1;
+    }
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    unlink(path.c_str());
+    if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int main(int argc, char** argv) {
+    std::string socketPath;
+    int workerCount = std::max(1u, std::thread::hardware_concurrency());
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--socket" && i + 1 < argc) {
+            socketPath = argv[++i];
+        } else if (arg == "--workers" && i + 1 < argc) {
+            workerCount = std::atoi(argv[++i]);
+        } else {
+            std::cerr << "usage: layout_server [--socket PATH] [--workers N]" << std::endl;
+            return 2;
+        }
+    }
+    // A client going away must not kill the server while its responses are written.
+    std::signal(SIGPIPE, SIG_IGN);
+
+    LayoutServer server(workerCount);
+    if (socketPath.empty()) {
+        server.serve(STDIN_FILENO, STDOUT_FILENO, false);
+        return 0;
+    }
+    int listener = listenOn(socketPath);
+    if (listener < 0) {
+        std::cerr << "layout_server: can't listen on " << socketPath << ": " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    std::mutex mutex;
+    std::condition_variable condition;
+    int connectionCount = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [&connectionCount] { return connectionCount < MAX_CONNECTIONS; });
+        }
+        int client = accept(listener, nullptr, nullptr);
+        if (client < 0) {
+            continue;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            connectionCount++;
+        }
+        std::thread([client, &server, &mutex, &condition, &connectionCount] {
+            server.serve(client, client, true);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                connectionCount--;
+            }
+            condition.notify_one();
+        }).detach();
+    }
+}
@@ -0,0 +1,290 @@
+const path = require('path');
+
+function loadAddon() {
+    return require(process.env.CSSOM_LAYOUT_ADDON || path.join(__dirname, 'build', 'cpp', 'cssom_layout.node'));
+}
+
+// The CSS keywords of the enum attributes, valued as the constants of FlexEnum.h and Item.h.
+const keywords = {
+    flexDirection: {'row': 0, 'row-reverse': 1, 'column': 2, 'column-reverse': 3},
+    flexWrap: {'nowrap': 0, 'wrap': 1, 'wrap-reverse': 2},
+    justifyContent: {'flex-start': 0, 'flex-end': 1, 'center': 2, 'space-between': 3, 'space-around': 4, 'space-evenly': 5},
+    alignItems: {'flex-start': 0, 'flex-end': 1, 'center': 2, 'baseline': 3, 'stretch': 4},
+    alignSelf: {'auto': -1, 'flex-start': 0, 'flex-end': 1, 'center': 2, 'baseline': 3, 'stretch': 4},
+    alignContent: {'flex-start': 0, 'flex-end': 1, 'center': 2, 'space-between': 3, 'space-around': 4, 'stretch': 5},
+    visibility: {'visible': 0, 'hidden': 4, 'invisible': 4, 'collapse': 8, 'gone': 8},
+    orientation: {'horizontal': 0, 'vertical': 1},
+    width: {'auto': -2, 'wrap_content': -2, 'match_parent': -1},
+    height: {'auto': -2, 'wrap_content': -2, 'match_parent': -1},
+};
+
+const sides = ['Top', 'Right', 'Bottom', 'Left'];
+
+/**
+ * Converts a resolved style value, e.g. '12px', 'center' or 8.
+ * @returns the number of the attribute, or undefined if the value can't be converted
+ */
+function toNumber(name, value) {
+    if (typeof value === 'number') {
+        return value;
+    }
+    if (typeof value === 'boolean') {
+        return value ? 1 : 0;
+    }
+    if (typeof value !== 'string') {
+        return undefined;
+    }
+    value = value.trim();
+    const names = keywords[name];
+    if (names && value in names) {
+        return names[value];
+    }
+    const number = parseFloat(value);
+    return isNaN(number) ? undefined : number;
+}
+
+/**
+ * Collects the layout attributes of the view, expanding the shorthands and the percentages.
+ */
+function collectAttributes(view, attributeNames) {
+    const attributes = {};
+    // The shorthands first, so that the sides set explicitly override them.
+    for (const shorthand of ['margin', 'padding']) {
+        const value = view[shorthand];
+        if (value === undefined || value === null || value === '') {
+            continue;
+        }
+        const values = String(value).trim().split(/\s+/).map((v) => toNumber(shorthand, v));
+        // top [right [bottom [left]]], as in CSS.
+        const expanded = [values[0], values[1] ?? values[0], values[2] ?? values[0], values[3] ?? values[1] ?? values[0]];
+        expanded.forEach((v, i) => {
+            if (v !== undefined) {
+                attributes[shorthand + sides[i]] = v;
+            }
+        });
+    }
+    for (const name of attributeNames) {
+        const value = view[name];
+        if (name === 'margin' || name === 'padding' || value === undefined || value === null || value === '') {
+            continue;
+        }
+        if ((name === 'width' || name === 'height') && typeof value === 'string' && value.trim().endsWith('%')) {
+            attributes[name] = keywords[name]['match_parent'];
+            attributes[name + 'Percent'] = parseFloat(value) / 100;
+            continue;
+        }
+        const number = toNumber(name, value);
+        if (number !== undefined) {
+            attributes[name] = number;
+        }
+    }
+    if (typeof view.flexBasis === 'string' && view.flexBasis.trim().endsWith('%')) {
+        attributes.flexBasisPercent = parseFloat(view.flexBasis) / 100;
+    }
+    return attributes;
+}
+
+/**
+ * The operations packed in a growable Float64Array, see NativeTree.h.
+ */
+class DiffEncoder {
+    constructor() {
+        this.buffer = new Float64Array(256);
+        this.length = 0;
+    }
+
+    push(op, a, b, c) {
+        if (this.length + 4 > this.buffer.length) {
+            const buffer = new Float64Array(this.buffer.length * 2);
+            buffer.set(this.buffer);
+            this.buffer = buffer;
+        }
+        const buffer = this.buffer;
+        buffer[this.length++] = op;
+        buffer[this.length++] = a;
+        if (b !== undefined) {
+            buffer[this.length++] = b;
+            if (c !== undefined) {
+                buffer[this.length++] = c;
+            }
+        }
+    }
+
+    take() {
+        const ops = this.buffer.subarray(0, this.length);
+        this.length = 0;
+        return ops;
+    }
+}
+
+/**
+ * Mirrors View trees into the native layout engine and lays them out there. Each sync diffs the
+ * views against what has been sent and ships the changes as one message, so the cost of a
+ * layout is proportional to what changed instead of a call per attribute.
+ *
+ * The layout attributes are read from the views, as the style scope sets them, named after the
+ * native setters (width, flexGrow, marginTop, justifyContent...). The class of a view's node is
+ * its layoutType, or its type name if it's one of the native classes; otherwise a view with
+ * children is a FlexLayout and a leaf an Item. An attribute the class doesn't take is ignored.
+ */
+class NativeLayout {
+    constructor(addon = loadAddon()) {
+        this._addon = addon;
+        this._tree = new addon.LayoutTree();
+        this._encoder = new DiffEncoder();
+        this._attributeIds = new Map(addon.attributes.map((name, i) => [name, i]));
+        this._nodes = [];
+        this._freeIds = [];
+        this._frames = null;
+        // The nodes of the collected views are released with the next message.
+        this._collected = [];
+        this._registry = new FinalizationRegistry((node) => this._collected.push(node));
+    }
+
+    /**
+     * Sends the changes of the tree of the view since the last sync. The native tree applies
+     * nothing of a message it rejects, e.g. for an attribute out of range, while the nodes here
+     * already hold its changes: the trees are then dropped, and the next sync sends it all again.
+     */
+    sync(root) {
+        try {
+            for (const node of this._collected) {
+                if (this._nodes[node.id] === node) {
+                    this._release(node);
+                }
+            }
+            this._collected.length = 0;
+            this._syncView(root);
+            this._tree.apply(this._encoder.take());
+        } catch (e) {
+            this._encoder.take();
+            this._tree = new this._addon.LayoutTree();
+            this._nodes = [];
+            this._freeIds = [];
+            this._frames = null;
+            throw e;
+        }
+    }
+
+    /**
+     * Syncs the tree of the view then measures and lays it out natively.
+     * @param root the root view
+     * @param width the exact width, or undefined to leave it unspecified
+     * @param height the exact height, or undefined to leave it unspecified
+     * @returns an Int32Array of left, top, width and height per node, see getFrame()
+     */
+    layout(root, width, height) {
+        this.sync(root);
+        const {EXACTLY, UNSPECIFIED, MODE_MASK} = this._addon.MeasureSpec;
+        const spec = (size) => (size === undefined ? UNSPECIFIED : (Math.max(0, Math.round(size)) & ~MODE_MASK) | EXACTLY);
+        this._frames = this._tree.layout(root._layoutNode.id, spec(width), spec(height));
+        return this._frames;
+    }
+
+    /**
+     * @returns the frame of the view relative to its parent in the last layout, or null
+     */
+    getFrame(view) {
+        const node = view._layoutNode;
+        if (!node || node.owner !== this || !this._frames || node.id * 4 >= this._frames.length) {
+            return null;
+        }
+        const frames = this._frames;
+        const i = node.id * 4;
+        return {left: frames[i], top: frames[i + 1], width: frames[i + 2], height: frames[i + 3]};
+    }
+
+    _getType(view) {
+        const types = this._addon.types;
+        if (view.layoutType in types) {
+            return types[view.layoutType];
+        }
+        if (view.typeName in types) {
+            return types[view.typeName];
+        }
+        return view.children.length > 0 ? types.FlexLayout : types.Item;
+    }
+
+    /**
+     * @returns the id of the node of the view
+     */
+    _syncView(view) {
+        const encoder = this._encoder;
+        const {CREATE, SET, INSERT, REMOVE} = this._addon.ops;
+        const type = this._getType(view);
+        const attributes = collectAttributes(view, this._addon.attributes);
+        let node = view._layoutNode;
+        if (node && node.owner === this && this._nodes[node.id] === node) {
+            // The native setters have no reset, so an attribute going back to its default, like a
+            // change of class, recreates the node.
+            let stale = node.type !== type;
+            for (const name in node.attributes) {
+                stale = stale || !(name in attributes);
+            }
+            if (stale) {
+                this._registry.unregister(node);
+                this._release(node);
+                node = null;
+            }
+        } else {
+            node = null;
+        }
+        if (!node) {
+            const id = this._freeIds.length > 0 ? this._freeIds.pop() : this._nodes.length;
+            node = {owner: this, id, type, attributes: {}, children: [], parent: -1};
+            this._nodes[id] = node;
+            view._layoutNode = node;
+            this._registry.register(view, node, node);
+            encoder.push(CREATE, id, type);
+        }
+        for (const name in attributes) {
+            if (node.attributes[name] !== attributes[name]) {
+                encoder.push(SET, node.id, this._attributeIds.get(name), attributes[name]);
+            }
+        }
+        node.attributes = attributes;
+
+        const children = view.children.map((child) => this._syncView(child));
+        const changed = children.length !== node.children.length || children.some((id, i) => id !== node.children[i]);
+        if (changed) {
+            for (const id of node.children) {
+                const child = this._nodes[id];
+                if (child && child.parent === node.id) {
+                    encoder.push(REMOVE, id);
+                    child.parent = -1;
+                }
+            }
+            for (const id of children) {
+                const child = this._nodes[id];
+                if (child.parent !== -1) {
+                    // Moved from another container, which hasn't been synced yet.
+                    encoder.push(REMOVE, id);
+                }
+                encoder.push(INSERT, node.id, id, -1);
+                child.parent = node.id;
+            }
+            node.children = children;
+        }
+        return node.id;
+    }
+
+    _release(node) {
+        this._encoder.push(this._addon.ops.DESTROY, node.id);
+        // The native node detaches itself and its children. Its id may be reused in the same
+        // container, which has to see its children change.
+        const parent = this._nodes[node.parent];
+        if (parent) {
+            parent.children = parent.children.filter((id) => id !== node.id);
+        }
+        for (const id of node.children) {
+            const child = this._nodes[id];
+            if (child && child.parent === node.id) {
+                child.parent = -1;
+            }
+        }
+        this._nodes[node.id] = undefined;
+        this._freeIds.push(node.id);
+    }
+}
+
+exports.NativeLayout = NativeLayout;
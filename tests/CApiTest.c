@@ -0,0 +1,159 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cssom_layout.h"
+
+/** A linear congruential generator, so that a seed gives the same batches everywhere. */
+static unsigned int next(unsigned int* state, unsigned int bound) {
+    *state = *state * 1103515245u + 12345u;
+    return (*state >> 16) % bound;
+}
+
+/**
+ * Sets a random field of the description to a value out of its range.
+ */
+static void corrupt(cssom_node_desc* desc, unsigned int* state) {
+    switch (next(state, 8)) {
+        case 0:
+            desc->type = 4;
+            break;
+        case 1:
+            desc->visibility = 3;
+            break;
+        case 2:
+            desc->align_self = 9;
+            break;
+        case 3:
+            desc->width = -3;
+            break;
+        case 4:
+            desc->margin_left = INT32_MIN;
+            break;
+        case 5:
+            desc->type = CSSOM_NODE_FLEX_LAYOUT;
+            desc->flex_direction = 4;
+            break;
+        case 6:
+            desc->type = CSSOM_NODE_LINEAR_LAYOUT;
+            desc->orientation = 2;
+            break;
+        default:
+            desc->type = CSSOM_NODE_LINEAR_LAYOUT;
+            desc->show_dividers = 8;
+            break;
+    }
+}
+
+/**
+ * Creates a random flat tree through the C API, lays it out and reads its frames back, then
+ * sends batches holding one invalid description, handle, spec or array: each one must fail and
+ * change nothing, neither the nodes, nor the frames laid out, nor the frames read. Compiled as C,
+ * so that the header is checked to be C.
+ *
+ * Usage: CApiTest [runs [first seed]]
+ */
+int main(int argc, char** argv) {
+    int runs = argc > 1 ? atoi(argv[1]) : 1000;
+    unsigned int firstSeed = argc > 2 ? (unsigned int) atoi(argv[2]) : 0;
+    int failures = 0;
+    unsigned int seed;
+    if (cssom_layout_abi_version() != CSSOM_LAYOUT_ABI_VERSION) {
+        printf("the library has another ABI version\n");
+        return EXIT_FAILURE;
+    }
+    for (seed = firstSeed; seed < firstSeed + (unsigned int) runs; seed++) {
+        unsigned int state = seed;
+        cssom_tree* tree = cssom_tree_create();
+        cssom_node_desc descs[9];
+        cssom_node nodes[9];
+        cssom_frame frames[9];
+        cssom_frame before[9];
+        int32_t widthSpec = cssom_make_measure_spec((int32_t) (100 + next(&state, 600)), CSSOM_SPEC_EXACTLY);
+        int32_t heightSpec = cssom_make_measure_spec((int32_t) (100 + next(&state, 600)), CSSOM_SPEC_AT_MOST);
+        int32_t invalidSpec = widthSpec | CSSOM_SPEC_EXACTLY | CSSOM_SPEC_AT_MOST;
+        size_t count = 1 + next(&state, 9);
+        size_t i;
+        const char* failure = NULL;
+
+        cssom_node_desc_init(&descs[0], CSSOM_NODE_FLEX_LAYOUT + next(&state, 3));
+        for (i = 1; i < count; i++) {
+            cssom_node_desc_init(&descs[i], CSSOM_NODE_ITEM);
+            descs[i].parent = 0;
+            descs[i].width = (int32_t) next(&state, 200);
+            descs[i].height = (int32_t) next(&state, 200);
+        }
+        if (cssom_tree_create_nodes(tree, descs, count, nodes) != CSSOM_OK || cssom_tree_node_count(tree) != count) {
+            failure = "a valid batch isn't created";
+        }
+
+        /* An invalid description anywhere in the batch. */
+        i = next(&state, (unsigned int) count);
+        corrupt(&descs[i], &state);
+        if (!failure && (cssom_tree_create_nodes(tree, descs, count, NULL) != CSSOM_INVALID_ARGUMENT
+                         || cssom_tree_node_count(tree) != count)) {
+            failure = "an invalid description is created";
+        }
+        if (!failure && cssom_tree_update_nodes(tree, nodes, descs, count) != CSSOM_INVALID_ARGUMENT) {
+            failure = "an invalid description is applied";
+        }
+
+        /* A batch of roots whose last one is unknown lays out none of them. */
+        if (!failure) {
+            cssom_node roots[2];
+            int32_t widthSpecs[2];
+            int32_t heightSpecs[2];
+            roots[0] = nodes[0];
+            roots[1] = next(&state, 2) == 0 ? (cssom_node) count : CSSOM_NO_NODE;
+            widthSpecs[0] = widthSpecs[1] = widthSpec;
+            heightSpecs[0] = heightSpecs[1] = heightSpec;
+            memset(before, 0, sizeof(before));
+            if (cssom_tree_layout(tree, roots, widthSpecs, heightSpecs, 2) != CSSOM_INVALID_ARGUMENT
+                || cssom_tree_get_frames(tree, NULL, count, frames) != CSSOM_OK
+                || memcmp(frames, before, count * sizeof(cssom_frame)) != 0) {
+                failure = "a batch with an unknown root is laid out";
+            }
+            roots[1] = nodes[0];
+            widthSpecs[1] = invalidSpec;
+            if (!failure && cssom_tree_layout(tree, roots, widthSpecs, heightSpecs, 2) != CSSOM_INVALID_ARGUMENT) {
+                failure = "a batch with an invalid spec is laid out";
+            }
+            if (!failure && cssom_tree_layout(tree, NULL, widthSpecs, heightSpecs, 1) != CSSOM_INVALID_ARGUMENT) {
+                failure = "a null array of roots is laid out";
+            }
+        }
+
+        if (!failure && (cssom_tree_layout(tree, nodes, &widthSpec, &heightSpec, 1) != CSSOM_OK
+                         || cssom_tree_get_frames(tree, nodes, count, frames) != CSSOM_OK
+                         || frames[0].width != (widthSpec & ~(CSSOM_SPEC_EXACTLY | CSSOM_SPEC_AT_MOST)))) {
+            failure = "a valid tree isn't laid out";
+        }
+
+        /* Frames read for an unknown node, or more nodes than the tree has, are left untouched. */
+        if (!failure) {
+            memcpy(before, frames, sizeof(frames));
+            nodes[next(&state, (unsigned int) count)] = (cssom_node) (count + next(&state, 3));
+            if (cssom_tree_get_frames(tree, nodes, count, frames) != CSSOM_INVALID_ARGUMENT
+                || cssom_tree_get_frames(tree, NULL, count + 1, frames) != CSSOM_INVALID_ARGUMENT
+                || memcmp(frames, before, sizeof(frames)) != 0) {
+                failure = "frames are read for unknown nodes";
+            }
+        }
+        if (!failure && cssom_tree_last_error(tree)[0] == '\0') {
+            failure = "an error has no message";
+        }
+        cssom_tree_destroy(tree);
+        if (failure) {
+            printf("seed %u: %s\n", seed, failure);
+            failures++;
+        }
+    }
+    printf("%d/%d runs differ\n", failures, runs);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
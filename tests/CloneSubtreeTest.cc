@@ -0,0 +1,99 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <unordered_map>
+#include "ItemArena.h"
+#include "RandomTree.h"
+
+/**
+ * The text bound to each leaf, which isn't a layout attribute.
+ */
+static std::unordered_map<const Item*, int> sTexts;
+
+/**
+ * Gives the leaves of a subtree a text whose length is read from the text bound to them, as a
+ * text bound to a cell would be, and binds them to the given texts.
+ */
+static void bindTexts(Item* item, int& text) {
+    if (Layout* layout = dynamic_cast<Layout*>(item)) {
+        for (int i = 0; i < layout->getChildCount(); i++) {
+            bindTexts(layout->getChildAt(i), text);
+        }
+        return;
+    }
+    sTexts[item] = text++;
+    item->setMeasureFunction([](Item* item, int widthMeasureSpec, int heightMeasureSpec) {
+        return measureText(1 + sTexts[item] % 7)(item, widthMeasureSpec, heightMeasureSpec);
+    });
+    // The text isn't in the layout hash.
+    item->setContentKey(0);
+}
+
+/**
+ * Binds the leaves of a subtree to other texts, without invalidating anything: the copies of a
+ * template are bound to their data after the copy.
+ */
+static void rebindTexts(Item* item, int& text) {
+    if (Layout* layout = dynamic_cast<Layout*>(item)) {
+        for (int i = 0; i < layout->getChildCount(); i++) {
+            rebindTexts(layout->getChildAt(i), text);
+        }
+        return;
+    }
+    sTexts[item] = text++;
+}
+
+/**
+ * Copies a random template whose leaves are texts into a container sharing the layouts of its
+ * children, binds each copy to other texts and compares the frames with the same copies in a
+ * container which doesn't share: the copies must not keep the layout hash of the template.
+ *
+ * Usage: CloneSubtreeTest [runs [first seed]]
+ */
+int main(int argc, char** argv) {
+    int runs = argc > 1 ? atoi(argv[1]) : 2000;
+    unsigned int firstSeed = argc > 2 ? static_cast<unsigned int>(atoi(argv[2])) : 0;
+    int failures = 0;
+    for (unsigned int seed = firstSeed; seed < firstSeed + runs; seed++) {
+        Generator generator(seed);
+        Desc desc = generator.tree(2);
+        Items items;
+        Item* prototype = items.build(desc);
+        int text = 0;
+        bindTexts(prototype, text);
+        // The template has been laid out and hashed before it is copied.
+        prototype->getLayoutHash();
+        layoutRoot(prototype, Item::MeasureSpec::makeMeasureSpec(300, Item::MeasureSpec::AT_MOST),
+                   Item::MeasureSpec::makeMeasureSpec(0, Item::MeasureSpec::UNSPECIFIED));
+
+        ItemArena arena;
+        std::vector<int> frames[2];
+        for (int sharing = 0; sharing < 2; sharing++) {
+            FlexLayout* list = arena.create<FlexLayout>();
+            list->setFlexDirection(FlexDirection::COLUMN);
+            list->setLayoutSharing(sharing != 0);
+            text = 0;
+            for (int i = 0; i < 4; i++) {
+                Item* copy = prototype->cloneSubtree(&arena);
+                rebindTexts(copy, text);
+                list->addItem(copy);
+            }
+            layoutRoot(list, Item::MeasureSpec::makeMeasureSpec(300, Item::MeasureSpec::EXACTLY),
+                       Item::MeasureSpec::makeMeasureSpec(0, Item::MeasureSpec::UNSPECIFIED));
+            collectFrames(list, frames[sharing]);
+        }
+        if (frames[0] != frames[1]) {
+            printf("seed %u: the frames of the shared copies differ\n", seed);
+            failures++;
+        }
+        sTexts.clear();
+    }
+    printf("%d/%d runs differ\n", failures, runs);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
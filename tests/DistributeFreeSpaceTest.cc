@@ -0,0 +1,147 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "FlexboxHelper.h"
+
+/**
+ * The sizes the original item by item loop of expandFlexItems and shrinkFlexItems gave to the
+ * items of a line, carrying the rounding error from item to item and adding the rest to the last
+ * item if it is flexed. Items which reach their limit take it and don't carry an error.
+ */
+static std::vector<int> distributeGenerically(float unitSpace, bool shrink, const std::vector<int>& sizes,
+                                              const std::vector<float>& factors, const std::vector<int>& limits) {
+    std::vector<int> outSizes(sizes);
+    float accumulatedRoundError = 0;
+    int count = static_cast<int>(sizes.size());
+    for (int i = 0; i < count; i++) {
+        if (factors[i] <= 0) {
+            continue;
+        }
+        float rawSize = shrink ? sizes[i] - unitSpace * factors[i] : sizes[i] + unitSpace * factors[i];
+        if (i == count - 1) {
+            rawSize += accumulatedRoundError;
+            accumulatedRoundError = 0;
+        }
+        int size = static_cast<int>(std::round(rawSize));
+        if (shrink ? size < limits[i] : size > limits[i]) {
+            size = limits[i];
+        } else {
+            accumulatedRoundError += rawSize - static_cast<float>(size);
+            if (accumulatedRoundError > 1.0) {
+                size += 1;
+                accumulatedRoundError -= 1.0;
+            } else if (accumulatedRoundError < -1.0) {
+                size -= 1;
+                accumulatedRoundError += 1.0;
+            }
+        }
+        outSizes[i] = size;
+    }
+    return outSizes;
+}
+
+/**
+ * Distributes random free space over random flex lines with FlexboxHelper::distributeFreeSpace,
+ * and checks the vectorized result against the documented formula evaluated item by item. Then
+ * checks the rounding it documents against the exact shares and the original generic loop: each
+ * size is within a pixel of its exact share, the shares add up to the rounded free space, and the
+ * generic loop is at most two pixels away per item and one pixel away in total, or two when its
+ * last item isn't flexed and its rounding error is lost.
+ *
+ * Usage: DistributeFreeSpaceTest [runs [first seed]]
+ */
+int main(int argc, char** argv) {
+    int runs = argc > 1 ? atoi(argv[1]) : 20000;
+    unsigned int firstSeed = argc > 2 ? static_cast<unsigned int>(atoi(argv[2])) : 0;
+    int failures = 0;
+    for (unsigned int seed = firstSeed; seed < firstSeed + runs; seed++) {
+        std::mt19937 random(seed);
+        bool shrink = random() % 2 == 0;
+        float unitSpace = static_cast<float>(random() % 5000) / 100;
+        int count = static_cast<int>(random() % 20);
+        std::vector<int> sizes(count);
+        std::vector<float> factors(count);
+        std::vector<int> limits(count);
+        for (int i = 0; i < count; i++) {
+            sizes[i] = static_cast<int>(random() % 500);
+            float someFactors[] = {0, 0, 0.5f, 1, 1, 2, 3, static_cast<float>(random() % 30) / 10};
+            factors[i] = someFactors[random() % 8];
+            int slack = static_cast<int>(random() % 200);
+            if (shrink) {
+                limits[i] = random() % 3 == 0 ? sizes[i] - slack : INT_MIN;
+            } else {
+                limits[i] = random() % 3 == 0 ? sizes[i] + slack : Item::MAX_SIZE;
+            }
+        }
+        std::vector<int> outSizes(count);
+        std::vector<int> outClamped(count);
+        FlexboxHelper::distributeFreeSpace(unitSpace, shrink, sizes.data(), factors.data(), limits.data(),
+                                           outSizes.data(), outClamped.data(), count);
+
+        double prefixFactor = 0;
+        int previousPrefixShare = 0;
+        int total = 0;
+        bool clampedAny = false;
+        bool failed = false;
+        for (int i = 0; i < count && !failed; i++) {
+            prefixFactor += factors[i];
+            int prefixShare = static_cast<int>(static_cast<double>(unitSpace) * prefixFactor + 0.5);
+            int share = prefixShare - previousPrefixShare;
+            previousPrefixShare = prefixShare;
+            int size = shrink ? sizes[i] - share : sizes[i] + share;
+            bool clamped = shrink ? size < limits[i] : size > limits[i];
+            double exact = shrink ? sizes[i] - static_cast<double>(unitSpace) * factors[i]
+                                  : sizes[i] + static_cast<double>(unitSpace) * factors[i];
+            if (outSizes[i] != (clamped ? limits[i] : size) || (outClamped[i] != 0) != clamped) {
+                printf("seed %u: item %d has the size %d instead of %d\n", seed, i, outSizes[i],
+                       clamped ? limits[i] : size);
+                failed = true;
+            } else if (!clamped && std::abs(size - exact) >= 1) {
+                printf("seed %u: item %d has the size %d for the exact share %f\n", seed, i, size, exact);
+                failed = true;
+            }
+            total += share;
+            clampedAny = clampedAny || clamped;
+        }
+        double exactTotal = static_cast<double>(unitSpace) * prefixFactor;
+        if (!failed && total != static_cast<int>(exactTotal + 0.5)) {
+            printf("seed %u: the shares add up to %d instead of %f\n", seed, total, exactTotal);
+            failed = true;
+        }
+
+        std::vector<int> genericSizes = distributeGenerically(unitSpace, shrink, sizes, factors, limits);
+        bool genericClampedAny = false;
+        int newTotal = 0;
+        int genericTotal = 0;
+        for (int i = 0; i < count && !failed; i++) {
+            genericClampedAny = genericClampedAny || (factors[i] > 0 && genericSizes[i] == limits[i]);
+            if (std::abs(outSizes[i] - genericSizes[i]) > 2) {
+                printf("seed %u: item %d has the size %d, the generic loop %d\n", seed, i, outSizes[i],
+                       genericSizes[i]);
+                failed = true;
+            }
+            newTotal += outSizes[i];
+            genericTotal += genericSizes[i];
+        }
+        int allowedDrift = count > 0 && factors[count - 1] > 0 ? 1 : 2;
+        if (!failed && !clampedAny && !genericClampedAny && std::abs(newTotal - genericTotal) > allowedDrift) {
+            printf("seed %u: the sizes add up to %d, %d with the generic loop\n", seed, newTotal, genericTotal);
+            failed = true;
+        }
+        if (failed) {
+            failures++;
+        }
+    }
+    printf("%d/%d runs differ\n", failures, runs);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
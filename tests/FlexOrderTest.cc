@@ -0,0 +1,81 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include "RandomTree.h"
+
+/**
+ * Adds, removes and reorders the items of wrapping FlexLayouts whose items have various orders,
+ * lays them out again with Item::layoutIfNeeded() and compares the frames with the same trees
+ * measured from scratch. The retained flex lines and the reordered items have to follow the
+ * changes of the order.
+ *
+ * Usage: FlexOrderTest [runs [first seed]]
+ */
+static Desc randomItem(Generator& generator) {
+    Desc desc;
+    desc.attributes.emplace_back(0, 2 + generator.next(18));
+    desc.attributes.emplace_back(1, 2 + generator.next(18));
+    if (generator.next(3) == 0) {
+        desc.attributes.emplace_back(14, 4 * generator.next(5));
+    }
+    return desc;
+}
+
+int main(int argc, char** argv) {
+    int runs = argc > 1 ? atoi(argv[1]) : 2000;
+    unsigned int firstSeed = argc > 2 ? static_cast<unsigned int>(atoi(argv[2])) : 0;
+    int failures = 0;
+    for (unsigned int seed = firstSeed; seed < firstSeed + runs; seed++) {
+        Generator generator(seed);
+        Desc desc;
+        desc.kind = ItemKind::FLEX;
+        // A wrapping row or column.
+        desc.attributes.emplace_back(15, 2 * generator.next(2));
+        desc.attributes.emplace_back(16, 1);
+        for (int i = generator.next(12); i > 0; i--) {
+            desc.children.push_back(randomItem(generator));
+        }
+        Items items;
+        Item* root = items.build(desc);
+        int widthMeasureSpec = Item::MeasureSpec::makeMeasureSpec(200 + generator.next(200),
+                                                                  Item::MeasureSpec::EXACTLY);
+        int heightMeasureSpec = Item::MeasureSpec::makeMeasureSpec(200 + generator.next(200),
+                                                                   Item::MeasureSpec::EXACTLY);
+        layoutRoot(root, widthMeasureSpec, heightMeasureSpec);
+        Layout* container = static_cast<Layout*>(root);
+        for (int step = 0; step < 20; step++) {
+            int operation = generator.next(4);
+            int count = static_cast<int>(desc.children.size());
+            if (operation == 0 || count == 0) {
+                int index = generator.next(count + 1);
+                Desc child = randomItem(generator);
+                container->addItem(items.build(child), index);
+                desc.children.insert(desc.children.begin() + index, child);
+            } else if (operation == 1) {
+                int index = generator.next(count);
+                container->removeItemAt(index);
+                desc.children.erase(desc.children.begin() + index);
+            } else {
+                int index = generator.next(count);
+                int attribute = operation == 2 ? 14 : 0;
+                int value = operation == 2 ? 4 * generator.next(5) : 2 + generator.next(18);
+                applyAttribute(container->getChildAt(index), ItemKind::ITEM, attribute, value);
+                desc.children[index].attributes.emplace_back(attribute, value);
+            }
+            root->layoutIfNeeded();
+            if (compareWithReference(root, desc, widthMeasureSpec, heightMeasureSpec) == 0) {
+                printf("seed %u: the frames differ after step %d\n", seed, step);
+                failures++;
+                break;
+            }
+        }
+    }
+    printf("%d/%d runs differ\n", failures, runs);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
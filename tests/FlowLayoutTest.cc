@@ -0,0 +1,173 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "FlowLayout.h"
+
+/**
+ * A flow whose spacings can be set by the test.
+ */
+struct SpacedFlowLayout : FlowLayout {
+    using FlowLayout::getItemSpacing;
+    using FlowLayout::setItemSpacing;
+    using FlowLayout::getLineSpacing;
+    using FlowLayout::setLineSpacing;
+};
+
+/**
+ * The measured size and the frames of the children of a flow as the original child by child
+ * algorithm computes them, which doesn't assume that the ends of the children increase.
+ */
+static std::vector<int> layOutNaively(SpacedFlowLayout& flow, int widthMeasureSpec, int heightMeasureSpec) {
+    int width = Item::MeasureSpec::getSize(widthMeasureSpec);
+    int widthMode = Item::MeasureSpec::getMode(widthMeasureSpec);
+    int maxRight = (widthMode == Item::MeasureSpec::UNSPECIFIED ? INT_MAX : width) - flow.getPaddingRight();
+    int childLeft = flow.getPaddingLeft();
+    int childTop = flow.getPaddingTop();
+    int childBottom = childTop;
+    int maxChildRight = 0;
+    for (int i = 0; i < flow.getChildCount(); i++) {
+        Item* child = flow.getChildAt(i);
+        if (child->getVisibility() == Item::GONE) {
+            continue;
+        }
+        int childRight = childLeft + child->getMarginLeft() + child->getMeasuredWidth();
+        if (childRight > maxRight && !flow.isSingleLine()) {
+            childLeft = flow.getPaddingLeft();
+            childTop = childBottom + flow.getLineSpacing();
+        }
+        childRight = childLeft + child->getMarginLeft() + child->getMeasuredWidth();
+        childBottom = childTop + child->getMeasuredHeight();
+        maxChildRight = std::max(maxChildRight, childRight);
+        childLeft += child->getMarginLeft() + child->getMarginRight() + child->getMeasuredWidth()
+                     + flow.getItemSpacing();
+        if (i == flow.getChildCount() - 1) {
+            maxChildRight += child->getMarginRight();
+        }
+    }
+    maxChildRight += flow.getPaddingRight();
+    childBottom += flow.getPaddingBottom();
+    int height = Item::MeasureSpec::getSize(heightMeasureSpec);
+    int heightMode = Item::MeasureSpec::getMode(heightMeasureSpec);
+    int measuredWidth = widthMode == Item::MeasureSpec::EXACTLY ? width
+                        : widthMode == Item::MeasureSpec::AT_MOST ? std::min(maxChildRight, width) : maxChildRight;
+    int measuredHeight = heightMode == Item::MeasureSpec::EXACTLY ? height
+                         : heightMode == Item::MeasureSpec::AT_MOST ? std::min(childBottom, height) : childBottom;
+    std::vector<int> frames = {measuredWidth, measuredHeight};
+
+    int maxChildEnd = measuredWidth - flow.getPaddingRight();
+    int childStart = flow.getPaddingLeft();
+    childTop = flow.getPaddingTop();
+    childBottom = childTop;
+    for (int i = 0; i < flow.getChildCount(); i++) {
+        Item* child = flow.getChildAt(i);
+        if (child->getVisibility() == Item::GONE) {
+            continue;
+        }
+        int childEnd = childStart + child->getMarginLeft() + child->getMeasuredWidth();
+        if (!flow.isSingleLine() && childEnd > maxChildEnd) {
+            childStart = flow.getPaddingLeft();
+            childTop = childBottom + flow.getLineSpacing();
+        }
+        childEnd = childStart + child->getMarginLeft() + child->getMeasuredWidth();
+        childBottom = childTop + child->getMeasuredHeight();
+        for (int value : {childStart + child->getMarginLeft(), childTop, childEnd, childBottom}) {
+            frames.push_back(value);
+        }
+        childStart += child->getMarginLeft() + child->getMarginRight() + child->getMeasuredWidth()
+                      + flow.getItemSpacing();
+    }
+    return frames;
+}
+
+static void changeChild(std::mt19937& random, Item* child) {
+    switch (random() % 3) {
+        case 0:
+            child->setWidth(10 + static_cast<int>(random() % 120));
+            break;
+        case 1: {
+            // Negative margins move the next children back.
+            int left = static_cast<int>(random() % 41) - 20;
+            int right = static_cast<int>(random() % 41) - 20;
+            child->setMargins(left, 0, right, 0);
+            break;
+        }
+        default:
+            child->setVisibility(random() % 4 == 0 ? Item::GONE : Item::VISIBLE);
+            break;
+    }
+}
+
+/**
+ * Lays out random flows of leaves, with negative margins and item spacings among them, at various
+ * widths and after changes of their children, and compares the result with the original child by
+ * child algorithm.
+ *
+ * Usage: FlowLayoutTest [runs [first seed]]
+ */
+int main(int argc, char** argv) {
+    int runs = argc > 1 ? atoi(argv[1]) : 2000;
+    unsigned int firstSeed = argc > 2 ? static_cast<unsigned int>(atoi(argv[2])) : 0;
+    int failures = 0;
+    for (unsigned int seed = firstSeed; seed < firstSeed + runs; seed++) {
+        std::mt19937 random(seed);
+        SpacedFlowLayout flow;
+        flow.setItemSpacing(static_cast<int>(random() % 41) - 25);
+        flow.setLineSpacing(static_cast<int>(random() % 10));
+        flow.setSingleLine(random() % 5 == 0);
+        flow.setPadding(static_cast<int>(random() % 10), static_cast<int>(random() % 10),
+                        static_cast<int>(random() % 10), static_cast<int>(random() % 10));
+        std::vector<Item> children(random() % 13);
+        for (Item& child : children) {
+            child.setWidth(10 + static_cast<int>(random() % 120));
+            child.setHeight(10 + static_cast<int>(random() % 50));
+            if (random() % 2 == 0) {
+                changeChild(random, &child);
+            }
+            flow.addItem(&child);
+        }
+        for (int step = 0; step < 8; step++) {
+            if (step > 0 && !children.empty() && random() % 2 == 0) {
+                changeChild(random, &children[random() % children.size()]);
+            }
+            int mode = static_cast<int>(random() % 3);
+            int widthMeasureSpec = Item::MeasureSpec::makeMeasureSpec(
+                    50 + static_cast<int>(random() % 450),
+                    mode == 0 ? Item::MeasureSpec::EXACTLY
+                              : mode == 1 ? Item::MeasureSpec::AT_MOST : Item::MeasureSpec::UNSPECIFIED);
+            int heightMeasureSpec = Item::MeasureSpec::makeMeasureSpec(1000, Item::MeasureSpec::AT_MOST);
+            flow.measure(widthMeasureSpec, heightMeasureSpec);
+            flow.layout(0, 0, flow.getMeasuredWidth(), flow.getMeasuredHeight());
+            std::vector<int> actual = {flow.getMeasuredWidth(), flow.getMeasuredHeight()};
+            for (const Item& child : children) {
+                if (child.getVisibility() != Item::GONE) {
+                    for (int value : {child.getLeft(), child.getTop(), child.getRight(), child.getBottom()}) {
+                        actual.push_back(value);
+                    }
+                }
+            }
+            std::vector<int> expected = layOutNaively(flow, widthMeasureSpec, heightMeasureSpec);
+            // The margins add up to a negative width, which a measured size can't hold.
+            if (expected[0] < 0) {
+                break;
+            }
+            if (actual != expected) {
+                printf("seed %u: the flow differs at step %d\n", seed, step);
+                failures++;
+                break;
+            }
+        }
+        flow.removeAllItems();
+    }
+    printf("%d/%d runs differ\n", failures, runs);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include "RandomTree.h"
+
+/**
+ * Appends the min-content and max-content widths and heights of the items of the tree in
+ * pre-order, or of one in every few of them, so that only some of the caches are filled.
+ */
+static void collectIntrinsicSizes(Item* item, std::vector<int>& sizes, int every, int& index) {
+    if (index++ % every == 0) {
+        for (int intrinsicSize : {IntrinsicSize::MIN_CONTENT, IntrinsicSize::MAX_CONTENT}) {
+            sizes.push_back(item->getIntrinsicWidth(intrinsicSize));
+            sizes.push_back(item->getIntrinsicHeight(intrinsicSize));
+        }
+    }
+    if (Layout* layout = dynamic_cast<Layout*>(item)) {
+        for (int i = 0; i < layout->getChildCount(); i++) {
+            collectIntrinsicSizes(layout->getChildAt(i), sizes, every, index);
+        }
+    }
+}
+
+/**
+ * Changes random trees step by step, laying them out and querying the intrinsic sizes of some of
+ * their items between the changes, and compares the cached intrinsic sizes of all the items with
+ * the ones of the same trees built from scratch: a change must invalidate every cached size it
+ * affects.
+ *
+ * Usage: IntrinsicSizeTest [runs [first seed]]
+ */
+int main(int argc, char** argv) {
+    int runs = argc > 1 ? atoi(argv[1]) : 2000;
+    unsigned int firstSeed = argc > 2 ? static_cast<unsigned int>(atoi(argv[2])) : 0;
+    int failures = 0;
+    for (unsigned int seed = firstSeed; seed < firstSeed + runs; seed++) {
+        Generator generator(seed);
+        Desc desc = generator.tree(3);
+        Items items;
+        Item* root = items.build(desc);
+        for (int step = 0; step < 10; step++) {
+            if (step > 0) {
+                for (int i = 1 + generator.next(3); i > 0; i--) {
+                    mutate(generator, items, desc, root);
+                }
+            }
+            if (generator.next(2) == 0) {
+                layoutRoot(root, Item::MeasureSpec::makeMeasureSpec(100 + generator.next(600),
+                                                                    Item::MeasureSpec::EXACTLY),
+                           Item::MeasureSpec::makeMeasureSpec(100 + generator.next(600),
+                                                              Item::MeasureSpec::AT_MOST));
+            }
+            std::vector<int> partial;
+            int index = 0;
+            collectIntrinsicSizes(root, partial, 1 + generator.next(4), index);
+
+            std::vector<int> actual;
+            std::vector<int> expected;
+            index = 0;
+            collectIntrinsicSizes(root, actual, 1, index);
+            Items referenceItems;
+            index = 0;
+            collectIntrinsicSizes(referenceItems.build(desc), expected, 1, index);
+            if (actual != expected) {
+                printf("seed %u: the intrinsic sizes differ after step %d\n", seed, step);
+                failures++;
+                break;
+            }
+        }
+    }
+    printf("%d/%d runs differ\n", failures, runs);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,179 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <unordered_map>
+#include "ItemArena.h"
+#include "ItemRecycler.h"
+#include "RandomTree.h"
+
+/**
+ * Replaces the LinearLayouts of a tree with FlexLayouts: the LinearLayout port doesn't lay out
+ * its children, whose frames would keep the values of an earlier binding.
+ */
+static void withoutLinearLayouts(Desc& desc) {
+    if (desc.kind == ItemKind::LINEAR) {
+        desc.kind = ItemKind::FLEX;
+    }
+    for (auto& child : desc.children) {
+        withoutLinearLayouts(child);
+    }
+}
+
+/**
+ * The text bound to each leaf, which isn't a layout attribute.
+ */
+static std::unordered_map<const Item*, int> sTexts;
+
+/**
+ * Gives the leaves of a template a text whose length is read from the text bound to them.
+ */
+static void bindTexts(Item* item) {
+    if (Layout* layout = dynamic_cast<Layout*>(item)) {
+        for (int i = 0; i < layout->getChildCount(); i++) {
+            bindTexts(layout->getChildAt(i));
+        }
+        return;
+    }
+    item->setMeasureFunction([](Item* item, int widthMeasureSpec, int heightMeasureSpec) {
+        return measureText(1 + sTexts[item] % 7)(item, widthMeasureSpec, heightMeasureSpec);
+    });
+    item->setContentKey(0);
+}
+
+/**
+ * Binds the leaves of a row to the texts of a data index, and gives them the length of their text
+ * as content key if keyed.
+ */
+static void bind(Item* item, int& text, bool keyed) {
+    if (Layout* layout = dynamic_cast<Layout*>(item)) {
+        for (int i = 0; i < layout->getChildCount(); i++) {
+            bind(layout->getChildAt(i), text, keyed);
+        }
+        return;
+    }
+    sTexts[item] = text++;
+    if (keyed) {
+        item->setContentKey(static_cast<size_t>(1 + sTexts[item] % 7));
+    }
+}
+
+/**
+ * Appends the frames of the items of the tree which aren't gone, in pre-order.
+ */
+static void collectVisibleFrames(Item* item, std::vector<int>& frames) {
+    if (item->getVisibility() == Item::GONE) {
+        return;
+    }
+    for (int value : {item->getLeft(), item->getTop(), item->getRight(), item->getBottom()}) {
+        frames.push_back(value);
+    }
+    if (Layout* layout = dynamic_cast<Layout*>(item)) {
+        for (int i = 0; i < layout->getChildCount(); i++) {
+            collectVisibleFrames(layout->getChildAt(i), frames);
+        }
+    }
+}
+
+/**
+ * Scrolls random lists of two view types whose rows come from an ItemRecycler, changes the rows
+ * before recycling them, sometimes so that they don't match their template any more, and
+ * compares the frames with the same rows freshly cloned from the templates. The recycler must
+ * measure the rebound texts again and release the subtrees it drops.
+ *
+ * Usage: ItemRecyclerTest [runs [first seed]]
+ */
+int main(int argc, char** argv) {
+    int runs = argc > 1 ? atoi(argv[1]) : 1000;
+    unsigned int firstSeed = argc > 2 ? static_cast<unsigned int>(atoi(argv[2])) : 0;
+    int failures = 0;
+    for (unsigned int seed = firstSeed; seed < firstSeed + runs; seed++) {
+        Generator generator(seed);
+        bool keyed = generator.next(2) == 0;
+        Items items(false);
+        Item* prototypes[2];
+        ItemRecycler recycler;
+        for (int viewType = 0; viewType < 2; viewType++) {
+            Desc desc = generator.tree(2);
+            withoutLinearLayouts(desc);
+            prototypes[viewType] = items.build(desc);
+            bindTexts(prototypes[viewType]);
+            recycler.setPrototype(viewType, prototypes[viewType]);
+        }
+        FlexLayout list;
+        list.setFlexDirection(FlexDirection::COLUMN);
+        list.setLayoutSharing(generator.next(2) == 0);
+        int rowCount = 3 + generator.next(8);
+        int first = 0;
+        bool failed = false;
+        for (int step = 0; step < 30 && !failed; step++) {
+            for (int scrolled = step > 0 ? generator.next(rowCount) : 0; scrolled > 0; scrolled--) {
+                Item* row = list.getChildAt(0);
+                Layout* container = dynamic_cast<Layout*>(row);
+                int change = generator.next(4);
+                if (change == 0 && container != nullptr && container->getChildCount() > 0) {
+                    // The row doesn't match its template any more, it is dropped.
+                    container->removeItemAt(0);
+                } else if (change == 1) {
+                    row->setWidth(10 + generator.next(200));
+                }
+                recycler.recycle(first % 2, row);
+                first++;
+            }
+            while (list.getChildCount() < rowCount) {
+                int data = first + list.getChildCount();
+                Item* row = recycler.obtain(data % 2);
+                int text = data * 10;
+                bind(row, text, keyed);
+                list.addItem(row);
+            }
+            int widthMeasureSpec = Item::MeasureSpec::makeMeasureSpec(300, Item::MeasureSpec::EXACTLY);
+            int heightMeasureSpec = Item::MeasureSpec::makeMeasureSpec(0, Item::MeasureSpec::UNSPECIFIED);
+            layoutRoot(&list, widthMeasureSpec, heightMeasureSpec);
+
+            ItemArena arena;
+            FlexLayout* reference = arena.create<FlexLayout>();
+            reference->setFlexDirection(FlexDirection::COLUMN);
+            for (int data = first; data < first + rowCount; data++) {
+                Item* row = prototypes[data % 2]->cloneSubtree(&arena);
+                int text = data * 10;
+                bind(row, text, keyed);
+                reference->addItem(row);
+            }
+            layoutRoot(reference, widthMeasureSpec, heightMeasureSpec);
+            std::vector<int> actual;
+            std::vector<int> expected;
+            collectVisibleFrames(&list, actual);
+            collectVisibleFrames(reference, expected);
+            bool overflows = false;
+            for (size_t i = 0; i < expected.size() && i < actual.size(); i++) {
+                // The random sizes add up beyond what a measured size can hold.
+                overflows = overflows || std::abs(expected[i]) > (1 << 22) || std::abs(actual[i]) > (1 << 22);
+            }
+            if (overflows) {
+                break;
+            }
+            if (actual != expected) {
+                printf("seed %u: the frames of the recycled rows differ at step %d\n", seed, step);
+                failed = true;
+            } else if (recycler.getSubtreeCount()
+                       != list.getChildCount() + recycler.getRecycledCount(0) + recycler.getRecycledCount(1)) {
+                printf("seed %u: the recycler owns %d subtrees at step %d\n", seed, recycler.getSubtreeCount(),
+                       step);
+                failed = true;
+            }
+        }
+        if (failed) {
+            failures++;
+        }
+        list.removeAllItems();
+        sTexts.clear();
+    }
+    printf("%d/%d runs differ\n", failures, runs);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
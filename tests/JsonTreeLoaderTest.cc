@@ -0,0 +1,236 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include "ItemArena.h"
+#include "JsonTreeLoader.h"
+#include "RandomTree.h"
+#include "TreeFormat.h"
+
+/**
+ * Removes the measure functions from a tree description, a document doesn't hold them.
+ */
+static void withoutTexts(Desc& desc) {
+    auto& attributes = desc.attributes;
+    attributes.erase(std::remove_if(attributes.begin(), attributes.end(),
+                                    [](const std::pair<int, int>& attribute) { return attribute.first == 12; }),
+                     attributes.end());
+    for (auto& child : desc.children) {
+        withoutTexts(child);
+    }
+}
+
+static void appendMember(std::string& json, const char* name, double value) {
+    char number[32];
+    // Enough digits for a float to be read back exactly.
+    snprintf(number, sizeof(number), "%.9g", value);
+    json += json.back() == '{' ? "\"" : ", \"";
+    json += name;
+    json += "\": ";
+    json += number;
+}
+
+/**
+ * Writes the document of a tree, with all the attributes of each item.
+ */
+static void appendJson(Item* item, std::string& json) {
+    TreeFormat::NodeRecord record;
+    TreeFormat::writeRecord(item, record);
+    const char* types[] = {"Item", "FlexLayout", "LinearLayout", "FlowLayout"};
+    json += "{\"type\": \"";
+    json += types[record.type];
+    json += "\"";
+    std::pair<const char*, double> members[] = {
+            {"order", record.order}, {"alignSelf", record.alignSelf}, {"minWidth", record.minWidth},
+            {"minHeight", record.minHeight}, {"maxWidth", record.maxWidth}, {"maxHeight", record.maxHeight},
+            {"width", record.width}, {"height", record.height}, {"marginLeft", record.marginLeft},
+            {"marginTop", record.marginTop}, {"marginRight", record.marginRight},
+            {"marginBottom", record.marginBottom}, {"visibility", record.visibility},
+            {"wrapBefore", record.wrapBefore}, {"flexGrow", record.flexGrow}, {"flexShrink", record.flexShrink},
+            {"flexBasisPercent", record.flexBasisPercent}, {"widthPercent", record.widthPercent},
+            {"heightPercent", record.heightPercent}, {"weight", record.weight}};
+    for (const auto& member : members) {
+        appendMember(json, member.first, member.second);
+    }
+    if (record.type == TreeFormat::NodeType::ITEM) {
+        json += "}";
+        return;
+    }
+    std::pair<const char*, double> layoutMembers[] = {
+            {"paddingLeft", record.paddingLeft}, {"paddingTop", record.paddingTop},
+            {"paddingRight", record.paddingRight}, {"paddingBottom", record.paddingBottom},
+            {"resizeMode", record.resizeMode}, {"layoutSharing", record.layoutSharing}};
+    for (const auto& member : layoutMembers) {
+        appendMember(json, member.first, member.second);
+    }
+    if (record.type == TreeFormat::NodeType::FLEX_LAYOUT) {
+        appendMember(json, "flexDirection", record.flexDirection);
+        appendMember(json, "flexWrap", record.flexWrap);
+        appendMember(json, "justifyContent", record.justifyContent);
+        appendMember(json, "alignItems", record.alignItems);
+        appendMember(json, "alignContent", record.alignContent);
+        appendMember(json, "maxLine", record.maxLine);
+    } else if (record.type == TreeFormat::NodeType::LINEAR_LAYOUT) {
+        appendMember(json, "orientation", record.orientation);
+        appendMember(json, "weightSum", record.weightSum);
+        appendMember(json, "useLargestChild", record.useLargestChild);
+        appendMember(json, "showDividers", record.showDividers);
+        appendMember(json, "dividerWidth", record.dividerWidth);
+        appendMember(json, "dividerHeight", record.dividerHeight);
+    } else {
+        appendMember(json, "lineSpacing", record.lineSpacing);
+        appendMember(json, "itemSpacing", record.itemSpacing);
+        appendMember(json, "singleLine", record.singleLine);
+    }
+    auto layout = static_cast<Layout*>(item);
+    json += ", \"children\": [";
+    for (int i = 0; i < layout->getChildCount(); i++) {
+        if (i > 0) {
+            json += ", ";
+        }
+        appendJson(layout->getChildAt(i), json);
+    }
+    json += "]}";
+}
+
+/**
+ * Destroys a tree loaded without an arena, whose items have each been allocated with new.
+ */
+static void deleteTree(Item* item) {
+    if (Layout* layout = dynamic_cast<Layout*>(item)) {
+        while (layout->getChildCount() > 0) {
+            Item* child = layout->getChildAt(0);
+            layout->removeItemAt(0);
+            deleteTree(child);
+        }
+    }
+    delete item;
+}
+
+/**
+ * Feeds the document in chunks of random sizes.
+ *
+ * @return the root of the tree
+ * @throws std::invalid_argument if the document is rejected
+ */
+static Item* load(Generator& generator, JsonTreeLoader& loader, const std::string& json) {
+    for (size_t offset = 0; offset < json.size();) {
+        size_t size = std::min(json.size() - offset, static_cast<size_t>(1 + generator.next(64)));
+        loader.feed(json.data() + offset, size);
+        offset += size;
+    }
+    return loader.finish();
+}
+
+/**
+ * Documents which must be rejected.
+ */
+static const char* const MALFORMED[] = {
+        "",
+        "[]",
+        "{\"type\": \"Item\"",
+        "{\"width\": 10,}",
+        "{\"width\" 10}",
+        "{\"width\": 010}",
+        "{\"width\": 0x10}",
+        "{\"width\": +1}",
+        "{\"width\": 1.}",
+        "{\"width\": 1e400}",
+        "{\"width\": -2147483648}",
+        "{\"marginLeft\": -2147483648}",
+        "{\"width\": \"10\"}",
+        "{\"width\": -3}",
+        "{\"visibility\": 3}",
+        "{\"alignSelf\": 9}",
+        "{\"type\": \"Button\"}",
+        "{\"width\": 10, \"type\": \"Item\"}",
+        "{\"type\": 1}",
+        "{\"children\": []}",
+        "{\"type\": \"FlexLayout\", \"children\": {}}",
+        "{\"type\": \"FlexLayout\", \"children\": [1]}",
+        "{\"type\": \"FlexLayout\", \"flexDirection\": 4}",
+        "{\"type\": \"FlexLayout\", \"children\": [{\"width\": 10}, {\"height\": nul}]}",
+        "{\"type\": \"FlexLayout\", \"children\": [{\"type\": \"FlowLayout\", \"children\": [{}]}, {\"x\": \"\\q\"}]}",
+        "{\"type\": \"LinearLayout\", \"showDividers\": 8, \"children\": [{}]}",
+        "{\"type\": \"FlowLayout\", \"padding\": 4, \"children\": [{\"padding\": 4}]}",
+        "{} {}",
+        "{\"id\": \"\\u12\"}",
+};
+
+/**
+ * Writes the documents of random trees, loads them in random chunks, with or without an arena,
+ * and compares the trees loaded with the original ones, checking that each subtree is reported
+ * complete and in its container. Then checks that malformed documents, and truncated or changed
+ * copies of the valid ones, are rejected or loaded, and never crash nor leak.
+ *
+ * Usage: JsonTreeLoaderTest [runs [first seed]]
+ */
+int main(int argc, char** argv) {
+    int runs = argc > 1 ? atoi(argv[1]) : 1000;
+    unsigned int firstSeed = argc > 2 ? static_cast<unsigned int>(atoi(argv[2])) : 0;
+    int failures = 0;
+    for (const char* json : MALFORMED) {
+        Generator generator(0);
+        JsonTreeLoader loader;
+        try {
+            deleteTree(load(generator, loader, json));
+            printf("the malformed document %s is loaded\n", json);
+            failures++;
+        } catch (const std::invalid_argument&) {
+        }
+    }
+    for (unsigned int seed = firstSeed; seed < firstSeed + runs; seed++) {
+        Generator generator(seed);
+        Desc desc = generator.tree(3);
+        withoutTexts(desc);
+        desc.kind = ItemKind::FLEX + generator.next(3);
+        Items items(false);
+        Item* root = items.build(desc);
+        std::string json;
+        appendJson(root, json);
+
+        bool withArena = generator.next(2) == 0;
+        ItemArena arena;
+        JsonTreeLoader loader(withArena ? &arena : nullptr);
+        bool failed = false;
+        loader.setSubtreeListener([&failed](Item* item, int depth) {
+            failed = failed || (depth > 0) != (item->getParent() != nullptr);
+        });
+        Item* copy = load(generator, loader, json);
+        if (failed) {
+            printf("seed %u: a subtree is reported outside of its container\n", seed);
+        } else if (TreeFormat::write(copy) != TreeFormat::write(root)) {
+            printf("seed %u: the tree loaded differs\n", seed);
+            failed = true;
+        }
+        if (!withArena) {
+            deleteTree(copy);
+        }
+
+        std::string corrupted = json.substr(0, generator.next(static_cast<int>(json.size())));
+        if (generator.next(2) == 0) {
+            corrupted = json;
+            for (int i = 1 + generator.next(4); i > 0; i--) {
+                corrupted[generator.next(static_cast<int>(corrupted.size()))] = "{}[],:\"-0a\\ "[generator.next(12)];
+            }
+        }
+        JsonTreeLoader corruptedLoader;
+        try {
+            deleteTree(load(generator, corruptedLoader, corrupted));
+        } catch (const std::invalid_argument&) {
+        }
+        if (failed) {
+            failures++;
+        }
+    }
+    printf("%d/%d runs differ\n", failures, runs);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
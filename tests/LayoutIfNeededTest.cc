@@ -0,0 +1,70 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include "RandomTree.h"
+
+/**
+ * Mutates random trees, lays them out again with Item::layoutIfNeeded() and compares the frames
+ * with the same trees measured from scratch, so that any change an invalidation misses shows up.
+ * Half of the trees have fixed sizes and baseline alignment, most of their items being relayout
+ * boundaries.
+ *
+ * Usage: LayoutIfNeededTest [runs [first seed]]
+ */
+int main(int argc, char** argv) {
+    int runs = argc > 1 ? atoi(argv[1]) : 2000;
+    unsigned int firstSeed = argc > 2 ? static_cast<unsigned int>(atoi(argv[2])) : 0;
+    int failures = 0;
+    for (unsigned int seed = firstSeed; seed < firstSeed + runs; seed++) {
+        Generator generator(seed);
+        Desc desc = generator.tree(3);
+        desc.kind = ItemKind::FLEX + generator.next(3);
+        if (seed % 2 != 0) {
+            // Fixed sizes make relayout boundaries, whose baselines may still be aligned.
+            std::vector<int> path;
+            std::vector<std::vector<int>> paths;
+            collectPaths(desc, path, paths);
+            for (const auto& itemPath : paths) {
+                Desc& target = descAt(desc, itemPath);
+                if (target.kind == ItemKind::FLEX) {
+                    // alignItems: BASELINE
+                    target.attributes.emplace_back(18, 3);
+                }
+                target.attributes.emplace_back(0, 2 + generator.next(2));
+                target.attributes.emplace_back(1, 2 + generator.next(2));
+            }
+        }
+        Items items;
+        Item* root = items.build(desc);
+        // A root measured with AT_MOST takes the size of its content.
+        int rootMode = generator.next(2) == 0 ? Item::MeasureSpec::EXACTLY : Item::MeasureSpec::AT_MOST;
+        int widthMeasureSpec = Item::MeasureSpec::makeMeasureSpec(300 + generator.next(400), rootMode);
+        int heightMeasureSpec = Item::MeasureSpec::makeMeasureSpec(300 + generator.next(400), rootMode);
+        layoutRoot(root, widthMeasureSpec, heightMeasureSpec);
+        for (int step = 0; step < 20; step++) {
+            mutate(generator, items, desc, root);
+            // Several changes may be batched before the next layout.
+            if (generator.next(3) == 0) {
+                continue;
+            }
+            root->layoutIfNeeded();
+            int result = compareWithReference(root, desc, widthMeasureSpec, heightMeasureSpec);
+            if (result < 0) {
+                break;
+            }
+            if (result == 0) {
+                printf("seed %u: the frames differ after step %d\n", seed, step);
+                failures++;
+                break;
+            }
+        }
+    }
+    printf("%d/%d runs differ\n", failures, runs);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
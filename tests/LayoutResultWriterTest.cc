@@ -0,0 +1,198 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <tuple>
+#include "LayoutResultWriter.h"
+#include "RandomTree.h"
+
+/**
+ * What a renderer displays for an item: its frame and the id of its container.
+ */
+using Shown = std::tuple<int, int, int, int, int>;
+
+/**
+ * Gives the items of the tree without an id a new one, and maps the ids to the items.
+ */
+static void assignIds(Item* item, int& nextId, std::map<int, Item*>& items) {
+    if (item->getId() == Item::NO_ID) {
+        item->setId(nextId++);
+        items[item->getId()] = item;
+    }
+    if (Layout* layout = dynamic_cast<Layout*>(item)) {
+        for (int i = 0; i < layout->getChildCount(); i++) {
+            assignIds(layout->getChildAt(i), nextId, items);
+        }
+    }
+}
+
+static Shown shownOf(const LayoutResultWriter::Record& record, const std::map<int, Item*>& items) {
+    Item* parent = items.at(record.id)->getParent();
+    return Shown(record.left, record.top, record.width, record.height,
+                 parent != nullptr ? parent->getId() : Item::NO_ID);
+}
+
+/**
+ * Appends what the renderer must display for the items of the tree.
+ */
+static void collectShown(Item* item, std::map<int, Shown>& shown) {
+    Item* parent = item->getParent();
+    shown[item->getId()] = Shown(item->getLeft(), item->getTop(), item->getRight() - item->getLeft(),
+                                 item->getBottom() - item->getTop(), parent != nullptr ? parent->getId() : Item::NO_ID);
+    if (Layout* layout = dynamic_cast<Layout*>(item)) {
+        for (int i = 0; i < layout->getChildCount(); i++) {
+            collectShown(layout->getChildAt(i), shown);
+        }
+    }
+}
+
+/**
+ * Stops displaying an item and the items displayed in it.
+ */
+static void hide(std::map<int, Shown>& shown, int id) {
+    shown.erase(id);
+    for (auto i = shown.begin(); i != shown.end();) {
+        if (std::get<4>(i->second) == id) {
+            int child = i->first;
+            hide(shown, child);
+            i = shown.upper_bound(child);
+        } else {
+            ++i;
+        }
+    }
+}
+
+/**
+ * Moves a random item of the tree, or an item removed earlier, to a random container, or removes
+ * a random item to be added again later. The description follows the tree.
+ */
+static void move(Generator& generator, Desc& desc, Item* root, std::vector<std::pair<Item*, Desc>>& removed) {
+    std::vector<int> path;
+    std::vector<std::vector<int>> paths;
+    collectPaths(desc, path, paths);
+    std::pair<Item*, Desc> moved;
+    if (!removed.empty() && generator.next(2) == 0) {
+        int index = generator.next(static_cast<int>(removed.size()));
+        moved = removed[index];
+        removed.erase(removed.begin() + index);
+    } else if (paths.size() > 1) {
+        path = paths[1 + generator.next(static_cast<int>(paths.size()) - 1)];
+        int index = path.back();
+        path.pop_back();
+        Desc& parent = descAt(desc, path);
+        moved = std::make_pair(static_cast<Layout*>(itemAt(root, path))->getChildAt(index), parent.children[index]);
+        static_cast<Layout*>(itemAt(root, path))->removeItemAt(index);
+        parent.children.erase(parent.children.begin() + index);
+        if (generator.next(2) == 0) {
+            removed.push_back(moved);
+            return;
+        }
+    } else {
+        return;
+    }
+    paths.clear();
+    path.clear();
+    collectPaths(desc, path, paths);
+    std::vector<std::vector<int>> containers;
+    for (const auto& candidate : paths) {
+        if (descAt(desc, candidate).kind != ItemKind::ITEM) {
+            containers.push_back(candidate);
+        }
+    }
+    path = containers[generator.next(static_cast<int>(containers.size()))];
+    Desc& parent = descAt(desc, path);
+    int index = generator.next(static_cast<int>(parent.children.size()) + 1);
+    static_cast<Layout*>(itemAt(root, path))->addItem(moved.first, index);
+    parent.children.insert(parent.children.begin() + index, moved.second);
+}
+
+/**
+ * Changes, moves and lays out random trees step by step and writes the damage set of each step,
+ * into buffers large enough or not: a renderer applying the records must display the frames of
+ * the tree written whole, and a damage set written at once must only hold the frames which
+ * changed for the renderer and the removals.
+ *
+ * Usage: LayoutResultWriterTest [runs [first seed]]
+ */
+int main(int argc, char** argv) {
+    int runs = argc > 1 ? atoi(argv[1]) : 1000;
+    unsigned int firstSeed = argc > 2 ? static_cast<unsigned int>(atoi(argv[2])) : 0;
+    int failures = 0;
+    for (unsigned int seed = firstSeed; seed < firstSeed + runs; seed++) {
+        Generator generator(seed);
+        Desc desc = generator.tree(3);
+        desc.kind = ItemKind::FLEX + generator.next(3);
+        Items items(false);
+        Item* root = items.build(desc);
+        std::vector<std::pair<Item*, Desc>> removed;
+        std::map<int, Item*> ids;
+        int nextId = 0;
+        std::map<int, Shown> shown;
+        bool failed = false;
+        for (int step = 0; step < 20 && !failed; step++) {
+            if (step > 0) {
+                for (int i = 1 + generator.next(3); i > 0; i--) {
+                    if (generator.next(3) == 0) {
+                        move(generator, desc, root, removed);
+                    } else {
+                        mutate(generator, items, desc, root);
+                    }
+                }
+            }
+            assignIds(root, nextId, ids);
+            layoutRoot(root, Item::MeasureSpec::makeMeasureSpec(100 + generator.next(600),
+                                                                Item::MeasureSpec::EXACTLY),
+                       Item::MeasureSpec::makeMeasureSpec(100 + generator.next(600), Item::MeasureSpec::AT_MOST));
+
+            bool large = generator.next(2) == 0;
+            // The whole tree is only written into a buffer large enough.
+            bool whole = large && generator.next(4) == 0;
+            std::vector<int32_t> buffer((sizeof(LayoutResultWriter::Header)
+                                         + (large ? 2 * ids.size() : 1 + generator.next(8))
+                                           * sizeof(LayoutResultWriter::Record)) / sizeof(int32_t));
+            LayoutResultWriter writer(buffer.data(), buffer.size() * sizeof(int32_t));
+            if (whole) {
+                shown.clear();
+            }
+            do {
+                size_t count = whole ? writer.writeFrames(root) : writer.writeDamagedFrames(root);
+                auto records = reinterpret_cast<const LayoutResultWriter::Record*>(
+                        buffer.data() + sizeof(LayoutResultWriter::Header) / sizeof(int32_t));
+                for (size_t i = 0; i < count; i++) {
+                    const LayoutResultWriter::Record& record = records[i];
+                    if (record.width == LayoutResultWriter::REMOVED && record.height == LayoutResultWriter::REMOVED) {
+                        hide(shown, record.id);
+                        continue;
+                    }
+                    Shown frame = shownOf(record, ids);
+                    auto previous = shown.find(record.id);
+                    if (!whole && large && previous != shown.end() && previous->second == frame) {
+                        printf("seed %u: an unchanged frame is written at step %d\n", seed, step);
+                        failed = true;
+                    }
+                    shown[record.id] = frame;
+                }
+                // A full buffer is written again, the items left are still in the damage set.
+                whole = false;
+            } while (!writer.isComplete());
+
+            std::map<int, Shown> expected;
+            collectShown(root, expected);
+            if (!failed && shown != expected) {
+                printf("seed %u: the frames displayed differ from the tree at step %d\n", seed, step);
+                failed = true;
+            }
+        }
+        if (failed) {
+            failures++;
+        }
+    }
+    printf("%d/%d runs differ\n", failures, runs);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
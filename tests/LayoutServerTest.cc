@@ -0,0 +1,185 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "ItemArena.h"
+#include "LayoutResultWriter.h"
+#include "LayoutServer.h"
+#include "RandomTree.h"
+#include "TreeFormat.h"
+
+/** The statuses of a response, and the end of the connection */
+static constexpr int OK = LayoutProtocol::Status::OK;
+static constexpr int ERROR = LayoutProtocol::Status::ERROR;
+static constexpr int CLOSED = -1;
+
+static bool readFully(int fd, void* data, size_t size) {
+    char* next = static_cast<char*>(data);
+    while (size > 0) {
+        ssize_t count = read(fd, next, size);
+        if (count <= 0) {
+            return false;
+        }
+        next += count;
+        size -= count;
+    }
+    return true;
+}
+
+static bool writeFully(int fd, const void* data, size_t size) {
+    const char* next = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t count = write(fd, next, size);
+        if (count <= 0) {
+            return false;
+        }
+        next += count;
+        size -= count;
+    }
+    return true;
+}
+
+static void send(int fd, uint32_t templateId, int widthMeasureSpec, int heightMeasureSpec,
+                 const std::vector<char>& tree) {
+    LayoutProtocol::RequestHeader header = {};
+    std::memcpy(header.magic, LayoutProtocol::REQUEST_MAGIC, sizeof(header.magic));
+    header.requestId = templateId;
+    header.templateId = templateId;
+    header.widthMeasureSpec = widthMeasureSpec;
+    header.heightMeasureSpec = heightMeasureSpec;
+    header.treeSize = static_cast<uint32_t>(tree.size());
+    writeFully(fd, &header, sizeof(header)) && writeFully(fd, tree.data(), tree.size());
+}
+
+/**
+ * @return the status of the response, or CLOSED
+ */
+static int receive(int fd, std::vector<char>& payload) {
+    LayoutProtocol::ResponseHeader header;
+    if (!readFully(fd, &header, sizeof(header))) {
+        return CLOSED;
+    }
+    payload.resize(header.size);
+    return readFully(fd, payload.data(), payload.size()) ? static_cast<int>(header.status) : CLOSED;
+}
+
+/**
+ * Gives the items their index in pre-order as id, as the server does.
+ */
+static void assignIds(Item* item, int& id) {
+    item->setId(id++);
+    if (Layout* layout = dynamic_cast<Layout*>(item)) {
+        for (int i = 0; i < layout->getChildCount(); i++) {
+            assignIds(layout->getChildAt(i), id);
+        }
+    }
+}
+
+/**
+ * The frames the server must reply for the tree.
+ */
+static std::vector<char> layOut(const std::vector<char>& tree, int widthMeasureSpec, int heightMeasureSpec) {
+    ItemArena arena;
+    Item* root = TreeFormat::read(tree.data(), tree.size(), &arena);
+    int id = 0;
+    assignIds(root, id);
+    root->measure(widthMeasureSpec, heightMeasureSpec);
+    root->layout(0, 0, root->getMeasuredWidth() & Item::MEASURED_SIZE_MASK,
+                 root->getMeasuredHeight() & Item::MEASURED_SIZE_MASK);
+    size_t itemCount = reinterpret_cast<const TreeFormat::Header*>(tree.data())->nodeCount;
+    std::vector<int32_t> frames((sizeof(LayoutResultWriter::Header) + itemCount * sizeof(LayoutResultWriter::Record))
+                                / sizeof(int32_t));
+    LayoutResultWriter writer(frames.data(), frames.size() * sizeof(int32_t));
+    writer.writeFrames(root);
+    auto begin = reinterpret_cast<const char*>(frames.data());
+    return std::vector<char>(begin, begin + writer.getSize());
+}
+
+/**
+ * Sends random trees to a server over socket pairs, then the same trees with a record out of
+ * range, malformed specs and the earlier trees reused: a malformed request must be answered with
+ * an error and leave the template as it was. Then a request with a wrong magic must close the
+ * connection once the earlier requests are answered.
+ *
+ * Usage: LayoutServerTest [runs [first seed]]
+ */
+int main(int argc, char** argv) {
+    int runs = argc > 1 ? atoi(argv[1]) : 200;
+    unsigned int firstSeed = argc > 2 ? static_cast<unsigned int>(atoi(argv[2])) : 0;
+    int failures = 0;
+    // The server closing its end must fail the writes instead of killing the test.
+    std::signal(SIGPIPE, SIG_IGN);
+    LayoutServer server(2);
+    for (unsigned int seed = firstSeed; seed < firstSeed + runs; seed++) {
+        Generator generator(seed);
+        Items items(false);
+        std::vector<char> tree = TreeFormat::write(items.build(generator.tree(3)));
+        int widthMeasureSpec = Item::MeasureSpec::makeMeasureSpec(100 + generator.next(600),
+                                                                  Item::MeasureSpec::EXACTLY);
+        int heightMeasureSpec = Item::MeasureSpec::makeMeasureSpec(100 + generator.next(600),
+                                                                   Item::MeasureSpec::AT_MOST);
+        std::vector<char> expected = layOut(tree, widthMeasureSpec, heightMeasureSpec);
+
+        std::vector<char> corrupted(tree);
+        auto header = reinterpret_cast<const TreeFormat::Header*>(tree.data());
+        size_t offset = sizeof(TreeFormat::Header)
+                        + generator.next(static_cast<int>(header->nodeCount)) * sizeof(TreeFormat::NodeRecord);
+        reinterpret_cast<TreeFormat::NodeRecord*>(corrupted.data() + offset)->visibility = 3;
+
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+            perror("socketpair");
+            return EXIT_FAILURE;
+        }
+        std::thread serving([&server, &fds] { server.serve(fds[1], fds[1], true); });
+        // The templates are shared by the runs.
+        uint32_t templateId = seed;
+        std::vector<char> payload;
+        const char* failure = nullptr;
+        send(fds[0], templateId, widthMeasureSpec, heightMeasureSpec, tree);
+        if (receive(fds[0], payload) != OK || payload != expected) {
+            failure = "the frames of a tree differ";
+        }
+        send(fds[0], templateId, widthMeasureSpec, heightMeasureSpec, corrupted);
+        if (!failure && receive(fds[0], payload) != ERROR) {
+            failure = "a record out of range is laid out";
+        }
+        send(fds[0], templateId, widthMeasureSpec | Item::MeasureSpec::MODE_MASK, heightMeasureSpec, {});
+        if (!failure && receive(fds[0], payload) != ERROR) {
+            failure = "a malformed spec is laid out";
+        }
+        send(fds[0], templateId, widthMeasureSpec, heightMeasureSpec, {});
+        if (!failure && (receive(fds[0], payload) != OK || payload != expected)) {
+            failure = "a malformed request changes the template";
+        }
+
+        // Answered before the connection is closed.
+        send(fds[0], templateId, widthMeasureSpec, heightMeasureSpec, {});
+        LayoutProtocol::RequestHeader wrong = {};
+        writeFully(fds[0], &wrong, sizeof(wrong));
+        if (!failure && receive(fds[0], payload) != OK) {
+            failure = "a request isn't answered before the connection is closed";
+        }
+        if (!failure && receive(fds[0], payload) != CLOSED) {
+            failure = "a malformed request doesn't close the connection";
+        }
+        serving.join();
+        close(fds[0]);
+        if (failure) {
+            printf("seed %u: %s\n", seed, failure);
+            failures++;
+        }
+    }
+    printf("%d/%d runs differ\n", failures, runs);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
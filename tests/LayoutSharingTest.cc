@@ -0,0 +1,116 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include "RandomTree.h"
+
+/**
+ * Enables the layout sharing on all the containers of a tree.
+ */
+static void shareLayouts(Item* item) {
+    if (Layout* layout = dynamic_cast<Layout*>(item)) {
+        layout->setLayoutSharing(true);
+        for (int i = 0; i < layout->getChildCount(); i++) {
+            shareLayouts(layout->getChildAt(i));
+        }
+    }
+}
+
+static void destroySubtree(Items& items, Item* item) {
+    if (Layout* layout = dynamic_cast<Layout*>(item)) {
+        while (layout->getChildCount() > 0) {
+            Item* child = layout->getChildAt(0);
+            layout->removeItemAt(0);
+            destroySubtree(items, child);
+        }
+    }
+    items.destroy(item);
+}
+
+/**
+ * Repeats the first child of some containers, so that there are siblings to share with.
+ */
+static void repeatChildren(Generator& generator, Desc& desc) {
+    if (!desc.children.empty() && generator.next(2) == 0) {
+        desc.children.resize(2 + generator.next(4), desc.children[0]);
+    }
+    for (auto& child : desc.children) {
+        repeatChildren(generator, child);
+    }
+}
+
+/**
+ * Enables the layout sharing on all the containers of random trees with runs of equal siblings,
+ * changes the attributes of random items and compares the frames with the same trees laid out
+ * without sharing: a child may only copy the layout of a sibling which is still equal to it, and
+ * which hasn't been removed since the measure.
+ *
+ * Usage: LayoutSharingTest [runs [first seed]]
+ */
+int main(int argc, char** argv) {
+    int runs = argc > 1 ? atoi(argv[1]) : 2000;
+    unsigned int firstSeed = argc > 2 ? static_cast<unsigned int>(atoi(argv[2])) : 0;
+    int failures = 0;
+    for (unsigned int seed = firstSeed; seed < firstSeed + runs; seed++) {
+        Generator generator(seed);
+        Desc desc = generator.tree(3);
+        desc.kind = ItemKind::FLEX + generator.next(3);
+        repeatChildren(generator, desc);
+        Items items;
+        Item* root = items.build(desc);
+        shareLayouts(root);
+        std::vector<int> path;
+        std::vector<std::vector<int>> paths;
+        collectPaths(desc, path, paths);
+        for (int step = 0; step < 10; step++) {
+            if (step > 0) {
+                for (int i = 1 + generator.next(3); i > 0; i--) {
+                    const auto& itemPath = paths[generator.next(static_cast<int>(paths.size()))];
+                    Desc& target = descAt(desc, itemPath);
+                    int attribute = generator.next(ATTRIBUTE_COUNT);
+                    int value = generator.next(20);
+                    target.attributes.emplace_back(attribute, value);
+                    applyAttribute(itemAt(root, itemPath), target.kind, attribute, value);
+                }
+            }
+            int widthMeasureSpec = Item::MeasureSpec::makeMeasureSpec(100 + generator.next(600),
+                                                                      Item::MeasureSpec::EXACTLY);
+            int heightMeasureSpec = Item::MeasureSpec::makeMeasureSpec(100 + generator.next(600),
+                                                                       Item::MeasureSpec::AT_MOST);
+            root->measure(widthMeasureSpec, heightMeasureSpec);
+            if (generator.next(3) == 0) {
+                // A source copied by the measure may be removed and destroyed before the layout.
+                const auto& itemPath = paths[generator.next(static_cast<int>(paths.size()))];
+                Desc& target = descAt(desc, itemPath);
+                if (!target.children.empty()) {
+                    int index = generator.next(static_cast<int>(target.children.size()));
+                    auto container = static_cast<Layout*>(itemAt(root, itemPath));
+                    Item* child = container->getChildAt(index);
+                    container->removeItemAt(index);
+                    destroySubtree(items, child);
+                    target.children.erase(target.children.begin() + index);
+                    root->layout(0, 0, root->getMeasuredWidth(), root->getMeasuredHeight());
+                    paths.clear();
+                    collectPaths(desc, path, paths);
+                }
+            }
+            layoutRoot(root, widthMeasureSpec, heightMeasureSpec);
+            int result = compareWithReference(root, desc, widthMeasureSpec, heightMeasureSpec);
+            if (result < 0) {
+                break;
+            }
+            if (result == 0) {
+                printf("seed %u: the frames differ after step %d\n", seed, step);
+                failures++;
+                break;
+            }
+        }
+    }
+    printf("%d/%d runs differ\n", failures, runs);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include "LayoutSnapshot.h"
+#include "RandomTree.h"
+
+/**
+ * Restores the snapshots of random trees into new trees built from the same descriptions and
+ * compares the frames with the snapshotted trees, then checks that the snapshot doesn't apply to
+ * a changed tree, and that a corrupted snapshot is either rejected or restored into a tree which
+ * can still be laid out.
+ *
+ * Usage: LayoutSnapshotTest [runs [first seed]]
+ */
+int main(int argc, char** argv) {
+    int runs = argc > 1 ? atoi(argv[1]) : 2000;
+    unsigned int firstSeed = argc > 2 ? static_cast<unsigned int>(atoi(argv[2])) : 0;
+    int failures = 0;
+    for (unsigned int seed = firstSeed; seed < firstSeed + runs; seed++) {
+        Generator generator(seed);
+        Desc desc = generator.tree(3);
+        desc.kind = ItemKind::FLEX + generator.next(3);
+        Items items(false);
+        Item* root = items.build(desc);
+        int widthMeasureSpec = Item::MeasureSpec::makeMeasureSpec(100 + generator.next(600),
+                                                                  Item::MeasureSpec::EXACTLY);
+        int heightMeasureSpec = Item::MeasureSpec::makeMeasureSpec(100 + generator.next(600),
+                                                                   Item::MeasureSpec::AT_MOST);
+        layoutRoot(root, widthMeasureSpec, heightMeasureSpec);
+        uint64_t contentKey = generator.next(2);
+        std::vector<char> bytes = LayoutSnapshot::write(root, contentKey);
+        // The records are read in place, aligned on 4 bytes.
+        std::vector<int32_t> snapshot((bytes.size() + 3) / 4);
+        std::memcpy(snapshot.data(), bytes.data(), bytes.size());
+
+        std::vector<int> expected;
+        collectFrames(root, expected);
+        Item* restored = items.build(desc);
+        bool applied = LayoutSnapshot::restore(restored, snapshot.data(), bytes.size(), widthMeasureSpec,
+                                               heightMeasureSpec, contentKey);
+        layoutRoot(restored, widthMeasureSpec, heightMeasureSpec);
+        std::vector<int> actual;
+        collectFrames(restored, actual);
+        if (!applied || actual != expected) {
+            printf("seed %u: the restored frames differ\n", seed);
+            failures++;
+            continue;
+        }
+
+        if (LayoutSnapshot::restore(items.build(desc), snapshot.data(), bytes.size(), widthMeasureSpec,
+                                    heightMeasureSpec, contentKey + 1)) {
+            printf("seed %u: the snapshot applies to another content\n", seed);
+            failures++;
+            continue;
+        }
+        Desc changed = desc;
+        changed.attributes.emplace_back(0, 2 + generator.next(18));
+        Item* other = items.build(changed);
+        bool sameWidth = other->getWidth() == root->getWidth();
+        if (!sameWidth && LayoutSnapshot::restore(other, snapshot.data(), bytes.size(), widthMeasureSpec,
+                                                  heightMeasureSpec, contentKey)) {
+            printf("seed %u: the snapshot applies to another tree\n", seed);
+            failures++;
+            continue;
+        }
+
+        // The words after the header, whose hashes would reject the snapshot.
+        int headerWords = sizeof(LayoutSnapshot::Header) / 4;
+        for (int i = 0; i < 4 && static_cast<int>(snapshot.size()) > headerWords; i++) {
+            std::vector<int32_t> corrupted = snapshot;
+            int word = headerWords + generator.next(static_cast<int>(corrupted.size()) - headerWords);
+            corrupted[word] = generator.next(2) == 0 ? corrupted[word] + generator.next(5) - 2 : -generator.next(3);
+            Item* target = items.build(desc);
+            try {
+                LayoutSnapshot::restore(target, corrupted.data(), bytes.size(), widthMeasureSpec, heightMeasureSpec,
+                                        contentKey);
+            } catch (const std::invalid_argument&) {
+                continue;
+            }
+            layoutRoot(target, widthMeasureSpec, heightMeasureSpec);
+        }
+    }
+    printf("%d/%d runs differ\n", failures, runs);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
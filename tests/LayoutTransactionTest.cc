@@ -0,0 +1,60 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include "LayoutTransaction.h"
+#include "RandomTree.h"
+
+/**
+ * Mutates random trees inside transactions, some of them nested, lays them out again with
+ * Item::layoutIfNeeded() and compares the frames with the same trees measured from scratch: the
+ * invalidations deferred to the commit must have the effect of the immediate ones.
+ *
+ * Usage: LayoutTransactionTest [runs [first seed]]
+ */
+int main(int argc, char** argv) {
+    int runs = argc > 1 ? atoi(argv[1]) : 2000;
+    unsigned int firstSeed = argc > 2 ? static_cast<unsigned int>(atoi(argv[2])) : 0;
+    int failures = 0;
+    for (unsigned int seed = firstSeed; seed < firstSeed + runs; seed++) {
+        Generator generator(seed);
+        Desc desc = generator.tree(3);
+        desc.kind = ItemKind::FLEX + generator.next(3);
+        Items items;
+        Item* root = items.build(desc);
+        int widthMeasureSpec = Item::MeasureSpec::makeMeasureSpec(300 + generator.next(400),
+                                                                  Item::MeasureSpec::EXACTLY);
+        int heightMeasureSpec = Item::MeasureSpec::makeMeasureSpec(300 + generator.next(400),
+                                                                   Item::MeasureSpec::EXACTLY);
+        layoutRoot(root, widthMeasureSpec, heightMeasureSpec);
+        for (int step = 0; step < 10; step++) {
+            {
+                LayoutTransaction transaction;
+                for (int i = 1 + generator.next(5); i > 0; i--) {
+                    mutate(generator, items, desc, root);
+                    if (generator.next(4) == 0) {
+                        LayoutTransaction nested;
+                        mutate(generator, items, desc, root);
+                    }
+                }
+            }
+            root->layoutIfNeeded();
+            int result = compareWithReference(root, desc, widthMeasureSpec, heightMeasureSpec);
+            if (result < 0) {
+                break;
+            }
+            if (result == 0) {
+                printf("seed %u: the frames differ after transaction %d\n", seed, step);
+                failures++;
+                break;
+            }
+        }
+    }
+    printf("%d/%d runs differ\n", failures, runs);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "Layout.h"
+
+/**
+ * Computes the specs of random batches of children with the vectorized
+ * Layout::getChildMeasureSpecs and compares each one with the scalar Layout::getChildMeasureSpec.
+ * The batches have every length around the vector widths, so that the scalar tail is covered too.
+ *
+ * Usage: MeasureSpecKernelTest [runs [first seed]]
+ */
+int main(int argc, char** argv) {
+    int runs = argc > 1 ? atoi(argv[1]) : 20000;
+    unsigned int firstSeed = argc > 2 ? static_cast<unsigned int>(atoi(argv[2])) : 0;
+    int failures = 0;
+    for (unsigned int seed = firstSeed; seed < firstSeed + runs; seed++) {
+        std::mt19937 random(seed);
+        int modes[] = {Item::MeasureSpec::EXACTLY, Item::MeasureSpec::AT_MOST, Item::MeasureSpec::UNSPECIFIED};
+        // Sizes up to the largest a spec can hold.
+        int size = random() % 4 == 0 ? static_cast<int>(random() & Item::MEASURED_SIZE_MASK)
+                                     : static_cast<int>(random() % 2000);
+        int spec = Item::MeasureSpec::makeMeasureSpec(size, modes[random() % 3]);
+        int count = static_cast<int>(random() % 20);
+        std::vector<int> paddings(count);
+        std::vector<int> childDimensions(count);
+        std::vector<float> percents(count);
+        for (int i = 0; i < count; i++) {
+            // Negative margins may make the padding negative.
+            paddings[i] = static_cast<int>(random() % 300) - 50;
+            switch (random() % 4) {
+                case 0:
+                    childDimensions[i] = Item::LayoutParams::MATCH_PARENT;
+                    break;
+                case 1:
+                    childDimensions[i] = Item::LayoutParams::WRAP_CONTENT;
+                    break;
+                default:
+                    childDimensions[i] = static_cast<int>(random() % 3000);
+                    break;
+            }
+            percents[i] = random() % 2 == 0 ? 1.0f : static_cast<float>(random() % 101) / 100;
+        }
+        std::vector<int> measureSpecs(count);
+        Layout::getChildMeasureSpecs(spec, paddings.data(), childDimensions.data(), percents.data(),
+                                     measureSpecs.data(), count);
+        for (int i = 0; i < count; i++) {
+            int expected = Layout::getChildMeasureSpec(spec, paddings[i], childDimensions[i], percents[i]);
+            if (measureSpecs[i] != expected) {
+                printf("seed %u: child %d has the spec %x instead of %x\n", seed, i, measureSpecs[i], expected);
+                failures++;
+                break;
+            }
+        }
+    }
+    printf("%d/%d runs differ\n", failures, runs);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
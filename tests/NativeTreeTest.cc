@@ -0,0 +1,259 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include "NativeTree.h"
+#include "RandomTree.h"
+
+/**
+ * The nodes a sender has created, as it keeps track of them to write valid messages.
+ */
+struct Model {
+    /** The type of each node, or -1 if it's free */
+    std::vector<int> types;
+    std::vector<int> parents;
+    std::vector<std::vector<int>> children;
+
+    std::vector<int> nodes() const {
+        std::vector<int> result;
+        for (int node = 0; node < static_cast<int>(types.size()); node++) {
+            if (types[node] != -1) {
+                result.push_back(node);
+            }
+        }
+        return result;
+    }
+
+    bool contains(int ancestor, int node) const {
+        for (; node != -1; node = parents[node]) {
+            if (node == ancestor) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void detach(int node) {
+        if (parents[node] != -1) {
+            auto& siblings = children[parents[node]];
+            siblings.erase(std::find(siblings.begin(), siblings.end(), node));
+            parents[node] = -1;
+        }
+    }
+};
+
+static int attributeOf(const char* name) {
+    const auto& names = NativeTree::getAttributeNames();
+    return static_cast<int>(std::find(names.begin(), names.end(), name) - names.begin());
+}
+
+/**
+ * Appends a random valid operation to the message and applies it to the model.
+ */
+static void appendOperation(Generator& generator, Model& model, std::vector<double>& ops) {
+    std::vector<int> nodes = model.nodes();
+    int choice = nodes.empty() ? 0 : generator.next(8);
+    if (choice == 0) {
+        auto free = std::find(model.types.begin(), model.types.end(), -1);
+        int node = static_cast<int>(free - model.types.begin());
+        if (free == model.types.end()) {
+            model.types.push_back(-1);
+            model.parents.push_back(-1);
+            model.children.emplace_back();
+        }
+        model.types[node] = generator.next(4);
+        ops.insert(ops.end(), {NativeTree::CREATE, static_cast<double>(node), static_cast<double>(model.types[node])});
+        return;
+    }
+    int node = nodes[generator.next(static_cast<int>(nodes.size()))];
+    if (choice <= 3) {
+        // Values in the ranges of the attributes, a padding being ignored by an item.
+        static const std::pair<const char*, int> attributes[] = {
+                {"width", 200}, {"height", 200}, {"marginLeft", 10}, {"marginTop", 10}, {"paddingLeft", 10},
+                {"flexGrow", 3}, {"flexDirection", 4}, {"flexWrap", 3}, {"orientation", 2}};
+        const auto& attribute = attributes[generator.next(sizeof(attributes) / sizeof(attributes[0]))];
+        ops.insert(ops.end(), {NativeTree::SET, static_cast<double>(node),
+                               static_cast<double>(attributeOf(attribute.first)),
+                               static_cast<double>(generator.next(attribute.second))});
+    } else if (choice <= 5) {
+        std::vector<int> containers;
+        for (int container : nodes) {
+            if (model.types[container] != NativeTree::TYPE_ITEM && !model.contains(node, container)) {
+                containers.push_back(container);
+            }
+        }
+        if (containers.empty()) {
+            return;
+        }
+        int parent = containers[generator.next(static_cast<int>(containers.size()))];
+        if (model.parents[node] != -1) {
+            ops.insert(ops.end(), {NativeTree::REMOVE, static_cast<double>(node)});
+            model.detach(node);
+        }
+        int index = generator.next(static_cast<int>(model.children[parent].size()) + 2) - 1;
+        ops.insert(ops.end(), {NativeTree::INSERT, static_cast<double>(parent), static_cast<double>(node),
+                               static_cast<double>(index)});
+        auto& siblings = model.children[parent];
+        siblings.insert(index == -1 ? siblings.end() : siblings.begin() + index, node);
+        model.parents[node] = parent;
+    } else if (choice == 6) {
+        ops.insert(ops.end(), {NativeTree::REMOVE, static_cast<double>(node)});
+        model.detach(node);
+    } else {
+        ops.insert(ops.end(), {NativeTree::DESTROY, static_cast<double>(node)});
+        model.detach(node);
+        for (int child : model.children[node]) {
+            model.parents[child] = -1;
+        }
+        model.children[node].clear();
+        model.types[node] = -1;
+    }
+}
+
+/**
+ * Appends an invalid operation to the message, for the model as the message leaves it.
+ */
+static void appendInvalidOperation(Generator& generator, const Model& model, std::vector<double>& ops) {
+    std::vector<int> nodes = model.nodes();
+    if (nodes.empty()) {
+        ops.insert(ops.end(), {NativeTree::SET, 0, static_cast<double>(attributeOf("width")), 10});
+        return;
+    }
+    auto node = static_cast<double>(nodes[generator.next(static_cast<int>(nodes.size()))]);
+    switch (generator.next(8)) {
+        case 0:
+            ops.insert(ops.end(), {7, node});
+            break;
+        case 1:
+            ops.insert(ops.end(), {NativeTree::CREATE, node, NativeTree::TYPE_ITEM});
+            break;
+        case 2:
+            ops.insert(ops.end(), {NativeTree::SET, node, static_cast<double>(attributeOf("visibility")), 3});
+            break;
+        case 3:
+            ops.insert(ops.end(), {NativeTree::SET, node, static_cast<double>(attributeOf("width")), NAN});
+            break;
+        case 4:
+            ops.insert(ops.end(), {NativeTree::SET, node, static_cast<double>(attributeOf("width"))});
+            break;
+        case 5: {
+            // A container inserted into itself or into a container it contains.
+            std::vector<int> containers;
+            for (int container : nodes) {
+                if (model.types[container] != NativeTree::TYPE_ITEM && model.parents[container] == -1) {
+                    containers.push_back(container);
+                }
+            }
+            if (containers.empty()) {
+                ops.insert(ops.end(), {NativeTree::INSERT, node, node, -1});
+                break;
+            }
+            int ancestor = containers[generator.next(static_cast<int>(containers.size()))];
+            int descendant = ancestor;
+            while (!model.children[descendant].empty() && generator.next(2) == 0) {
+                int child = model.children[descendant][0];
+                if (model.types[child] == NativeTree::TYPE_ITEM) {
+                    break;
+                }
+                descendant = child;
+            }
+            ops.insert(ops.end(), {NativeTree::INSERT, static_cast<double>(descendant),
+                                   static_cast<double>(ancestor), -1});
+            break;
+        }
+        case 6:
+            ops.insert(ops.end(), {NativeTree::DESTROY, node, NativeTree::SET, node,
+                                   static_cast<double>(attributeOf("height")), 10});
+            break;
+        default:
+            ops.insert(ops.end(), {NativeTree::SET, node, static_cast<double>(attributeOf("width")), -3});
+            break;
+    }
+}
+
+/**
+ * Lays out the roots of the tree and returns its frames.
+ */
+static std::vector<int32_t> layOut(NativeTree& tree, const Model& model, int widthMeasureSpec,
+                                   int heightMeasureSpec) {
+    for (int node : model.nodes()) {
+        if (model.parents[node] == -1) {
+            tree.layout(node, widthMeasureSpec, heightMeasureSpec);
+        }
+    }
+    std::vector<int32_t> frames(tree.getFrameCount() * NativeTree::FRAME_SIZE);
+    tree.getFrames(frames.data());
+    return frames;
+}
+
+/**
+ * Sends random valid messages to two trees, and to one of them messages made of valid operations
+ * followed by an invalid one, e.g. a cycle, an operation on a released node or a value out of
+ * range: each of those must be rejected and change nothing, so that both trees take the same
+ * messages afterwards and lay them out with the same frames.
+ *
+ * Usage: NativeTreeTest [runs [first seed]]
+ */
+int main(int argc, char** argv) {
+    int runs = argc > 1 ? atoi(argv[1]) : 1000;
+    unsigned int firstSeed = argc > 2 ? static_cast<unsigned int>(atoi(argv[2])) : 0;
+    int failures = 0;
+    for (unsigned int seed = firstSeed; seed < firstSeed + runs; seed++) {
+        Generator generator(seed);
+        NativeTree tree;
+        NativeTree expected;
+        Model model;
+        const char* failure = nullptr;
+        for (int step = 0; step < 20 && failure == nullptr; step++) {
+            std::vector<double> ops;
+            for (int i = generator.next(12); i > 0; i--) {
+                appendOperation(generator, model, ops);
+            }
+            try {
+                tree.apply(ops.data(), ops.size());
+                expected.apply(ops.data(), ops.size());
+            } catch (const std::invalid_argument& e) {
+                printf("seed %u: %s\n", seed, e.what());
+                failure = "a valid message is rejected";
+                break;
+            }
+
+            if (generator.next(2) == 0) {
+                Model rejected = model;
+                ops.clear();
+                for (int i = generator.next(6); i > 0; i--) {
+                    appendOperation(generator, rejected, ops);
+                }
+                appendInvalidOperation(generator, rejected, ops);
+                try {
+                    tree.apply(ops.data(), ops.size());
+                    failure = "an invalid message is applied";
+                } catch (const std::invalid_argument&) {
+                }
+            }
+
+            int widthMeasureSpec = Item::MeasureSpec::makeMeasureSpec(100 + generator.next(600),
+                                                                      Item::MeasureSpec::EXACTLY);
+            int heightMeasureSpec = Item::MeasureSpec::makeMeasureSpec(100 + generator.next(600),
+                                                                       Item::MeasureSpec::AT_MOST);
+            if (failure == nullptr && layOut(tree, model, widthMeasureSpec, heightMeasureSpec)
+                                      != layOut(expected, model, widthMeasureSpec, heightMeasureSpec)) {
+                failure = "a rejected message changes the tree";
+            }
+        }
+        if (failure) {
+            printf("seed %u: %s\n", seed, failure);
+            failures++;
+        }
+    }
+    printf("%d/%d runs differ\n", failures, runs);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,392 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <vector>
+#include "FlexLayout.h"
+#include "FlowLayout.h"
+#include "LinearLayout.h"
+
+/**
+ * The kinds of items of the random trees.
+ */
+struct ItemKind {
+    static constexpr int ITEM = 0;
+    static constexpr int FLEX = 1;
+    static constexpr int LINEAR = 2;
+    static constexpr int FLOW = 3;
+};
+
+/**
+ * The number of attributes set by {@link #applyAttribute(Item*, int, int, int)} when a tree is
+ * generated, the last ones being those of the container kind.
+ */
+constexpr int ATTRIBUTE_COUNT = 20;
+
+/**
+ * The number of attributes changed by {@link #mutate(Generator&, Items&, Desc&, Item*)}: the
+ * margins, the padding and the visibility are only changed on existing trees.
+ */
+constexpr int MUTATED_ATTRIBUTE_COUNT = ATTRIBUTE_COUNT + 3;
+
+/**
+ * Random layout trees for the differential tests: a tree is kept as a description next to the
+ * live items, so that the description can be replayed on new items to get the reference layout
+ * of the same tree measured from scratch.
+ */
+struct Desc {
+    int kind = ItemKind::ITEM;
+    /** The attributes in the order they are set, as (attribute, value) pairs. */
+    std::vector<std::pair<int, int>> attributes;
+    std::vector<Desc> children;
+};
+
+/**
+ * Records whether the container laid the item out: items which are not laid out keep the frame
+ * of their last layout, which new items don't have.
+ */
+struct Probed {
+    bool laidOut = false;
+};
+
+template<class T>
+struct Probe : T, Probed {
+    void onLayout(bool changed, int left, int top, int right, int bottom) override {
+        laidOut = true;
+        T::onLayout(changed, left, top, right, bottom);
+    }
+};
+
+class Generator {
+public:
+    explicit Generator(unsigned int seed) : mRandom(seed) {}
+
+    int next(int bound) {
+        return static_cast<int>(mRandom() % bound);
+    }
+
+    Desc tree(int depth) {
+        Desc desc;
+        desc.kind = depth > 0 && next(3) != 0 ? ItemKind::FLEX + next(3) : ItemKind::ITEM;
+        for (int i = next(5); i > 0; i--) {
+            desc.attributes.emplace_back(next(ATTRIBUTE_COUNT), next(20));
+        }
+        if (desc.kind != ItemKind::ITEM) {
+            for (int i = next(5); i > 0; i--) {
+                desc.children.push_back(tree(depth - 1));
+            }
+        }
+        return desc;
+    }
+
+private:
+    std::mt19937 mRandom;
+};
+
+/**
+ * A text of words of various widths, broken into lines of 16 at the width it is given.
+ *
+ * @param words the number of words
+ */
+inline Item::MeasureFunction measureText(int words) {
+    return [words](Item* /* item */, int widthMeasureSpec, int /* heightMeasureSpec */) {
+        int available = Item::MeasureSpec::getMode(widthMeasureSpec) == Item::MeasureSpec::UNSPECIFIED
+                        ? INT_MAX : Item::MeasureSpec::getSize(widthMeasureSpec);
+        int width = 0;
+        int lineWidth = 0;
+        int lines = 1;
+        for (int i = 0; i < words; i++) {
+            int wordWidth = 10 + i * 7 % 23;
+            if (lineWidth > 0 && lineWidth + 4 + wordWidth > available) {
+                lines++;
+                lineWidth = wordWidth;
+            } else {
+                lineWidth += lineWidth > 0 ? 4 + wordWidth : wordWidth;
+            }
+            width = std::max(width, lineWidth);
+        }
+        return Item::MeasureResult{width, lines * 16, 12};
+    };
+}
+
+inline void applyAttribute(Item* item, int kind, int attribute, int value) {
+    switch (attribute) {
+        case 0:
+            item->setWidth(value % 4 == 0 ? Item::LayoutParams::WRAP_CONTENT
+                                          : value % 4 == 1 ? Item::LayoutParams::MATCH_PARENT : 10 + value * 7);
+            return;
+        case 1:
+            item->setHeight(value % 4 == 0 ? Item::LayoutParams::WRAP_CONTENT
+                                           : value % 4 == 1 ? Item::LayoutParams::MATCH_PARENT : 10 + value * 5);
+            return;
+        case 2:
+            item->setFlexGrow(value % 3);
+            return;
+        case 3:
+            item->setFlexShrink(value % 3);
+            return;
+        case 4:
+            item->setAlignSelf(value % 6 - 1);
+            return;
+        case 5:
+            item->setMinWidth(value % 2 != 0 ? 0 : value * 3);
+            return;
+        case 6:
+            item->setMaxWidth(value % 2 != 0 ? Item::MAX_SIZE : 40 + value * 9);
+            return;
+        case 7:
+            item->setWrapBefore(value % 5 == 0);
+            return;
+        case 8:
+            item->setFlexBasisPercent(value % 3 == 0 ? 0.3f : -1);
+            return;
+        case 9:
+            item->setWeight(value % 3);
+            return;
+        case 10:
+            item->setMinHeight(value % 2 != 0 ? 0 : value * 2);
+            return;
+        case 11:
+            item->setMaxHeight(value % 2 != 0 ? Item::MAX_SIZE : 30 + value * 9);
+            return;
+        case 12:
+            if (kind == ItemKind::ITEM) {
+                item->setMeasureFunction(value % 4 == 0 ? nullptr : measureText(value));
+                // Texts of the same words may share their layouts.
+                item->setContentKey(value % 3 == 0 ? 0 : static_cast<size_t>(value));
+            }
+            return;
+        case 13:
+            if (kind != ItemKind::ITEM) {
+                static_cast<Layout*>(item)->setResizeMode(value % 2 == 0);
+            }
+            return;
+        case 14:
+            item->setOrder(value % 4 == 0 ? value % 3 - 1 : 0);
+            return;
+        case 20:
+            item->setMargins(value % 5, value % 3 * 4, value % 7, value % 2 * 5);
+            return;
+        case 21:
+            if (kind != ItemKind::ITEM) {
+                static_cast<Layout*>(item)->setPadding(value % 4 * 3, value % 3 * 5, value % 5, value % 2 * 6);
+            }
+            return;
+        case 22:
+            item->setVisibility(value % 5 == 0 ? Item::GONE : value % 5 == 1 ? Item::INVISIBLE : Item::VISIBLE);
+            return;
+        default:
+            break;
+    }
+    if (kind == ItemKind::FLEX) {
+        FlexLayout* flex = static_cast<FlexLayout*>(item);
+        switch (attribute) {
+            case 15:
+                flex->setFlexDirection(value % 4);
+                return;
+            case 16:
+                flex->setFlexWrap(value % 2);
+                return;
+            case 17:
+                flex->setJustifyContent(value % 6);
+                return;
+            case 18:
+                flex->setAlignItems(value % 5);
+                return;
+            default:
+                flex->setAlignContent(value % 6);
+                return;
+        }
+    } else if (kind == ItemKind::LINEAR) {
+        static_cast<LinearLayout*>(item)->setOrientation(value % 2);
+    } else if (kind == ItemKind::FLOW) {
+        static_cast<FlowLayout*>(item)->setSingleLine(value % 3 == 0);
+    }
+}
+
+/**
+ * Owns the items of the trees built by a test, the containers don't own their children.
+ */
+class Items {
+public:
+    /**
+     * @param probed whether the items are probes, see collectLaidOut(), or of the plain classes,
+     *               e.g. to be reused by an ItemRecycler or written by TreeFormat
+     */
+    explicit Items(bool probed = true) : mProbed(probed) {}
+
+    Item* create(int kind) {
+        Item* item;
+        switch (kind) {
+            case ItemKind::FLEX:
+                item = mProbed ? new Probe<FlexLayout>() : new FlexLayout();
+                break;
+            case ItemKind::LINEAR:
+                item = mProbed ? new Probe<LinearLayout>() : new LinearLayout();
+                break;
+            case ItemKind::FLOW:
+                item = mProbed ? new Probe<FlowLayout>() : new FlowLayout();
+                break;
+            default:
+                item = mProbed ? new Probe<Item>() : new Item();
+                break;
+        }
+        mItems.emplace_back(item);
+        return item;
+    }
+
+    Item* build(const Desc& desc) {
+        Item* item = create(desc.kind);
+        for (const auto& attribute : desc.attributes) {
+            applyAttribute(item, desc.kind, attribute.first, attribute.second);
+        }
+        for (const auto& child : desc.children) {
+            static_cast<Layout*>(item)->addItem(build(child));
+        }
+        return item;
+    }
+
+    /**
+     * Destroys an item built by this, which is in no container.
+     */
+    void destroy(Item* item) {
+        for (auto& owned : mItems) {
+            if (owned.get() == item) {
+                owned.reset();
+            }
+        }
+    }
+
+private:
+    bool mProbed;
+    std::vector<std::unique_ptr<Item>> mItems;
+};
+
+/**
+ * The index paths of all the items of a tree, in pre-order.
+ */
+inline void collectPaths(const Desc& desc, std::vector<int>& path, std::vector<std::vector<int>>& paths) {
+    paths.push_back(path);
+    for (size_t i = 0; i < desc.children.size(); i++) {
+        path.push_back(static_cast<int>(i));
+        collectPaths(desc.children[i], path, paths);
+        path.pop_back();
+    }
+}
+
+inline Desc& descAt(Desc& root, const std::vector<int>& path) {
+    Desc* desc = &root;
+    for (int index : path) {
+        desc = &desc->children[index];
+    }
+    return *desc;
+}
+
+inline Item* itemAt(Item* root, const std::vector<int>& path) {
+    Item* item = root;
+    for (int index : path) {
+        item = static_cast<Layout*>(item)->getChildAt(index);
+    }
+    return item;
+}
+
+/**
+ * Applies a random change to a random item of a tree and to its description: a new child, the
+ * removal of a child or a new attribute value, margins, padding or visibility included.
+ */
+inline void mutate(Generator& generator, Items& items, Desc& desc, Item* root) {
+    std::vector<int> path;
+    std::vector<std::vector<int>> paths;
+    collectPaths(desc, path, paths);
+    path = paths[generator.next(static_cast<int>(paths.size()))];
+    Desc& target = descAt(desc, path);
+    Item* item = itemAt(root, path);
+    int operation = generator.next(10);
+    if (operation == 0 && target.kind != ItemKind::ITEM) {
+        int index = generator.next(static_cast<int>(target.children.size()) + 1);
+        Desc child = generator.tree(1);
+        static_cast<Layout*>(item)->addItem(items.build(child), index);
+        target.children.insert(target.children.begin() + index, child);
+    } else if (operation == 1 && !target.children.empty()) {
+        int index = generator.next(static_cast<int>(target.children.size()));
+        static_cast<Layout*>(item)->removeItemAt(index);
+        target.children.erase(target.children.begin() + index);
+    } else {
+        int attribute = generator.next(MUTATED_ATTRIBUTE_COUNT);
+        int value = generator.next(20);
+        applyAttribute(item, target.kind, attribute, value);
+        target.attributes.emplace_back(attribute, value);
+    }
+}
+
+inline void layoutRoot(Item* root, int widthMeasureSpec, int heightMeasureSpec) {
+    root->measure(widthMeasureSpec, heightMeasureSpec);
+    root->layout(0, 0, root->getMeasuredWidth(), root->getMeasuredHeight());
+}
+
+/**
+ * Appends the frames of the items of the tree in pre-order, as left, top, right, bottom.
+ */
+inline void collectFrames(Item* item, std::vector<int>& frames) {
+    frames.push_back(item->getLeft());
+    frames.push_back(item->getTop());
+    frames.push_back(item->getRight());
+    frames.push_back(item->getBottom());
+    if (Layout* layout = dynamic_cast<Layout*>(item)) {
+        for (int i = 0; i < layout->getChildCount(); i++) {
+            collectFrames(layout->getChildAt(i), frames);
+        }
+    }
+}
+
+/**
+ * Appends whether each item of the tree has been laid out, in pre-order.
+ */
+inline void collectLaidOut(Item* item, std::vector<bool>& laidOut) {
+    laidOut.push_back(dynamic_cast<Probed*>(item)->laidOut);
+    if (Layout* layout = dynamic_cast<Layout*>(item)) {
+        for (int i = 0; i < layout->getChildCount(); i++) {
+            collectLaidOut(layout->getChildAt(i), laidOut);
+        }
+    }
+}
+
+/**
+ * Compares the frames of a tree with the reference frames of the same tree measured from scratch
+ * with the same specs. The items the reference didn't lay out are not compared.
+ *
+ * @return 1 if they match, 0 if they differ, -1 if the reference overflows the measured sizes
+ */
+inline int compareWithReference(Item* root, const Desc& desc, int widthMeasureSpec, int heightMeasureSpec) {
+    Items items;
+    Item* reference = items.build(desc);
+    layoutRoot(reference, widthMeasureSpec, heightMeasureSpec);
+    std::vector<int> actual;
+    std::vector<int> expected;
+    std::vector<bool> laidOut;
+    collectFrames(root, actual);
+    collectFrames(reference, expected);
+    collectLaidOut(reference, laidOut);
+    for (size_t i = 0; i < expected.size(); i++) {
+        // The random sizes add up beyond what a measured size can hold.
+        if (std::abs(expected[i]) > (1 << 22) || std::abs(actual[i]) > (1 << 22)) {
+            return -1;
+        }
+    }
+    for (size_t i = 0; i < expected.size(); i++) {
+        if (laidOut[i / 4] && actual[i] != expected[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
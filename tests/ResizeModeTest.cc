@@ -0,0 +1,79 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include "RandomTree.h"
+
+/**
+ * Resizes random trees whose containers are in resize mode, with texts among the leaves, and
+ * compares the frames with the same trees measured from scratch for the new size: the sizes the
+ * containers keep have to be the ones a new measure would give. Some resizes come back to an
+ * earlier size, some follow a change of an attribute deep in the tree.
+ *
+ * Usage: ResizeModeTest [runs [first seed]]
+ */
+int main(int argc, char** argv) {
+    int runs = argc > 1 ? atoi(argv[1]) : 2000;
+    unsigned int firstSeed = argc > 2 ? static_cast<unsigned int>(atoi(argv[2])) : 0;
+    int failures = 0;
+    for (unsigned int seed = firstSeed; seed < firstSeed + runs; seed++) {
+        Generator generator(seed);
+        Desc desc = generator.tree(3);
+        desc.kind = ItemKind::FLEX + generator.next(3);
+        // Most containers keep the sizes of their children.
+        std::vector<int> path;
+        std::vector<std::vector<int>> paths;
+        collectPaths(desc, path, paths);
+        for (const auto& itemPath : paths) {
+            Desc& target = descAt(desc, itemPath);
+            target.attributes.emplace_back(target.kind == ItemKind::ITEM ? 12 : 13, generator.next(20));
+        }
+        Items items;
+        Item* root = items.build(desc);
+        int width = 0;
+        int height = 0;
+        std::vector<std::pair<int, int>> sizes;
+        for (int step = 0; step < 10; step++) {
+            int rootMode = generator.next(2) == 0 ? Item::MeasureSpec::EXACTLY : Item::MeasureSpec::AT_MOST;
+            // A new size, an earlier one, or the size the root took with the other mode.
+            if (step == 0 || generator.next(2) == 0) {
+                width = 100 + generator.next(600);
+                height = 100 + generator.next(600);
+                sizes.emplace_back(width, height);
+            } else if (generator.next(2) == 0) {
+                width = sizes[generator.next(static_cast<int>(sizes.size()))].first;
+                height = sizes[generator.next(static_cast<int>(sizes.size()))].second;
+            }
+            if (step > 0 && generator.next(3) == 0) {
+                // The sizes kept from the earlier sizes don't hold anymore for the changed subtree.
+                path = paths[generator.next(static_cast<int>(paths.size()))];
+                Desc& target = descAt(desc, path);
+                int attribute = generator.next(ATTRIBUTE_COUNT);
+                int value = generator.next(20);
+                applyAttribute(itemAt(root, path), target.kind, attribute, value);
+                target.attributes.emplace_back(attribute, value);
+            }
+            int widthMeasureSpec = Item::MeasureSpec::makeMeasureSpec(width, rootMode);
+            int heightMeasureSpec = Item::MeasureSpec::makeMeasureSpec(height, rootMode);
+            layoutRoot(root, widthMeasureSpec, heightMeasureSpec);
+            width = root->getMeasuredWidth();
+            height = root->getMeasuredHeight();
+            int result = compareWithReference(root, desc, widthMeasureSpec, heightMeasureSpec);
+            if (result < 0) {
+                break;
+            }
+            if (result == 0) {
+                printf("seed %u: the frames differ after resize %d\n", seed, step);
+                failures++;
+                break;
+            }
+        }
+    }
+    printf("%d/%d runs differ\n", failures, runs);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
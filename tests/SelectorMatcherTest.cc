@@ -0,0 +1,433 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+#include "RandomTree.h"
+#include "SelectorMatcher.h"
+
+static const char* const TYPES[] = {"view", "text", "image"};
+static const char* const IDS[] = {"a", "b", "c"};
+static const char* const CLASSES[] = {"x", "y", "z", "w"};
+static const char* const PSEUDO_CLASSES[] = {"active", "focus"};
+static const char* const ATTRIBUTES[] = {"role", "lang"};
+static const char* const VALUES[] = {"en", "en-us", "tab", "tab bar", "bar"};
+static const char* const OPERATORS[] = {"", "=", "~=", "|=", "^=", "$=", "*="};
+static const char* const DECLARATIONS[] = {"width", "height", "margin-left", "padding-top", "flex-grow"};
+
+template<typename T, size_t N>
+static const char* pick(Generator& generator, T (&names)[N]) {
+    return names[generator.next(N)];
+}
+
+/**
+ * A simple selector as generated: kind is one of '*' (universal), 't' (type), '#', '.', ':'
+ * and '[', op being one of the OPERATORS for an attribute.
+ */
+struct Simple {
+    char kind;
+    std::string name;
+    std::string op;
+    std::string value;
+};
+
+struct Compound {
+    std::vector<Simple> selectors;
+    /** How this compound relates to the compound on its left: ' ', '>' or '+' */
+    char combinator;
+};
+
+struct Selector {
+    /** From left to right */
+    std::vector<Compound> compounds;
+    std::string text;
+    int specificity;
+};
+
+static Selector generateSelector(Generator& generator) {
+    Selector selector;
+    selector.specificity = 0;
+    for (int i = 1 + generator.next(3); i > 0; i--) {
+        Compound compound;
+        compound.combinator = " >+"[generator.next(3)];
+        int head = generator.next(3);
+        if (head == 1) {
+            compound.selectors.push_back({'t', pick(generator, TYPES), "", ""});
+        } else if (head == 2) {
+            compound.selectors.push_back({'*', "", "", ""});
+        }
+        for (int j = generator.next(3); j > 0 || compound.selectors.empty(); j--) {
+            switch (generator.next(4)) {
+                case 0:
+                    compound.selectors.push_back({'#', pick(generator, IDS), "", ""});
+                    break;
+                case 1:
+                    compound.selectors.push_back({'.', pick(generator, CLASSES), "", ""});
+                    break;
+                case 2:
+                    compound.selectors.push_back({':', pick(generator, PSEUDO_CLASSES), "", ""});
+                    break;
+                default:
+                    compound.selectors.push_back({'[', pick(generator, ATTRIBUTES), pick(generator, OPERATORS),
+                                                  pick(generator, VALUES)});
+                    break;
+            }
+        }
+        if (!selector.compounds.empty()) {
+            selector.text += compound.combinator == ' ' ? " " : std::string(" ") + compound.combinator + " ";
+        }
+        for (const Simple& simple : compound.selectors) {
+            if (simple.kind == '*') {
+                selector.text += "*";
+            } else if (simple.kind == 't') {
+                selector.text += simple.name;
+                selector.specificity += 1;
+            } else if (simple.kind == '[') {
+                std::string test = simple.op.empty() ? "" : simple.op + "'" + simple.value + "'";
+                selector.text += "[" + simple.name + test + "]";
+                selector.specificity += 0x100;
+            } else {
+                selector.text += simple.kind + simple.name;
+                selector.specificity += simple.kind == '#' ? 0x10000 : 0x100;
+            }
+        }
+        selector.compounds.push_back(std::move(compound));
+    }
+    return selector;
+}
+
+/**
+ * The names of the atoms of the elements, as generated.
+ */
+struct Names {
+    std::string type;
+    std::string id;
+    std::vector<std::string> classes;
+    std::vector<std::string> pseudoClasses;
+    std::vector<std::pair<std::string, std::string>> attributes;
+};
+
+static bool matchesAttribute(const Simple& simple, const std::string& value) {
+    const std::string& expected = simple.value;
+    if (simple.op.empty()) {
+        return true;
+    } else if (simple.op == "=") {
+        return value == expected;
+    } else if (simple.op == "~=") {
+        std::vector<std::string> words;
+        std::string word;
+        for (char c : value + " ") {
+            if (c == ' ') {
+                words.push_back(word);
+                word.clear();
+            } else {
+                word += c;
+            }
+        }
+        return std::find(words.begin(), words.end(), expected) != words.end();
+    } else if (simple.op == "|=") {
+        return value == expected || value.find(expected + "-") == 0;
+    } else if (simple.op == "^=") {
+        return value.find(expected) == 0;
+    } else if (simple.op == "$=") {
+        return value.size() >= expected.size() && value.substr(value.size() - expected.size()) == expected;
+    }
+    return value.find(expected) != std::string::npos;
+}
+
+static bool matchesCompound(const Compound& compound, const Names& names) {
+    for (const Simple& simple : compound.selectors) {
+        bool matched = true;
+        switch (simple.kind) {
+            case 't':
+                matched = names.type == simple.name;
+                break;
+            case '#':
+                matched = names.id == simple.name;
+                break;
+            case '.':
+                matched = std::count(names.classes.begin(), names.classes.end(), simple.name) != 0;
+                break;
+            case ':':
+                matched = std::count(names.pseudoClasses.begin(), names.pseudoClasses.end(), simple.name) != 0;
+                break;
+            case '[':
+                matched = false;
+                for (const auto& attribute : names.attributes) {
+                    if (attribute.first == simple.name) {
+                        matched = matchesAttribute(simple, attribute.second);
+                    }
+                }
+                break;
+            default:
+                break;
+        }
+        if (!matched) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * The elements of a tree with their names, indexed in pre-order.
+ */
+struct Tree {
+    std::vector<std::unique_ptr<StyleElement>> elements;
+    std::vector<Names> names;
+    std::vector<int> parents;
+    std::vector<int> previousSiblings;
+    /** The number of elements with the names of their previous sibling, in another order */
+    int copiedSiblings = 0;
+};
+
+/**
+ * Matches the compounds of the selector from the given one leftwards, walking up the tree.
+ */
+static bool matchesNaively(const Selector& selector, int compound, const Tree& tree, int element) {
+    if (!matchesCompound(selector.compounds[compound], tree.names[element])) {
+        return false;
+    }
+    if (compound == 0) {
+        return true;
+    }
+    switch (selector.compounds[compound].combinator) {
+        case '>':
+            return tree.parents[element] >= 0 && matchesNaively(selector, compound - 1, tree, tree.parents[element]);
+        case '+':
+            return tree.previousSiblings[element] >= 0
+                   && matchesNaively(selector, compound - 1, tree, tree.previousSiblings[element]);
+        default:
+            for (int ancestor = tree.parents[element]; ancestor >= 0; ancestor = tree.parents[ancestor]) {
+                if (matchesNaively(selector, compound - 1, tree, ancestor)) {
+                    return true;
+                }
+            }
+            return false;
+    }
+}
+
+static void generateNames(Generator& generator, Names& names) {
+    names.type = generator.next(5) == 0 ? "" : pick(generator, TYPES);
+    names.id = generator.next(3) == 0 ? pick(generator, IDS) : "";
+    names.classes.clear();
+    for (int i = generator.next(3); i > 0; i--) {
+        std::string cssClass = pick(generator, CLASSES);
+        if (std::count(names.classes.begin(), names.classes.end(), cssClass) == 0) {
+            names.classes.push_back(cssClass);
+        }
+    }
+    names.pseudoClasses.clear();
+    if (generator.next(4) == 0) {
+        names.pseudoClasses.push_back(pick(generator, PSEUDO_CLASSES));
+    }
+    names.attributes.clear();
+    for (int i = generator.next(3); i > 0; i--) {
+        std::string name = pick(generator, ATTRIBUTES);
+        if (names.attributes.empty() || names.attributes[0].first != name) {
+            names.attributes.emplace_back(name, pick(generator, VALUES));
+        }
+    }
+}
+
+static void setNames(StyleElement* element, const Names& names, AtomTable& atoms) {
+    element->setType(names.type.empty() ? AtomTable::NONE : atoms.intern(names.type));
+    element->setId(names.id.empty() ? AtomTable::NONE : atoms.intern(names.id));
+    element->clearClasses();
+    for (const std::string& cssClass : names.classes) {
+        element->addClass(atoms.intern(cssClass));
+    }
+    for (const char* pseudoClass : PSEUDO_CLASSES) {
+        element->removePseudoClass(atoms.intern(pseudoClass));
+    }
+    for (const std::string& pseudoClass : names.pseudoClasses) {
+        element->addPseudoClass(atoms.intern(pseudoClass));
+    }
+    for (const auto& attribute : names.attributes) {
+        element->setAttribute(atoms.intern(attribute.first), attribute.second);
+    }
+}
+
+static void generateTree(Generator& generator, Tree& tree, AtomTable& atoms, int parent, int depth) {
+    int index = static_cast<int>(tree.elements.size());
+    tree.elements.emplace_back(new StyleElement());
+    tree.names.emplace_back();
+    tree.parents.push_back(parent);
+    tree.previousSiblings.push_back(-1);
+    // The previous sibling is the closest preceding element with the same parent.
+    for (int i = index - 1; i > parent && parent >= 0; i--) {
+        if (tree.parents[i] == parent) {
+            tree.previousSiblings[index] = i;
+            break;
+        }
+    }
+    int previous = tree.previousSiblings[index];
+    if (previous >= 0 && generator.next(3) == 0) {
+        // As the items of a list, whose classes and attributes may be added in another order.
+        Names names = tree.names[previous];
+        std::reverse(names.classes.begin(), names.classes.end());
+        std::reverse(names.attributes.begin(), names.attributes.end());
+        tree.names[index] = names;
+        tree.copiedSiblings++;
+    } else {
+        generateNames(generator, tree.names[index]);
+    }
+    setNames(tree.elements[index].get(), tree.names[index], atoms);
+    if (parent >= 0) {
+        tree.elements[parent]->addChild(tree.elements[index].get());
+    }
+    if (depth > 0) {
+        for (int i = generator.next(5); i > 0; i--) {
+            generateTree(generator, tree, atoms, index, depth - 1);
+        }
+    }
+}
+
+/**
+ * Matches random selectors against random trees of elements with SelectorMatcher, resolving
+ * whole trees with the ancestor filter and the style sharing of the siblings, then single
+ * elements, and compares the computed styles with the cascade of the selectors matched by
+ * walking up the tree. The trees are resolved again without sharing, which must give the same
+ * styles, and the siblings with the same names in another order must have shared theirs unless
+ * a selector has a next-sibling combinator. The elements then change their names and subtrees
+ * are resolved again.
+ *
+ * Usage: SelectorMatcherTest [runs [first seed]]
+ */
+int main(int argc, char** argv) {
+    int runs = argc > 1 ? atoi(argv[1]) : 2000;
+    unsigned int firstSeed = argc > 2 ? static_cast<unsigned int>(atoi(argv[2])) : 0;
+    int failures = 0;
+    for (unsigned int seed = firstSeed; seed < firstSeed + runs; seed++) {
+        Generator generator(seed);
+        // Each rule sets one property, to a value telling the rules apart.
+        std::vector<Selector> selectors;
+        std::vector<int> selectorRules;
+        std::string ast = R"({"type": "stylesheet", "stylesheet": {"rules": [)";
+        int ruleCount = 1 + generator.next(12);
+        for (int rule = 0; rule < ruleCount; rule++) {
+            ast += rule > 0 ? ", " : "";
+            ast += R"({"type": "rule", "selectors": [)";
+            for (int i = 1 + generator.next(2); i > 0; i--) {
+                selectors.push_back(generateSelector(generator));
+                selectorRules.push_back(rule);
+                ast += (ast.back() != '[' ? ", \"" : "\"") + selectors.back().text + "\"";
+            }
+            ast += R"(], "declarations": [{"type": "declaration", "property": ")";
+            ast += pick(generator, DECLARATIONS);
+            ast += R"(", "value": ")" + std::to_string(rule + 1) + R"("}]})";
+        }
+        ast += "]}}";
+        ItemStylePool pool;
+        StyleSheet sheet(&pool);
+        sheet.load(ast);
+        AtomTable atoms;
+        SelectorMatcher matcher(sheet, &atoms, &pool);
+        if (matcher.getSelectorCount() != selectors.size()) {
+            printf("seed %u: %zu of %zu selectors parsed\n", seed, matcher.getSelectorCount(), selectors.size());
+            failures++;
+            continue;
+        }
+
+        Tree tree;
+        generateTree(generator, tree, atoms, -1, 3);
+        auto expectedStyle = [&](int element) {
+            std::vector<int> matched;
+            for (size_t i = 0; i < selectors.size(); i++) {
+                if (matchesNaively(selectors[i], static_cast<int>(selectors[i].compounds.size()) - 1, tree, element)) {
+                    matched.push_back(static_cast<int>(i));
+                }
+            }
+            std::stable_sort(matched.begin(), matched.end(), [&selectors](int a, int b) {
+                return selectors[a].specificity < selectors[b].specificity;
+            });
+            ItemStyle style;
+            for (int selector : matched) {
+                style.merge(*sheet.getRules()[selectorRules[selector]].style);
+            }
+            return style;
+        };
+        auto check = [&](int first, int end, const char* pass) {
+            for (int element = first; element < end; element++) {
+                ItemStyle expected = expectedStyle(element);
+                const ItemStyle* resolved = tree.elements[element]->getStyle();
+                if (resolved == nullptr || !(*resolved == expected)) {
+                    printf("seed %u: the %s style of element %d differs\n", seed, pass, element);
+                    return false;
+                }
+                if (!(*matcher.match(*tree.elements[element]) == expected)) {
+                    printf("seed %u: the matched style of element %d differs\n", seed, element);
+                    return false;
+                }
+            }
+            return true;
+        };
+
+        matcher.resolve(tree.elements[0].get());
+        bool passed = check(0, static_cast<int>(tree.elements.size()), "resolved");
+
+        // The same styles without sharing, none being shared with a next-sibling combinator.
+        bool hasSiblingSelectors = std::any_of(selectors.begin(), selectors.end(), [](const Selector& selector) {
+            return selector.text.find(" + ") != std::string::npos;
+        });
+        size_t sharedCount = matcher.getSharedStyleCount();
+        auto copiedCount = static_cast<size_t>(tree.copiedSiblings);
+        if (passed && (hasSiblingSelectors ? sharedCount != 0 : sharedCount < copiedCount)) {
+            printf("seed %u: %zu styles shared for %zu copied siblings\n", seed, sharedCount, copiedCount);
+            passed = false;
+        }
+        std::vector<const ItemStyle*> shared;
+        for (auto& element : tree.elements) {
+            shared.push_back(element->getStyle());
+        }
+        SelectorMatcher unshared(sheet, &atoms, &pool);
+        unshared.setStyleSharing(false);
+        unshared.resolve(tree.elements[0].get());
+        for (size_t element = 0; element < tree.elements.size() && passed; element++) {
+            if (tree.elements[element]->getStyle() != shared[element]) {
+                printf("seed %u: the shared style of element %zu differs from the one matched\n", seed, element);
+                passed = false;
+            }
+        }
+        for (int step = 0; step < 5 && passed; step++) {
+            // A subtree is a range of the pre-order.
+            int root = generator.next(static_cast<int>(tree.elements.size()));
+            int end = root + 1;
+            while (end < static_cast<int>(tree.elements.size()) && tree.parents[end] >= root) {
+                end++;
+            }
+            for (int i = generator.next(3); i >= 0; i--) {
+                int element = root + generator.next(end - root);
+                Names& names = tree.names[element];
+                std::vector<std::pair<std::string, std::string>> attributes = names.attributes;
+                generateNames(generator, names);
+                // An attribute can't be removed from an element, those set before get new values.
+                for (auto& attribute : attributes) {
+                    auto it = std::find_if(names.attributes.begin(), names.attributes.end(),
+                                           [&attribute](const std::pair<std::string, std::string>& other) {
+                                               return other.first == attribute.first;
+                                           });
+                    if (it == names.attributes.end()) {
+                        names.attributes.emplace_back(attribute.first, pick(generator, VALUES));
+                    }
+                }
+                setNames(tree.elements[element].get(), names, atoms);
+            }
+            matcher.resolve(tree.elements[root].get());
+            passed = check(root, end, "restyled");
+        }
+        if (!passed) {
+            failures++;
+        }
+    }
+    printf("%d/%d runs differ\n", failures, runs);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
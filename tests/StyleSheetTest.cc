@@ -0,0 +1,222 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "FlexLayout.h"
+#include "RandomTree.h"
+#include "SelectorMatcher.h"
+#include "TreeFormat.h"
+
+/**
+ * A declaration and the properties it compiles to, none if it must be rejected.
+ */
+struct Compiled {
+    const char* property;
+    const char* value;
+    std::vector<std::pair<int, double>> properties;
+};
+
+static const Compiled COMPILED[] = {
+        {"width", "50%", {{ItemStyle::WIDTH, Item::LayoutParams::MATCH_PARENT}, {ItemStyle::WIDTH_PERCENT, 0.5}}},
+        {"width", "auto", {{ItemStyle::WIDTH, Item::LayoutParams::WRAP_CONTENT}, {ItemStyle::WIDTH_PERCENT, 1}}},
+        // Exact beyond the 24 bits of a float.
+        {"height", "16777217px", {{ItemStyle::HEIGHT, 16777217}, {ItemStyle::HEIGHT_PERCENT, 1}}},
+        {"max-width", "2147483647", {{ItemStyle::MAX_WIDTH, 2147483647}}},
+        {"max-width", "2147483648", {}},
+        {"width", "-1", {}},
+        {"width", "inf", {}},
+        {"width", "10em", {}},
+        {"margin", "1 2 3", {{ItemStyle::MARGIN_TOP, 1}, {ItemStyle::MARGIN_RIGHT, 2}, {ItemStyle::MARGIN_BOTTOM, 3},
+                             {ItemStyle::MARGIN_LEFT, 2}}},
+        {"margin-left", "-4.5px", {{ItemStyle::MARGIN_LEFT, -4}}},
+        {"padding", "1 2 3 4 5", {}},
+        {"order", "-3", {{ItemStyle::ORDER, -3}}},
+        {"order", "1.5", {}},
+        {"flex", "none", {{ItemStyle::FLEX_GROW, 0}, {ItemStyle::FLEX_SHRINK, 0},
+                          {ItemStyle::FLEX_BASIS_PERCENT, Item::FLEX_BASIS_PERCENT_DEFAULT},
+                          {ItemStyle::FLEX_BASIS, -1}}},
+        {"flex", "2", {{ItemStyle::FLEX_GROW, 2}, {ItemStyle::FLEX_SHRINK, 1}, {ItemStyle::FLEX_BASIS_PERCENT, 0},
+                       {ItemStyle::FLEX_BASIS, -1}}},
+        {"flex", "1 50px", {{ItemStyle::FLEX_GROW, 1}, {ItemStyle::FLEX_SHRINK, 1},
+                            {ItemStyle::FLEX_BASIS_PERCENT, Item::FLEX_BASIS_PERCENT_DEFAULT},
+                            {ItemStyle::FLEX_BASIS, 50}}},
+        {"flex", "0 0 50px", {{ItemStyle::FLEX_GROW, 0}, {ItemStyle::FLEX_SHRINK, 0},
+                              {ItemStyle::FLEX_BASIS_PERCENT, Item::FLEX_BASIS_PERCENT_DEFAULT},
+                              {ItemStyle::FLEX_BASIS, 50}}},
+        {"flex", "1 2 3 4", {}},
+        {"flex-grow", "-1", {}},
+        {"flex-direction", "column", {{ItemStyle::FLEX_DIRECTION, FlexDirection::COLUMN}}},
+        {"visibility", "collapse", {{ItemStyle::VISIBILITY, Item::GONE}}},
+        {"color", "red", {}},
+};
+
+/**
+ * Values of a member the reader skips, valid and malformed ones.
+ */
+static const char* const SKIPPED_VALUES[] = {"-1.5e3", "0", "true", "null", "[1, {\"a\": false}]", "\"\\u00e9\""};
+static const char* const MALFORMED_VALUES[] = {"0x10", "+1", "inf", "nan", "01", "1.", "-", "tru", "1e", "{"};
+
+static std::string document(const std::string& position, const std::string& property) {
+    return R"({"type": "stylesheet", "stylesheet": {"rules": [{"type": "rule", "selectors": [".a"],)"
+           R"( "declarations": [{"type": "declaration", "property": ")" + property
+           + R"(", "value": "1", "position": )" + position + "}]}]}}";
+}
+
+static const char* const DECLARATIONS[][2] = {
+        {"width", "120"}, {"width", "50%"}, {"width", "auto"}, {"height", "80px"}, {"height", "25%"},
+        {"flex", "1 50px"}, {"flex", "0 0 40px"}, {"flex", "2"}, {"flex", "none"}, {"flex", "1 30%"},
+        {"flex-basis", "20px"}, {"flex-basis", "auto"}, {"flex-direction", "row"}, {"flex-direction", "column"},
+        {"flex-direction", "row-reverse"}, {"flex-direction", "column-reverse"}, {"margin", "1 2"},
+        {"padding", "3"}, {"min-width", "10"}, {"max-height", "none"}, {"flex-wrap", "wrap"}};
+
+static constexpr int CLASS_COUNT = 8;
+
+static void setClasses(Generator& generator, StyleElement& element, AtomTable& atoms) {
+    element.clearClasses();
+    for (int i = 0; i < CLASS_COUNT; i++) {
+        if (generator.next(3) == 0) {
+            element.addClass(atoms.intern("c" + std::to_string(i)));
+        }
+    }
+}
+
+static std::vector<char> recordOf(Item* item) {
+    TreeFormat::NodeRecord record;
+    TreeFormat::writeRecord(item, record);
+    record.childCount = 0;
+    auto begin = reinterpret_cast<const char*>(&record);
+    return std::vector<char>(begin, begin + sizeof(record));
+}
+
+/**
+ * Compiles declarations to known properties, and loads documents whose skipped values are valid
+ * or not, a malformed one leaving the rules as they were. Then restyles a random container and
+ * its child step by step with a {@link SelectorMatcher}, changing the direction of the container
+ * and the flex bases of the child among others: the items must be left as the styles resolved
+ * set new items.
+ *
+ * Usage: StyleSheetTest [runs [first seed]]
+ */
+int main(int argc, char** argv) {
+    int runs = argc > 1 ? atoi(argv[1]) : 1000;
+    unsigned int firstSeed = argc > 2 ? static_cast<unsigned int>(atoi(argv[2])) : 0;
+    int failures = 0;
+    for (const Compiled& compiled : COMPILED) {
+        ItemStyle style;
+        ItemStyle expected;
+        for (const auto& property : compiled.properties) {
+            if (ItemStyle::isFloat(property.first)) {
+                expected.setFloat(property.first, static_cast<float>(property.second));
+            } else {
+                expected.setInt(property.first, static_cast<int>(property.second));
+            }
+        }
+        if (style.compile(compiled.property, compiled.value) != !compiled.properties.empty()
+            || !(style == expected)) {
+            printf("%s: %s isn't compiled as expected\n", compiled.property, compiled.value);
+            failures++;
+        }
+    }
+    ItemStylePool pool;
+    StyleSheet sheet(&pool);
+    for (const char* value : SKIPPED_VALUES) {
+        size_t ruleCount = sheet.getRules().size();
+        try {
+            // The properties are lowercased.
+            sheet.load(document(value, "WIDTH"));
+        } catch (const std::invalid_argument& e) {
+            printf("the value %s isn't skipped: %s\n", value, e.what());
+            failures++;
+            continue;
+        }
+        if (sheet.getRules().size() != ruleCount + 1) {
+            printf("the rule of the document with %s isn't loaded\n", value);
+            failures++;
+        }
+    }
+    // Bytes of multibyte characters, which aren't lowercased, in a property the rule drops.
+    size_t loaded = sheet.getRules().size();
+    sheet.load(document("0", "\xc3\x89WIDTH\xff"));
+    if (sheet.getRules().size() != loaded) {
+        printf("a rule without layout declarations is loaded\n");
+        failures++;
+    }
+    for (const char* value : MALFORMED_VALUES) {
+        size_t ruleCount = sheet.getRules().size();
+        try {
+            sheet.load(document(value, "width"));
+            printf("the malformed value %s is skipped\n", value);
+            failures++;
+        } catch (const std::invalid_argument&) {
+            if (sheet.getRules().size() != ruleCount) {
+                printf("the malformed value %s changes the rules\n", value);
+                failures++;
+            }
+        }
+    }
+
+    for (unsigned int seed = firstSeed; seed < firstSeed + runs; seed++) {
+        Generator generator(seed);
+        std::string ast = R"({"type": "stylesheet", "stylesheet": {"rules": [)";
+        for (int rule = 0; rule < CLASS_COUNT; rule++) {
+            ast += rule > 0 ? ", " : "";
+            ast += R"({"type": "rule", "selectors": [".c)" + std::to_string(rule) + R"("], "declarations": [)";
+            for (int i = 1 + generator.next(2); i > 0; i--) {
+                const char* const* declaration = DECLARATIONS[generator.next(sizeof(DECLARATIONS)
+                                                                             / sizeof(DECLARATIONS[0]))];
+                ast += ast.back() == '[' ? "" : ", ";
+                ast += R"({"type": "declaration", "property": ")" + std::string(declaration[0])
+                       + R"(", "value": ")" + declaration[1] + R"("})";
+            }
+            ast += "]}";
+        }
+        ast += "]}}";
+        ItemStylePool stylePool;
+        StyleSheet styleSheet(&stylePool);
+        styleSheet.load(ast);
+        AtomTable atoms;
+        SelectorMatcher matcher(styleSheet, &atoms, &stylePool);
+
+        FlexLayout container;
+        FlexLayout item;
+        container.addItem(&item);
+        StyleElement containerElement(&container);
+        StyleElement itemElement(&item);
+        containerElement.addChild(&itemElement);
+        bool failed = false;
+        for (int step = 0; step < 20 && !failed; step++) {
+            if (step == 0 || generator.next(2) == 0) {
+                setClasses(generator, containerElement, atoms);
+            }
+            if (step == 0 || generator.next(2) == 0) {
+                setClasses(generator, itemElement, atoms);
+            }
+            matcher.resolve(&containerElement);
+
+            FlexLayout expectedContainer;
+            FlexLayout expectedItem;
+            containerElement.getStyle()->apply(&expectedContainer);
+            expectedContainer.addItem(&expectedItem);
+            itemElement.getStyle()->apply(&expectedItem);
+            if (recordOf(&container) != recordOf(&expectedContainer) || recordOf(&item) != recordOf(&expectedItem)) {
+                printf("seed %u: the items differ from new ones at step %d\n", seed, step);
+                failed = true;
+            }
+            expectedContainer.removeAllItems();
+        }
+        container.removeAllItems();
+        if (failed) {
+            failures++;
+        }
+    }
+    printf("%d/%d runs differ\n", failures, runs);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
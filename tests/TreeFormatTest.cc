@@ -0,0 +1,153 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include "ItemArena.h"
+#include "RandomTree.h"
+#include "TreeFormat.h"
+
+/**
+ * Removes the measure functions from a tree description, the format doesn't hold them.
+ */
+static void withoutTexts(Desc& desc) {
+    auto& attributes = desc.attributes;
+    attributes.erase(std::remove_if(attributes.begin(), attributes.end(),
+                                    [](const std::pair<int, int>& attribute) { return attribute.first == 12; }),
+                     attributes.end());
+    for (auto& child : desc.children) {
+        withoutTexts(child);
+    }
+}
+
+/**
+ * Destroys a tree read without an arena, whose items have each been allocated with new.
+ */
+static void deleteTree(Item* item) {
+    if (Layout* layout = dynamic_cast<Layout*>(item)) {
+        while (layout->getChildCount() > 0) {
+            Item* child = layout->getChildAt(0);
+            layout->removeItemAt(0);
+            deleteTree(child);
+        }
+    }
+    delete item;
+}
+
+/**
+ * Returns whether reading the bytes is rejected with std::invalid_argument. A tree which is read
+ * is laid out, which must not fail either.
+ */
+static bool isRejected(const std::vector<char>& bytes) {
+    ItemArena arena;
+    Item* root;
+    try {
+        root = TreeFormat::read(bytes.data(), bytes.size(), &arena);
+    } catch (const std::invalid_argument&) {
+        return true;
+    }
+    layoutRoot(root, Item::MeasureSpec::makeMeasureSpec(500, Item::MeasureSpec::EXACTLY),
+               Item::MeasureSpec::makeMeasureSpec(500, Item::MeasureSpec::AT_MOST));
+    return false;
+}
+
+/**
+ * Writes random trees without texts, reads them back and checks that they are written again with
+ * the same bytes and laid out with the same frames. Then corrupts the files: a file whose records
+ * hold values out of range must be rejected, and one with random bytes changed must be rejected
+ * or read into a tree which can be laid out.
+ *
+ * Usage: TreeFormatTest [runs [first seed]]
+ */
+int main(int argc, char** argv) {
+    int runs = argc > 1 ? atoi(argv[1]) : 2000;
+    unsigned int firstSeed = argc > 2 ? static_cast<unsigned int>(atoi(argv[2])) : 0;
+    int failures = 0;
+    for (unsigned int seed = firstSeed; seed < firstSeed + runs; seed++) {
+        Generator generator(seed);
+        Desc desc = generator.tree(3);
+        withoutTexts(desc);
+        Items items(false);
+        Item* root = items.build(desc);
+        std::vector<char> bytes = TreeFormat::write(root);
+
+        bool withArena = generator.next(2) == 0;
+        ItemArena arena;
+        Item* copy = TreeFormat::read(bytes.data(), bytes.size(), withArena ? &arena : nullptr);
+        int widthMeasureSpec = Item::MeasureSpec::makeMeasureSpec(100 + generator.next(600),
+                                                                  Item::MeasureSpec::EXACTLY);
+        int heightMeasureSpec = Item::MeasureSpec::makeMeasureSpec(100 + generator.next(600),
+                                                                   Item::MeasureSpec::AT_MOST);
+        layoutRoot(root, widthMeasureSpec, heightMeasureSpec);
+        layoutRoot(copy, widthMeasureSpec, heightMeasureSpec);
+        std::vector<int> expected;
+        std::vector<int> actual;
+        collectFrames(root, expected);
+        collectFrames(copy, actual);
+        bool failed = false;
+        if (TreeFormat::write(copy) != bytes) {
+            printf("seed %u: the tree read is written with other bytes\n", seed);
+            failed = true;
+        } else if (actual != expected) {
+            printf("seed %u: the tree read is laid out with other frames\n", seed);
+            failed = true;
+        }
+        if (!withArena) {
+            deleteTree(copy);
+        }
+
+        // A field of a random record out of its range.
+        auto header = reinterpret_cast<const TreeFormat::Header*>(bytes.data());
+        std::vector<char> corrupted(bytes);
+        size_t offset = sizeof(TreeFormat::Header)
+                        + generator.next(static_cast<int>(header->nodeCount)) * sizeof(TreeFormat::NodeRecord);
+        auto record = reinterpret_cast<TreeFormat::NodeRecord*>(corrupted.data() + offset);
+        switch (generator.next(6)) {
+            case 0:
+                record->marginLeft = INT_MIN;
+                break;
+            case 1:
+                record->paddingBottom = INT_MIN;
+                break;
+            case 2:
+                record->width = -3;
+                break;
+            case 3:
+                record->alignSelf = 5;
+                break;
+            case 4:
+                record->visibility = 3;
+                break;
+            default:
+                record->type = 4;
+                break;
+        }
+        if (!failed && !isRejected(corrupted)) {
+            printf("seed %u: a record out of range is read\n", seed);
+            failed = true;
+        }
+
+        // Random bytes changed, or a truncated file.
+        corrupted = bytes;
+        for (int i = 1 + generator.next(4); i > 0; i--) {
+            corrupted[generator.next(static_cast<int>(corrupted.size()))] = static_cast<char>(generator.next(256));
+        }
+        if (generator.next(4) == 0) {
+            corrupted.resize(generator.next(static_cast<int>(corrupted.size())));
+        }
+        isRejected(corrupted);
+        if (failed) {
+            failures++;
+        }
+    }
+    printf("%d/%d runs differ\n", failures, runs);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,144 @@
+/*
+ * Copyright 2021 BaiQiang
+ *
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <vector>
+#include "RandomTree.h"
+
+/**
+ * A LinearLayout which always measures with the generic two passes.
+ */
+struct GenericLinearLayout : LinearLayout {
+    bool vertical = false;
+
+    void onMeasure(int widthMeasureSpec, int heightMeasureSpec) override {
+        if (vertical) {
+            measureVertical(widthMeasureSpec, heightMeasureSpec);
+        } else {
+            measureHorizontal(widthMeasureSpec, heightMeasureSpec);
+        }
+    }
+};
+
+/**
+ * Builds a random tree of LinearLayouts, most of whose weighted children have no size along the
+ * main axis so that they can be measured in one pass. The same seed builds the same tree.
+ */
+static Item* build(std::mt19937& random, bool generic, int depth, std::vector<std::unique_ptr<Item>>& items,
+                   bool vertical = false) {
+    bool container = depth > 0 && random() % 3 != 0;
+    Item* item;
+    bool itemVertical = random() % 2 == 0;
+    if (!container) {
+        item = new Item();
+    } else if (generic) {
+        auto linearLayout = new GenericLinearLayout();
+        linearLayout->vertical = itemVertical;
+        item = linearLayout;
+    } else {
+        item = new LinearLayout();
+    }
+    items.emplace_back(item);
+    int sizes[] = {Item::LayoutParams::WRAP_CONTENT, Item::LayoutParams::MATCH_PARENT, 0,
+                   static_cast<int>(10 + random() % 150)};
+    int width = sizes[random() % 4];
+    int height = sizes[random() % 4];
+    item->setWidth(width);
+    item->setHeight(height);
+    if (random() % 2 == 0) {
+        item->setWeight(static_cast<float>(1 + random() % 3));
+        // Most weighted children only take a share of the excess space.
+        if (random() % 5 != 0) {
+            if (vertical) {
+                item->setHeight(0);
+            } else {
+                item->setWidth(0);
+            }
+        }
+    }
+    if (random() % 3 == 0) {
+        item->setMargins(static_cast<int>(random() % 10), static_cast<int>(random() % 10),
+                         static_cast<int>(random() % 10), static_cast<int>(random() % 10));
+    }
+    if (random() % 4 == 0) {
+        item->setMinWidth(static_cast<int>(random() % 80));
+        item->setMinHeight(static_cast<int>(random() % 80));
+    }
+    if (random() % 8 == 0) {
+        item->setVisibility(Item::GONE);
+    }
+    if (!container) {
+        if (random() % 2 == 0) {
+            item->setMeasureFunction(measureText(static_cast<int>(1 + random() % 20)));
+        }
+        return item;
+    }
+    auto linearLayout = static_cast<LinearLayout*>(item);
+    linearLayout->setOrientation(itemVertical ? LinearLayout::VERTICAL : LinearLayout::HORIZONTAL);
+    linearLayout->setPadding(static_cast<int>(random() % 10), static_cast<int>(random() % 10),
+                             static_cast<int>(random() % 10), static_cast<int>(random() % 10));
+    for (int i = static_cast<int>(random() % 6); i > 0; i--) {
+        linearLayout->addItem(build(random, generic, depth - 1, items, itemVertical));
+    }
+    return item;
+}
+
+/**
+ * Appends the measured sizes of the items of the tree in pre-order. The LinearLayout port only
+ * measures its children, it doesn't position them.
+ */
+static void collectMeasuredSizes(Item* item, std::vector<int>& sizes) {
+    sizes.push_back(item->getMeasuredWidth());
+    sizes.push_back(item->getMeasuredHeight());
+    if (Layout* layout = dynamic_cast<Layout*>(item)) {
+        for (int i = 0; i < layout->getChildCount(); i++) {
+            collectMeasuredSizes(layout->getChildAt(i), sizes);
+        }
+    }
+}
+
+/**
+ * Measures random trees of LinearLayouts, which take the one pass path for weighted children
+ * whenever they can, and compares the measured sizes with the same trees measured by the generic
+ * two passes.
+ *
+ * Usage: WeightsInOnePassTest [runs [first seed]]
+ */
+int main(int argc, char** argv) {
+    int runs = argc > 1 ? atoi(argv[1]) : 2000;
+    unsigned int firstSeed = argc > 2 ? static_cast<unsigned int>(atoi(argv[2])) : 0;
+    int failures = 0;
+    for (unsigned int seed = firstSeed; seed < firstSeed + runs; seed++) {
+        std::vector<std::unique_ptr<Item>> items;
+        std::mt19937 random(seed);
+        Item* root = build(random, false, 3, items);
+        std::mt19937 referenceRandom(seed);
+        Item* reference = build(referenceRandom, true, 3, items);
+        // Mostly exact, so that the root can measure its weighted children in one pass.
+        int widthMeasureSpec = Item::MeasureSpec::makeMeasureSpec(
+                100 + static_cast<int>(random() % 600),
+                random() % 4 != 0 ? Item::MeasureSpec::EXACTLY : Item::MeasureSpec::AT_MOST);
+        int heightMeasureSpec = Item::MeasureSpec::makeMeasureSpec(
+                100 + static_cast<int>(random() % 600),
+                random() % 4 != 0 ? Item::MeasureSpec::EXACTLY : Item::MeasureSpec::AT_MOST);
+        root->measure(widthMeasureSpec, heightMeasureSpec);
+        reference->measure(widthMeasureSpec, heightMeasureSpec);
+        std::vector<int> actual;
+        std::vector<int> expected;
+        collectMeasuredSizes(root, actual);
+        collectMeasuredSizes(reference, expected);
+        if (actual != expected) {
+            printf("seed %u: the measured sizes differ\n", seed);
+            failures++;
+        }
+    }
+    printf("%d/%d runs differ\n", failures, runs);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}